@@ -52,6 +52,11 @@ SOURCES += src/attrmap.cpp \
     src/useralerts.cpp \
     src/utils.cpp \
     src/logging.cpp \
+    src/metrics.cpp \
+    src/tracing.cpp \
+    src/asynclogging.cpp \
+    src/eventdispatcher.cpp \
+    src/streamingcache.cpp \
     src/waiterbase.cpp  \
     src/proxy.cpp \
     src/pendingcontactrequest.cpp \
@@ -425,6 +430,11 @@ HEADERS  += include/mega.h \
             include/mega/useralerts.h \
             include/mega/utils.h \
             include/mega/logging.h \
+            include/mega/metrics.h \
+            include/mega/tracing.h \
+            include/mega/asynclogging.h \
+            include/mega/eventdispatcher.h \
+            include/mega/streamingcache.h \
             include/mega/waiter.h \
             include/mega/proxy.h \
             include/mega/pendingcontactrequest.h \
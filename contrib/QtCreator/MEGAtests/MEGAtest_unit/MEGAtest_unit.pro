@@ -38,16 +38,23 @@ SOURCES += \
 ../../../../tests/unit/FileFingerprint_test.cpp \
 ../../../../tests/unit/File_test.cpp \
 ../../../../tests/unit/FsNode.cpp \
+../../../../tests/unit/JSON_test.cpp \
 ../../../../tests/unit/Logging_test.cpp \
 ../../../../tests/unit/main.cpp \
 ../../../../tests/unit/MediaProperties_test.cpp \
 ../../../../tests/unit/MegaApi_test.cpp \
+../../../../tests/unit/Metrics_test.cpp \
+../../../../tests/unit/Node_test.cpp \
 ../../../../tests/unit/PayCrypter_test.cpp \
 ../../../../tests/unit/PendingContactRequest_test.cpp \
 ../../../../tests/unit/Serialization_test.cpp \
 ../../../../tests/unit/Share_test.cpp \
 ../../../../tests/unit/Sync_test.cpp \
 ../../../../tests/unit/TextChat_test.cpp \
+../../../../tests/unit/Tracing_test.cpp \
+../../../../tests/unit/AsyncLogging_test.cpp \
+../../../../tests/unit/EventDispatcher_test.cpp \
+../../../../tests/unit/StreamingCache_test.cpp \
 ../../../../tests/unit/Transfer_test.cpp \
 ../../../../tests/unit/User_test.cpp \
 ../../../../tests/unit/utils.cpp \
@@ -0,0 +1,103 @@
+/**
+ * @file mega/asynclogging.h
+ * @brief Logger that moves log output off the logging threads
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_ASYNCLOGGING_H
+#define MEGA_ASYNCLOGGING_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mega/logging.h"
+
+namespace mega {
+
+// Logger for SimpleLogger::setOutputClass that never blocks the logging thread on log I/O.
+//
+// Each thread that logs gets its own single producer / single consumer ring buffer, so logging
+// only copies the message into it, without locks. A background thread drains the rings and
+// delivers the messages to the target Logger, or writes them to a file in a compact binary
+// format (see decode()). When a ring is full the message is dropped and counted; the number
+// of dropped messages is reported in the log once there is room again.
+class MEGA_API AsyncLogger : public Logger
+{
+public:
+    // ringSize is the buffer size of each logging thread, in bytes
+    explicit AsyncLogger(Logger* target, size_t ringSize = 256 * 1024);
+
+    // delivers whatever is still queued
+    ~AsyncLogger() override;
+
+    void log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+             , const char **directMessages = nullptr, size_t *directMessagesSizes = nullptr, unsigned numberMessages = 0
+#endif
+             ) override;
+
+    // write binary records to the file at path instead of delivering them to the target,
+    // or go back to the target if path is empty. Returns false if the file can't be created.
+    bool setBinaryOutput(const std::string& path);
+
+    // wait until every message logged before the call has been delivered
+    void flush();
+
+    // messages discarded so far because the ring of their thread was full
+    uint64_t dropped() const;
+
+    // convert a binary log written by this class to text lines; false if the input is not one
+    static bool decode(std::istream& in, std::ostream& out);
+
+private:
+    class Ring;
+    struct ThreadRing;
+
+    Logger* mTarget;
+    const size_t mRingSize;
+    const uint64_t mId;
+
+    std::mutex mRingsMutex;
+    std::vector<std::shared_ptr<Ring>> mRings;
+
+    // flusher thread state, protected by mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mFlushed;
+    bool mStop = false;
+    uint64_t mFlushRequested = 0;
+    uint64_t mFlushCompleted = 0;
+    std::ofstream mBinary;
+
+    std::atomic<uint64_t> mDropped{0};
+    std::thread mThread;
+
+    Ring* threadRing();
+    void run();
+    bool drain(std::string& scratch);
+    void deliver(const std::string& record);
+};
+
+} // namespace
+
+#endif
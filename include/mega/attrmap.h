@@ -27,7 +27,49 @@
 namespace mega {
 
 // maps attribute names to attribute values
-typedef map<nameid, string> attr_map;
+// Kept as a vector sorted by name, since nodes only have a few attributes: a tree would cost
+// an allocation and three pointers per attribute. Same interface as the std::map it replaces,
+// but inserting or erasing invalidates the iterators (and the addresses of the other values).
+class MEGA_API attr_map
+{
+public:
+    typedef nameid key_type;
+    typedef string mapped_type;
+    typedef pair<nameid, string> value_type;
+    typedef vector<value_type>::iterator iterator;
+    typedef vector<value_type>::const_iterator const_iterator;
+
+    attr_map() = default;
+    attr_map(std::initializer_list<value_type> values);
+    attr_map& operator=(std::initializer_list<value_type> values);
+
+    iterator begin() { return mValues.begin(); }
+    iterator end() { return mValues.end(); }
+    const_iterator begin() const { return mValues.begin(); }
+    const_iterator end() const { return mValues.end(); }
+
+    size_t size() const { return mValues.size(); }
+    bool empty() const { return mValues.empty(); }
+
+    iterator find(nameid name);
+    const_iterator find(nameid name) const;
+    size_t count(nameid name) const { return find(name) != end(); }
+
+    string& operator[](nameid name);
+    pair<iterator, bool> insert(const value_type& value);
+
+    iterator erase(const_iterator it) { return mValues.erase(it); }
+    size_t erase(nameid name);
+
+    void clear() { mValues.clear(); }
+    void swap(attr_map& other) { mValues.swap(other.mValues); }
+
+    bool operator==(const attr_map& other) const { return mValues == other.mValues; }
+    bool operator!=(const attr_map& other) const { return mValues != other.mValues; }
+
+private:
+    vector<value_type> mValues;
+};
 
 struct MEGA_API AttrMap
 {
@@ -68,6 +68,17 @@ public:
     // some commands are guaranteed to work if we query without specifying a SID (eg. gmf)
     bool suppressSID;
 
+    // read-only commands whose result doesn't depend on the ones queued before them,
+    // so they may be sent on a cs side channel (see RequestDispatcher) if there is one
+    bool orderIndependent;
+
+    // the API command name passed to cmd(), used to label the latency metrics
+    const char* commandName;
+
+    // id and queueing time of the command while tracing (see RequestTracer), 0 otherwise
+    uint64_t traceId;
+    std::chrono::steady_clock::time_point traceQueued;
+
     void cmd(const char*);
     void notself(MegaClient*);
     virtual void cancel(void);
@@ -587,9 +598,15 @@ class MEGA_API CommandPutNodes : public Command
     void removePendingDBRecordsAndTempFiles();
 
 public:
+    // if set, receives the result of PUTNODES_APP requests instead of MegaApp::putnodes_result()
+    typedef std::function<void(const Error&, targettype_t, vector<NewNode>&, bool targetOverride)> Completion;
+
     bool procresult(Result) override;
 
-    CommandPutNodes(MegaClient*, handle, const char*, vector<NewNode>&&, int, putsource_t = PUTNODES_APP, const char *cauth = NULL);
+    CommandPutNodes(MegaClient*, handle, const char*, vector<NewNode>&&, int, putsource_t = PUTNODES_APP, const char *cauth = NULL, Completion&& = nullptr);
+
+private:
+    Completion mResultFunction;
 };
 
 class MEGA_API CommandSetAttr : public Command
@@ -0,0 +1,122 @@
+/**
+ * @file mega/eventdispatcher.h
+ * @brief Delivery of listener callbacks on a dedicated thread
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_EVENTDISPATCHER_H
+#define MEGA_EVENTDISPATCHER_H 1
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace mega {
+
+// Runs listener callbacks on its own thread, in the order they were posted, so that the
+// thread posting them (the SDK thread) never waits for the listeners.
+//
+// Events about the same subject (eg. a transfer) that only report progress replace the
+// queued one, and are dropped if the queue is full; other events are never dropped.
+// Consecutive events of the same batch type (eg. node updates) are merged.
+class MEGA_API EventDispatcher
+{
+public:
+    struct Target
+    {
+        // identifies the listener for removeListener()
+        const void* listener;
+        std::function<void()> call;
+    };
+
+    struct Event
+    {
+        std::vector<Target> targets;
+
+        // 0: not about any particular subject
+        uint64_t subject = 0;
+        bool progress = false;
+
+        // 0: never merged. Otherwise mergeBatch(queued batch, this batch) merges them.
+        int batchType = 0;
+        std::shared_ptr<void> batch;
+        std::function<void(void* into, void* from)> mergeBatch;
+    };
+
+    // maxQueued: queue length from which progress events are dropped
+    explicit EventDispatcher(size_t maxQueued);
+
+    // delivers the events still queued
+    ~EventDispatcher();
+
+    void post(Event&& event);
+
+    // discard the queued callbacks of listener, and wait until it's not running any
+    // (unless called from one of them)
+    void removeListener(const void* listener);
+
+    // wait until the events posted before the call have been delivered
+    void flush();
+
+    bool onDispatcherThread() const;
+
+    void setMaxQueued(size_t maxQueued);
+
+    // nothing queued or being delivered
+    bool idle() const;
+
+    size_t pending() const;
+    uint64_t dropped() const;
+    uint64_t coalesced() const;
+
+private:
+    mutable std::mutex mMutex;
+    size_t mMaxQueued;
+    std::condition_variable mWake;
+    std::condition_variable mIdle;
+    std::deque<std::unique_ptr<Event>> mQueue;
+
+    // last queued event of each subject
+    std::map<uint64_t, Event*> mLastOfSubject;
+
+    // event being delivered, and listener running
+    std::unique_ptr<Event> mCurrent;
+    const void* mRunning = nullptr;
+
+    uint64_t mPosted = 0;
+    uint64_t mDelivered = 0;
+    uint64_t mDropped = 0;
+    uint64_t mCoalesced = 0;
+    bool mStop = false;
+
+    std::thread mThread;
+
+    void run();
+    static bool sameListeners(const Event& a, const Event& b);
+};
+
+} // namespace
+
+#endif
@@ -63,6 +63,17 @@ struct MEGA_API FileFingerprintCmp
     bool operator()(const FileFingerprint* a, const FileFingerprint* b) const;
 };
 
+// hashes and compares file fingerprints by exact size / mtime / sparse CRC (as FileFingerprintCmp)
+struct MEGA_API FileFingerprintHash
+{
+    size_t operator()(const FileFingerprint* f) const;
+};
+
+struct MEGA_API FileFingerprintEqual
+{
+    bool operator()(const FileFingerprint* a, const FileFingerprint* b) const;
+};
+
 bool operator==(const FileFingerprint& lhs, const FileFingerprint& rhs);
 
 // A light-weight fingerprint only based on size and mtime
@@ -207,6 +207,21 @@ struct MEGA_API HttpIO : public EventTrigger
     // get max upload speed
     virtual m_off_t getmaxuploadspeed();
 
+    // DNS cache in a form that can be persisted across runs (empty if not supported)
+    virtual string serializednscache() { return string(); }
+
+    // restore a persisted DNS cache; restored records are revalidated on first use
+    virtual void loaddnscache(const string&) { }
+
+    // resolve the hosts of the given URLs (and recently used hosts) ahead of their first request
+    virtual void prewarm(const vector<string>&) { }
+
+    // negotiate HTTP/2 and multiplex the requests to the same host (false if not supported)
+    virtual bool sethttp2(bool enable) { return !enable; }
+
+    // cap the simultaneous connections to a single host for one direction, 0 = no cap (false if not supported)
+    virtual bool setmaxhostconnections(direction_t, long) { return false; }
+
     HttpIO();
     virtual ~HttpIO() { }
 };
@@ -321,6 +336,9 @@ struct MEGA_API HttpReq
     // timestamp of last data sent or received
     dstime lastdata;
 
+    // when the request was last posted and when its first response byte arrived, for the latency metrics and tracing
+    std::chrono::steady_clock::time_point posttime, firstdatatime;
+
     // prevent raw data from being dumped in debug mode
     bool binary;
 
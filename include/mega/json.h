@@ -128,6 +128,41 @@ private:
     signed char mLevel;
 }; // JSONWriter
 
+// locates the complete elements of a JSON array whose text is still being received
+class MEGA_API JSONArrayScanner
+{
+public:
+    // scan the new part of data (which starts right after the opening bracket of the array
+    // or right after the last consumed prefix); returns the length of the prefix holding
+    // complete elements only (without the separator after the last one)
+    size_t scan(const char* data, size_t len);
+
+    // the caller dropped the first len bytes of data
+    void consume(size_t len);
+
+    // the closing bracket of the array has been scanned
+    bool ended() const { return mEnded; }
+
+    // number of complete elements found so far
+    size_t elements() const { return mElements; }
+
+    // offset of the last complete element
+    size_t laststart() const { return mLastStart; }
+
+    void reset();
+
+private:
+    size_t mPos = 0;
+    size_t mComplete = 0;
+    size_t mStart = 0;
+    size_t mLastStart = 0;
+    size_t mElements = 0;
+    int mDepth = 0;
+    bool mInString = false;
+    bool mEscape = false;
+    bool mEnded = false;
+};
+
 } // namespace
 
 #endif
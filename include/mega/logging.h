@@ -198,6 +198,7 @@ class SimpleLogger
     // actual output to the loggers is not synchronised (at least, not by this class)
     static std::mutex outputs_mutex;
     static OutputMap outputs;
+    static std::atomic<bool> outputsAdded; // so that statements skip the mutex while there are none
     static OutputStreams getOutput(enum LogLevel ll);
 #else
 
@@ -431,6 +432,11 @@ public:
         if (logger)
             logger->log(t.c_str(), level, fname.c_str(), ostr.str().c_str());
 
+        if (!outputsAdded.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
         ostr << std::endl;
 
         vec = getOutput(level);
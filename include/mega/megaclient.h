@@ -283,6 +283,9 @@ public:
     // process API requests and HTTP I/O
     void exec();
 
+    // publish queue depths and transfer buffer memory to the metrics registry
+    void updatemetricsgauges();
+
     // wait for I/O or other events
     int wait();
 
@@ -682,6 +685,10 @@ public:
     // close all open HTTP connections
     void disconnect();
 
+    // opt-in: send order-independent commands over up to n additional cs connections
+    // (0 disables them). Fails while a side channel has a request in flight
+    bool setcssidechannels(unsigned n);
+
     // close server-client HTTP connection
     void catchup();
     // abort lock request
@@ -1188,6 +1195,26 @@ public:
     // ourselves in cases where many clients get 500s for a while and then recover at the same time
     bool pendingcs_serverBusySent = false;
 
+    // additional cs connections, each with its own request ID sequence and backoff
+    struct CsSideChannel
+    {
+        unique_ptr<HttpReq> req;
+        BackoffTimer bt;
+        char reqid[10];
+
+        CsSideChannel(PrnGen& rng) : bt(rng) {}
+    };
+    vector<unique_ptr<CsSideChannel>> cssidechannels;
+
+    // send and process requests on the cs side channels
+    void execsidechannels();
+
+    // an idle side channel could send queued commands right away
+    bool cssidechannelready() const;
+
+    // URL for a cs request with the given ID
+    string csurl(const char* id, size_t idlen, bool suppressSID) const;
+
     // pending HTTP requests
     pendinghttp_map pendinghttp;
 
@@ -1197,12 +1224,19 @@ public:
     // record type indicator for statusTable
     enum StatusTableRecType { CACHEDSTATUS };
 
+    // record type indicator for the DNS cache table
+    enum DnsTableRecType { CACHEDDNS = 1 };
+
     // open/create state cache database table
     void opensctable();
 
     // open/create status database table
     void openStatusTable();
 
+    // DNS cache persisted next to the state cache (shared by all sessions)
+    void loaddnscache();
+    void savednscache();
+
     // initialize/update state cache referenced sctable
     void initsc();
     void updatesc();
@@ -1221,6 +1255,21 @@ public:
     bool insca;
     bool insca_notlast;
 
+    // large sc responses are processed while they are being received: batches of
+    // complete action packets are moved out of pendingsc and applied one by one
+    static const size_t SCSTREAMTHRESHOLD;
+    static const size_t SCSTREAMCHECKPOINT;
+    bool scstreaming = false;
+    JSONArrayScanner scstreamscanner;
+    string scstreambatch;
+    size_t scstreamcommitted = 0;
+    bool feedscstream();
+
+    // action packets processed from the current sc response, and from the responses
+    // for the current scsn (a failed streamed response leaves some of them applied)
+    size_t scpacket = 0;
+    size_t scapplied = 0;
+
     // no two interrelated client instances should ever have the same sessionid
     char sessionid[10];
 
@@ -1296,6 +1345,9 @@ public:
     // transfer tslots
     transferslot_list tslots;
 
+    // completed downloads that may serve later downloads of the same content
+    RecentDownloads recentdownloads;
+
     // keep track of next transfer slot timeout
     BackoffTimerGroupTracker transferSlotsBackoff;
 
@@ -1315,6 +1367,10 @@ public:
     handle_vector nodekeyrewrite;
     handle_vector sharekeyrewrite;
 
+    // keys decrypted with our RSA key, by ciphertext: the same keys arrive again
+    // (eg. when reloading the nodes) until the server has rewritten them
+    std::unordered_map<string, string> mRsaDecryptedKeys;
+
     static const char* const EXPORTEDLINK;
 
     // default number of seconds to wait after a bandwidth overquota
@@ -1527,6 +1583,10 @@ public:
     // transfer queue dispatch/retry handling
     void dispatchTransfers();
 
+    // start filling a fresh download's temporary file with a copy of a verified identical
+    // local file, on a worker thread. nullptr if there is no such file to try
+    std::shared_ptr<struct LocalReplicaCopy> copylocalreplica(Transfer*);
+
     void defer(direction_t, int td, int = 0);
     void freeq(direction_t);
 
@@ -1660,6 +1720,12 @@ public:
     // apply keys
     void applykeys();
 
+    // decrypt the RSA-encrypted keys of the nodes not readable yet in parallel
+    void decryptrsakeys();
+
+    // decrypt RSA-encrypted keys (ciphertext, key length) in parallel, into mRsaDecryptedKeys
+    void decryptrsakeys(vector<pair<string, int>>& encrypted);
+
     // send andy key rewrites prepared when keys were applied
     void sendkeyrewrites();
 
@@ -1819,6 +1885,12 @@ public:
 
     MegaClientAsyncQueue mAsyncQueue;
 
+    // local copies of downloads (see copylocalreplica) take a while, so they run on a thread
+    // of their own rather than holding mAsyncQueue, with a file system access of their own
+    // (fsaccess belongs to this thread). Declared first, the file system access outlives the thread
+    std::unique_ptr<FileSystemAccess> mLocalCopyFsAccess;
+    MegaClientAsyncQueue mLocalCopyQueue;
+
     // Keep track of high level operation counts and times, for performance analysis
     struct PerformanceStats
     {
@@ -1838,6 +1910,14 @@ public:
         uint64_t prepwaitImmediate = 0, prepwaitZero = 0, prepwaitHttpio = 0, prepwaitFsaccess = 0, nonzeroWait = 0;
         CodeCounter::DurationSum csRequestWaitTime;
         CodeCounter::DurationSum transfersActiveTime;
+
+        // per cs channel, the primary one first
+        struct CsChannelStats
+        {
+            uint64_t batchesSent = 0, backoffs = 0;
+        };
+        std::vector<CsChannelStats> csChannels = std::vector<CsChannelStats>(1);
+
         std::string report(bool reset, HttpIO* httpio, Waiter* waiter, const RequestDispatcher& reqs);
     } performanceStats;
 
@@ -0,0 +1,193 @@
+/**
+ * @file mega/metrics.h
+ * @brief Runtime counters, gauges and latency histograms
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_METRICS_H
+#define MEGA_METRICS_H 1
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "types.h"
+
+namespace mega {
+
+// Latency histogram with log-linear buckets: 4 buckets per power of two of microseconds,
+// so any recorded value is within 25% of its bucket's bounds, from 1us to several days.
+class MEGA_API MetricsHistogram
+{
+public:
+    enum { SUBBUCKETS = 4 };
+    enum { NUMBUCKETS = SUBBUCKETS + 40 * SUBBUCKETS };
+
+    void record(std::chrono::steady_clock::duration d);
+    void recordMicroseconds(uint64_t us);
+
+    // bucket a value falls in, and the largest value that bucket holds
+    static unsigned bucketIndex(uint64_t us);
+    static uint64_t bucketUpperBound(unsigned index);
+
+    struct Snapshot
+    {
+        uint64_t count = 0;
+        uint64_t sumMicroseconds = 0;
+        std::array<uint64_t, NUMBUCKETS> buckets{};
+
+        // estimated value at quantile q (0..1), in microseconds
+        uint64_t percentile(double q) const;
+    };
+    Snapshot snapshot() const;
+
+private:
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSum{0};
+    std::array<std::atomic<uint64_t>, NUMBUCKETS> mBuckets{};
+};
+
+struct MEGA_API MetricsSnapshot
+{
+    std::map<std::string, uint64_t> counters;
+    std::map<std::string, int64_t> gauges;
+
+    // keyed by family name, then label value ("" for families without a label)
+    std::map<std::string, std::map<std::string, MetricsHistogram::Snapshot>> histograms;
+    std::map<std::string, std::string> histogramLabels;
+
+    // Prometheus text exposition format
+    std::string prometheus() const;
+};
+
+// Process wide registry, shared by all the MegaClient instances.
+// Disabled by default; while disabled, every recording call returns after one relaxed load.
+class MEGA_API MetricsRegistry
+{
+public:
+    enum Counter
+    {
+        CS_REQUESTS_SENT,
+        CS_COMMANDS_SENT,
+        CS_BACKOFFS,
+        SC_ACTIONPACKETS,
+        TRANSFER_CHUNKS_GET,
+        TRANSFER_CHUNKS_PUT,
+        TRANSFER_TEMPERRORS,
+        TRANSFER_FAILS,
+        DB_COMMITS,
+        EVENTS_DROPPED,
+        EVENTS_COALESCED,
+        NUM_COUNTERS
+    };
+
+    enum Gauge
+    {
+        CS_PENDING_COMMANDS,
+        TRANSFERS_QUEUED,
+        TRANSFER_SLOTS,
+        TRANSFER_BUFFER_BYTES,
+        EVENTS_PENDING,
+        NUM_GAUGES
+    };
+
+    bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    void add(Counter c, uint64_t n = 1)
+    {
+        if (enabled())
+        {
+            mShards[shardIndex()].counters[c].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    void set(Gauge g, int64_t value)
+    {
+        if (enabled())
+        {
+            mGauges[g].store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void adjust(Gauge g, int64_t delta)
+    {
+        if (enabled())
+        {
+            mGauges[g].fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+    // Histograms are grouped in families with at most one label, eg. cs_command_seconds{command="f"}.
+    // The returned reference stays valid for the life of the process, so callers may keep it.
+    MetricsHistogram& histogram(const std::string& family, const std::string& labelName = std::string(), const std::string& labelValue = std::string());
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    // counters are sharded per thread so that concurrent increments don't contend on one cache line
+    enum { NUMSHARDS = 16 };
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters{};
+    };
+    std::array<Shard, NUMSHARDS> mShards;
+    std::array<std::atomic<int64_t>, NUM_GAUGES> mGauges{};
+    std::atomic<bool> mEnabled{false};
+
+    mutable std::mutex mHistogramsMutex;
+    std::map<std::string, std::map<std::string, std::unique_ptr<MetricsHistogram>>> mHistograms;
+    std::map<std::string, std::string> mHistogramLabels;
+
+    static unsigned shardIndex();
+    static const char* counterName(Counter c);
+    static const char* gaugeName(Gauge g);
+};
+
+extern MEGA_API MetricsRegistry g_metrics;
+
+// records the lifetime of the object into a histogram, if metrics are enabled when it starts
+class MEGA_API MetricsTimer
+{
+public:
+    explicit MetricsTimer(MetricsHistogram& h)
+        : mHistogram(g_metrics.enabled() ? &h : nullptr)
+    {
+        if (mHistogram)
+        {
+            mStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~MetricsTimer()
+    {
+        if (mHistogram)
+        {
+            mHistogram->record(std::chrono::steady_clock::now() - mStart);
+        }
+    }
+
+private:
+    MetricsHistogram* mHistogram;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+} // namespace
+
+#endif
@@ -37,7 +37,48 @@ struct LocalPathPtrCmp
     }
 };
 
-typedef map<const LocalPath*, LocalNode*, LocalPathPtrCmp> localnode_map;
+// LocalNode children by name, kept as a vector sorted by LocalPathPtrCmp.
+// Iteration order is the same as the former std::map, but each child costs a pointer pair
+// in one contiguous array instead of a separately allocated tree node.
+// Unlike std::map, erasing or inserting an entry invalidates all iterators.
+class MEGA_API LocalNodeChildMap
+{
+public:
+    using value_type = std::pair<const LocalPath*, LocalNode*>;
+    using container_type = vector<value_type>;
+    using iterator = container_type::iterator;
+    using const_iterator = container_type::const_iterator;
+
+    iterator begin() { return mEntries.begin(); }
+    iterator end() { return mEntries.end(); }
+    const_iterator begin() const { return mEntries.begin(); }
+    const_iterator end() const { return mEntries.end(); }
+
+    size_t size() const { return mEntries.size(); }
+    bool empty() const { return mEntries.empty(); }
+
+    iterator find(const LocalPath* name);
+    const_iterator find(const LocalPath* name) const;
+
+    // returns the slot for name, inserting an empty one if not present
+    LocalNode*& operator[](const LocalPath* name);
+
+    size_t erase(const LocalPath* name);
+    iterator erase(iterator it);
+
+    void clear();
+
+private:
+    iterator lowerBound(const LocalPath* name);
+    const_iterator lowerBound(const LocalPath* name) const;
+
+    // release spare capacity once a directory shrinks well below its peak
+    void compact();
+
+    container_type mEntries;
+};
+
+typedef LocalNodeChildMap localnode_map;
 typedef map<const string*, Node*, StringCmp> remotenode_map;
 
 struct MEGA_API NodeCore
@@ -93,16 +134,17 @@ struct MEGA_API PublicLink
     bool isExpired();
 };
 
-// Container storing FileFingerprint* (Node* in practice) ordered by fingerprint.
+// Container storing FileFingerprint* (Node* in practice) hashed by fingerprint.
 struct Fingerprints
 {
     // maps FileFingerprints to node
-    using fingerprint_set = std::multiset<FileFingerprint*, FileFingerprintCmp>;
+    using fingerprint_set = std::unordered_multiset<FileFingerprint*, FileFingerprintHash, FileFingerprintEqual>;
     using iterator = fingerprint_set::iterator;
 
-    void newnode(Node* n);
     void add(Node* n);
-    void remove(Node* n);
+
+    // false if n wasn't there. n must still have the fingerprint it was added with
+    bool remove(Node* n);
     void clear();
     m_off_t getSumSizes();
 
@@ -115,6 +157,63 @@ private:
 };
 
 
+// Children of a node, linked through the children themselves (Node::prevsibling and
+// Node::nextsibling): no allocation per child, and no need to store the position of each
+// child in its parent's list to unlink it.
+// Erasing a child only invalidates the iterators pointing to it.
+class MEGA_API node_list
+{
+public:
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Node* value_type;
+        typedef ptrdiff_t difference_type;
+        typedef Node* const* pointer;
+        typedef Node* const& reference;
+
+        explicit iterator(Node* node = nullptr) : mNode(node) {}
+
+        reference operator*() const { return mNode; }
+        pointer operator->() const { return &mNode; }
+        iterator& operator++();
+        iterator operator++(int);
+
+        bool operator==(const iterator& other) const { return mNode == other.mNode; }
+        bool operator!=(const iterator& other) const { return mNode != other.mNode; }
+
+    private:
+        Node* mNode;
+    };
+    typedef iterator const_iterator;
+
+    node_list() = default;
+    node_list(const node_list&) = delete;
+    node_list& operator=(const node_list&) = delete;
+
+    iterator begin() const { return iterator(mFirst); }
+    iterator end() const { return iterator(); }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return !mSize; }
+
+    // children of type FILENODE
+    size_t files() const { return mFiles; }
+    Node* front() const { return mFirst; }
+    Node* back() const { return mLast; }
+
+    void push_back(Node*);
+    void erase(Node*);
+    void clear();
+
+private:
+    Node* mFirst = nullptr;
+    Node* mLast = nullptr;
+    uint32_t mSize = 0;
+    uint32_t mFiles = 0;
+};
+
 // filesystem node
 struct MEGA_API Node : public NodeCore, FileFingerprint
 {
@@ -190,23 +289,6 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // app-private pointer
     void* appdata = nullptr;
 
-    bool foreignkey = false;
-
-    struct
-    {
-        bool removed : 1;
-        bool attrs : 1;
-        bool owner : 1;
-        bool ctime : 1;
-        bool fileattrstring : 1;
-        bool inshare : 1;
-        bool outshares : 1;
-        bool pendingshares : 1;
-        bool parent : 1;
-        bool publiclink : 1;
-        bool newnode : 1;
-    } changed;
-
     void setkey(const byte* = NULL);
 
     void setkeyfromjson(const char*);
@@ -215,20 +297,19 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
 
     void faspec(string*);
 
+    // files, folders and versions below the node, itself included
+    // (kept up to date for folders, so that it's O(1) for them)
     NodeCounter subnodeCounts() const;
 
+    // change the size of a file, updating the counts of the folders above it
+    void setsize(m_off_t);
+
     // parent
     Node* parent = nullptr;
 
     // children
     node_list children;
 
-    // own position in parent's children
-    node_list::iterator child_it;
-
-    // own position in fingerprint set (only valid for file nodes)
-    Fingerprints::iterator fingerprint_it;
-
 #ifdef ENABLE_SYNC
     // related synced item or NULL
     LocalNode* localnode = nullptr;
@@ -238,18 +319,28 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
 
     // state of removal to //bin / SyncDebris
     syncdel_t syncdeleted = SYNCDEL_NONE;
-
-    // location in the todebris node_set
-    node_set::iterator todebris_it;
-
-    // location in the tounlink node_set
-    // FIXME: merge todebris / tounlink
-    node_set::iterator tounlink_it;
 #endif
 
     // source tag.  The tag of the request or transfer that last modified this node (available in MegaApi)
     int tag = 0;
 
+    bool foreignkey = false;
+
+    struct
+    {
+        bool removed : 1;
+        bool attrs : 1;
+        bool owner : 1;
+        bool ctime : 1;
+        bool fileattrstring : 1;
+        bool inshare : 1;
+        bool outshares : 1;
+        bool pendingshares : 1;
+        bool parent : 1;
+        bool publiclink : 1;
+        bool newnode : 1;
+    } changed;
+
     // check if node is below this node
     bool isbelow(Node*) const;
 
@@ -269,8 +360,33 @@ private:
     // node crypto keys (raw or cooked -
     // cooked if size() == FOLDERNODEKEYLENGTH or FILEFOLDERNODEKEYLENGTH)
     string nodekeydata;
+
+    // counts of the subtree of a folder, updated as nodes are added, moved
+    // or removed below it (null for files)
+    std::unique_ptr<NodeCounter> mCounts;
+
+    // add or subtract the counts of the node's subtree from the folders above it
+    void updateancestorcounts(const NodeCounter&, bool add);
+
+    // links in the parent's children
+    friend class node_list;
+    Node* prevsibling = nullptr;
+    Node* nextsibling = nullptr;
 };
 
+inline node_list::iterator& node_list::iterator::operator++()
+{
+    mNode = mNode->nextsibling;
+    return *this;
+}
+
+inline node_list::iterator node_list::iterator::operator++(int)
+{
+    iterator it = *this;
+    mNode = mNode->nextsibling;
+    return it;
+}
+
 inline const string& Node::nodekey() const
 {
     assert(keyApplied() || type == ROOTNODE || type == INCOMINGNODE || type == RUBBISHNODE);
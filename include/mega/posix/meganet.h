@@ -105,6 +105,9 @@ protected:
     std::map<string, CurlDNSEntry> dnscache;
     int pkpErrors;
 
+    // hosts prewarmed before IPv6 requests were enabled, queried over IPv6 once they are
+    std::set<string> mPrewarmIPv6;
+
     void send_pending_requests();
     void drop_pending_requests();
 
@@ -145,6 +148,7 @@ protected:
 
     static void proxy_ready_callback(void*, int, int, struct hostent*);
     static void ares_completed_callback(void*, int, int, struct hostent*);
+    static void ares_prewarm_callback(void*, int, int, struct hostent*);
     static void send_request(CurlHttpContext*);
     void request_proxy_ip();
     static struct curl_slist* clone_curl_slist(struct curl_slist*);
@@ -182,6 +186,11 @@ protected:
     bool curlsocketsprocessed;
     m_time_t arestimeout;
 
+    // HTTP/2 negotiation and multiplexing, and per host connection caps (0 = no cap)
+    bool http2enabled;
+    long maxhostconnections[3];
+    void configuremulti(direction_t d);
+
 public:
     void post(HttpReq*, const char* = 0, unsigned = 0) override;
     void cancel(HttpReq*) override;
@@ -210,6 +219,29 @@ public:
     // get max upload speed
     m_off_t getmaxuploadspeed() override;
 
+    string serializednscache() override;
+    void loaddnscache(const string&) override;
+    void prewarm(const vector<string>& urls) override;
+
+    // negotiate HTTP/2 (via ALPN, falling back to HTTP/1.1) and multiplex requests
+    // to the same host over one connection. Returns false if libcurl can't do it.
+    // Disabling it restores the defaults of libcurl rather than forcing HTTP/1.1
+    bool sethttp2(bool enable) override;
+
+    // cap the number of simultaneous connections to a single host for one direction (0 = no cap)
+    bool setmaxhostconnections(direction_t d, long n) override;
+
+    // handshakes (new connections) and reused connections, per direction
+    struct ConnectionStats
+    {
+        uint64_t requests = 0;
+        uint64_t handshakes = 0;
+        uint64_t reused = 0;
+        uint64_t http2 = 0;
+    };
+    ConnectionStats connectionstats[3];
+    string connectionstatsreport(bool reset);
+
     CurlHttpIO();
     ~CurlHttpIO();
 
@@ -261,6 +293,14 @@ struct MEGA_API CurlDNSEntry
     dstime ipv6timestamp;
 
     bool mNeedsResolvingAgain = false;
+
+    // wall clock time of the last successful resolution, for the persisted cache
+    m_time_t mResolvedTime = 0;
+
+    // prewarm queries not answered yet (one per address family), and whether one failed:
+    // the entry is confirmed once all of them have been answered
+    int mPrewarmsPending = 0;
+    bool mPrewarmFailed = false;
 };
 
 } // namespace
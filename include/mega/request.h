@@ -49,11 +49,21 @@ public:
     void process(MegaClient* client);
     bool processCmdJSON(Command* cmd);
 
+    // emit the trace events of a command whose result has been processed, and of a batch being retried
+    void tracecommand(Command* cmd, std::chrono::steady_clock::time_point procresultStart, std::chrono::steady_clock::time_point procresultEnd) const;
+    void traceretry(size_t channel) const;
+
     void clear();
     bool empty() const;
     void swap(Request&);
     bool stopProcessing = false;
 
+    // when the batch was serialized for sending, for the cs latency metrics and tracing
+    std::chrono::steady_clock::time_point sentTime;
+
+    // HTTP exchange of the batch, only while tracing (see RequestTracer)
+    std::chrono::steady_clock::time_point postTime, firstByteTime, lastByteTime;
+
     // if contains only one command and that command is FetchNodes
     bool isFetchNodes() const;
 };
@@ -67,31 +77,59 @@ class MEGA_API RequestDispatcher
     // client-server request double-buffering, in batches of up to MAX_COMMANDS
     deque<Request> nextreqs;
 
+    // Optional side channels: commands flagged `orderIndependent` are batched separately and
+    // can be sent on any idle side channel, instead of waiting behind the primary channel's batch.
+    // Channel 0 is the primary channel, channel i > 0 uses sideinflightreqs[i - 1].
+    vector<Request> sideinflightreqs;
+    deque<Request> sidenextreqs;
+
     // flags for dealing with resetting everything from a command in progress
     bool processing = false;
     bool clearWhenSafe = false;
 
     static const int MAX_COMMANDS = 10000;
 
+    // cs_command_seconds histograms by command name (always a literal, so keyed by its address)
+    std::unordered_map<const char*, MetricsHistogram*> commandHistograms;
+
+    Request& inflight(size_t channel);
+    deque<Request>& queued(size_t channel);
+
+    void addTo(deque<Request>&, Command*);
+
 public:
     RequestDispatcher();
 
     // Queue a command to be send to MEGA. Some commands must go in their own batch (in case other commands fail the whole batch), determined by the Command's `batchSeparately` field.
     void add(Command*);
 
-    bool cmdspending() const;
+    // Number of side channels in use (0 by default). Can only change while none of them has a request in flight.
+    bool setSideChannels(size_t);
+    size_t sideChannels() const;
+
+    bool cmdspending(size_t channel = 0) const;
+
+    // commands queued but not sent yet, on all channels
+    size_t queuedCommands() const;
+
+    // the latency histogram of a command, looked up in the registry once per command name
+    MetricsHistogram& commandHistogram(const char* commandName);
 
     /**
      * @brief get the set of commands to be sent to the server (could be a retry)
      * @param suppressSID
      * @param includesFetchingNodes set to whether the commands include fetch nodes
+     * @param channel the channel the commands are sent on
      */
-    void serverrequest(string*, bool& suppressSID, bool &includesFetchingNodes);
+    void serverrequest(string*, bool& suppressSID, bool &includesFetchingNodes, size_t channel = 0);
+
+    // record the timing of the HTTP exchange of the batch in flight, before it is processed
+    void received(const HttpReq&, size_t channel = 0);
 
     // once the server response is determined, call one of these to specify the results
-    void requeuerequest();
-    void serverresponse(string&& movestring, MegaClient*);
-    void servererror(const std::string &e, MegaClient*);
+    void requeuerequest(size_t channel = 0);
+    void serverresponse(string&& movestring, MegaClient*, size_t channel = 0);
+    void servererror(const std::string &e, MegaClient*, size_t channel = 0);
 
     void clear();
 
@@ -63,6 +63,9 @@ struct MEGA_API NewShare
     byte key[SymmCipher::BLOCKSIZE];
     byte auth[SymmCipher::BLOCKSIZE];
 
+    // RSA-encrypted key, decrypted (along with the others queued) when merged
+    string rsakey;
+
     NewShare(handle, int, handle, accesslevel_t, m_time_t, const byte*, const byte* = NULL, handle = UNDEF, bool = false, bool = false);
 };
 
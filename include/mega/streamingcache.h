@@ -0,0 +1,159 @@
+/**
+ * @file mega/streamingcache.h
+ * @brief Data of a file streamed to several readers at once
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_STREAMINGCACHE_H
+#define MEGA_STREAMINGCACHE_H 1
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "types.h"
+
+namespace mega {
+
+// Data of a file that several readers stream at the same time (eg. the connections of the
+// HTTP server playing the same video, or the range requests of a single player).
+//
+// The data is kept in reference-counted segments, each of them downloaded once. Downloads
+// ("fetches") start where the data a reader needs is missing, and stop when they are the
+// read-ahead of the furthest reader following them past it, or when they reach data already cached.
+class MEGA_API StreamingCache : public std::enable_shared_from_this<StreamingCache>
+{
+public:
+    static const m_off_t SEGMENT_SIZE = 1048576;
+
+    // downloads of the data at a position that can fail before the readers needing it fail
+    static const int MAX_FETCH_ATTEMPTS = 3;
+
+    // Starts downloading len bytes of the file from pos. The data has to be passed to
+    // write(id, ...) until it returns false, and then the end reported to finish(id, ...).
+    // Called without the cache locked.
+    using StartFetch = std::function<void(const std::shared_ptr<StreamingCache>& cache, int id, m_off_t pos, m_off_t len)>;
+
+    StreamingCache(m_off_t fileSize, m_off_t readAhead, StartFetch startFetch);
+
+    // notify is called (with the cache locked) when there is new data, or a download failed,
+    // and fetchStarted (likewise) with the transfer tag of the downloads started for the reader
+    void addReader(const void* reader, m_off_t pos, std::function<void()> notify,
+                   std::function<void(int tag)> fetchStarted = nullptr);
+
+    // the callbacks won't be called anymore once this returns
+    void removeReader(const void* reader);
+
+    // data fetched ahead of the reader (eg. more for faster readers), between readAhead and half the cache
+    void setReadAhead(const void* reader, m_off_t readAhead);
+
+    struct Chunk
+    {
+        // keeps the segment alive while the data is in use
+        std::shared_ptr<const char> data;
+        size_t len = 0;
+    };
+
+    // Cached data at pos (up to maxLen bytes), empty if it isn't there yet.
+    // Returns false if the download of the data at pos failed MAX_FETCH_ATTEMPTS times.
+    bool read(const void* reader, m_off_t pos, size_t maxLen, Chunk& chunk);
+
+    // for the fetches
+    void started(int id, int tag);
+    bool write(int id, const char* data, size_t len);
+    void finish(int id, bool failed);
+
+    // some data can't be downloaded (new readers are better served by a new cache)
+    bool failed() const;
+    m_off_t cachedSize() const;
+    int fetchesStarted() const;
+
+private:
+    struct Segment
+    {
+        explicit Segment(m_off_t size);
+
+        std::unique_ptr<char[]> data;
+        m_off_t size;
+
+        // bytes written from the start of the segment
+        m_off_t filled = 0;
+    };
+
+    struct Reader
+    {
+        m_off_t pos;
+        m_off_t readAhead;
+        std::function<void()> notify;
+        std::function<void(int)> fetchStarted;
+    };
+
+    struct Fetch
+    {
+        // next byte to be written
+        m_off_t pos;
+
+        // write() returned false, waiting for finish()
+        bool stopping;
+
+        // the reader it was started for
+        const void* reader;
+    };
+
+    struct FetchStart
+    {
+        int id;
+        m_off_t pos;
+    };
+
+    const m_off_t mFileSize;
+    const m_off_t mReadAhead;
+    const m_off_t mMaxCached;
+    const StartFetch mStartFetch;
+
+    mutable std::mutex mMutex;
+    std::map<m_off_t, std::shared_ptr<Segment>> mSegments;
+    std::map<const void*, Reader> mReaders;
+    std::map<int, Fetch> mFetches;
+    m_off_t mCachedSize = 0;
+    int mLastFetchId = 0;
+
+    // failed fetches, by the position they stopped at (where the next one starts)
+    std::map<m_off_t, int> mFailures;
+
+    // first byte missing from the segment of pos onwards
+    m_off_t firstMissing(m_off_t pos) const;
+    bool gaveUp(m_off_t missing) const;
+
+    // start a fetch for the reader if the data following pos is missing soon
+    void prefetch(const void* reader, m_off_t pos, m_off_t readAhead, std::vector<FetchStart>& starts);
+    void startFetches(const std::vector<FetchStart>& starts);
+
+    // the fetch was readAhead bytes past the readers following it, or reached cached data
+    bool fetchIsDone(const Fetch& fetch) const;
+
+    // drop segments no reader needs soon, while over mMaxCached
+    void trim();
+    void notifyReaders();
+};
+
+} // namespace
+
+#endif
@@ -116,9 +116,12 @@ public:
     // recursively add children
     void addstatecachechildren(uint32_t, idlocalnode_map*, LocalPath&, LocalNode*, int);
 
-    // Caches all synchronized LocalNode
+    // Caches synchronized LocalNodes, up to CACHENODES_BATCH_SIZE records per call
     void cachenodes();
 
+    // set while insertq/deleteq hold more than one cachenodes() batch
+    bool mCacheFlushPending = false;
+
     // change state, signal to application
     void changestate(syncstate_t, SyncError newSyncError = NO_SYNC_ERROR);
 
@@ -202,10 +205,17 @@ public:
     static const int FILE_UPDATE_DELAY_DS;
     static const int FILE_UPDATE_MAX_DELAY_SECS;
     static const dstime RECENT_VERSION_INTERVAL_SECS;
+    static const size_t CACHENODES_BATCH_SIZE;
 
 protected :
     bool readstatecache();
 
+    // writes up to limit queued additions/deletions to the state cache in one transaction
+    void writestatecache(size_t limit);
+
+    // writes l to the state cache, preceded by any queued ancestors still lacking a dbid
+    bool cachenode(LocalNode* l, size_t& written);
+
 private:
     std::string mLocalPath;
 };
@@ -0,0 +1,102 @@
+/**
+ * @file mega/tracing.h
+ * @brief Timelines of API commands and transfer chunks
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_TRACING_H
+#define MEGA_TRACING_H 1
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "types.h"
+
+namespace mega {
+
+// A span of a traced operation, or a point in time if `instant` is set
+struct MEGA_API TraceEvent
+{
+    // "cs" for API commands, "transfer" for transfer slots
+    const char* category = "";
+    std::string name;
+
+    // shared by all the events of one command or one transfer slot (0: not tied to any)
+    uint64_t id = 0;
+
+    // microseconds since the tracer was created
+    int64_t start = 0;
+    int64_t duration = 0;
+    bool instant = false;
+
+    // extra details as JSON object members without the braces, eg. "\"size\":1024"
+    std::string args;
+};
+
+// Process wide collector of the timelines of API commands (queued, serialized, posted,
+// first and last byte of the response, procresult) and of transfer chunks.
+// Disabled by default; while disabled, every call site returns after one relaxed load.
+class MEGA_API RequestTracer
+{
+public:
+    typedef std::function<void(const TraceEvent&)> Callback;
+
+    RequestTracer();
+
+    bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    // invoked for every event, on the thread that records it (the SDK thread)
+    void setCallback(Callback callback);
+
+    // number of most recent events kept for chromeTraceJson()
+    void setCapacity(size_t capacity);
+
+    // id for a new command or transfer slot, 0 while disabled
+    uint64_t newId();
+
+    void span(const char* category, std::string name, uint64_t id,
+              std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+              std::string args = std::string());
+    void instant(const char* category, std::string name, uint64_t id, std::string args = std::string());
+
+    // the kept events in the Chrome trace event format (chrome://tracing, Perfetto),
+    // as nestable async events grouped by id
+    std::string chromeTraceJson() const;
+    void clear();
+
+private:
+    std::atomic<bool> mEnabled{false};
+    std::atomic<uint64_t> mNextId{0};
+    const std::chrono::steady_clock::time_point mEpoch;
+
+    mutable std::mutex mMutex;
+    Callback mCallback;
+    std::deque<TraceEvent> mEvents;
+    size_t mCapacity = 100000;
+
+    void record(TraceEvent&& event);
+};
+
+extern MEGA_API RequestTracer g_tracer;
+
+} // namespace
+
+#endif
@@ -164,6 +164,9 @@ struct MEGA_API Transfer : public FileFingerprint
 
     // whether the Transfer needs to remove itself from the list it's in (for quick shutdown we can skip)
     bool mOptimizedDelete = false;
+
+    // a download already looked for an identical local file to copy (see MegaClient::copylocalreplica)
+    bool localcopytried = false;
 };
 
 
@@ -223,6 +226,33 @@ private:
     bool isReady(Transfer *transfer);
 };
 
+// Local paths of recently completed downloads, by fingerprint.
+// Further downloads of identical content can then be served with a local copy.
+// Entries are only hints: the file may have changed since, so callers must verify it.
+class MEGA_API RecentDownloads
+{
+public:
+    static const size_t MAX_ENTRIES = 1024;
+
+    void add(const FileFingerprint& fingerprint, const LocalPath& path);
+    const LocalPath* find(const FileFingerprint& fingerprint) const;
+    void clear();
+
+private:
+    struct Cmp
+    {
+        bool operator()(const FileFingerprint& a, const FileFingerprint& b) const
+        {
+            return FileFingerprintCmp()(&a, &b);
+        }
+    };
+
+    std::map<FileFingerprint, LocalPath, Cmp> mPaths;
+
+    // insertion order, oldest first, for eviction
+    std::deque<FileFingerprint> mOrder;
+};
+
 struct MEGA_API DirectReadSlot
 {
     m_off_t pos;
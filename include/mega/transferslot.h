@@ -46,6 +46,23 @@ public:
 
 class DBTableTransactionCommitter;
 
+// copy of an identical local file serving a download, made on the client's local copy thread
+// (see MegaClient::copylocalreplica)
+struct MEGA_API LocalReplicaCopy
+{
+    std::mutex mutex;
+
+    // where the worker copies the file, next to the transfer's temporary file
+    LocalPath path;
+
+    // the worker has finished, and the file at path has the expected content
+    bool done = false;
+    bool copied = false;
+
+    // the slot went away first, so the worker removes its copy
+    bool abandoned = false;
+};
+
 // active transfer
 struct MEGA_API TransferSlot
 {
@@ -108,9 +125,16 @@ struct MEGA_API TransferSlot
     // Manage download input buffers and file output buffers for file download.  Raid-aware, and automatically performs decryption and mac.
     TransferBufferManager transferbuf;
 
+    // id and start of the slot while tracing (see RequestTracer), 0 otherwise
+    uint64_t traceId;
+    std::chrono::steady_clock::time_point traceStart;
+
     // async IO operations
     AsyncIOContext** asyncIO;
 
+    // local copy in progress instead of a download (the slot has no file meanwhile)
+    std::shared_ptr<LocalReplicaCopy> localcopy;
+
     // handle I/O for this slot
     void doio(MegaClient*, DBTableTransactionCommitter&);
 
@@ -149,6 +173,9 @@ private:
     bool checkMetaMacWithMissingLateEntries();
     bool tryRaidRecoveryFromHttpGetError(unsigned i, bool incrementErrors);
 
+    // emit the trace events of the chunk just completed on connection i
+    void tracechunk(int i);
+
     // returns true if connection haven't received data recently (set incrementErrors) or if slower than other connections (reset incrementErrors)
     bool testForSlowRaidConnection(unsigned connectionNum, bool& incrementErrors);
 };
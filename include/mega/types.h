@@ -76,6 +76,8 @@ typedef unsigned char byte;
 #include <memory>
 #include <string>
 #include <chrono>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace mega {
 
@@ -411,9 +413,8 @@ typedef multimap<int32_t, LocalNode*> idlocalnode_map;
 
 typedef set<Node*> node_set;
 
-// enumerates a node's children
-// FIXME: switch to forward_list once C++11 becomes more widely available
-typedef list<Node*> node_list;
+// enumerates a node's children (linked through the children, see node.h)
+class node_list;
 
 // undefined node handle
 const handle UNDEF = ~(handle)0;
@@ -481,8 +482,8 @@ typedef map<int, GenericHttpReq*> pendinghttp_map;
 // map an upload handle to the corresponding transer
 typedef map<handle, Transfer*> handletransfer_map;
 
-// maps node handles to Node pointers
-typedef map<handle, Node*> node_map;
+// maps node handles to Node pointers (unordered: lookups are on nearly every path)
+typedef std::unordered_map<handle, Node*> node_map;
 
 struct NodeCounter
 {
@@ -518,10 +519,10 @@ typedef vector<struct PendingContactRequest*> pcr_vector;
 typedef map<int, User> user_map;
 
 // maps user handles to userids
-typedef map<handle, int> uh_map;
+typedef std::unordered_map<handle, int> uh_map;
 
 // maps lowercase user e-mail addresses to userids
-typedef map<string, int> um_map;
+typedef std::unordered_map<string, int> um_map;
 
 // file attribute fetch map
 typedef map<handle, FileAttributeFetch*> faf_map;
@@ -738,23 +739,32 @@ unique_ptr<T> make_unique(constructorArgs&&... args)
 
 //#define MEGA_MEASURE_CODE   // uncomment this to track time spent in major subsystems, and log it every 2 minutes, with extra control from megacli
 
+class MetricsHistogram;
+
 namespace CodeCounter
 {
     // Some classes that allow us to easily measure the number of times a block of code is called, and the sum of the time it takes.
-    // Only enabled if MEGA_MEASURE_CODE is turned on.
+    // The counts and sums are only kept if MEGA_MEASURE_CODE is turned on.  In all builds, the time spent in each scope
+    // is also recorded in the exec_phase_seconds histograms of the runtime metrics (mega/metrics.h), when those are enabled.
     // Usage generally doesn't need to be protected by the macro as the classes and methods will be empty when not enabled.
 
     using namespace std::chrono;
 
+    // defined in metrics.cpp
+    MEGA_API MetricsHistogram* scopeHistogram(const std::string& name);
+    MEGA_API bool scopeMetricsEnabled();
+    MEGA_API void recordScope(MetricsHistogram* histogram, steady_clock::duration d);
+
     struct ScopeStats
     {
+        MetricsHistogram* histogram;
 #ifdef MEGA_MEASURE_CODE
         uint64_t count = 0;
         uint64_t starts = 0;
         uint64_t finishes = 0;
         high_resolution_clock::duration timeSpent{};
         std::string name;
-        ScopeStats(std::string s) : name(std::move(s)) {}
+        ScopeStats(std::string s) : histogram(scopeHistogram(s)), name(std::move(s)) {}
 
         inline string report(bool reset = false)
         {
@@ -769,7 +779,7 @@ namespace CodeCounter
             return s;
         }
 #else
-        ScopeStats(std::string s) {}
+        ScopeStats(std::string s) : histogram(scopeHistogram(s)) {}
 #endif
     };
 
@@ -796,23 +806,32 @@ namespace CodeCounter
 
     struct ScopeTimer
     {
+        MetricsHistogram* histogram;
+        steady_clock::time_point metricsStart;
 #ifdef MEGA_MEASURE_CODE
         ScopeStats& scope;
         high_resolution_clock::time_point blockStart;
 
-        ScopeTimer(ScopeStats& sm) : scope(sm), blockStart(high_resolution_clock::now())
+        ScopeTimer(ScopeStats& sm) : histogram(scopeMetricsEnabled() ? sm.histogram : nullptr), scope(sm), blockStart(high_resolution_clock::now())
         {
             ++scope.starts;
+            if (histogram) metricsStart = steady_clock::now();
         }
         ~ScopeTimer()
         {
             ++scope.count;
             ++scope.finishes;
             scope.timeSpent += high_resolution_clock::now() - blockStart;
+            if (histogram) recordScope(histogram, steady_clock::now() - metricsStart);
         }
 #else
-        ScopeTimer(ScopeStats& sm)
+        ScopeTimer(ScopeStats& sm) : histogram(scopeMetricsEnabled() ? sm.histogram : nullptr)
+        {
+            if (histogram) metricsStart = steady_clock::now();
+        }
+        ~ScopeTimer()
         {
+            if (histogram) recordScope(histogram, steady_clock::now() - metricsStart);
         }
 #endif
     };
@@ -443,10 +443,28 @@ void tolower_string(std::string& str);
 int macOSmajorVersion();
 #endif
 
-// file chunk macs
-class chunkmac_map : public map<m_off_t, ChunkMAC>
+// file chunk macs, indexed by chunk (the chunk boundaries follow ChunkedHash)
+class chunkmac_map
 {
 public:
+    // MAC of the chunk containing pos, added if missing
+    ChunkMAC& operator[](m_off_t pos);
+
+    // nullptr if the chunk containing pos has no MAC
+    ChunkMAC* find(m_off_t pos);
+
+    size_t size() const { return mCount; }
+    bool empty() const { return !mCount; }
+    void clear();
+    void swap(chunkmac_map& other);
+    bool operator==(const chunkmac_map& other) const;
+
+    // copy the MACs present here to other
+    void copyEntriesTo(chunkmac_map& other) const;
+
+    static size_t chunkIndex(m_off_t pos);
+    static m_off_t chunkStart(size_t index);
+
     int64_t macsmac(SymmCipher *cipher);
     int64_t macsmac_gaps(SymmCipher *cipher, size_t g1, size_t g2, size_t g3, size_t g4);
     void serialize(string& d) const;
@@ -455,6 +473,15 @@ public:
     m_off_t nextUnprocessedPosFrom(m_off_t pos);
     m_off_t expandUnprocessedPiece(m_off_t pos, m_off_t npos, m_off_t fileSize, m_off_t maxReqSize);
     void finishedUploadChunks(chunkmac_map& macs);
+
+private:
+    // chunks [mFirst, mFirst + mMacs.size()), mPresent telling which of them have a MAC
+    size_t mFirst = 0;
+    vector<ChunkMAC> mMacs;
+    vector<bool> mPresent;
+    size_t mCount = 0;
+
+    const ChunkMAC* at(size_t index) const;
 };
 
 struct CacheableWriter
@@ -535,6 +562,9 @@ struct MegaClientAsyncQueue
     void push(std::function<void(SymmCipher&)> f, bool discardable);
     void clearDiscardable();
 
+    // number of worker threads (0: things pushed run on the caller's thread)
+    size_t threadCount() const { return mThreads.size(); }
+
     MegaClientAsyncQueue(Waiter& w, unsigned threadCount);
     ~MegaClientAsyncQueue();
 
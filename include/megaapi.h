@@ -77,6 +77,7 @@ class MegaContactRequestList;
 class MegaShareList;
 class MegaTransferList;
 class MegaFolderInfo;
+class MegaMetrics;
 class MegaTimeZoneDetails;
 class MegaPushNotificationSettings;
 class MegaBackgroundMediaUpload;
@@ -4376,6 +4377,127 @@ public:
     virtual long long getVersionsSize() const;
 };
 
+/**
+ * @brief Snapshot of the runtime metrics collected by the SDK
+ *
+ * This object is related to results of the function MegaApi::getMetrics
+ *
+ * Objects of this class aren't live, they contain the values of the metrics when the
+ * object is created, they are immutable.
+ *
+ * Histograms are grouped in families, eg. "cs_command_seconds", and every family
+ * can have several series, distinguished by a label value, eg. the name of the API command.
+ * Families without a label have a single series with an empty label value.
+ */
+class MegaMetrics
+{
+public:
+    virtual ~MegaMetrics();
+
+    /**
+     * @brief Creates a copy of this MegaMetrics object
+     *
+     * The resulting object is fully independent of the source MegaMetrics,
+     * it contains a copy of all internal attributes, so it will be valid after
+     * the original object is deleted.
+     *
+     * You are the owner of the returned object
+     *
+     * @return Copy of the MegaMetrics object
+     */
+    virtual MegaMetrics *copy() const;
+
+    /**
+     * @brief Returns the names of the counters
+     *
+     * You take the ownership of the returned value
+     *
+     * @return Names of the counters
+     */
+    virtual MegaStringList *getCounterNames() const;
+
+    /**
+     * @brief Returns the value of a counter
+     * @param name Name of the counter
+     * @return Value of the counter, or 0 if there is no counter with that name
+     */
+    virtual long long getCounter(const char *name) const;
+
+    /**
+     * @brief Returns the names of the gauges
+     *
+     * You take the ownership of the returned value
+     *
+     * @return Names of the gauges
+     */
+    virtual MegaStringList *getGaugeNames() const;
+
+    /**
+     * @brief Returns the value of a gauge
+     * @param name Name of the gauge
+     * @return Value of the gauge, or 0 if there is no gauge with that name
+     */
+    virtual long long getGauge(const char *name) const;
+
+    /**
+     * @brief Returns the names of the histogram families
+     *
+     * You take the ownership of the returned value
+     *
+     * @return Names of the histogram families
+     */
+    virtual MegaStringList *getHistogramNames() const;
+
+    /**
+     * @brief Returns the label values of the series of a histogram family
+     *
+     * You take the ownership of the returned value
+     *
+     * @param name Name of the histogram family
+     * @return Label values of the series in the family
+     */
+    virtual MegaStringList *getHistogramLabels(const char *name) const;
+
+    /**
+     * @brief Returns the number of values recorded in a histogram
+     * @param name Name of the histogram family
+     * @param label Label value of the series, or NULL for families without a label
+     * @return Number of values recorded
+     */
+    virtual long long getHistogramCount(const char *name, const char *label = NULL) const;
+
+    /**
+     * @brief Returns the sum of the values recorded in a histogram
+     * @param name Name of the histogram family
+     * @param label Label value of the series, or NULL for families without a label
+     * @return Sum of the values recorded, in microseconds
+     */
+    virtual long long getHistogramSum(const char *name, const char *label = NULL) const;
+
+    /**
+     * @brief Returns an estimation of a percentile of the values recorded in a histogram
+     *
+     * The result is the upper bound of the bucket that contains the percentile, which is
+     * at most 25% higher than the actual value.
+     *
+     * @param name Name of the histogram family
+     * @param label Label value of the series, or NULL for families without a label
+     * @param percentile Percentile to estimate, between 0 and 100
+     * @return Estimated value of the percentile, in microseconds
+     */
+    virtual long long getHistogramPercentile(const char *name, const char *label, double percentile) const;
+
+    /**
+     * @brief Returns all the metrics in the Prometheus text exposition format
+     *
+     * You take the ownership of the returned value
+     * Use delete [] to free it.
+     *
+     * @return Metrics in the Prometheus text format
+     */
+    virtual char *getPrometheusText() const;
+};
+
 /**
  * @brief Provides information about timezones and the current default
  *
@@ -7835,6 +7957,51 @@ class MegaApi
          */
         void removeGlobalListener(MegaGlobalListener* listener);
 
+        /**
+         * @brief Deliver the callbacks of the listeners on a dedicated thread
+         *
+         * By default, listeners are called by the thread of the SDK, that can't do anything
+         * else until they return. When this option is enabled, the callbacks of requests,
+         * transfers and global events are queued and called in the same order by a thread
+         * dedicated to them, so slow listeners don't delay the SDK.
+         *
+         * In this mode:
+         * - Listeners receive copies of the MegaRequest, MegaTransfer and lists, valid until the
+         *   callback returns. MegaApi::getCurrentRequest and similar functions return NULL.
+         * - When a transfer or request has a progress update queued, a newer update replaces it.
+         *   Progress updates are discarded while maxQueuedProgressEvents callbacks are queued;
+         *   other callbacks are never discarded.
+         * - Consecutive MegaGlobalListener::onNodesUpdate callbacks are merged into one.
+         * - Once a remove*Listener function returns, the listener won't receive more callbacks.
+         *
+         * Callbacks related to syncs and backups, MegaTransferListener::onTransferData and
+         * streaming are still delivered synchronously.
+         *
+         * When it's disabled, the callbacks already queued are delivered before the next ones.
+         *
+         * @param enable True to deliver the callbacks on a dedicated thread
+         * @param maxQueuedProgressEvents Queued callbacks from which progress updates are discarded
+         */
+        void setAsyncEventDelivery(bool enable, int maxQueuedProgressEvents = 1000);
+
+        /**
+         * @brief Get the number of callbacks queued for the listeners
+         *
+         * @see MegaApi::setAsyncEventDelivery
+         *
+         * @return Number of queued callbacks, 0 if they are delivered synchronously
+         */
+        int getPendingEvents();
+
+        /**
+         * @brief Get the number of progress updates discarded since the asynchronous delivery was enabled
+         *
+         * @see MegaApi::setAsyncEventDelivery
+         *
+         * @return Number of discarded progress updates
+         */
+        long long getDroppedEvents();
+
         /**
          * @brief Get the current request
          *
@@ -9667,6 +9834,28 @@ class MegaApi
          */
         static void setLogToConsole(bool enable);
 
+        /**
+         * @brief Deliver log messages from a background thread
+         *
+         * By default, log messages are delivered to the MegaLogger objects on the thread that
+         * generates them, so slow loggers delay the SDK. When asynchronous logging is enabled,
+         * the threads only copy their messages to a per-thread buffer and a background thread
+         * delivers them. Messages are still formatted and filtered by log level on the calling
+         * thread. If a buffer fills up because the loggers can't keep up, new messages from that
+         * thread are discarded, and a warning with the number of discarded messages is logged later.
+         *
+         * If binaryFilePath is set, the messages are written to that file in a compact binary format
+         * instead of being delivered to the MegaLogger objects. Use the logdecode tool (or
+         * mega::AsyncLogger::decode) to convert the file to text.
+         *
+         * @param enable True to deliver messages from a background thread, false to go back
+         * to delivering them on the calling threads.
+         * @param binaryFilePath Path of the binary log file, or NULL to deliver messages to the
+         * MegaLogger objects. The file is truncated. Ignored when enable is false.
+         * @return False if the binary log file can't be created, true otherwise
+         */
+        static bool setLogAsync(bool enable, const char *binaryFilePath = NULL);
+
         /**
          * @brief Add a MegaLogger implementation to receive SDK logs
          *
@@ -9728,6 +9917,75 @@ class MegaApi
          */
         void setLoggingName(const char* loggingName);
 
+        /**
+         * @brief Enable or disable the collection of runtime metrics
+         *
+         * When enabled, the SDK counts API requests, action packets, transfer chunks and
+         * database commits, and records latency histograms for API commands, transfer chunks,
+         * database commits and the phases of the SDK loop. The overhead while disabled is
+         * negligible.
+         *
+         * Metrics are shared by all the MegaApi instances in the process.
+         * By default, they are disabled.
+         *
+         * @param enable true to collect metrics, false to stop collecting them
+         */
+        static void setMetricsEnabled(bool enable);
+
+        /**
+         * @brief Check if runtime metrics are being collected
+         * @return true if metrics are enabled, otherwise false
+         */
+        static bool isMetricsEnabled();
+
+        /**
+         * @brief Get a snapshot of the runtime metrics
+         *
+         * The values keep accumulating while metrics are enabled, they are not reset
+         * when they are read. See MegaApi::setMetricsEnabled
+         *
+         * You take the ownership of the returned value
+         *
+         * @return Current values of the counters, gauges and histograms
+         */
+        static MegaMetrics *getMetrics();
+
+        /**
+         * @brief Enable or disable the tracing of API commands and transfers
+         *
+         * When enabled, the SDK records the timeline of every API command (time queued, sent,
+         * waiting for the server, receiving the response and processing it) and of every
+         * transfer chunk, plus retries and backoffs. Each command and each transfer gets a
+         * trace id shared by all its events.
+         *
+         * The most recent events can be obtained with MegaApi::getTrace.
+         * Tracing is shared by all the MegaApi instances in the process.
+         * By default, it is disabled.
+         *
+         * @param enable true to record traces, false to stop recording them
+         */
+        static void setTracingEnabled(bool enable);
+
+        /**
+         * @brief Check if API commands and transfers are being traced
+         * @return true if tracing is enabled, otherwise false
+         */
+        static bool isTracingEnabled();
+
+        /**
+         * @brief Get the most recent trace events
+         *
+         * The result uses the Chrome trace event format, so it can be loaded in
+         * chrome://tracing or in Perfetto. See MegaApi::setTracingEnabled
+         *
+         * You take the ownership of the returned value
+         * Use delete [] to free it.
+         *
+         * @param clear true to discard the returned events
+         * @return JSON object with the trace events
+         */
+        static char *getTrace(bool clear = false);
+
         /**
          * @brief Create a folder in the MEGA account
          *
@@ -13055,6 +13313,59 @@ class MegaApi
          */
         bool setMaxUploadSpeed(long long bpslimit);
 
+        /**
+         * @brief Use HTTP/2 for the connections of the SDK
+         *
+         * When it's enabled, HTTP/2 is negotiated with the servers that support it, and the
+         * requests to the same server share a single connection instead of opening one each.
+         * When it's disabled (the default), the defaults of the network layer are used.
+         *
+         * Currently, this method is only available using the cURL-based network layer,
+         * with a version of libcurl built with HTTP/2 support. You can check if the function
+         * will have effect by checking the return value.
+         *
+         * @param enable True to use HTTP/2, false to go back to the defaults
+         * @return true if the value will be applied, otherwise false
+         */
+        bool setHttp2Enabled(bool enable);
+
+        /**
+         * @brief Set the maximum number of simultaneous connections to a single server
+         *
+         * This limits the connections the transfers open to each storage server, on top of the
+         * connections per transfer set by MegaApi::setMaxConnections. Requests over the limit
+         * wait for a connection to be free, or share one if HTTP/2 is enabled.
+         *
+         * Currently, this method is only available using the cURL-based network layer.
+         * You can check if the function will have effect by checking the return value.
+         *
+         * @param direction Direction of the connections
+         * Valid values for this parameter are:
+         * - MegaTransfer::TYPE_DOWNLOAD = 0
+         * - MegaTransfer::TYPE_UPLOAD = 1
+         * - -1 for both of them
+         * @param connections Maximum number of connections to a server, 0 for no limit (the default)
+         * @return true if the value will be applied, otherwise false
+         */
+        bool setMaxConnectionsPerHost(int direction, int connections);
+
+        /**
+         * @brief Send the API requests that don't depend on the others over additional connections
+         *
+         * By default, the requests to the API server are sent in order over a single connection,
+         * so a slow request delays the following ones. With additional connections, requests
+         * whose result doesn't depend on the order (eg. getting attributes or download URLs)
+         * are sent over the first idle one of them instead.
+         *
+         * The number of connections can't be changed while one of the additional connections
+         * has a request in progress. In that case, this function returns false and it can
+         * be called again later.
+         *
+         * @param channels Number of additional connections, 0 to disable them (the default)
+         * @return true if the value was applied, otherwise false
+         */
+        bool setApiSideChannels(int channels);
+
         /**
          * @brief Get the maximum download speed in bytes per second
          *
@@ -16749,6 +17060,28 @@ class MegaApi
          */
         bool httpServerIsFolderServerEnabled();
 
+        /**
+         * @brief Allow/forbid to serve the runtime metrics
+         *
+         * By default, metrics are NOT served
+         *
+         * When enabled, a GET request to /metrics returns the metrics collected by the SDK in the
+         * Prometheus text format. Metrics have to be enabled with MegaApi::setMetricsEnabled
+         * for the values to change.
+         *
+         * @param enable true to serve the metrics, false to forbid it
+         */
+        void httpServerEnableMetrics(bool enable);
+
+        /**
+         * @brief Check if it's allowed to serve the runtime metrics
+         *
+         * This function can return true even if the HTTP proxy server is not running
+         *
+         * @return true if it's allowed to serve the metrics, otherwise false
+         */
+        bool httpServerIsMetricsEnabled();
+
         /**
          * @brief Stablish FILE_ATTRIBUTE_OFFLINE attribute
          *
@@ -24,12 +24,16 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 
 #include "mega.h"
 #include "mega/gfx/external.h"
 #include "megaapi.h"
 
 #include "mega/heartbeats.h"
+#include "mega/asynclogging.h"
+#include "mega/eventdispatcher.h"
+#include "mega/streamingcache.h"
 
 #define CRON_USE_LOCAL_TIME 1
 #include "mega/mega_ccronexpr.h"
@@ -167,6 +171,7 @@ public:
     void removeMegaLogger(MegaLogger *logger);
     void setLogLevel(int logLevel);
     void setLogToConsole(bool enable);
+    bool setLogAsync(bool enable, const char *binaryFilePath);
     void postLog(int logLevel, const char *message, const char *filename, int line);
     void log(const char *time, int loglevel, const char *source, const char *message
 #ifdef ENABLE_LOG_PERFORMANCE
@@ -178,6 +183,11 @@ private:
     std::recursive_mutex mutex;
     set <MegaLogger *> megaLoggers;
     bool logToConsole;
+
+    // created the first time async logging is enabled, and kept until exit because
+    // other threads may be using it even after SimpleLogger stops pointing at it
+    std::unique_ptr<AsyncLogger> asyncLogger;
+    std::mutex asyncLoggerMutex;
 };
 
 class MegaTransferPrivate;
@@ -229,25 +239,48 @@ protected:
     MegaErrorPrivate mLastError = { API_OK };
 };
 
-class MegaFolderUploadController : public MegaRequestListener, public MegaTransferListener, public MegaRecursiveOperation
+class MegaFolderUploadController : public MegaTransferListener, public MegaRecursiveOperation
 {
 public:
     MegaFolderUploadController(MegaApiImpl *megaApi, MegaTransferPrivate *transfer);
     void start(MegaNode* node) override;
     void cancel() override;
 
+    // maximum number of folders created by a single putnodes command
+    static const size_t MAX_FOLDERS_PER_BATCH;
+
 protected:
-    void onFolderAvailable(MegaHandle handle);
+    // local folder of the uploaded tree, and the remote folder it maps to
+    struct LocalFolder
+    {
+        LocalPath localpath;
+        string name;
+        size_t parent;                  // index in mFolders, NO_PARENT for the uploaded folder itself
+        handle remoteHandle = UNDEF;    // UNDEF until the remote folder exists
+        bool requested = false;         // being created by a pending putnodes
+        bool failed = false;
+    };
+
+    static const size_t NO_PARENT;
+
+    void scanLocalTree();
+    void createPendingFolders();
+    void onFoldersCreated(const Error& e, vector<NewNode>& nn, const vector<size_t>& folders);
+    void uploadFiles(size_t folder);
     void checkCompletion();
 
-    std::list<LocalPath> pendingFolders;
+    // the whole local folder hierarchy, parents before children
+    vector<LocalFolder> mFolders;
+    handle mParentHandle = UNDEF;
+    int mPendingBatches = 0;
+
+    // putnodes results arriving after this controller is destroyed are ignored
+    std::shared_ptr<int> mAliveToken = std::make_shared<int>(0);
 
 public:
-    void onRequestFinish(MegaApi* api, MegaRequest *request, MegaError *e) override;
     void onTransferStart(MegaApi *api, MegaTransfer *transfer) override;
     void onTransferUpdate(MegaApi *api, MegaTransfer *transfer) override;
     void onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError *e) override;
-    ~MegaFolderUploadController();
 };
 
 
@@ -400,10 +433,33 @@ public:
     void start(MegaNode *node) override;
     void cancel() override;
 
+    // subtransfers queued at once; the walk resumes when half of them are finished
+    static const int MAX_PENDING_SUBTRANSFERS;
+
 protected:
-    void downloadFolderNode(MegaNode *node, LocalPath& path, FileSystemType fsType);
+    // folder whose local directory still has to be created and its children queued
+    struct PendingFolder
+    {
+        MegaHandle handle;
+        MegaNode *foreignNode;  // owned by the public node tree, since foreign nodes can't be looked up by handle
+        LocalPath localpath;
+    };
+
+    void downloadPendingFolders();
+    bool openFolder(PendingFolder& folder);
     void checkCompletion();
 
+    FileSystemType mFsType = FS_UNKNOWN;
+
+    // folders are visited breadth-first, so files near the top of the tree are queued first
+    std::deque<PendingFolder> mPendingFolders;
+
+    // children of the folder being walked, and the next one to queue
+    MegaNodeList *mChildren = nullptr;
+    std::unique_ptr<MegaNodeList> mOwnedChildren;
+    int mChildIndex = 0;
+    LocalPath mChildrenPath;
+
 public:
     void onTransferStart(MegaApi *, MegaTransfer *t) override;
     void onTransferUpdate(MegaApi *, MegaTransfer *t) override;
@@ -499,6 +555,17 @@ class MegaNodePrivate : public MegaNode, public Cacheable
 
     protected:
         MegaNodePrivate(Node *node);
+
+        // decodes the node attributes exposed by MegaNode (custom attributes, fingerprints, duration,
+        // coordinates, restore handle, favourite and label) from the values in attrs
+        void decodeAttrs(const attr_map& attrs, MegaClient* client);
+
+        // the values above are decoded on first access, from these (see MegaNodePrivate(Node*))
+        void decodePendingAttrs(MegaClient* client = nullptr);
+        std::shared_ptr<const attr_map> pendingAttrs;
+        FileFingerprint pendingFingerprint;
+        std::once_flag pendingDecoded;
+
         int type;
         const char *name;
         const char *fingerprint;
@@ -874,6 +941,33 @@ protected:
     long long versionsSize;
 };
 
+class MegaMetricsPrivate : public MegaMetrics
+{
+public:
+    MegaMetricsPrivate(MetricsSnapshot&& snapshot);
+    MegaMetricsPrivate(const MegaMetricsPrivate *metrics);
+
+    virtual ~MegaMetricsPrivate();
+
+    virtual MegaMetrics *copy() const;
+
+    virtual MegaStringList *getCounterNames() const;
+    virtual long long getCounter(const char *name) const;
+    virtual MegaStringList *getGaugeNames() const;
+    virtual long long getGauge(const char *name) const;
+    virtual MegaStringList *getHistogramNames() const;
+    virtual MegaStringList *getHistogramLabels(const char *name) const;
+    virtual long long getHistogramCount(const char *name, const char *label) const;
+    virtual long long getHistogramSum(const char *name, const char *label) const;
+    virtual long long getHistogramPercentile(const char *name, const char *label, double percentile) const;
+    virtual char *getPrometheusText() const;
+
+protected:
+    const MetricsHistogram::Snapshot *findHistogram(const char *name, const char *label) const;
+
+    MetricsSnapshot snapshot;
+};
+
 class MegaTimeZoneDetailsPrivate : public MegaTimeZoneDetails
 {
 public:
@@ -1733,6 +1827,9 @@ class MegaNodeListPrivate : public MegaNodeList
 
         void addNode(MegaNode* node) override;
 
+        // moves the nodes of other to the end of this list
+        void takeNodes(MegaNodeListPrivate& other);
+
 	protected:
 		MegaNode** list;
 		int s;
@@ -2022,33 +2119,6 @@ class PendingOutShareProcessor : public TreeProcessor
         vector<handle> handles;
 };
 
-class SizeProcessor : public TreeProcessor
-{
-    protected:
-        long long totalBytes;
-
-    public:
-        SizeProcessor();
-        virtual bool processNode(Node* node);
-        long long getTotalBytes();
-};
-
-class TreeProcFolderInfo : public TreeProc
-{
-    public:
-        TreeProcFolderInfo();
-        virtual void proc(MegaClient*, Node*);
-        virtual ~TreeProcFolderInfo() {}
-        MegaFolderInfo *getResult();
-
-    protected:
-        int numFiles;
-        int numFolders;
-        int numVersions;
-        long long currentSize;
-        long long versionsSize;
-};
-
 //Thread safe request queue
 class RequestQueue
 {
@@ -2117,6 +2187,10 @@ class MegaApiImpl : public MegaApp
         void removeBackupListener(MegaBackupListener* listener);
         void removeGlobalListener(MegaGlobalListener* listener);
 
+        void setAsyncEventDelivery(bool enable, int maxQueuedProgressEvents);
+        int getPendingEvents();
+        long long getDroppedEvents();
+
         void cancelPendingTransfersByFolderTag(int folderTag);
 
 
@@ -2228,10 +2302,18 @@ class MegaApiImpl : public MegaApp
         static void addLoggerClass(MegaLogger *megaLogger);
         static void removeLoggerClass(MegaLogger *megaLogger);
         static void setLogToConsole(bool enable);
+        static bool setLogAsync(bool enable, const char *binaryFilePath);
         static void log(int logLevel, const char* message, const char *filename = NULL, int line = -1);
 
         void setLoggingName(const char* loggingName);
 
+        static void setMetricsEnabled(bool enable);
+        static bool isMetricsEnabled();
+        static MegaMetrics *getMetrics();
+        static void setTracingEnabled(bool enable);
+        static bool isTracingEnabled();
+        static char *getTrace(bool clear);
+
         bool platformSetRLimitNumFile(int newNumFileLimit) const;
 
         void createFolder(const char* name, MegaNode *parent, MegaRequestListener *listener = NULL);
@@ -2368,6 +2450,9 @@ class MegaApiImpl : public MegaApp
         void setUploadMethod(int method);
         bool setMaxDownloadSpeed(m_off_t bpslimit);
         bool setMaxUploadSpeed(m_off_t bpslimit);
+        bool setHttp2Enabled(bool enable);
+        bool setMaxConnectionsPerHost(int direction, int connections);
+        bool setApiSideChannels(int channels);
         int getMaxDownloadSpeed();
         int getMaxUploadSpeed();
         int getCurrentDownloadSpeed();
@@ -2455,6 +2540,9 @@ class MegaApiImpl : public MegaApp
 		int getNumChildFiles(MegaNode* parent);
 		int getNumChildFolders(MegaNode* parent);
         MegaNodeList* getChildren(MegaNode *parent, int order);
+
+        // handles of the children of a folder, and a tag that changes whenever any of them does
+        bool getChildrenHandles(MegaNode *parent, std::vector<MegaHandle> &handles, std::string &etag);
         MegaNodeList* getVersions(MegaNode *node);
         int getNumVersions(MegaNode *node);
         bool hasVersions(MegaNode *node);
@@ -2646,6 +2734,8 @@ class MegaApiImpl : public MegaApp
         bool httpServerIsFileServerEnabled();
         void httpServerEnableFolderServer(bool enable);
         bool httpServerIsFolderServerEnabled();
+        void httpServerEnableMetrics(bool enable);
+        bool httpServerIsMetricsEnabled();
         bool httpServerIsOfflineAttributeEnabled();
         void httpServerSetRestrictedMode(int mode);
         int httpServerGetRestrictedMode();
@@ -2807,6 +2897,12 @@ protected:
 
         MegaTransferPrivate* getMegaTransferPrivate(int tag);
 
+        // hand the callbacks to eventDispatcher, if enabled (otherwise they must be called right away)
+        std::shared_ptr<EventDispatcher> asyncEventDispatcher();
+        bool postRequestEvent(int callback, MegaRequestPrivate *request, MegaErrorPrivate *e);
+        bool postTransferEvent(int callback, MegaTransferPrivate *transfer, MegaErrorPrivate *e);
+        bool postGlobalEvent(int callback, std::shared_ptr<void> payload);
+
         void fireOnRequestStart(MegaRequestPrivate *request);
         void fireOnRequestFinish(MegaRequestPrivate *request, unique_ptr<MegaErrorPrivate> e);
         void fireOnRequestUpdate(MegaRequestPrivate *request);
@@ -2858,6 +2954,7 @@ protected:
         int httpServerMaxOutputSize;
         bool httpServerEnableFiles;
         bool httpServerEnableFolders;
+        bool httpServerMetricsEnabled;
         bool httpServerOfflineAttributeEnabled;
         int httpServerRestrictedMode;
         bool httpServerSubtitlesSupportEnabled;
@@ -2903,6 +3000,11 @@ protected:
         set<MegaBackupListener *> backupListeners;
         set<MegaGlobalListener *> globalListeners;
         set<MegaListener *> listeners;
+
+        // delivers the callbacks of the listeners above on its own thread, when enabled
+        std::shared_ptr<EventDispatcher> eventDispatcher;
+        bool eventDispatcherStopping = false;
+
         retryreason_t waitingRequest;
         vector<string> excludedNames;
         vector<string> excludedPaths;
@@ -3449,6 +3551,7 @@ protected:
     virtual MegaTCPContext * initializeContext(uv_stream_t *server_handle) = 0;
     virtual void processWriteFinished(MegaTCPContext* tcpctx, int status) = 0;
     virtual void processOnAsyncEventClose(MegaTCPContext* tcpctx);
+    virtual void processOnClose(MegaTCPContext* tcpctx);
     virtual bool respondNewConnection(MegaTCPContext* tcpctx) = 0; //returns true if server needs to start by reading
     virtual void processOnExitHandleClose(MegaTCPServer* tcpServer);
 
@@ -3482,6 +3585,43 @@ public:
 };
 
 
+// Downloads a range of a node for a StreamingCache, deleting itself when it ends
+class MegaStreamingCacheFetch : public MegaTransferListener
+{
+public:
+    MegaStreamingCacheFetch(std::shared_ptr<StreamingCache> cache, int id);
+
+    void onTransferStart(MegaApi *, MegaTransfer *transfer) override;
+    bool onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size) override;
+    void onTransferFinish(MegaApi *, MegaTransfer *transfer, MegaError *e) override;
+
+private:
+    std::shared_ptr<StreamingCache> cache;
+    int id;
+};
+
+// Multistatus response of a PROPFIND on a folder, generated a page of children at a time
+struct MegaWebDavListing
+{
+    MegaHandle folder;
+    std::string etag;
+    std::string baseURL;
+    bool offlineAttribute;
+
+    // prolog and entry of the folder itself, sent with the first page
+    std::string head;
+    std::vector<MegaHandle> children;
+    size_t next = 0;
+    bool done = false;
+
+    // chunk being written
+    std::string chunk;
+
+    // the whole body, while small enough to be cached
+    std::string body;
+    bool cacheable = true;
+};
+
 class MegaTCServer;
 class MegaHTTPServer;
 class MegaHTTPContext : public MegaTCPContext
@@ -3495,11 +3635,20 @@ public:
     StreamingBuffer streamingBuffer;
     std::unique_ptr<MegaTransferPrivate> transfer;
     http_parser parser;
+
+    // data of the node shared with other connections, and the parts being written
+    std::shared_ptr<StreamingCache> streamingCache;
+    std::vector<StreamingCache::Chunk> streamingChunks;
+
+    // bytes per write, and bytes per second, adapted to how fast the socket drains
+    m_off_t outputSize;
+    m_off_t drainRate;
+    uint64_t writeStartTime;
+
     char *lastBuffer;
     int lastBufferLen;
     bool nodereceived;
     bool failed;
-    bool pause;
 
     // Request information
     bool range;
@@ -3520,6 +3669,8 @@ public:
 
     // WEBDAV related
     int depth;
+    std::string ifNoneMatch;
+    std::unique_ptr<MegaWebDavListing> webDavListing;
     std::string lastheader;
     std::string subpathrelative;
     const char *messageBody;
@@ -3537,7 +3688,6 @@ public:
     std::list<std::string> responses;
 
     virtual void onTransferStart(MegaApi *, MegaTransfer *transfer);
-    virtual bool onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size);
     virtual void onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError *e);
     virtual void onRequestFinish(MegaApi* api, MegaRequest *request, MegaError *e);
 };
@@ -3551,6 +3701,35 @@ protected:
     bool folderServerEnabled;
     bool offlineAttribute;
     bool subtitlesSupportEnabled;
+    bool metricsEnabled;
+
+    // nodes being streamed, accessed from the libuv thread only
+    std::map<MegaHandle, std::weak_ptr<StreamingCache>> streamingCaches;
+    std::shared_ptr<StreamingCache> getStreamingCache(MegaNode *node);
+
+    // segments gathered in a single write, and the limits to grow or shrink the writes
+    static const size_t MAX_WRITE_BUFFERS = 16;
+    static const uint64_t FAST_WRITE_US = 10000;
+    static const uint64_t SLOW_WRITE_US = 200000;
+    static const m_off_t READ_AHEAD_SECONDS = 4;
+    static void adaptOutputSize(MegaHTTPContext *httpctx);
+
+    // PROPFIND responses of unchanged folders, accessed from the libuv thread only
+    struct CachedWebDavListing
+    {
+        std::string etag;
+        std::string baseURL;
+        bool offlineAttribute;
+        std::string body;
+        uint64_t lastUse;
+    };
+    std::map<MegaHandle, CachedWebDavListing> webDavListings;
+    size_t webDavListingsSize;
+    uint64_t webDavListingsUses;
+    static const size_t WEBDAV_LISTING_PAGE = 256;
+    static const size_t MAX_CACHED_WEBDAV_LISTING = 1048576;
+    static const size_t MAX_CACHED_WEBDAV_LISTINGS = 16777216;
+    void cacheWebDavListing(const MegaWebDavListing &listing);
 
     //virtual methods:
     virtual void processReceivedData(MegaTCPContext *ftpctx, ssize_t nread, const uv_buf_t * buf);
@@ -3558,6 +3737,7 @@ protected:
     virtual MegaTCPContext * initializeContext(uv_stream_t *server_handle);
     virtual void processWriteFinished(MegaTCPContext* tcpctx, int status);
     virtual void processOnAsyncEventClose(MegaTCPContext* tcpctx);
+    virtual void processOnClose(MegaTCPContext* tcpctx);
     virtual bool respondNewConnection(MegaTCPContext* tcpctx);
     virtual void processOnExitHandleClose(MegaTCPServer* tcpServer);
 
@@ -3583,6 +3763,8 @@ protected:
     // WEBDAV related
     static std::string getWebDavPropFindResponseForNode(std::string baseURL, std::string subnodepath, MegaNode *node, MegaHTTPContext* httpctx);
     static std::string getWebDavProfFindNodeContents(MegaNode *node, std::string baseURL, bool offlineAttribute);
+    static std::string startWebDavListing(std::string baseURL, std::string subnodepath, MegaNode *node, MegaHTTPContext* httpctx);
+    static bool nextWebDavListingChunk(MegaHTTPContext* httpctx);
 
     static void returnHttpCodeBasedOnRequestError(MegaHTTPContext* httpctx, MegaError *e, bool synchronous = true);
     static void returnHttpCode(MegaHTTPContext* httpctx, int errorCode, std::string errorMessage = string(), bool synchronous = true);
@@ -3608,6 +3790,8 @@ public:
     bool isOfflineAttributeEnabled();
     bool isSubtitlesSupportEnabled();
     void enableSubtitlesSupport(bool enable);
+    void enableMetrics(bool enable);
+    bool isMetricsEnabled();
 
 };
 
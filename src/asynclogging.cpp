@@ -0,0 +1,425 @@
+/**
+ * @file asynclogging.cpp
+ * @brief Logger that moves log output off the logging threads
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/asynclogging.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+
+namespace mega {
+
+namespace {
+
+// Every record, in the rings and in binary log files, is this header followed by the source and the message.
+// Binary files start with BINARY_MAGIC and then contain the records as they were queued.
+struct RecordHeader
+{
+    uint32_t size;       // whole record, header included
+    uint8_t level;
+    uint8_t flags;
+    uint16_t sourceLen;
+    int64_t time;        // microseconds since the epoch
+};
+static_assert(sizeof(RecordHeader) == 16, "binary log records need a fixed layout");
+
+enum { RECORD_HAS_TIME = 1, RECORD_HAS_SOURCE = 2 };
+
+const char BINARY_MAGIC[8] = { 'M', 'E', 'G', 'A', 'L', 'O', 'G', 1 };
+
+std::string formatTime(int64_t us, bool withDate)
+{
+    time_t t = time_t(us / 1000000);
+    char ts[50];
+    if (!std::strftime(ts, sizeof(ts), withDate ? "%Y-%m-%d %H:%M:%S" : "%H:%M:%S", std::gmtime(&t)))
+    {
+        ts[0] = '\0';
+    }
+    return ts;
+}
+
+}
+
+class AsyncLogger::Ring
+{
+public:
+    explicit Ring(size_t size)
+        : mBuffer(new char[size])
+        , mSize(size)
+    {
+    }
+
+    // producer side: false if there is no room
+    bool push(const RecordHeader& header, const char* source, const char* const* parts, const size_t* sizes, unsigned numParts)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+        size_t tail = mTail.load(std::memory_order_acquire);
+        if (mSize - (head - tail) < header.size)
+        {
+            return false;
+        }
+
+        size_t pos = head;
+        write(pos, &header, sizeof header);
+        pos += sizeof header;
+        write(pos, source, header.sourceLen);
+        pos += header.sourceLen;
+        size_t remaining = header.size - sizeof header - header.sourceLen;
+        for (unsigned i = 0; i < numParts && remaining; i++)
+        {
+            size_t n = std::min(sizes[i], remaining);
+            write(pos, parts[i], n);
+            pos += n;
+            remaining -= n;
+        }
+
+        mHead.store(head + header.size, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: moves the oldest record into out, false if there is none
+    bool pop(std::string& out)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        RecordHeader header;
+        read(tail, &header, sizeof header);
+        out.resize(header.size);
+        read(tail, &out[0], header.size);
+        mTail.store(tail + header.size, std::memory_order_release);
+        return true;
+    }
+
+    size_t used() const
+    {
+        return mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> dropped{0};
+
+    // the thread that owns the ring has exited
+    std::atomic<bool> abandoned{false};
+
+private:
+    std::unique_ptr<char[]> mBuffer;
+    const size_t mSize;
+
+    // positions grow forever, the offset in the buffer is position % mSize.
+    // Kept apart so that the producer and the consumer don't write to the same cache line.
+    std::atomic<size_t> mHead{0};
+    char mPadding[64];
+    std::atomic<size_t> mTail{0};
+
+    void write(size_t pos, const void* data, size_t len)
+    {
+        size_t offset = pos % mSize;
+        size_t first = std::min(len, mSize - offset);
+        memcpy(mBuffer.get() + offset, data, first);
+        memcpy(mBuffer.get(), static_cast<const char*>(data) + first, len - first);
+    }
+
+    void read(size_t pos, void* data, size_t len) const
+    {
+        size_t offset = pos % mSize;
+        size_t first = std::min(len, mSize - offset);
+        memcpy(data, mBuffer.get() + offset, first);
+        memcpy(static_cast<char*>(data) + first, mBuffer.get(), len - first);
+    }
+};
+
+struct AsyncLogger::ThreadRing
+{
+    uint64_t owner = 0;
+    std::shared_ptr<Ring> ring;
+
+    ~ThreadRing()
+    {
+        if (ring)
+        {
+            ring->abandoned = true;
+        }
+    }
+};
+
+static std::atomic<uint64_t> nextAsyncLoggerId{0};
+
+AsyncLogger::AsyncLogger(Logger* target, size_t ringSize)
+    : mTarget(target)
+    , mRingSize(std::max<size_t>(ringSize, 4096))
+    , mId(++nextAsyncLoggerId)
+{
+    mThread = std::thread([this]() { run(); });
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+AsyncLogger::Ring* AsyncLogger::threadRing()
+{
+    static thread_local ThreadRing threadRing;
+    if (threadRing.owner != mId)
+    {
+        // first message of this thread for this logger
+        if (threadRing.ring)
+        {
+            threadRing.ring->abandoned = true;
+        }
+        threadRing.ring = std::make_shared<Ring>(mRingSize);
+        threadRing.owner = mId;
+
+        std::lock_guard<std::mutex> g(mRingsMutex);
+        mRings.push_back(threadRing.ring);
+    }
+    return threadRing.ring.get();
+}
+
+void AsyncLogger::log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+                      , const char **directMessages, size_t *directMessagesSizes, unsigned numberMessages
+#endif
+                      )
+{
+    const char* parts[1] = { message ? message : "" };
+    size_t partSizes[1] = { strlen(parts[0]) };
+    const char* const* messageParts = parts;
+    const size_t* messageSizes = partSizes;
+    unsigned numParts = 1;
+#ifdef ENABLE_LOG_PERFORMANCE
+    if (numberMessages)
+    {
+        messageParts = directMessages;
+        messageSizes = directMessagesSizes;
+        numParts = numberMessages;
+    }
+#endif
+
+    RecordHeader header;
+    header.level = uint8_t(loglevel);
+    header.flags = uint8_t((time ? RECORD_HAS_TIME : 0) | (source ? RECORD_HAS_SOURCE : 0));
+    header.sourceLen = uint16_t(source ? std::min<size_t>(strlen(source), 256) : 0);
+    header.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // very long payloads are truncated rather than taking over the whole ring
+    size_t messageLen = 0;
+    for (unsigned i = 0; i < numParts; i++)
+    {
+        messageLen += messageSizes[i];
+    }
+    messageLen = std::min(messageLen, mRingSize / 4 - sizeof header - header.sourceLen);
+    header.size = uint32_t(sizeof header + header.sourceLen + messageLen);
+
+    Ring* ring = threadRing();
+    if (!ring->push(header, source, messageParts, messageSizes, numParts))
+    {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (loglevel <= logError || ring->used() > mRingSize / 2)
+    {
+        mWake.notify_one();
+    }
+}
+
+bool AsyncLogger::setBinaryOutput(const std::string& path)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    if (mBinary.is_open())
+    {
+        mBinary.close();
+    }
+
+    if (path.empty())
+    {
+        return true;
+    }
+
+    mBinary.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!mBinary)
+    {
+        mBinary.close();
+        return false;
+    }
+    mBinary.write(BINARY_MAGIC, sizeof BINARY_MAGIC);
+    return true;
+}
+
+void AsyncLogger::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    uint64_t request = ++mFlushRequested;
+    mWake.notify_one();
+    mFlushed.wait(lock, [this, request]() { return mFlushCompleted >= request || mStop; });
+}
+
+uint64_t AsyncLogger::dropped() const
+{
+    return mDropped.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::run()
+{
+    std::string scratch;
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        uint64_t requested = mFlushRequested;
+        bool stop = mStop;
+
+        drain(scratch);
+        if (mBinary.is_open())
+        {
+            mBinary.flush();
+        }
+
+        mFlushCompleted = requested;
+        mFlushed.notify_all();
+
+        if (stop)
+        {
+            break;
+        }
+
+        if (mFlushRequested == requested && !mStop)
+        {
+            mWake.wait_for(lock, std::chrono::milliseconds(20));
+        }
+    }
+}
+
+bool AsyncLogger::drain(std::string& scratch)
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> g(mRingsMutex);
+        rings = mRings;
+    }
+
+    bool delivered = false;
+    uint64_t dropped = 0;
+    for (auto& ring : rings)
+    {
+        bool abandoned = ring->abandoned.load();
+        while (ring->pop(scratch))
+        {
+            deliver(scratch);
+            delivered = true;
+        }
+        dropped += ring->dropped.exchange(0);
+
+        if (abandoned)
+        {
+            std::lock_guard<std::mutex> g(mRingsMutex);
+            mRings.erase(std::remove(mRings.begin(), mRings.end(), ring), mRings.end());
+        }
+    }
+
+    if (dropped)
+    {
+        std::string message = "Async logging dropped " + std::to_string(dropped) + " messages, the log buffers were full";
+        RecordHeader header;
+        header.level = logWarning;
+        header.flags = RECORD_HAS_TIME;
+        header.sourceLen = 0;
+        header.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        header.size = uint32_t(sizeof header + message.size());
+
+        scratch.assign(reinterpret_cast<const char*>(&header), sizeof header);
+        scratch.append(message);
+        deliver(scratch);
+    }
+    return delivered;
+}
+
+void AsyncLogger::deliver(const std::string& record)
+{
+    if (mBinary.is_open())
+    {
+        mBinary.write(record.data(), std::streamsize(record.size()));
+        return;
+    }
+
+    if (!mTarget)
+    {
+        return;
+    }
+
+    RecordHeader header;
+    memcpy(&header, record.data(), sizeof header);
+    std::string source = record.substr(sizeof header, header.sourceLen);
+    std::string message = record.substr(sizeof header + header.sourceLen);
+    std::string time = (header.flags & RECORD_HAS_TIME) ? formatTime(header.time, false) : std::string();
+
+    mTarget->log((header.flags & RECORD_HAS_TIME) ? time.c_str() : nullptr,
+                 header.level,
+                 (header.flags & RECORD_HAS_SOURCE) ? source.c_str() : nullptr,
+                 message.c_str());
+}
+
+bool AsyncLogger::decode(std::istream& in, std::ostream& out)
+{
+    char magic[sizeof BINARY_MAGIC];
+    if (!in.read(magic, sizeof magic) || memcmp(magic, BINARY_MAGIC, sizeof magic))
+    {
+        return false;
+    }
+
+    std::string body;
+    RecordHeader header;
+    while (in.read(reinterpret_cast<char*>(&header), sizeof header))
+    {
+        if (header.size < sizeof header + header.sourceLen || header.level > logMax)
+        {
+            return false;
+        }
+
+        body.resize(header.size - sizeof header);
+        if (!in.read(&body[0], std::streamsize(body.size())))
+        {
+            // the last record was being written when the file was copied
+            break;
+        }
+
+        out << formatTime(header.time, true) << "." << std::setw(6) << std::setfill('0') << header.time % 1000000
+            << " [" << SimpleLogger::toStr(LogLevel(header.level)) << "] "
+            << body.substr(header.sourceLen);
+        if (header.sourceLen)
+        {
+            out << " [" << body.substr(0, header.sourceLen) << "]";
+        }
+        out << "\n";
+    }
+    return true;
+}
+
+} // namespace
@@ -21,7 +21,76 @@
 
 #include "mega/attrmap.h"
 
+#include <algorithm>
+
 namespace mega {
+
+namespace {
+bool nameBefore(const attr_map::value_type& value, nameid name)
+{
+    return value.first < name;
+}
+}
+
+attr_map::attr_map(std::initializer_list<value_type> values)
+{
+    *this = values;
+}
+
+attr_map& attr_map::operator=(std::initializer_list<value_type> values)
+{
+    mValues.clear();
+    mValues.reserve(values.size());
+    for (const value_type& value : values)
+    {
+        insert(value);
+    }
+    return *this;
+}
+
+attr_map::iterator attr_map::find(nameid name)
+{
+    iterator it = std::lower_bound(mValues.begin(), mValues.end(), name, nameBefore);
+    return (it != mValues.end() && it->first == name) ? it : mValues.end();
+}
+
+attr_map::const_iterator attr_map::find(nameid name) const
+{
+    const_iterator it = std::lower_bound(mValues.begin(), mValues.end(), name, nameBefore);
+    return (it != mValues.end() && it->first == name) ? it : mValues.end();
+}
+
+string& attr_map::operator[](nameid name)
+{
+    iterator it = std::lower_bound(mValues.begin(), mValues.end(), name, nameBefore);
+    if (it == mValues.end() || it->first != name)
+    {
+        it = mValues.emplace(it, name, string());
+    }
+    return it->second;
+}
+
+pair<attr_map::iterator, bool> attr_map::insert(const value_type& value)
+{
+    iterator it = std::lower_bound(mValues.begin(), mValues.end(), value.first, nameBefore);
+    if (it != mValues.end() && it->first == value.first)
+    {
+        return make_pair(it, false);
+    }
+    return make_pair(mValues.insert(it, value), true);
+}
+
+size_t attr_map::erase(nameid name)
+{
+    iterator it = find(name);
+    if (it == mValues.end())
+    {
+        return 0;
+    }
+    mValues.erase(it);
+    return 1;
+}
+
 // approximate raw storage size of serialized AttrMap, not taking JSON escaping
 // or name length into account
 unsigned AttrMap::storagesize(int perrecord) const
@@ -33,6 +33,9 @@ Command::Command()
     tag = 0;
     batchSeparately = false;
     suppressSID = false;
+    orderIndependent = false;
+    commandName = "";
+    traceId = 0;
 }
 
 Command::~Command()
@@ -141,6 +144,7 @@ void Command::addListener(const std::shared_ptr<CommandListener> &listener)
 
 void Command::cmd(const char* cmd)
 {
+    commandName = cmd;
     jsonWriter.cmd(cmd);
 }
 
@@ -151,6 +151,7 @@ m_off_t HttpReqCommandPutFA::transferred(MegaClient *client)
 CommandGetFA::CommandGetFA(MegaClient *client, int p, handle fahref)
 {
     part = p;
+    orderIndependent = true;
 
     cmd("ufa");
     arg("fah", (byte*)&fahref, sizeof fahref);
@@ -867,7 +868,7 @@ bool CommandGetFile::procresult(Result r)
                                                 Node *n = client->nodebyhandle(ph);
                                                 if (n)
                                                 {
-                                                    n->size = s;
+                                                    n->setsize(s);
                                                     client->notifynode(n);
                                                 }
                                             }
@@ -1013,7 +1014,9 @@ bool CommandSetAttr::procresult(Result r)
 // (the result is not processed directly - we rely on the server-client
 // response)
 CommandPutNodes::CommandPutNodes(MegaClient* client, handle th,
-                                 const char* userhandle, vector<NewNode>&& newnodes, int ctag, putsource_t csource, const char *cauth)
+                                 const char* userhandle, vector<NewNode>&& newnodes, int ctag, putsource_t csource, const char *cauth,
+                                 Completion&& resultFunction)
+    : mResultFunction(move(resultFunction))
 {
     byte key[FILENODEKEYLENGTH];
 
@@ -1212,7 +1215,8 @@ bool CommandPutNodes::procresult(Result r)
 #endif
             if (source == PUTNODES_APP)
             {
-                client->app->putnodes_result(r.errorOrOK(), type, nn);
+                if (mResultFunction)    mResultFunction(r.errorOrOK(), type, nn, false);
+                else         client->app->putnodes_result(r.errorOrOK(), type, nn);
                 return true;
             }
 #ifdef ENABLE_SYNC
@@ -1301,7 +1305,9 @@ bool CommandPutNodes::procresult(Result r)
             }
         }
 #endif
-        client->app->putnodes_result((!e && empty) ? API_ENOENT : static_cast<error>(e), type, nn, targetOverride);
+        Error result = (!e && empty) ? API_ENOENT : static_cast<error>(e);
+        if (mResultFunction)    mResultFunction(result, type, nn, targetOverride);
+        else         client->app->putnodes_result(result, type, nn, targetOverride);
     }
 #ifdef ENABLE_SYNC
     else
@@ -1404,8 +1410,7 @@ bool CommandMoveNode::procresult(Result r)
                     {
                         LOG_err << "Error moving node to the Rubbish Bin";
                         syncn->syncdeleted = SYNCDEL_NONE;
-                        client->todebris.erase(syncn->todebris_it);
-                        syncn->todebris_it = client->todebris.end();
+                        client->todebris.erase(syncn);
                     }
                     else
                     {
@@ -2975,12 +2980,16 @@ bool CommandPutUA::procresult(Result r)
     return true;
 }
 
-CommandGetUA::CommandGetUA(MegaClient* /*client*/, const char* uid, attr_t at, const char* ph, int ctag)
+CommandGetUA::CommandGetUA(MegaClient* client, const char* uid, attr_t at, const char* ph, int ctag)
 {
     this->uid = uid;
     this->at = at;
     this->ph = ph ? string(ph) : "";
 
+    // own attributes take part in login and key setup, which rely on request order
+    User* u = client->finduser(uid);
+    orderIndependent = !u || u->userhandle != client->me;
+
     if (ph && ph[0])
     {
         cmd("mcuga");
@@ -420,6 +420,10 @@ void SqliteDbTable::commit()
 
     LOG_debug << "DB transaction COMMIT " << dbfile;
 
+    static MetricsHistogram& commitTime = g_metrics.histogram("db_commit_seconds");
+    MetricsTimer timer(commitTime);
+    g_metrics.add(MetricsRegistry::DB_COMMITS);
+
     int rc = sqlite3_exec(db, "COMMIT", 0, 0, NULL);
     if (rc != SQLITE_OK)
     {
@@ -0,0 +1,238 @@
+/**
+ * @file eventdispatcher.cpp
+ * @brief Delivery of listener callbacks on a dedicated thread
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/eventdispatcher.h"
+#include "mega/metrics.h"
+
+#include <cassert>
+
+namespace mega {
+
+EventDispatcher::EventDispatcher(size_t maxQueued)
+    : mMaxQueued(maxQueued)
+{
+    mThread = std::thread([this]() { run(); });
+}
+
+EventDispatcher::~EventDispatcher()
+{
+    assert(!onDispatcherThread());
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+bool EventDispatcher::sameListeners(const Event& a, const Event& b)
+{
+    if (a.targets.size() != b.targets.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.targets.size(); i++)
+    {
+        if (a.targets[i].listener != b.targets[i].listener)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EventDispatcher::post(Event&& event)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    if (event.subject && event.progress)
+    {
+        auto it = mLastOfSubject.find(event.subject);
+        if (it != mLastOfSubject.end() && it->second->progress)
+        {
+            // nothing else happened to the subject since, so the newer progress is enough
+            it->second->targets = std::move(event.targets);
+            mCoalesced++;
+            g_metrics.add(MetricsRegistry::EVENTS_COALESCED);
+            return;
+        }
+
+        if (mQueue.size() >= mMaxQueued)
+        {
+            mDropped++;
+            g_metrics.add(MetricsRegistry::EVENTS_DROPPED);
+            return;
+        }
+    }
+
+    if (event.batchType && !mQueue.empty())
+    {
+        Event& last = *mQueue.back();
+        if (last.batchType == event.batchType && sameListeners(last, event))
+        {
+            last.mergeBatch(last.batch.get(), event.batch.get());
+            mCoalesced++;
+            g_metrics.add(MetricsRegistry::EVENTS_COALESCED);
+            return;
+        }
+    }
+
+    std::unique_ptr<Event> e(new Event(std::move(event)));
+    if (e->subject)
+    {
+        mLastOfSubject[e->subject] = e.get();
+    }
+    mQueue.push_back(std::move(e));
+    mPosted++;
+    g_metrics.adjust(MetricsRegistry::EVENTS_PENDING, 1);
+    mWake.notify_one();
+}
+
+void EventDispatcher::removeListener(const void* listener)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (auto& e : mQueue)
+    {
+        for (auto& t : e->targets)
+        {
+            if (t.listener == listener)
+            {
+                t.listener = nullptr;
+                t.call = nullptr;
+            }
+        }
+    }
+
+    if (mCurrent)
+    {
+        // the call of the running target must stay alive until it returns
+        for (auto& t : mCurrent->targets)
+        {
+            if (t.listener == listener)
+            {
+                t.listener = nullptr;
+            }
+        }
+    }
+
+    if (!onDispatcherThread())
+    {
+        mIdle.wait(lock, [this, listener]() { return mRunning != listener; });
+    }
+}
+
+void EventDispatcher::flush()
+{
+    if (onDispatcherThread())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    uint64_t posted = mPosted;
+    mIdle.wait(lock, [this, posted]() { return mDelivered >= posted; });
+}
+
+bool EventDispatcher::onDispatcherThread() const
+{
+    return std::this_thread::get_id() == mThread.get_id();
+}
+
+void EventDispatcher::setMaxQueued(size_t maxQueued)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mMaxQueued = maxQueued;
+}
+
+bool EventDispatcher::idle() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mQueue.empty() && !mCurrent;
+}
+
+size_t EventDispatcher::pending() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mQueue.size();
+}
+
+uint64_t EventDispatcher::dropped() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mDropped;
+}
+
+uint64_t EventDispatcher::coalesced() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mCoalesced;
+}
+
+void EventDispatcher::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWake.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+        if (mQueue.empty())
+        {
+            break;
+        }
+
+        mCurrent = std::move(mQueue.front());
+        mQueue.pop_front();
+        g_metrics.adjust(MetricsRegistry::EVENTS_PENDING, -1);
+
+        auto it = mLastOfSubject.find(mCurrent->subject);
+        if (it != mLastOfSubject.end() && it->second == mCurrent.get())
+        {
+            mLastOfSubject.erase(it);
+        }
+
+        for (auto& t : mCurrent->targets)
+        {
+            if (!t.listener)
+            {
+                continue;
+            }
+
+            mRunning = t.listener;
+            lock.unlock();
+            t.call();
+            lock.lock();
+            mRunning = nullptr;
+            mIdle.notify_all();
+        }
+
+        // the payloads are released without the lock, they may be large
+        std::unique_ptr<Event> done = std::move(mCurrent);
+        lock.unlock();
+        done.reset();
+        lock.lock();
+
+        mDelivered++;
+        mIdle.notify_all();
+    }
+}
+
+} // namespace
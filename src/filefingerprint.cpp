@@ -414,6 +414,28 @@ bool FileFingerprintCmp::operator()(const FileFingerprint* a, const FileFingerpr
     return memcmp(a->crc.data(), b->crc.data(), sizeof a->crc) < 0;
 }
 
+size_t FileFingerprintHash::operator()(const FileFingerprint* f) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](uint64_t value)
+    {
+        hash = (hash ^ value) * 1099511628211ULL;
+    };
+
+    add(uint64_t(f->size));
+    add(uint64_t(f->mtime));
+    for (int32_t c : f->crc)
+    {
+        add(uint32_t(c));
+    }
+    return size_t(hash ^ (hash >> 32));
+}
+
+bool FileFingerprintEqual::operator()(const FileFingerprint* a, const FileFingerprint* b) const
+{
+    return a->size == b->size && a->mtime == b->mtime && a->crc == b->crc;
+}
+
 bool LightFileFingerprint::genfingerprint(const m_off_t filesize, const m_time_t filemtime)
 {
     bool changed = false;
@@ -401,6 +401,8 @@ void HttpReq::post(MegaClient* client, const char* data, unsigned len)
     method = METHOD_POST;
     contentlength = -1;
     lastdata = Waiter::ds;
+    posttime = std::chrono::steady_clock::now();
+    firstdatatime = std::chrono::steady_clock::time_point();
 
     DEBUG_TEST_HOOK_HTTPREQ_POST(this)
 
@@ -424,6 +426,8 @@ void HttpReq::get(MegaClient *client)
     method = METHOD_GET;
     contentlength = -1;
     lastdata = Waiter::ds;
+    posttime = std::chrono::steady_clock::now();
+    firstdatatime = std::chrono::steady_clock::time_point();
 
     httpio->post(this);
 }
@@ -515,6 +519,11 @@ void HttpReq::setreq(const char* u, contenttype_t t)
 // add data to fixed or variable buffer
 void HttpReq::put(void* data, unsigned len, bool purge)
 {
+    if (!bufpos && len)
+    {
+        firstdatatime = std::chrono::steady_clock::now();
+    }
+
     if (buf)
     {
         if (bufpos + len > buflen)
@@ -24,14 +24,158 @@
 #include "mega/megaclient.h"
 #include "mega/logging.h"
 
+// The vectorized scanning reads whole aligned blocks, which may extend past the end of the
+// input (never into another page); address sanitizers would report those reads.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEGA_JSON_NO_SIMD 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#define MEGA_JSON_NO_SIMD 1
+#endif
+
+#if !defined(MEGA_JSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MEGA_JSON_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif !defined(MEGA_JSON_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define MEGA_JSON_NEON 1
+#include <arm_neon.h>
+#endif
+
 namespace mega {
+
+namespace {
+
+#if defined(MEGA_JSON_SSE2)
+
+const size_t SCANBLOCK = 16;
+
+inline unsigned lowestbit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return unsigned(index);
+#else
+    return unsigned(__builtin_ctz(mask));
+#endif
+}
+
+// one bit per byte that is a quote or a backslash (or a NUL, if withNul)
+inline unsigned stopmask(const char* p, bool aligned, bool withNul)
+{
+    __m128i v = aligned ? _mm_load_si128(reinterpret_cast<const __m128i*>(p))
+                        : _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    if (withNul)
+    {
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    }
+    return unsigned(_mm_movemask_epi8(m));
+}
+
+inline unsigned stopindex(unsigned mask)
+{
+    return lowestbit(mask);
+}
+
+inline unsigned skipbytes(unsigned mask, size_t n)
+{
+    return mask >> n;
+}
+
+#elif defined(MEGA_JSON_NEON)
+
+const size_t SCANBLOCK = 16;
+
+// four bits per byte that is a quote or a backslash (or a NUL, if withNul)
+inline uint64_t stopmask(const char* p, bool, bool withNul)
+{
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\')));
+    if (withNul)
+    {
+        m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8(0)));
+    }
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+}
+
+inline unsigned stopindex(uint64_t mask)
+{
+    return unsigned(__builtin_ctzll(mask)) / 4;
+}
+
+inline uint64_t skipbytes(uint64_t mask, size_t n)
+{
+    return mask >> (n * 4);
+}
+
+#endif
+
+// the first quote, backslash or NUL at or after p, in NUL-terminated JSON text
+const char* findstringstop(const char* p)
+{
+#if defined(MEGA_JSON_SSE2) || defined(MEGA_JSON_NEON)
+    // aligned blocks never straddle a page boundary, so reading past the terminating NUL is safe
+    size_t offset = reinterpret_cast<uintptr_t>(p) % SCANBLOCK;
+    const char* block = p - offset;
+    auto mask = skipbytes(stopmask(block, true, true), offset);
+    if (mask)
+    {
+        return p + stopindex(mask);
+    }
+
+    for (;;)
+    {
+        block += SCANBLOCK;
+        mask = stopmask(block, true, true);
+        if (mask)
+        {
+            return block + stopindex(mask);
+        }
+    }
+#else
+    while (*p && *p != '"' && *p != '\\')
+    {
+        p++;
+    }
+    return p;
+#endif
+}
+
+// the first quote or backslash in [p, end), or end
+const char* findstringstop(const char* p, const char* end)
+{
+#if defined(MEGA_JSON_SSE2) || defined(MEGA_JSON_NEON)
+    while (size_t(end - p) >= SCANBLOCK)
+    {
+        auto mask = stopmask(p, false, false);
+        if (mask)
+        {
+            return p + stopindex(mask);
+        }
+        p += SCANBLOCK;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\')
+    {
+        p++;
+    }
+    return p;
+}
+
+}
+
 // store array or object in string s
 // reposition after object
 bool JSON::storeobject(string* s)
 {
     int openobject[2] = { 0 };
     const char* ptr;
-    bool escaped = false;
 
     while (*(const signed char*)pos > 0 && *pos <= ' ')
     {
@@ -68,10 +212,10 @@ bool JSON::storeobject(string* s)
         {
             ptr++;
 
-            while (*ptr && (escaped || *ptr != '"'))
+            while (*(ptr = findstringstop(ptr)) == '\\')
             {
-                escaped = *ptr == '\\' && !escaped;
-                ptr++;
+                // skip the escaped character, unless the input ends there
+                ptr += ptr[1] ? 2 : 1;
             }
 
             if (!*ptr)
@@ -829,5 +973,85 @@ int JSONWriter::elements()
     return 1;
 }
 
-} // namespace
+size_t JSONArrayScanner::scan(const char* data, size_t len)
+{
+    for (; mPos < len && !mEnded; mPos++)
+    {
+        char c = data[mPos];
+
+        if (mInString)
+        {
+            if (mEscape)
+            {
+                mEscape = false;
+                continue;
+            }
+
+            mPos = size_t(findstringstop(data + mPos, data + len) - data);
+            if (mPos == len)
+            {
+                break;
+            }
+
+            if (data[mPos] == '\\')
+            {
+                mEscape = true;
+            }
+            else
+            {
+                mInString = false;
+            }
+            continue;
+        }
+
+        switch (c)
+        {
+            case '"':
+                mInString = true;
+                break;
+
+            case '{':
+            case '[':
+                if (!mDepth++)
+                {
+                    mStart = mPos;
+                }
+                break;
+
+            case '}':
+            case ']':
+                if (!mDepth)
+                {
+                    // end of the array itself
+                    mEnded = true;
+                    return mComplete;
+                }
+
+                if (!--mDepth)
+                {
+                    mComplete = mPos + 1;
+                    mLastStart = mStart;
+                    mElements++;
+                }
+                break;
+        }
+    }
+
+    return mComplete;
+}
+
+void JSONArrayScanner::consume(size_t len)
+{
+    assert(len <= mComplete);
+    mPos -= len;
+    mComplete -= len;
+    mStart -= std::min(len, mStart);
+    mLastStart -= std::min(len, mLastStart);
+}
+
+void JSONArrayScanner::reset()
+{
+    *this = JSONArrayScanner();
+}
 
+} // namespace
@@ -54,6 +54,7 @@ __thread std::array<char, LOGGER_CHUNKS_SIZE> SimpleLogger::mBuffer;
 // static member initialization
 std::mutex SimpleLogger::outputs_mutex;
 OutputMap SimpleLogger::outputs;
+std::atomic<bool> SimpleLogger::outputsAdded{false};
 
 std::string SimpleLogger::getTime()
 {
@@ -98,6 +99,7 @@ void SimpleLogger::addOutput(enum LogLevel ll, std::ostream *os)
     assert(unsigned(ll) < outputs.size());
     std::lock_guard<std::mutex> guard(outputs_mutex);
     outputs[ll].push_back(os);
+    outputsAdded = true;
 }
 
 void SimpleLogger::setAllOutputs(std::ostream *os)
@@ -107,6 +109,7 @@ void SimpleLogger::setAllOutputs(std::ostream *os)
     {
         o.push_back(os);
     }
+    outputsAdded = true;
 }
 #endif
 
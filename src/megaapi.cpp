@@ -1910,6 +1910,11 @@ void MegaApi::setLogToConsole(bool enable)
     MegaApiImpl::setLogToConsole(enable);
 }
 
+bool MegaApi::setLogAsync(bool enable, const char *binaryFilePath)
+{
+    return MegaApiImpl::setLogAsync(enable, binaryFilePath);
+}
+
 void MegaApi::addLoggerObject(MegaLogger *megaLogger)
 {
     MegaApiImpl::addLoggerClass(megaLogger);
@@ -1930,6 +1935,36 @@ void MegaApi::setLoggingName(const char* loggingName)
     pImpl->setLoggingName(loggingName);
 }
 
+void MegaApi::setMetricsEnabled(bool enable)
+{
+    MegaApiImpl::setMetricsEnabled(enable);
+}
+
+bool MegaApi::isMetricsEnabled()
+{
+    return MegaApiImpl::isMetricsEnabled();
+}
+
+MegaMetrics *MegaApi::getMetrics()
+{
+    return MegaApiImpl::getMetrics();
+}
+
+void MegaApi::setTracingEnabled(bool enable)
+{
+    MegaApiImpl::setTracingEnabled(enable);
+}
+
+bool MegaApi::isTracingEnabled()
+{
+    return MegaApiImpl::isTracingEnabled();
+}
+
+char *MegaApi::getTrace(bool clear)
+{
+    return MegaApiImpl::getTrace(clear);
+}
+
 long long MegaApi::getSDKtime()
 {
     return pImpl->getSDKtime();
@@ -3010,6 +3045,21 @@ bool MegaApi::setMaxUploadSpeed(long long bpslimit)
     return pImpl->setMaxUploadSpeed(bpslimit);
 }
 
+bool MegaApi::setHttp2Enabled(bool enable)
+{
+    return pImpl->setHttp2Enabled(enable);
+}
+
+bool MegaApi::setMaxConnectionsPerHost(int direction, int connections)
+{
+    return pImpl->setMaxConnectionsPerHost(direction, connections);
+}
+
+bool MegaApi::setApiSideChannels(int channels)
+{
+    return pImpl->setApiSideChannels(channels);
+}
+
 int MegaApi::getCurrentDownloadSpeed()
 {
     return pImpl->getCurrentDownloadSpeed();
@@ -4041,6 +4091,21 @@ void MegaApi::removeGlobalListener(MegaGlobalListener* listener)
     pImpl->removeGlobalListener(listener);
 }
 
+void MegaApi::setAsyncEventDelivery(bool enable, int maxQueuedProgressEvents)
+{
+    pImpl->setAsyncEventDelivery(enable, maxQueuedProgressEvents);
+}
+
+int MegaApi::getPendingEvents()
+{
+    return pImpl->getPendingEvents();
+}
+
+long long MegaApi::getDroppedEvents()
+{
+    return pImpl->getDroppedEvents();
+}
+
 MegaRequest *MegaApi::getCurrentRequest()
 {
     return pImpl->getCurrentRequest();
@@ -4333,6 +4398,16 @@ bool MegaApi::httpServerIsFolderServerEnabled()
     return pImpl->httpServerIsFolderServerEnabled();
 }
 
+void MegaApi::httpServerEnableMetrics(bool enable)
+{
+    pImpl->httpServerEnableMetrics(enable);
+}
+
+bool MegaApi::httpServerIsMetricsEnabled()
+{
+    return pImpl->httpServerIsMetricsEnabled();
+}
+
 void MegaApi::httpServerSetRestrictedMode(int mode)
 {
     pImpl->httpServerSetRestrictedMode(mode);
@@ -6768,6 +6843,66 @@ long long MegaFolderInfo::getVersionsSize() const
     return 0;
 }
 
+MegaMetrics::~MegaMetrics()
+{
+
+}
+
+MegaMetrics *MegaMetrics::copy() const
+{
+    return NULL;
+}
+
+MegaStringList *MegaMetrics::getCounterNames() const
+{
+    return NULL;
+}
+
+long long MegaMetrics::getCounter(const char *) const
+{
+    return 0;
+}
+
+MegaStringList *MegaMetrics::getGaugeNames() const
+{
+    return NULL;
+}
+
+long long MegaMetrics::getGauge(const char *) const
+{
+    return 0;
+}
+
+MegaStringList *MegaMetrics::getHistogramNames() const
+{
+    return NULL;
+}
+
+MegaStringList *MegaMetrics::getHistogramLabels(const char *) const
+{
+    return NULL;
+}
+
+long long MegaMetrics::getHistogramCount(const char *, const char *) const
+{
+    return 0;
+}
+
+long long MegaMetrics::getHistogramSum(const char *, const char *) const
+{
+    return 0;
+}
+
+long long MegaMetrics::getHistogramPercentile(const char *, const char *, double) const
+{
+    return 0;
+}
+
+char *MegaMetrics::getPrometheusText() const
+{
+    return NULL;
+}
+
 MegaTimeZoneDetails::~MegaTimeZoneDetails()
 {
 
@@ -147,36 +147,52 @@ MegaNodePrivate::MegaNodePrivate(MegaNode *node)
 : MegaNode()
 {
     this->name = MegaApi::strdup(node->getName());
-    this->fingerprint = MegaApi::strdup(node->getFingerprint());
-    this->originalfingerprint = MegaApi::strdup(node->getOriginalFingerprint());
+    this->fingerprint = NULL;
+    this->originalfingerprint = NULL;
     this->customAttrs = NULL;
+    this->type = node->getType();
 
     MegaNodePrivate *np = dynamic_cast<MegaNodePrivate *>(node);
+    bool sharePending = np && (np->pendingAttrs || np->pendingFingerprint.isvalid);
+    if (sharePending)
+    {
+        // the copy decodes the same values on its own, if they are ever needed
+        this->pendingAttrs = np->pendingAttrs;
+        this->pendingFingerprint = np->pendingFingerprint;
+        this->duration = -1;
+        this->latitude = INVALID_COORDINATE;
+        this->longitude = INVALID_COORDINATE;
+        this->restorehandle = UNDEF;
+        this->mFavourite = false;
+        this->mLabel = LBL_UNKNOWN;
+    }
+    else
+    {
+        this->fingerprint = MegaApi::strdup(node->getFingerprint());
+        this->originalfingerprint = MegaApi::strdup(node->getOriginalFingerprint());
+        this->duration = np ? np->duration : node->getDuration();
+        this->latitude = node->getLatitude();
+        this->longitude = node->getLongitude();
+        this->restorehandle = node->getRestoreHandle();
+        this->mFavourite = node->isFavourite();
+        this->mLabel = static_cast<nodelabel_t>(node->getLabel());
+    }
+
     if (np)
     {
-        this->duration = np->duration;
         this->width = np->width;
         this->height = np->height;
         this->shortformat = np->shortformat;
         this->videocodecid = np->videocodecid;
-        this->mFavourite = np->mFavourite;
-        this->mLabel = np->mLabel;
     }
     else
     {
-        this->duration = node->getDuration();
         this->width = node->getWidth();
         this->height = node->getHeight();
         this->shortformat = node->getShortformat();
         this->videocodecid = node->getVideocodecid();
-        this->mFavourite = node->isFavourite();
-        this->mLabel = static_cast<nodelabel_t>(node->getLabel());
     }
 
-    this->latitude = node->getLatitude();
-    this->longitude = node->getLongitude();
-    this->restorehandle = node->getRestoreHandle();
-    this->type = node->getType();
     this->size = node->getSize();
     this->ctime = node->getCreationTime();
     this->mtime = node->getModificationTime();
@@ -231,7 +247,7 @@ MegaNodePrivate::MegaNodePrivate(MegaNode *node)
     }
     this->mNewLinkFormat = np->isNewLinkFormat();
 
-    if (node->hasCustomAttrs())
+    if (!sharePending && node->hasCustomAttrs())
     {
         this->customAttrs = new attr_map();
         MegaStringList *names = node->getCustomAttrNames();
@@ -256,24 +272,6 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->originalfingerprint = NULL;
     this->children = NULL;
     this->chatAuth = NULL;
-
-    if (node->isvalid)
-    {
-        string fingerprint;
-        node->serializefingerprint(&fingerprint);
-        m_off_t size = node->size;
-        char bsize[sizeof(size)+1];
-        int l = Serialize64::serialize((byte *)bsize, size);
-        char *buf = new char[l * 4 / 3 + 4];
-        char ssize = static_cast<char>('A' + Base64::btoa((const byte *)bsize, l, buf));
-        string result(1, ssize);
-        result.append(buf);
-        result.append(fingerprint);
-        delete [] buf;
-
-        this->fingerprint = MegaApi::strdup(result.c_str());
-    }
-
     this->duration = -1;
     this->width = -1;
     this->height = -1;
@@ -285,143 +283,42 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->restorehandle = UNDEF;
     this->mFavourite = false;
     this->mLabel = LBL_UNKNOWN;
+    this->type = node->type;
 
-    char buf[10];
+    // Most apps read a few fields of the nodes they list, so the attributes are decoded on first
+    // access. Only the ones decodeAttrs() uses are kept (the name is already copied, and "c" is
+    // overridden by the fingerprint of valid nodes), which is none for most nodes.
+    if (node->isvalid)
+    {
+        pendingFingerprint = *node;
+    }
+
+    attr_map* pending = nullptr;
+    bool hasGps = false;
     for (attr_map::iterator it = node->attrs.map.begin(); it != node->attrs.map.end(); it++)
     {
-        int attrlen = node->attrs.nameid2string(it->first, buf);
-        buf[attrlen] = '\0';
-        if (buf[0] == '_')
+        if (it->first == AttrMap::string2nameid("n") || (it->first == AttrMap::string2nameid("c") && node->isvalid))
         {
-           if (!customAttrs)
-           {
-               customAttrs = new attr_map();
-           }
-
-           nameid id = AttrMap::string2nameid(&buf[1]);
-           (*customAttrs)[id] = it->second;
+            continue;
         }
-        else
-        {
-            if (it->first == AttrMap::string2nameid("d"))
-            {
-               if (node->type == FILENODE)
-               {
-                   duration = int(Base64::atoi(&it->second));
-               }
-            }
-            else if (it->first == AttrMap::string2nameid("l") || it->first == AttrMap::string2nameid("gp"))
-            {
-                if (node->type == FILENODE)
-                {
-                    string coords = it->second;
-                    if ((it->first == AttrMap::string2nameid("l") && coords.size() != 8) ||
-                        (it->first == AttrMap::string2nameid("gp") && coords.size() != Base64Str<16>::STRLEN))
-                    {
-                       LOG_warn << "Malformed GPS coordinates attribute";
-                    }
-                    else
-                    {
-                        bool ok = true;
-                        if (it->first == AttrMap::string2nameid("gp"))
-                        {
-                            if (node->client && node->client->unshareablekey.size() == Base64Str<SymmCipher::KEYLENGTH>::STRLEN && coords.size() == Base64Str<16>::STRLEN)
-                            {
-                                SymmCipher c;
-                                byte data[SymmCipher::BLOCKSIZE] = { 0 };
-                                Base64::atob(coords.data(), data, Base64Str<SymmCipher::BLOCKSIZE>::STRLEN);
 
-                                node->client->setkey(&c, node->client->unshareablekey.data());
-                                c.ctr_crypt(data, SymmCipher::BLOCKSIZE, 0, 0, NULL, false);
-                                ok = !memcmp(data, "unshare/", 8);
-                                if (ok)
-                                {
-                                    coords = string((char*)data + 8, 8);
-                                }
-                            }
-                            else
-                            {
-                                ok = false;
-                            }
-                        }
-
-                        if (ok)
-                        {
-                            byte buf[3];
-                            int number = 0;
-                            if (Base64::atob((const char *)coords.substr(0, 4).data(), buf, sizeof(buf)) == sizeof(buf))
-                            {
-                                number = (buf[2] << 16) | (buf[1] << 8) | (buf[0]);
-                                latitude = -90 + 180 * (double)number / 0xFFFFFF;
-                            }
-
-                            if (Base64::atob((const char *)coords.substr(4, 4).data(), buf, sizeof(buf)) == sizeof(buf))
-                            {
-                                number = (buf[2] << 16) | (buf[1] << 8) | (buf[0]);
-                                longitude = -180 + 360 * (double)number / 0x01000000;
-                            }
-                        }
-                    }
-
-                    if (longitude < -180 || longitude > 180)
-                    {
-                        longitude = INVALID_COORDINATE;
-                    }
-                    if (latitude < -90 || latitude > 90)
-                    {
-                        latitude = INVALID_COORDINATE;
-                    }
-                    if (longitude == INVALID_COORDINATE || latitude == INVALID_COORDINATE)
-                    {
-                        longitude = INVALID_COORDINATE;
-                        latitude = INVALID_COORDINATE;
-                    }
-               }
-            }
-            else if (it->first == AttrMap::string2nameid("rr"))
-            {
-                handle rr = 0;
-                if (Base64::atob(it->second.c_str(), (byte *)&rr, sizeof(rr)) == MegaClient::NODEHANDLE)
-                {
-                    restorehandle = rr;
-                }
-            }
-            else if (it->first == AttrMap::string2nameid("c") && !fingerprint)
-            {
-                fingerprint = MegaApi::strdup(it->second.c_str());
-            }
-            else if (it->first == AttrMap::string2nameid("c0"))
-            {
-                originalfingerprint = MegaApi::strdup(it->second.c_str());
-            }
-            else if (it->first == AttrMap::string2nameid("fav"))
-            {
-                int fav = std::atoi(it->second.c_str());
-                if (fav != 1)
-                {
-                    LOG_err << "Invalid value for node attr fav: " << fav;
-                }
-                else
-                {
-                    mFavourite = fav;
-                }
-            }
-            else if (it->first == AttrMap::string2nameid("lbl"))
-            {
-                int lbl = std::atoi(it->second.c_str());
-                if (lbl < LBL_RED || lbl > LBL_GREY)
-                {
-                    LOG_err << "Invalid value for node attr lbl: " << lbl;
-                }
-                else
-                {
-                    mLabel = static_cast<nodelabel_t>(lbl);
-                }
-            }
+        if (!pending)
+        {
+            pending = new attr_map();
+            pendingAttrs.reset(pending);
         }
+        pending->insert(*it);
+        hasGps = hasGps || it->first == AttrMap::string2nameid("gp");
+    }
+
+    if (hasGps)
+    {
+        // the coordinates are decrypted with a key of the client, so they can't wait
+        decodePendingAttrs(node->client);
+        pendingAttrs.reset();
+        pendingFingerprint = FileFingerprint();
     }
 
-    this->type = node->type;
     this->size = node->size;
     this->ctime = node->ctime;
     this->mtime = node->mtime;
@@ -541,6 +438,8 @@ char *MegaNodePrivate::serialize()
 
 bool MegaNodePrivate::serialize(string *d)
 {
+    decodePendingAttrs();
+
     CacheableWriter w(*d);
     w.serializecstr(name, true);
     w.serializecstr(fingerprint, true);
@@ -653,21 +552,26 @@ const char* MegaNodePrivate::getName()
 
 const char *MegaNodePrivate::getFingerprint()
 {
+    decodePendingAttrs();
     return fingerprint;
 }
 
 const char *MegaNodePrivate::getOriginalFingerprint()
 {
+    decodePendingAttrs();
     return originalfingerprint;
 }
 
 bool MegaNodePrivate::hasCustomAttrs()
 {
+    decodePendingAttrs();
     return customAttrs != NULL;
 }
 
 MegaStringList *MegaNodePrivate::getCustomAttrNames()
 {
+    decodePendingAttrs();
+
     if (!customAttrs)
     {
         return new MegaStringList();
@@ -687,6 +591,8 @@ MegaStringList *MegaNodePrivate::getCustomAttrNames()
 
 const char *MegaNodePrivate::getCustomAttr(const char *attrName)
 {
+    decodePendingAttrs();
+
     if (!customAttrs)
     {
         return NULL;
@@ -709,6 +615,8 @@ const char *MegaNodePrivate::getCustomAttr(const char *attrName)
 
 int MegaNodePrivate::getDuration()
 {
+    decodePendingAttrs();
+
     if (type == MegaNode::TYPE_FILE && nodekey.size() == FILENODEKEYLENGTH && fileattrstring.size())
     {
         uint32_t* attrKey = (uint32_t*)(nodekey.data() + FILENODEKEYLENGTH / 2);
@@ -726,11 +634,13 @@ int MegaNodePrivate::getDuration()
 
 bool MegaNodePrivate::isFavourite()
 {
+    decodePendingAttrs();
     return mFavourite;
 }
 
 int MegaNodePrivate::getLabel()
 {
+    decodePendingAttrs();
     return mLabel;
 }
 
@@ -816,11 +726,13 @@ int MegaNodePrivate::getVideocodecid()
 
 double MegaNodePrivate::getLatitude()
 {
+    decodePendingAttrs();
     return latitude;
 }
 
 double MegaNodePrivate::getLongitude()
 {
+    decodePendingAttrs();
     return longitude;
 }
 
@@ -841,6 +753,7 @@ int64_t MegaNodePrivate::getModificationTime()
 
 MegaHandle MegaNodePrivate::getRestoreHandle()
 {
+    decodePendingAttrs();
     return restorehandle;
 }
 
@@ -921,6 +834,8 @@ MegaNode* MegaNodePrivate::getPublicNode()
         return NULL;
     }
 
+    decodePendingAttrs();
+
     char *skey = getBase64Key();
     string key(skey);
 
@@ -2155,6 +2070,173 @@ MegaNode *MegaNodePrivate::fromNode(Node *node)
     return new MegaNodePrivate(node);
 }
 
+void MegaNodePrivate::decodePendingAttrs(MegaClient* client)
+{
+    std::call_once(pendingDecoded, [this, client]()
+    {
+        if (pendingFingerprint.isvalid)
+        {
+            string fp;
+            pendingFingerprint.serializefingerprint(&fp);
+            m_off_t size = pendingFingerprint.size;
+            char bsize[sizeof(size)+1];
+            int l = Serialize64::serialize((byte *)bsize, size);
+            char *buf = new char[l * 4 / 3 + 4];
+            char ssize = static_cast<char>('A' + Base64::btoa((const byte *)bsize, l, buf));
+            string result(1, ssize);
+            result.append(buf);
+            result.append(fp);
+            delete [] buf;
+
+            fingerprint = MegaApi::strdup(result.c_str());
+        }
+
+        if (pendingAttrs)
+        {
+            decodeAttrs(*pendingAttrs, client);
+        }
+    });
+}
+
+void MegaNodePrivate::decodeAttrs(const attr_map& attrs, MegaClient* client)
+{
+    char buf[10];
+    for (attr_map::const_iterator it = attrs.begin(); it != attrs.end(); it++)
+    {
+        int attrlen = AttrMap::nameid2string(it->first, buf);
+        buf[attrlen] = '\0';
+        if (buf[0] == '_')
+        {
+           if (!customAttrs)
+           {
+               customAttrs = new attr_map();
+           }
+
+           nameid id = AttrMap::string2nameid(&buf[1]);
+           (*customAttrs)[id] = it->second;
+        }
+        else
+        {
+            if (it->first == AttrMap::string2nameid("d"))
+            {
+               if (type == FILENODE)
+               {
+                   string value = it->second;
+                   duration = int(Base64::atoi(&value));
+               }
+            }
+            else if (it->first == AttrMap::string2nameid("l") || it->first == AttrMap::string2nameid("gp"))
+            {
+                if (type == FILENODE)
+                {
+                    string coords = it->second;
+                    if ((it->first == AttrMap::string2nameid("l") && coords.size() != 8) ||
+                        (it->first == AttrMap::string2nameid("gp") && coords.size() != Base64Str<16>::STRLEN))
+                    {
+                       LOG_warn << "Malformed GPS coordinates attribute";
+                    }
+                    else
+                    {
+                        bool ok = true;
+                        if (it->first == AttrMap::string2nameid("gp"))
+                        {
+                            if (client && client->unshareablekey.size() == Base64Str<SymmCipher::KEYLENGTH>::STRLEN && coords.size() == Base64Str<16>::STRLEN)
+                            {
+                                SymmCipher c;
+                                byte data[SymmCipher::BLOCKSIZE] = { 0 };
+                                Base64::atob(coords.data(), data, Base64Str<SymmCipher::BLOCKSIZE>::STRLEN);
+
+                                client->setkey(&c, client->unshareablekey.data());
+                                c.ctr_crypt(data, SymmCipher::BLOCKSIZE, 0, 0, NULL, false);
+                                ok = !memcmp(data, "unshare/", 8);
+                                if (ok)
+                                {
+                                    coords = string((char*)data + 8, 8);
+                                }
+                            }
+                            else
+                            {
+                                ok = false;
+                            }
+                        }
+
+                        if (ok)
+                        {
+                            byte buf[3];
+                            int number = 0;
+                            if (Base64::atob((const char *)coords.substr(0, 4).data(), buf, sizeof(buf)) == sizeof(buf))
+                            {
+                                number = (buf[2] << 16) | (buf[1] << 8) | (buf[0]);
+                                latitude = -90 + 180 * (double)number / 0xFFFFFF;
+                            }
+
+                            if (Base64::atob((const char *)coords.substr(4, 4).data(), buf, sizeof(buf)) == sizeof(buf))
+                            {
+                                number = (buf[2] << 16) | (buf[1] << 8) | (buf[0]);
+                                longitude = -180 + 360 * (double)number / 0x01000000;
+                            }
+                        }
+                    }
+
+                    if (longitude < -180 || longitude > 180)
+                    {
+                        longitude = INVALID_COORDINATE;
+                    }
+                    if (latitude < -90 || latitude > 90)
+                    {
+                        latitude = INVALID_COORDINATE;
+                    }
+                    if (longitude == INVALID_COORDINATE || latitude == INVALID_COORDINATE)
+                    {
+                        longitude = INVALID_COORDINATE;
+                        latitude = INVALID_COORDINATE;
+                    }
+               }
+            }
+            else if (it->first == AttrMap::string2nameid("rr"))
+            {
+                handle rr = 0;
+                if (Base64::atob(it->second.c_str(), (byte *)&rr, sizeof(rr)) == MegaClient::NODEHANDLE)
+                {
+                    restorehandle = rr;
+                }
+            }
+            else if (it->first == AttrMap::string2nameid("c") && !fingerprint)
+            {
+                fingerprint = MegaApi::strdup(it->second.c_str());
+            }
+            else if (it->first == AttrMap::string2nameid("c0"))
+            {
+                originalfingerprint = MegaApi::strdup(it->second.c_str());
+            }
+            else if (it->first == AttrMap::string2nameid("fav"))
+            {
+                int fav = std::atoi(it->second.c_str());
+                if (fav != 1)
+                {
+                    LOG_err << "Invalid value for node attr fav: " << fav;
+                }
+                else
+                {
+                    mFavourite = fav;
+                }
+            }
+            else if (it->first == AttrMap::string2nameid("lbl"))
+            {
+                int lbl = std::atoi(it->second.c_str());
+                if (lbl < LBL_RED || lbl > LBL_GREY)
+                {
+                    LOG_err << "Invalid value for node attr lbl: " << lbl;
+                }
+                else
+                {
+                    mLabel = static_cast<nodelabel_t>(lbl);
+                }
+            }
+        }
+    }
+}
+
 MegaSharePrivate::MegaSharePrivate(MegaShare *share) : MegaShare()
 {
     this->nodehandle = share->getNodeHandle();
@@ -4416,6 +4498,25 @@ void MegaNodeListPrivate::addNode(MegaNode *node)
     }
 }
 
+void MegaNodeListPrivate::takeNodes(MegaNodeListPrivate& other)
+{
+    if (!other.s)
+    {
+        return;
+    }
+
+    MegaNode** merged = new MegaNode*[s + other.s];
+    std::copy(list, list + s, merged);
+    std::copy(other.list, other.list + other.s, merged + s);
+    delete [] list;
+    delete [] other.list;
+
+    list = merged;
+    s += other.s;
+    other.list = NULL;
+    other.s = 0;
+}
+
 MegaUserListPrivate::MegaUserListPrivate()
 {
     list = NULL;
@@ -5253,6 +5354,7 @@ void MegaApiImpl::init(MegaApi *api, const char *appKey, MegaGfxProcessor* proce
     httpServerMaxOutputSize = 0;
     httpServerEnableFiles = true;
     httpServerEnableFolders = false;
+    httpServerMetricsEnabled = false;
     httpServerOfflineAttributeEnabled = false;
     httpServerRestrictedMode = MegaApi::TCP_SERVER_ALLOW_CREATED_LOCAL_LINKS;
     httpServerSubtitlesSupportEnabled = false;
@@ -5344,6 +5446,9 @@ MegaApiImpl::~MegaApiImpl()
 #endif
 
     fireOnRequestFinish(request, make_unique<MegaErrorPrivate>(API_OK));
+
+    // the listeners may be deleted right after this returns
+    eventDispatcher.reset();
 }
 
 MegaApiImpl* MegaApiImpl::ImplOf(MegaApi* api)
@@ -5629,11 +5734,51 @@ void MegaApiImpl::setLogToConsole(bool enable)
     externalLogger.setLogToConsole(enable);
 }
 
+bool MegaApiImpl::setLogAsync(bool enable, const char *binaryFilePath)
+{
+    return externalLogger.setLogAsync(enable, binaryFilePath);
+}
+
 void MegaApiImpl::log(int logLevel, const char *message, const char *filename, int line)
 {
     externalLogger.postLog(logLevel, message, filename, line);
 }
 
+void MegaApiImpl::setMetricsEnabled(bool enable)
+{
+    g_metrics.setEnabled(enable);
+}
+
+bool MegaApiImpl::isMetricsEnabled()
+{
+    return g_metrics.enabled();
+}
+
+MegaMetrics *MegaApiImpl::getMetrics()
+{
+    return new MegaMetricsPrivate(g_metrics.snapshot());
+}
+
+void MegaApiImpl::setTracingEnabled(bool enable)
+{
+    g_tracer.setEnabled(enable);
+}
+
+bool MegaApiImpl::isTracingEnabled()
+{
+    return g_tracer.enabled();
+}
+
+char *MegaApiImpl::getTrace(bool clear)
+{
+    string json = g_tracer.chromeTraceJson();
+    if (clear)
+    {
+        g_tracer.clear();
+    }
+    return MegaApi::strdup(json.c_str());
+}
+
 void MegaApiImpl::setLoggingName(const char* loggingName)
 {
     sdkMutex.lock();
@@ -7884,6 +8029,45 @@ bool MegaApiImpl::setMaxUploadSpeed(m_off_t bpslimit)
     return result;
 }
 
+bool MegaApiImpl::setHttp2Enabled(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->httpio->sethttp2(enable);
+}
+
+bool MegaApiImpl::setMaxConnectionsPerHost(int direction, int connections)
+{
+    if (connections < 0 || (direction != -1
+            && direction != MegaTransfer::TYPE_DOWNLOAD
+            && direction != MegaTransfer::TYPE_UPLOAD))
+    {
+        return false;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    bool result = true;
+    if (direction != MegaTransfer::TYPE_UPLOAD)
+    {
+        result = client->httpio->setmaxhostconnections(GET, connections);
+    }
+    if (direction != MegaTransfer::TYPE_DOWNLOAD)
+    {
+        result = client->httpio->setmaxhostconnections(PUT, connections) && result;
+    }
+    return result;
+}
+
+bool MegaApiImpl::setApiSideChannels(int channels)
+{
+    if (channels < 0)
+    {
+        return false;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    return client->setcssidechannels(unsigned(channels));
+}
+
 int MegaApiImpl::getMaxDownloadSpeed()
 {
     return int(client->getmaxdownloadspeed());
@@ -9297,6 +9481,7 @@ bool MegaApiImpl::httpServerStart(bool localOnly, int port, bool useTLS, const c
     httpServer->enableFileServer(httpServerEnableFiles);
     httpServer->enableOfflineAttribute(httpServerOfflineAttributeEnabled);
     httpServer->enableFolderServer(httpServerEnableFolders);
+    httpServer->enableMetrics(httpServerMetricsEnabled);
     httpServer->setRestrictedMode(httpServerRestrictedMode);
     httpServer->enableSubtitlesSupport(httpServerRestrictedMode);
 
@@ -9562,6 +9747,22 @@ bool MegaApiImpl::httpServerIsFolderServerEnabled()
     return httpServerEnableFolders;
 }
 
+void MegaApiImpl::httpServerEnableMetrics(bool enable)
+{
+    sdkMutex.lock();
+    this->httpServerMetricsEnabled = enable;
+    if (httpServer)
+    {
+        httpServer->enableMetrics(enable);
+    }
+    sdkMutex.unlock();
+}
+
+bool MegaApiImpl::httpServerIsMetricsEnabled()
+{
+    return httpServerMetricsEnabled;
+}
+
 bool MegaApiImpl::httpServerIsOfflineAttributeEnabled()
 {
     return httpServerOfflineAttributeEnabled;
@@ -11739,19 +11940,16 @@ long long MegaApiImpl::getSize(MegaNode *n)
         return megaSizeProcessor.getTotalBytes();
     }
 
-    sdkMutex.lock();
+    SdkMutexGuard g(sdkMutex);
     Node *node = client->nodebyhandle(n->getHandle());
-    if(!node)
+    if (!node)
     {
-        sdkMutex.unlock();
         return 0;
     }
-    SizeProcessor sizeProcessor;
-    processTree(node, &sizeProcessor);
-    long long result = sizeProcessor.getTotalBytes();
-    sdkMutex.unlock();
 
-    return result;
+    // the versions aren't included
+    NodeCounter nc = node->subnodeCounts();
+    return nc.storage - nc.versionStorage;
 }
 
 char *MegaApiImpl::getFingerprint(const char *filePath)
@@ -12123,23 +12321,6 @@ vector<Node *> &SearchTreeProcessor::getResults()
     return mResults;
 }
 
-SizeProcessor::SizeProcessor()
-{
-    totalBytes=0;
-}
-
-bool SizeProcessor::processNode(Node *node)
-{
-    if(node->type == FILENODE)
-        totalBytes += node->size;
-    return true;
-}
-
-long long SizeProcessor::getTotalBytes()
-{
-    return totalBytes;
-}
-
 void MegaApiImpl::file_added(File *f)
 {
     Transfer *t = f->transfer;
@@ -16241,7 +16422,13 @@ void MegaApiImpl::removeListener(MegaListener* listener)
 
     sdkMutex.lock();
     listeners.erase(listener);
+    std::shared_ptr<EventDispatcher> dispatcher = eventDispatcher;
     sdkMutex.unlock();
+
+    if (dispatcher)
+    {
+        dispatcher->removeListener(listener);
+    }
 }
 
 void MegaApiImpl::removeRequestListener(MegaRequestListener* listener)
@@ -16262,7 +16449,13 @@ void MegaApiImpl::removeRequestListener(MegaRequestListener* listener)
     }
 
     requestQueue.removeListener(listener);
+    std::shared_ptr<EventDispatcher> dispatcher = eventDispatcher;
     sdkMutex.unlock();
+
+    if (dispatcher)
+    {
+        dispatcher->removeListener(listener);
+    }
 }
 
 void MegaApiImpl::removeTransferListener(MegaTransferListener* listener)
@@ -16283,7 +16476,13 @@ void MegaApiImpl::removeTransferListener(MegaTransferListener* listener)
     }
 
     transferQueue.removeListener(listener);
+    std::shared_ptr<EventDispatcher> dispatcher = eventDispatcher;
     sdkMutex.unlock();
+
+    if (dispatcher)
+    {
+        dispatcher->removeListener(listener);
+    }
 }
 
 void MegaApiImpl::removeBackupListener(MegaBackupListener* listener)
@@ -16313,7 +16512,48 @@ void MegaApiImpl::removeGlobalListener(MegaGlobalListener* listener)
 
     sdkMutex.lock();
     globalListeners.erase(listener);
+    std::shared_ptr<EventDispatcher> dispatcher = eventDispatcher;
     sdkMutex.unlock();
+
+    if (dispatcher)
+    {
+        dispatcher->removeListener(listener);
+    }
+}
+
+void MegaApiImpl::setAsyncEventDelivery(bool enable, int maxQueuedProgressEvents)
+{
+    SdkMutexGuard g(sdkMutex);
+    if (enable)
+    {
+        size_t maxQueued = maxQueuedProgressEvents > 0 ? size_t(maxQueuedProgressEvents) : 0;
+        if (eventDispatcher)
+        {
+            eventDispatcher->setMaxQueued(maxQueued);
+        }
+        else
+        {
+            eventDispatcher = std::make_shared<EventDispatcher>(maxQueued);
+        }
+        eventDispatcherStopping = false;
+    }
+    else
+    {
+        // released by the SDK thread once the callbacks already queued are delivered
+        eventDispatcherStopping = eventDispatcher != nullptr;
+    }
+}
+
+int MegaApiImpl::getPendingEvents()
+{
+    SdkMutexGuard g(sdkMutex);
+    return eventDispatcher ? int(eventDispatcher->pending()) : 0;
+}
+
+long long MegaApiImpl::getDroppedEvents()
+{
+    SdkMutexGuard g(sdkMutex);
+    return eventDispatcher ? (long long)eventDispatcher->dropped() : 0;
 }
 
 void MegaApiImpl::cancelPendingTransfersByFolderTag(int folderTag)
@@ -16357,24 +16597,297 @@ MegaUserList *MegaApiImpl::getCurrentUsers()
     return activeUsers;
 }
 
-void MegaApiImpl::fireOnRequestStart(MegaRequestPrivate *request)
+namespace {
+
+// callbacks that can be delivered by MegaApiImpl::eventDispatcher
+enum EventCallback
 {
-    activeRequest = request;
-    LOG_info << "Request (" << request->getRequestString() << ") starting";
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    EVENT_START = 1,
+    EVENT_UPDATE,
+    EVENT_TEMPORARY_ERROR,
+    EVENT_FINISH,
+    EVENT_USERS,
+    EVENT_USER_ALERTS,
+    EVENT_CONTACT_REQUESTS,
+    EVENT_NODES,
+    EVENT_ACCOUNT,
+    EVENT_RELOAD,
+    EVENT_EVENT,
+    EVENT_CHATS
+};
+
+template <typename Listener>
+void callRequestListener(Listener* listener, int callback, MegaApi* api, MegaRequest* request, MegaError* e)
+{
+    switch (callback)
     {
-        (*it++)->onRequestStart(api, request);
+        case EVENT_START: listener->onRequestStart(api, request); break;
+        case EVENT_UPDATE: listener->onRequestUpdate(api, request); break;
+        case EVENT_TEMPORARY_ERROR: listener->onRequestTemporaryError(api, request, e); break;
+        case EVENT_FINISH: listener->onRequestFinish(api, request, e); break;
     }
+}
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+template <typename Listener>
+void callTransferListener(Listener* listener, int callback, MegaApi* api, MegaTransfer* transfer, MegaError* e)
+{
+    switch (callback)
+    {
+        case EVENT_START: listener->onTransferStart(api, transfer); break;
+        case EVENT_UPDATE: listener->onTransferUpdate(api, transfer); break;
+        case EVENT_TEMPORARY_ERROR: listener->onTransferTemporaryError(api, transfer, e); break;
+        case EVENT_FINISH: listener->onTransferFinish(api, transfer, e); break;
+    }
+}
+
+template <typename Listener>
+void callGlobalListener(Listener* listener, int callback, MegaApi* api, void* payload)
+{
+    switch (callback)
+    {
+        case EVENT_USERS: listener->onUsersUpdate(api, static_cast<MegaUserList*>(payload)); break;
+        case EVENT_USER_ALERTS: listener->onUserAlertsUpdate(api, static_cast<MegaUserAlertList*>(payload)); break;
+        case EVENT_CONTACT_REQUESTS: listener->onContactRequestsUpdate(api, static_cast<MegaContactRequestList*>(payload)); break;
+        case EVENT_NODES: listener->onNodesUpdate(api, static_cast<MegaNodeList*>(payload)); break;
+        case EVENT_ACCOUNT: listener->onAccountUpdate(api); break;
+        case EVENT_RELOAD: listener->onReloadNeeded(api); break;
+        case EVENT_EVENT: listener->onEvent(api, static_cast<MegaEvent*>(payload)); break;
+#ifdef ENABLE_CHAT
+        case EVENT_CHATS: listener->onChatsUpdate(api, static_cast<MegaTextChatList*>(payload)); break;
+#endif
+    }
+}
+
+template <typename Listener>
+void addRequestTarget(EventDispatcher::Event& event, Listener* listener, int callback, MegaApi* api,
+                      std::shared_ptr<MegaRequest> request, std::shared_ptr<MegaError> e)
+{
+    event.targets.push_back({listener, [listener, callback, api, request, e]()
+    {
+        callRequestListener(listener, callback, api, request.get(), e.get());
+    }});
+}
+
+template <typename Listener>
+void addTransferTarget(EventDispatcher::Event& event, Listener* listener, int callback, MegaApi* api,
+                       std::shared_ptr<MegaTransfer> transfer, std::shared_ptr<MegaError> e)
+{
+    event.targets.push_back({listener, [listener, callback, api, transfer, e]()
+    {
+        callTransferListener(listener, callback, api, transfer.get(), e.get());
+    }});
+}
+
+template <typename Listener>
+void addGlobalTarget(EventDispatcher::Event& event, Listener* listener, int callback, MegaApi* api,
+                     std::shared_ptr<void> payload)
+{
+    event.targets.push_back({listener, [listener, callback, api, payload]()
+    {
+        callGlobalListener(listener, callback, api, payload.get());
+    }});
+}
+
+// the SDK's own listeners (of a request or transfer, and the heartbeat monitor) work with the client,
+// so they stay on the SDK thread
+bool isInternalListener(MegaRequestListener* listener)
+{
+    return dynamic_cast<MegaBackupController*>(listener)
+#ifdef HAVE_LIBUV
+        || dynamic_cast<MegaTCPContext*>(listener)
+#endif
+        ;
+}
+
+bool isInternalListener(MegaTransferListener* listener)
+{
+    return dynamic_cast<MegaRecursiveOperation*>(listener)
+        || dynamic_cast<MegaBackupController*>(listener)
+#ifdef HAVE_LIBUV
+        || dynamic_cast<MegaTCPContext*>(listener)
+        || dynamic_cast<MegaStreamingCacheFetch*>(listener)
+#endif
+        ;
+}
+
+bool isInternalListener(MegaListener* listener)
+{
+    return dynamic_cast<MegaBackupMonitor*>(listener);
+}
+
+} // namespace
+
+std::shared_ptr<EventDispatcher> MegaApiImpl::asyncEventDispatcher()
+{
+    if (eventDispatcher && eventDispatcherStopping && eventDispatcher->idle())
+    {
+        // everything posted before disabling it has been delivered, so the order is kept
+        eventDispatcher.reset();
+        eventDispatcherStopping = false;
+    }
+    return eventDispatcher;
+}
+
+bool MegaApiImpl::postRequestEvent(int callback, MegaRequestPrivate *request, MegaErrorPrivate *e)
+{
+    std::shared_ptr<EventDispatcher> dispatcher = asyncEventDispatcher();
+    if (!dispatcher)
     {
-        (*it++)->onRequestStart(api, request);
+        return false;
+    }
+
+    // the request keeps changing (or is deleted) meanwhile, so the listeners get a snapshot
+    std::shared_ptr<MegaRequest> r(request->copy());
+    std::shared_ptr<MegaError> err(e ? e->copy() : nullptr);
+
+    EventDispatcher::Event event;
+    event.subject = uint64_t(unsigned(request->getTag())) | (uint64_t(1) << 32);
+    event.progress = callback == EVENT_UPDATE;
+    for (MegaRequestListener* l : requestListeners)
+    {
+        addRequestTarget(event, l, callback, api, r, err);
+    }
+    for (MegaListener* l : listeners)
+    {
+        if (isInternalListener(l))
+        {
+            callRequestListener(l, callback, api, request, e);
+        }
+        else
+        {
+            addRequestTarget(event, l, callback, api, r, err);
+        }
     }
 
     MegaRequestListener* listener = request->getListener();
-    if(listener)
+    if (listener && isInternalListener(listener))
+    {
+        callRequestListener(listener, callback, api, request, e);
+    }
+    else if (listener)
+    {
+        addRequestTarget(event, listener, callback, api, r, err);
+    }
+
+    if (!event.targets.empty())
+    {
+        dispatcher->post(std::move(event));
+    }
+    return true;
+}
+
+bool MegaApiImpl::postTransferEvent(int callback, MegaTransferPrivate *transfer, MegaErrorPrivate *e)
+{
+    std::shared_ptr<EventDispatcher> dispatcher = asyncEventDispatcher();
+    if (!dispatcher)
+    {
+        return false;
+    }
+
+    std::shared_ptr<MegaTransfer> t(transfer->copy());
+    std::shared_ptr<MegaError> err(e ? e->copy() : nullptr);
+
+    EventDispatcher::Event event;
+    event.subject = uint64_t(unsigned(transfer->getTag())) | (uint64_t(2) << 32);
+    event.progress = callback == EVENT_UPDATE;
+    for (MegaTransferListener* l : transferListeners)
     {
-        listener->onRequestStart(api, request);
+        addTransferTarget(event, l, callback, api, t, err);
+    }
+    for (MegaListener* l : listeners)
+    {
+        if (isInternalListener(l))
+        {
+            callTransferListener(l, callback, api, transfer, e);
+        }
+        else
+        {
+            addTransferTarget(event, l, callback, api, t, err);
+        }
+    }
+
+    MegaTransferListener* listener = transfer->getListener();
+    if (listener && isInternalListener(listener))
+    {
+        callTransferListener(listener, callback, api, transfer, e);
+    }
+    else if (listener)
+    {
+        addTransferTarget(event, listener, callback, api, t, err);
+    }
+
+    if (!event.targets.empty())
+    {
+        dispatcher->post(std::move(event));
+    }
+    return true;
+}
+
+bool MegaApiImpl::postGlobalEvent(int callback, std::shared_ptr<void> payload)
+{
+    std::shared_ptr<EventDispatcher> dispatcher = asyncEventDispatcher();
+    if (!dispatcher)
+    {
+        return false;
+    }
+
+    EventDispatcher::Event event;
+    for (MegaGlobalListener* l : globalListeners)
+    {
+        addGlobalTarget(event, l, callback, api, payload);
+    }
+    for (MegaListener* l : listeners)
+    {
+        if (isInternalListener(l))
+        {
+            callGlobalListener(l, callback, api, payload.get());
+        }
+        else
+        {
+            addGlobalTarget(event, l, callback, api, payload);
+        }
+    }
+
+    if (callback == EVENT_NODES && payload)
+    {
+        // node updates still queued are extended, the listeners get them all in one callback
+        event.batchType = EVENT_NODES;
+        event.batch = payload;
+        event.mergeBatch = [](void* into, void* from)
+        {
+            static_cast<MegaNodeListPrivate*>(static_cast<MegaNodeList*>(into))->takeNodes(
+                        *static_cast<MegaNodeListPrivate*>(static_cast<MegaNodeList*>(from)));
+        };
+    }
+
+    if (!event.targets.empty())
+    {
+        dispatcher->post(std::move(event));
+    }
+    return true;
+}
+
+void MegaApiImpl::fireOnRequestStart(MegaRequestPrivate *request)
+{
+    activeRequest = request;
+    LOG_info << "Request (" << request->getRequestString() << ") starting";
+    if (!postRequestEvent(EVENT_START, request, nullptr))
+    {
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestStart(api, request);
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestStart(api, request);
+        }
+
+        MegaRequestListener* listener = request->getListener();
+        if(listener)
+        {
+            listener->onRequestStart(api, request);
+        }
     }
     activeRequest = NULL;
 }
@@ -16394,20 +16907,23 @@ void MegaApiImpl::fireOnRequestFinish(MegaRequestPrivate *request, unique_ptr<Me
         LOG_info << "Request (" << request->getRequestString() << ") finished";
     }
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (!postRequestEvent(EVENT_FINISH, request, e.get()))
     {
-        (*it++)->onRequestFinish(api, request, e.get());
-    }
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestFinish(api, request, e.get());
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onRequestFinish(api, request, e.get());
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestFinish(api, request, e.get());
+        }
 
-    MegaRequestListener* listener = request->getListener();
-    if(listener)
-    {
-        listener->onRequestFinish(api, request, e.get());
+        MegaRequestListener* listener = request->getListener();
+        if(listener)
+        {
+            listener->onRequestFinish(api, request, e.get());
+        }
     }
 
     requestMap.erase(request->getTag());
@@ -16421,20 +16937,23 @@ void MegaApiImpl::fireOnRequestUpdate(MegaRequestPrivate *request)
 {
     activeRequest = request;
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (!postRequestEvent(EVENT_UPDATE, request, nullptr))
     {
-        (*it++)->onRequestUpdate(api, request);
-    }
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestUpdate(api, request);
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onRequestUpdate(api, request);
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestUpdate(api, request);
+        }
 
-    MegaRequestListener* listener = request->getListener();
-    if(listener)
-    {
-        listener->onRequestUpdate(api, request);
+        MegaRequestListener* listener = request->getListener();
+        if(listener)
+        {
+            listener->onRequestUpdate(api, request);
+        }
     }
 
     activeRequest = NULL;
@@ -16447,20 +16966,23 @@ void MegaApiImpl::fireOnRequestTemporaryError(MegaRequestPrivate *request, uniqu
 
     request->setNumRetry(request->getNumRetry() + 1);
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (!postRequestEvent(EVENT_TEMPORARY_ERROR, request, e.get()))
     {
-        (*it++)->onRequestTemporaryError(api, request, e.get());
-    }
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestTemporaryError(api, request, e.get());
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onRequestTemporaryError(api, request, e.get());
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestTemporaryError(api, request, e.get());
+        }
 
-    MegaRequestListener* listener = request->getListener();
-    if(listener)
-    {
-        listener->onRequestTemporaryError(api, request, e.get());
+        MegaRequestListener* listener = request->getListener();
+        if(listener)
+        {
+            listener->onRequestTemporaryError(api, request, e.get());
+        }
     }
 
     activeRequest = NULL;
@@ -16473,20 +16995,23 @@ void MegaApiImpl::fireOnTransferStart(MegaTransferPrivate *transfer)
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (!postTransferEvent(EVENT_START, transfer, nullptr))
     {
-        (*it++)->onTransferStart(api, transfer);
-    }
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferStart(api, transfer);
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onTransferStart(api, transfer);
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferStart(api, transfer);
+        }
 
-    MegaTransferListener* listener = transfer->getListener();
-    if(listener)
-    {
-        listener->onTransferStart(api, transfer);
+        MegaTransferListener* listener = transfer->getListener();
+        if(listener)
+        {
+            listener->onTransferStart(api, transfer);
+        }
     }
 
     activeTransfer = NULL;
@@ -16515,20 +17040,23 @@ void MegaApiImpl::fireOnTransferFinish(MegaTransferPrivate *transfer, unique_ptr
         LOG_info << "Transfer (" << transfer->getTransferString() << ") finished. File: " << transfer->getFileName();
     }
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (!postTransferEvent(EVENT_FINISH, transfer, e.get()))
     {
-        (*it++)->onTransferFinish(api, transfer, e.get());
-    }
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferFinish(api, transfer, e.get());
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onTransferFinish(api, transfer, e.get());
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferFinish(api, transfer, e.get());
+        }
 
-    MegaTransferListener* listener = transfer->getListener();
-    if(listener)
-    {
-        listener->onTransferFinish(api, transfer, e.get());
+        MegaTransferListener* listener = transfer->getListener();
+        if(listener)
+        {
+            listener->onTransferFinish(api, transfer, e.get());
+        }
     }
 
     transferMap.erase(transfer->getTag());
@@ -16551,20 +17079,23 @@ void MegaApiImpl::fireOnTransferTemporaryError(MegaTransferPrivate *transfer, un
 
     transfer->setNumRetry(transfer->getNumRetry() + 1);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (!postTransferEvent(EVENT_TEMPORARY_ERROR, transfer, e.get()))
     {
-        (*it++)->onTransferTemporaryError(api, transfer, e.get());
-    }
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onTransferTemporaryError(api, transfer, e.get());
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        }
 
-    MegaTransferListener* listener = transfer->getListener();
-    if(listener)
-    {
-        listener->onTransferTemporaryError(api, transfer, e.get());
+        MegaTransferListener* listener = transfer->getListener();
+        if(listener)
+        {
+            listener->onTransferTemporaryError(api, transfer, e.get());
+        }
     }
 
     activeTransfer = NULL;
@@ -16582,20 +17113,23 @@ void MegaApiImpl::fireOnTransferUpdate(MegaTransferPrivate *transfer)
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (!postTransferEvent(EVENT_UPDATE, transfer, nullptr))
     {
-        (*it++)->onTransferUpdate(api, transfer);
-    }
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferUpdate(api, transfer);
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onTransferUpdate(api, transfer);
-    }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferUpdate(api, transfer);
+        }
 
-    MegaTransferListener* listener = transfer->getListener();
-    if(listener)
-    {
-        listener->onTransferUpdate(api, transfer);
+        MegaTransferListener* listener = transfer->getListener();
+        if(listener)
+        {
+            listener->onTransferUpdate(api, transfer);
+        }
     }
 
     activeTransfer = NULL;
@@ -16622,13 +17156,16 @@ void MegaApiImpl::fireOnUsersUpdate(MegaUserList *users)
 {
     activeUsers = users;
 
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
-    {
-        (*it++)->onUsersUpdate(api, users);
-    }
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    if (!eventDispatcher || !postGlobalEvent(EVENT_USERS, std::shared_ptr<MegaUserList>(users ? users->copy() : nullptr)))
     {
-        (*it++)->onUsersUpdate(api, users);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onUsersUpdate(api, users);
+        }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onUsersUpdate(api, users);
+        }
     }
 
     activeUsers = NULL;
@@ -16638,13 +17175,16 @@ void MegaApiImpl::fireOnUserAlertsUpdate(MegaUserAlertList *userAlerts)
 {
     activeUserAlerts = userAlerts;
 
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
-    {
-        (*it++)->onUserAlertsUpdate(api, userAlerts);
-    }
-    for (set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end();)
+    if (!eventDispatcher || !postGlobalEvent(EVENT_USER_ALERTS, std::shared_ptr<MegaUserAlertList>(userAlerts ? userAlerts->copy() : nullptr)))
     {
-        (*it++)->onUserAlertsUpdate(api, userAlerts);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onUserAlertsUpdate(api, userAlerts);
+        }
+        for (set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end();)
+        {
+            (*it++)->onUserAlertsUpdate(api, userAlerts);
+        }
     }
 
     activeUserAlerts = NULL;
@@ -16654,13 +17194,16 @@ void MegaApiImpl::fireOnContactRequestsUpdate(MegaContactRequestList *requests)
 {
     activeContactRequests = requests;
 
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
-    {
-        (*it++)->onContactRequestsUpdate(api, requests);
-    }
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    if (!eventDispatcher || !postGlobalEvent(EVENT_CONTACT_REQUESTS, std::shared_ptr<MegaContactRequestList>(requests ? requests->copy() : nullptr)))
     {
-        (*it++)->onContactRequestsUpdate(api, requests);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onContactRequestsUpdate(api, requests);
+        }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onContactRequestsUpdate(api, requests);
+        }
     }
 
     activeContactRequests = NULL;
@@ -16670,13 +17213,16 @@ void MegaApiImpl::fireOnNodesUpdate(MegaNodeList *nodes)
 {
     activeNodes = nodes;
 
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
-    {
-        (*it++)->onNodesUpdate(api, nodes);
-    }
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    if (!eventDispatcher || !postGlobalEvent(EVENT_NODES, std::shared_ptr<MegaNodeList>(nodes ? nodes->copy() : nullptr)))
     {
-        (*it++)->onNodesUpdate(api, nodes);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onNodesUpdate(api, nodes);
+        }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onNodesUpdate(api, nodes);
+        }
     }
 
     activeNodes = NULL;
@@ -16684,42 +17230,50 @@ void MegaApiImpl::fireOnNodesUpdate(MegaNodeList *nodes)
 
 void MegaApiImpl::fireOnAccountUpdate()
 {
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+    if (!postGlobalEvent(EVENT_ACCOUNT, nullptr))
     {
-        (*it++)->onAccountUpdate(api);
-    }
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onAccountUpdate(api);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onAccountUpdate(api);
+        }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onAccountUpdate(api);
+        }
     }
 }
 
 void MegaApiImpl::fireOnReloadNeeded()
 {
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+    if (!postGlobalEvent(EVENT_RELOAD, nullptr))
     {
-        (*it++)->onReloadNeeded(api);
-    }
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onReloadNeeded(api);
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onReloadNeeded(api);
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onReloadNeeded(api);
+        }
     }
 }
 
 void MegaApiImpl::fireOnEvent(MegaEventPrivate *event)
 {
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+    std::shared_ptr<MegaEvent> payload(event);
+    if (!postGlobalEvent(EVENT_EVENT, payload))
     {
-        (*it++)->onEvent(api, event);
-    }
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onEvent(api, event);
+        }
 
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onEvent(api, event);
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onEvent(api, event);
+        }
     }
-
-    delete event;
 }
 
 #ifdef ENABLE_SYNC
@@ -16917,13 +17471,16 @@ void MegaApiImpl::fireOnBackupUpdate(MegaBackupController *backup)
 
 void MegaApiImpl::fireOnChatsUpdate(MegaTextChatList *chats)
 {
-    for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+    if (!eventDispatcher || !postGlobalEvent(EVENT_CHATS, std::shared_ptr<MegaTextChatList>(chats ? chats->copy() : nullptr)))
     {
-        (*it++)->onChatsUpdate(api, chats);
-    }
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
-    {
-        (*it++)->onChatsUpdate(api, chats);
+        for(set<MegaGlobalListener *>::iterator it = globalListeners.begin(); it != globalListeners.end() ;)
+        {
+            (*it++)->onChatsUpdate(api, chats);
+        }
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onChatsUpdate(api, chats);
+        }
     }
 }
 
@@ -17771,12 +18328,7 @@ int MegaApiImpl::getNumChildFiles(MegaNode* p)
         return 0;
     }
 
-    int numFiles = 0;
-    for (node_list::iterator it = parent->children.begin(); it != parent->children.end(); it++)
-    {
-        if ((*it)->type == FILENODE)
-            numFiles++;
-    }
+    int numFiles = int(parent->children.files());
     sdkMutex.unlock();
 
     return numFiles;
@@ -17797,12 +18349,7 @@ int MegaApiImpl::getNumChildFolders(MegaNode* p)
         return 0;
     }
 
-    int numFolders = 0;
-    for (node_list::iterator it = parent->children.begin(); it != parent->children.end(); it++)
-    {
-        if ((*it)->type != FILENODE)
-            numFolders++;
-    }
+    int numFolders = int(parent->children.size() - parent->children.files());
     sdkMutex.unlock();
 
     return numFolders;
@@ -17836,6 +18383,52 @@ MegaNodeList *MegaApiImpl::getChildren(MegaNode* p, int order)
     return new MegaNodeListPrivate(childrenNodes.data(), int(childrenNodes.size()));
 }
 
+bool MegaApiImpl::getChildrenHandles(MegaNode *p, vector<MegaHandle> &handles, string &etag)
+{
+    handles.clear();
+    if (!p || p->getType() == MegaNode::TYPE_FILE)
+    {
+        return false;
+    }
+
+    SdkMutexGuard guard(sdkMutex);
+
+    Node *parent = client->nodebyhandle(p->getHandle());
+    if (!parent || parent->type == FILENODE)
+    {
+        return false;
+    }
+
+    // FNV-1a over what the listings show of the folder and its children
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](uint64_t value)
+    {
+        hash = (hash ^ value) * 1099511628211ULL;
+    };
+    std::hash<std::string> hashName;
+    auto addNode = [&add, &hashName](const Node *n)
+    {
+        add(n->nodehandle);
+        add(uint64_t(n->ctime));
+        add(uint64_t(n->mtime));
+        add(uint64_t(n->size));
+        add(hashName(n->displayname()));
+    };
+
+    addNode(parent);
+    handles.reserve(parent->children.size());
+    for (const Node *child : parent->children)
+    {
+        handles.push_back(child->nodehandle);
+        addNode(child);
+    }
+
+    std::ostringstream oss;
+    oss << '"' << std::hex << hash << '"';
+    etag = oss.str();
+    return true;
+}
+
 MegaNodeList *MegaApiImpl::getVersions(MegaNode *node)
 {
     if (!node || node->getType() != MegaNode::TYPE_FILE)
@@ -22757,11 +23350,11 @@ void MegaApiImpl::sendPendingRequests()
                 break;
             }
 
-            TreeProcFolderInfo folderProcessor;
-            client->proctree(node, &folderProcessor, false, false);
-            MegaFolderInfo *folderInfo = folderProcessor.getResult();
-            request->setMegaFolderInfo(folderInfo);
-            delete folderInfo;
+            // the folder itself isn't included
+            NodeCounter nc = node->subnodeCounts();
+            MegaFolderInfoPrivate folderInfo(int(nc.files - nc.versions), int(nc.folders) - (node->type == FOLDERNODE ? 1 : 0),
+                                             int(nc.versions), nc.storage - nc.versionStorage, nc.versionStorage);
+            request->setMegaFolderInfo(&folderInfo);
 
             fireOnRequestFinish(request, make_unique<MegaErrorPrivate>(API_OK));
             break;
@@ -23988,6 +24581,9 @@ ExternalLogger::~ExternalLogger()
 #ifndef ENABLE_LOG_PERFORMANCE
     mutex.unlock();
 #endif
+
+    // deliver what is still queued
+    asyncLogger.reset();
 }
 
 void ExternalLogger::addMegaLogger(MegaLogger *logger)
@@ -24028,6 +24624,35 @@ void ExternalLogger::setLogToConsole(bool enable)
     this->logToConsole = enable;
 }
 
+bool ExternalLogger::setLogAsync(bool enable, const char *binaryFilePath)
+{
+    std::lock_guard<std::mutex> g(asyncLoggerMutex);
+    if (!enable)
+    {
+        if (asyncLogger)
+        {
+            SimpleLogger::setOutputClass(this);
+            asyncLogger->flush();
+            asyncLogger->setBinaryOutput(string());
+        }
+        return true;
+    }
+
+    if (!asyncLogger)
+    {
+        asyncLogger = mega::make_unique<AsyncLogger>(this);
+    }
+
+    if (!asyncLogger->setBinaryOutput(binaryFilePath ? binaryFilePath : string()))
+    {
+        LOG_err << "Unable to create the binary log file: " << binaryFilePath;
+        return false;
+    }
+
+    SimpleLogger::setOutputClass(asyncLogger.get());
+    return true;
+}
+
 void ExternalLogger::postLog(int logLevel, const char *message, const char *filename, int line)
 {
     if (SimpleLogger::logCurrentLevel < logLevel)
@@ -25179,6 +25804,9 @@ bool MegaTreeProcCopy::processMegaNode(MegaNode *n)
     return true;
 }
 
+const size_t MegaFolderUploadController::MAX_FOLDERS_PER_BATCH = 5000;
+const size_t MegaFolderUploadController::NO_PARENT = size_t(-1);
+
 MegaFolderUploadController::MegaFolderUploadController(MegaApiImpl *megaApi, MegaTransferPrivate *transfer)
 {
     this->megaApi = megaApi;
@@ -25198,31 +25826,232 @@ void MegaFolderUploadController::start(MegaNode*)
     megaApi->fireOnTransferStart(transfer);
 
     const char *name = transfer->getFileName();
-    MegaNode *parent = megaApi->getNodeByHandle(transfer->getParentHandle());
-    if(!parent)
+    Node *parent = client->nodebyhandle(transfer->getParentHandle());
+    if(!name || !*name || !parent || parent->type == FILENODE)
     {
         transfer->setState(MegaTransfer::STATE_FAILED);
         DBTableTransactionCommitter committer(client->tctable);
         megaApi->fireOnTransferFinish(transfer, make_unique<MegaErrorPrivate>(API_EARGS), committer);
+        return;
     }
-    else
+
+    mParentHandle = parent->nodehandle;
+
+    LocalFolder root;
+    root.localpath = LocalPath::fromPath(transfer->getPath(), *client->fsaccess);
+    root.name = name;
+    root.parent = NO_PARENT;
+
+    Node *child = client->childnodebyname(parent, name, false);
+    if (child && child->type == FOLDERNODE)
     {
-        auto localpath = LocalPath::fromPath(transfer->getPath(), *client->fsaccess);
-        MegaNode *child = megaApi->getChildNode(parent, name);
+        root.remoteHandle = child->nodehandle;
+    }
+    mFolders.push_back(std::move(root));
 
-        if(!child || !child->isFolder())
+    // the local hierarchy is known before anything is created remotely, so
+    // whole subtrees go in one putnodes instead of one request per folder
+    scanLocalTree();
+
+    recursive++;
+    for (size_t i = 0; i < mFolders.size(); i++)
+    {
+        if (mFolders[i].remoteHandle != UNDEF)
         {
-            pendingFolders.push_back(localpath);
-            megaApi->createFolder(name, parent, this);
+            uploadFiles(i);
+        }
+    }
+    createPendingFolders();
+    recursive--;
+
+    checkCompletion();
+}
+
+void MegaFolderUploadController::scanLocalTree()
+{
+    // breadth-first, so every folder is stored after its parent
+    for (size_t i = 0; i < mFolders.size(); i++)
+    {
+        LocalPath localPath = mFolders[i].localpath;
+        Node *remoteFolder = mFolders[i].remoteHandle != UNDEF ? client->nodebyhandle(mFolders[i].remoteHandle) : nullptr;
+
+        std::unique_ptr<DirAccess> da(client->fsaccess->newdiraccess());
+        if (!da->dopen(&localPath, NULL, false))
+        {
+            continue;
+        }
+
+        FileSystemType fsType = client->fsaccess->getlocalfstype(localPath);
+
+        LocalPath localname;
+        nodetype_t dirEntryType;
+        while (da->dnext(localPath, localname, client->followsymlinks, &dirEntryType))
+        {
+            if (dirEntryType != FOLDERNODE)
+            {
+                continue;
+            }
+
+            LocalFolder folder;
+            folder.localpath = localPath;
+            folder.localpath.appendWithSeparator(localname, false);
+            folder.name = localname.toName(*client->fsaccess, fsType);
+            folder.parent = i;
+
+            // reuse the folders that already exist in the cloud
+            Node *child = remoteFolder ? client->childnodebyname(remoteFolder, folder.name.c_str(), false) : nullptr;
+            if (child && child->type == FOLDERNODE)
+            {
+                folder.remoteHandle = child->nodehandle;
+            }
+
+            mFolders.push_back(std::move(folder));
+        }
+    }
+}
+
+void MegaFolderUploadController::createPendingFolders()
+{
+    // folders that can be created now, grouped by the existing node they are created under.
+    // A folder whose parent goes in the same batch refers to it by its temporary handle
+    std::map<handle, vector<size_t>> batches;
+    vector<handle> batchTarget(mFolders.size(), UNDEF);
+
+    for (size_t i = 0; i < mFolders.size(); i++)
+    {
+        LocalFolder& folder = mFolders[i];
+        if (folder.remoteHandle != UNDEF || folder.requested || folder.failed)
+        {
+            continue;
+        }
+
+        handle target = mParentHandle;
+        if (folder.parent != NO_PARENT)
+        {
+            const LocalFolder& parent = mFolders[folder.parent];
+            if (parent.failed)
+            {
+                folder.failed = true;
+                mIncompleteTransfers++;
+                continue;
+            }
+
+            target = parent.remoteHandle != UNDEF ? parent.remoteHandle : batchTarget[folder.parent];
+            if (target == UNDEF)
+            {
+                // the parent is still being created by a previous batch
+                continue;
+            }
+        }
+
+        vector<size_t>& batch = batches[target];
+        if (batch.size() >= MAX_FOLDERS_PER_BATCH)
+        {
+            continue;
+        }
+
+        batch.push_back(i);
+        batchTarget[i] = target;
+        folder.requested = true;
+    }
+
+    for (auto& batch : batches)
+    {
+        vector<NewNode> newnodes(batch.second.size());
+        for (size_t j = 0; j < batch.second.size(); j++)
+        {
+            size_t i = batch.second[j];
+            const LocalFolder& folder = mFolders[i];
+
+            client->putnodes_prepareOneFolder(&newnodes[j], folder.name);
+            newnodes[j].nodehandle = handle(i + 1);
+            if (folder.parent != NO_PARENT && mFolders[folder.parent].remoteHandle == UNDEF)
+            {
+                newnodes[j].parenthandle = handle(folder.parent + 1);
+            }
+        }
+
+        LOG_debug << "Creating " << newnodes.size() << " folders for folder upload";
+
+        std::weak_ptr<int> alive = mAliveToken;
+        vector<size_t> folders = std::move(batch.second);
+        mPendingBatches++;
+        client->reqs.add(new CommandPutNodes(client, batch.first, NULL, move(newnodes), tag, PUTNODES_APP, NULL,
+            [this, alive, folders](const Error& e, targettype_t, vector<NewNode>& nn, bool)
+            {
+                if (!alive.expired())
+                {
+                    onFoldersCreated(e, nn, folders);
+                }
+            }));
+    }
+}
+
+void MegaFolderUploadController::onFoldersCreated(const Error& e, vector<NewNode>& nn, const vector<size_t>& folders)
+{
+    mPendingBatches--;
+    if (cancelled)
+    {
+        return;
+    }
+
+    recursive++;
+    for (size_t j = 0; j < folders.size(); j++)
+    {
+        LocalFolder& folder = mFolders[folders[j]];
+        folder.requested = false;
+
+        if (!e && j < nn.size() && nn[j].added && nn[j].mAddedHandle != UNDEF)
+        {
+            folder.remoteHandle = nn[j].mAddedHandle;
+            uploadFiles(folders[j]);
         }
         else
         {
-            pendingFolders.push_front(localpath);
-            onFolderAvailable(child->getHandle());
+            LOG_err << "Unable to create remote folder for: " << folder.localpath.toPath(*client->fsaccess);
+            folder.failed = true;
+            mLastError = MegaErrorPrivate(e ? e : Error(API_EINTERNAL));
+            mIncompleteTransfers++;
         }
+    }
 
-        delete child;
-        delete parent;
+    // the children of the folders created just now can go next
+    createPendingFolders();
+    recursive--;
+
+    checkCompletion();
+}
+
+void MegaFolderUploadController::uploadFiles(size_t folder)
+{
+    LocalPath localPath = mFolders[folder].localpath;
+    std::unique_ptr<MegaNode> parent(megaApi->getNodeByHandle(mFolders[folder].remoteHandle));
+    if (!parent)
+    {
+        LOG_err << "Remote folder not found for: " << localPath.toPath(*client->fsaccess);
+        mLastError = API_ENOENT;
+        mIncompleteTransfers++;
+        return;
+    }
+
+    std::unique_ptr<DirAccess> da(client->fsaccess->newdiraccess());
+    if (da->dopen(&localPath, NULL, false))
+    {
+        FileSystemType fsType = client->fsaccess->getlocalfstype(localPath);
+
+        LocalPath localname;
+        nodetype_t dirEntryType;
+        while (da->dnext(localPath, localname, client->followsymlinks, &dirEntryType))
+        {
+            if (dirEntryType == FILENODE)
+            {
+                ScopedLengthRestore restoreLen(localPath);
+                localPath.appendWithSeparator(localname, false);
+
+                pendingTransfers++;
+                megaApi->startUpload(false, localPath.toPath(*client->fsaccess).c_str(), parent.get(), (const char *)NULL, -1, tag, false, NULL, false, false, fsType, this);
+            }
+        }
     }
 }
 
@@ -25322,61 +26151,9 @@ void MegaFolderUploadController::cancel()
     transfer = nullptr;  // no final callback for this one since it is being destroyed now
 }
 
-void MegaFolderUploadController::onFolderAvailable(MegaHandle handle)
-{
-    recursive++;
-    auto localPath = pendingFolders.front();
-    pendingFolders.pop_front();
-
-    MegaNode *parent = megaApi->getNodeByHandle(handle);
-
-    LocalPath localname;
-    DirAccess* da;
-    da = client->fsaccess->newdiraccess();
-    if (da->dopen(&localPath, NULL, false))
-    {
-        FileSystemType fsType = client->fsaccess->getlocalfstype(localPath);
-
-        nodetype_t dirEntryType;
-        while (da->dnext(localPath, localname, client->followsymlinks, &dirEntryType))
-        {
-            ScopedLengthRestore restoreLen(localPath);
-            localPath.appendWithSeparator(localname, false);
-
-            string name = localname.toName(*client->fsaccess, fsType);
-            if (dirEntryType == FILENODE)
-            {
-                pendingTransfers++;
-                megaApi->startUpload(false, localPath.toPath(*client->fsaccess).c_str(), parent, (const char *)NULL, -1, tag, false, NULL, false, false, fsType, this);
-            }
-            else if (dirEntryType == FOLDERNODE)
-            {
-                MegaNode *child = megaApi->getChildNode(parent, name.c_str());
-                if(!child || !child->isFolder())
-                {
-                    pendingFolders.push_back(localPath);
-                    megaApi->createFolder(name.c_str(), parent, this);
-                }
-                else
-                {
-                    pendingFolders.push_front(localPath);
-                    onFolderAvailable(child->getHandle());
-                }
-                delete child;
-            }
-        }
-    }
-
-    delete da;
-    delete parent;
-    recursive--;
-
-    checkCompletion();
-}
-
 void MegaFolderUploadController::checkCompletion()
 {
-    if (!cancelled && !recursive && !pendingFolders.size() && !pendingTransfers)
+    if (!cancelled && !recursive && !mPendingBatches && !pendingTransfers)
     {
         LOG_debug << "Folder transfer finished - " << transfer->getTransferredBytes() << " of " << transfer->getTotalBytes();
         transfer->setState(MegaTransfer::STATE_COMPLETED);
@@ -25386,27 +26163,6 @@ void MegaFolderUploadController::checkCompletion()
     }
 }
 
-void MegaFolderUploadController::onRequestFinish(MegaApi *, MegaRequest *request, MegaError *e)
-{
-    int type = request->getType();
-    int errorCode = e->getErrorCode();
-
-    if (type == MegaRequest::TYPE_CREATE_FOLDER)
-    {
-        if (!errorCode)
-        {
-            onFolderAvailable(request->getNodeHandle());
-        }
-        else
-        {
-            pendingFolders.pop_front();
-            mLastError = *e;
-            mIncompleteTransfers++;
-            checkCompletion();
-        }
-    }
-}
-
 void MegaFolderUploadController::onTransferStart(MegaApi *, MegaTransfer *t)
 {
     subTransfers.insert(static_cast<MegaTransferPrivate*>(t));
@@ -25459,14 +26215,6 @@ void MegaFolderUploadController::onTransferFinish(MegaApi *, MegaTransfer *t, Me
     }
 }
 
-MegaFolderUploadController::~MegaFolderUploadController()
-{
-    //we dettach this as request listener: could be pending create folder req finish
-    megaApi->removeRequestListener(this);
-
-    //we shouldn't need to dettach as transfer listener: all listened transfer should have been cancelled/completed
-}
-
 MegaBackupController::MegaBackupController(MegaApiImpl *megaApi, int tag, int folderTransferTag, handle parenthandle, const char* filename, bool attendPastBackups, const char *speriod, int64_t period, int maxBackups)
 {
     LOG_info << "Registering backup for folder " << filename << " period=" << period << " speriod=" << speriod << " Number-of-Backups=" << maxBackups;
@@ -26562,6 +27310,8 @@ MegaBackupController::~MegaBackupController()
     }
 }
 
+const int MegaFolderDownloadController::MAX_PENDING_SUBTRANSFERS = 5000;
+
 MegaFolderDownloadController::MegaFolderDownloadController(MegaApiImpl *megaApi, MegaTransferPrivate *transfer)
 {
     this->megaApi = megaApi;
@@ -26626,18 +27376,28 @@ void MegaFolderDownloadController::start(MegaNode *node)
     path.ensureWinExtendedPathLenPrefix();
 
     transfer->setPath(path.toPath(*client->fsaccess).c_str());
-    downloadFolderNode(node, path, fsType);
+
+    mFsType = fsType;
+    mPendingFolders.push_back(PendingFolder{node->getHandle(), node->isForeign() ? node : nullptr, path});
 
     if (deleteNode)
     {
+        // the walk only keeps handles for nodes that aren't foreign
         delete node;
     }
+
+    downloadPendingFolders();
 }
 
 void MegaFolderDownloadController::cancel()
 {
     cancelled = true; //we dont want to further checkcompletion, and produce multile fireOnTransferFinish -> multiple deletions
 
+    // stop walking the remote tree
+    mPendingFolders.clear();
+    mChildren = nullptr;
+    mOwnedChildren.reset();
+
     //remove subtransfers from pending transferQueue
     megaApi->cancelPendingTransfersByFolderTag(tag);
 
@@ -26729,23 +27489,68 @@ void MegaFolderDownloadController::cancel()
     transfer = nullptr;  // no final callback for this one since it is being destroyed now
 }
 
-void MegaFolderDownloadController::downloadFolderNode(MegaNode *node, LocalPath& localpath, FileSystemType fsType)
+void MegaFolderDownloadController::downloadPendingFolders()
 {
+    // the walk is resumed from onTransferFinish(), so keep the number of queued files bounded
+    // instead of creating every folder and transfer of a huge tree in one go
     recursive++;
 
+    while (!cancelled && pendingTransfers < MAX_PENDING_SUBTRANSFERS)
+    {
+        if (!mChildren)
+        {
+            if (mPendingFolders.empty())
+            {
+                break;
+            }
+
+            PendingFolder folder = std::move(mPendingFolders.front());
+            mPendingFolders.pop_front();
+            openFolder(folder);
+            continue;
+        }
+
+        if (mChildIndex >= mChildren->size())
+        {
+            mChildren = nullptr;
+            mOwnedChildren.reset();
+            continue;
+        }
+
+        MegaNode *child = mChildren->get(mChildIndex++);
+
+        LocalPath localpath = mChildrenPath;
+        localpath.appendWithSeparator(LocalPath::fromName(child->getName(), *client->fsaccess, mFsType), true);
+
+        if (child->getType() == MegaNode::TYPE_FILE)
+        {
+            string utf8path = localpath.toPath(*client->fsaccess);
+            pendingTransfers++;
+            megaApi->startDownload(false, child, utf8path.c_str(), tag, transfer->getAppData(), this);
+        }
+        else
+        {
+            mPendingFolders.push_back(PendingFolder{child->getHandle(), child->isForeign() ? child : nullptr, std::move(localpath)});
+        }
+    }
+
+    recursive--;
+    checkCompletion();
+}
+
+bool MegaFolderDownloadController::openFolder(PendingFolder& folder)
+{
+    LocalPath& localpath = folder.localpath;
+
     auto da = client->fsaccess->newfileaccess();
     if (!da->fopen(localpath, true, false))
     {
         if (!client->fsaccess->mkdirlocal(localpath))
         {
-            da.reset();
             LOG_err << "Unable to create folder: " << localpath.toPath(*client->fsaccess);
-
-            recursive--;
             mLastError = API_EWRITE;
             mIncompleteTransfers++;
-            checkCompletion();
-            return;
+            return false;
         }
     }
     else if (da->type != FILENODE)
@@ -26754,70 +27559,43 @@ void MegaFolderDownloadController::downloadFolderNode(MegaNode *node, LocalPath&
     }
     else
     {
-        da.reset();
         LOG_err << "Local file detected where there should be a folder: " << localpath.toPath(*client->fsaccess);
-
-        recursive--;
         mLastError = API_EEXIST;
         mIncompleteTransfers++;
-        checkCompletion();
-        return;
+        return false;
     }
     da.reset();
 
-    MegaNodeList *children = NULL;
-    bool deleteChildren = false;
-    if (node->isForeign())
+    if (folder.foreignNode)
     {
-        children = node->getChildren();
+        mChildren = folder.foreignNode->getChildren();
     }
     else
     {
-        children = megaApi->getChildren(node, MegaApi::ORDER_NONE);  // no order is much faster for a very large folder (or nested folders with large subfolders)
-        deleteChildren = true;
+        std::unique_ptr<MegaNode> node(megaApi->getNodeByHandle(folder.handle));
+        if (node)
+        {
+            mOwnedChildren.reset(megaApi->getChildren(node.get(), MegaApi::ORDER_NONE));  // no order is much faster for a very large folder (or nested folders with large subfolders)
+            mChildren = mOwnedChildren.get();
+        }
     }
 
-    if (!children)
+    if (!mChildren)
     {
         LOG_err << "Child nodes not found: " << localpath.toPath(*client->fsaccess);
-        recursive--;
         mLastError = API_ENOENT;
         mIncompleteTransfers++;
-        checkCompletion();
-        return;
-    }
-
-    for (int i = 0; i < children->size(); i++)
-    {
-        MegaNode *child = children->get(i);
-
-        ScopedLengthRestore restoreLen(localpath);
-        localpath.appendWithSeparator(LocalPath::fromName(child->getName(), *client->fsaccess, fsType), true);
-
-        string utf8path = localpath.toPath(*client->fsaccess);
-
-        if (child->getType() == MegaNode::TYPE_FILE)
-        {
-            pendingTransfers++;
-            megaApi->startDownload(false, child, utf8path.c_str(), tag, transfer->getAppData(), this);
-        }
-        else
-        {
-            downloadFolderNode(child, localpath, fsType);
-        }
+        return false;
     }
 
-    recursive--;
-    checkCompletion();
-    if (deleteChildren)
-    {
-        delete children;
-    }
+    mChildIndex = 0;
+    mChildrenPath = std::move(localpath);
+    return true;
 }
 
 void MegaFolderDownloadController::checkCompletion()
 {
-    if (!cancelled && !recursive && !pendingTransfers)
+    if (!cancelled && !recursive && !pendingTransfers && !mChildren && mPendingFolders.empty())
     {
         LOG_debug << "Folder download finished - " << transfer->getTransferredBytes() << " of " << transfer->getTotalBytes();
         transfer->setState(MegaTransfer::STATE_COMPLETED);
@@ -26875,7 +27653,16 @@ void MegaFolderDownloadController::onTransferFinish(MegaApi *, MegaTransfer *t,
             mLastError = *e;
             mIncompleteTransfers++;
         }
-        checkCompletion();
+
+        if (!recursive && (mChildren || !mPendingFolders.empty())
+                && pendingTransfers <= MAX_PENDING_SUBTRANSFERS / 2)
+        {
+            downloadPendingFolders();
+        }
+        else
+        {
+            checkCompletion();
+        }
     }
 }
 
@@ -27701,6 +28488,7 @@ void MegaTCPServer::onClose(uv_handle_t* handle)
     // streaming transfers are automatically stopped when their listener is removed
     tcpctx->megaApi->removeTransferListener(tcpctx);
     tcpctx->megaApi->removeRequestListener(tcpctx);
+    tcpctx->server->processOnClose(tcpctx);
 
     tcpctx->server->connections.remove(tcpctx);
     LOG_debug << "Connection closed: " << tcpctx->server->connections.size() << " port = " << tcpctx->server->port << " closing async handle";
@@ -27914,6 +28702,10 @@ void MegaTCPServer::processOnAsyncEventClose(MegaTCPContext *tcpctx) // without
     LOG_debug << "At supposed to be virtual processOnAsyncEventClose";
 }
 
+void MegaTCPServer::processOnClose(MegaTCPContext *)
+{
+}
+
 void MegaTCPServer::processOnExitHandleClose(MegaTCPServer *tcpServer) // without this closing breaks!
 {
     LOG_debug << "At supposed to be virtual processOnExitHandleClose";
@@ -27949,6 +28741,9 @@ MegaHTTPServer::MegaHTTPServer(MegaApiImpl *megaApi, string basePath, bool useTL
     this->folderServerEnabled = true;
     this->offlineAttribute = false;
     this->subtitlesSupportEnabled = false;
+    this->metricsEnabled = false;
+    this->webDavListingsSize = 0;
+    this->webDavListingsUses = 0;
 }
 
 MegaTCPContext * MegaHTTPServer::initializeContext(uv_stream_t *server_handle)
@@ -28012,7 +28807,13 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
     LOG_verbose << "Bytes written: " << httpctx->lastBufferLen << " Remaining: " << (httpctx->size - httpctx->bytesWritten);
     httpctx->lastBuffer = NULL;
 
-    if (status < 0 || httpctx->size == httpctx->bytesWritten)
+    if (status >= 0 && !httpctx->streamingChunks.empty())
+    {
+        adaptOutputSize(httpctx);
+    }
+
+    bool listingPending = httpctx->webDavListing && !httpctx->webDavListing->done;
+    if (status < 0 || (httpctx->size == httpctx->bytesWritten && !listingPending))
     {
         if (status < 0)
         {
@@ -28032,25 +28833,20 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
     }
 
     uv_mutex_lock(&httpctx->mutex);
-    if (httpctx->lastBufferLen)
+    if (!httpctx->streamingChunks.empty())
     {
-        httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
+        httpctx->streamingChunks.clear();
         httpctx->lastBufferLen = 0;
     }
-
-    if (httpctx->pause)
+    else if (httpctx->webDavListing && !httpctx->webDavListing->chunk.empty())
     {
-        if (httpctx->streamingBuffer.availableSpace() > httpctx->streamingBuffer.availableCapacity() / 2)
-        {
-            httpctx->pause = false;
-            m_off_t start = httpctx->rangeStart + httpctx->rangeWritten + httpctx->streamingBuffer.availableData();
-            m_off_t len =  httpctx->rangeEnd - httpctx->rangeStart - httpctx->rangeWritten - httpctx->streamingBuffer.availableData();
-
-            LOG_debug << "Resuming streaming from " << start << " len: " << len
-                     << " Buffer status: " << httpctx->streamingBuffer.availableSpace()
-                     << " of " << httpctx->streamingBuffer.availableCapacity() << " bytes free";
-            httpctx->megaApi->startStreaming(httpctx->node, start, len, httpctx);
-        }
+        httpctx->webDavListing->chunk.clear();
+        httpctx->lastBufferLen = 0;
+    }
+    else if (httpctx->lastBufferLen)
+    {
+        httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
+        httpctx->lastBufferLen = 0;
     }
     uv_mutex_unlock(&httpctx->mutex);
 
@@ -28066,9 +28862,18 @@ void MegaHTTPServer::processOnAsyncEventClose(MegaTCPContext* tcpctx)
         httpctx->resultCode = API_EINCOMPLETE;
     }
 
+    if (httpctx->streamingCache)
+    {
+        // no more tags set on the transfer (the fetches no other connection reads stop by themselves)
+        httpctx->streamingCache->removeReader(httpctx);
+    }
+
     if (httpctx->transfer)
     {
-        httpctx->megaApi->cancelTransfer(httpctx->transfer.get());
+        if (!httpctx->streamingCache)
+        {
+            httpctx->megaApi->cancelTransfer(httpctx->transfer.get());
+        }
         httpctx->megaApi->fireOnStreamingFinish(httpctx->transfer.release(), make_unique<MegaErrorPrivate>(httpctx->resultCode)); // transfer will be deleted in fireOnStreamingFinish
     }
 
@@ -28076,6 +28881,46 @@ void MegaHTTPServer::processOnAsyncEventClose(MegaTCPContext* tcpctx)
     httpctx->node = NULL;
 }
 
+void MegaHTTPServer::processOnClose(MegaTCPContext *tcpctx)
+{
+    MegaHTTPContext* httpctx = dynamic_cast<MegaHTTPContext *>(tcpctx);
+    if (httpctx->streamingCache)
+    {
+        // it notifies the connection through the async handle, that is about to be closed
+        httpctx->streamingCache->removeReader(httpctx);
+    }
+}
+
+std::shared_ptr<StreamingCache> MegaHTTPServer::getStreamingCache(MegaNode *node)
+{
+    std::shared_ptr<StreamingCache> cache = streamingCaches[node->getHandle()].lock();
+    if (!cache || cache->failed())
+    {
+        MegaApiImpl *api = megaApi;
+        std::shared_ptr<MegaNode> streamedNode(node->copy());
+        cache = std::make_shared<StreamingCache>(node->getSize(), 2 * m_off_t(getMaxBufferSize()),
+            [api, streamedNode](const std::shared_ptr<StreamingCache>& c, int id, m_off_t pos, m_off_t len)
+            {
+                LOG_debug << "Streaming " << len << " bytes from " << pos << " for the connections of the node";
+                api->startStreaming(streamedNode.get(), pos, len, new MegaStreamingCacheFetch(c, id));
+            });
+        streamingCaches[node->getHandle()] = cache;
+    }
+
+    for (auto it = streamingCaches.begin(); it != streamingCaches.end(); )
+    {
+        if (it->second.expired())
+        {
+            it = streamingCaches.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+    return cache;
+}
+
 bool MegaHTTPServer::respondNewConnection(MegaTCPContext* tcpctx)
 {
     return true;
@@ -28138,6 +28983,16 @@ bool MegaHTTPServer::isFolderServerEnabled()
     return folderServerEnabled;
 }
 
+void MegaHTTPServer::enableMetrics(bool enable)
+{
+    this->metricsEnabled = enable;
+}
+
+bool MegaHTTPServer::isMetricsEnabled()
+{
+    return metricsEnabled;
+}
+
 bool MegaHTTPServer::isOfflineAttributeEnabled()
 {
     return offlineAttribute;
@@ -28295,7 +29150,12 @@ int MegaHTTPServer::onHeaderValue(http_parser *parser, const char *at, size_t le
     LOG_verbose << " onHeaderValue: " << httpctx->lastheader << " = " << value;
     if (httpctx->lastheader == "depth")
     {
-        httpctx->depth = atoi(value.c_str());
+        // infinity is served as the folder and its children, like no depth at all
+        httpctx->depth = (value == "infinity") ? -1 : atoi(value.c_str());
+    }
+    else if (httpctx->lastheader == "if-none-match")
+    {
+        httpctx->ifNoneMatch = value;
     }
     else if (httpctx->lastheader == "host")
     {
@@ -28471,6 +29331,155 @@ string MegaHTTPServer::getWebDavPropFindResponseForNode(string baseURL, string s
     return response.str();
 }
 
+string MegaHTTPServer::startWebDavListing(string baseURL, string subnodepath, MegaNode *node, MegaHTTPContext* httpctx)
+{
+    MegaHTTPServer* httpserver = dynamic_cast<MegaHTTPServer *>(httpctx->server);
+    std::unique_ptr<MegaWebDavListing> listing(new MegaWebDavListing());
+    if (!httpctx->megaApi->getChildrenHandles(node, listing->children, listing->etag))
+    {
+        return getWebDavPropFindResponseForNode(baseURL, subnodepath, node, httpctx);
+    }
+
+    listing->folder = node->getHandle();
+    listing->offlineAttribute = httpserver->isOfflineAttributeEnabled();
+    listing->baseURL = baseURL + subnodepath;
+    if (listing->baseURL.size() && listing->baseURL.back() != '/')
+    {
+        listing->baseURL.append("/");
+    }
+
+    std::ostringstream response;
+    httpctx->resultCode = API_OK;
+    if (httpctx->ifNoneMatch == listing->etag)
+    {
+        LOG_debug << "Folder listing not modified: " << listing->etag;
+        response << "HTTP/1.1 304 Not Modified\r\n"
+                    "etag: " << listing->etag << "\r\n"
+                    "server: MEGAsdk\r\n"
+                    "\r\n";
+        return response.str();
+    }
+
+    auto cached = httpserver->webDavListings.find(listing->folder);
+    if (cached != httpserver->webDavListings.end()
+            && cached->second.etag == listing->etag
+            && cached->second.baseURL == listing->baseURL
+            && cached->second.offlineAttribute == listing->offlineAttribute
+            && cached->second.body.size() < size_t(httpserver->getMaxBufferSize()) / 2)
+    {
+        LOG_debug << "Folder listing served from cache: " << listing->etag;
+        cached->second.lastUse = ++httpserver->webDavListingsUses;
+        response << "HTTP/1.1 207 Multi-Status\r\n"
+                    "content-length: " << cached->second.body.size() << "\r\n"
+                    "content-type: application/xml; charset=utf-8\r\n"
+                    "etag: " << listing->etag << "\r\n"
+                    "server: MEGAsdk\r\n"
+                    "\r\n";
+        response << cached->second.body;
+        return response.str();
+    }
+
+    listing->head = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+                    "<d:multistatus xmlns:d=\"DAV:\" xmlns:Z=\"urn:schemas-microsoft-com::\">\r\n";
+    listing->head.append(getWebDavProfFindNodeContents(node, listing->baseURL, listing->offlineAttribute));
+
+    // the children are sent by sendNextBytes, a page at a time
+    response << "HTTP/1.1 207 Multi-Status\r\n"
+                "transfer-encoding: chunked\r\n"
+                "content-type: application/xml; charset=utf-8\r\n"
+                "etag: " << listing->etag << "\r\n"
+                "server: MEGAsdk\r\n"
+                "\r\n";
+    httpctx->webDavListing = std::move(listing);
+    return response.str();
+}
+
+bool MegaHTTPServer::nextWebDavListingChunk(MegaHTTPContext* httpctx)
+{
+    MegaWebDavListing& listing = *httpctx->webDavListing;
+    if (listing.done)
+    {
+        return false;
+    }
+
+    std::ostringstream web;
+    web << listing.head;
+    listing.head.clear();
+
+    // each child is looked up on its own, so that the SDK is never locked for long
+    size_t end = std::min(listing.next + WEBDAV_LISTING_PAGE, listing.children.size());
+    for (; listing.next < end; listing.next++)
+    {
+        std::unique_ptr<MegaNode> child(httpctx->megaApi->getNodeByHandle(listing.children[listing.next]));
+        if (child)
+        {
+            web << getWebDavProfFindNodeContents(child.get(), listing.baseURL + child->getName(), listing.offlineAttribute);
+        }
+    }
+
+    if (listing.next == listing.children.size())
+    {
+        web << "</d:multistatus>"
+               "\r\n";
+        listing.done = true;
+    }
+
+    string data = web.str();
+    if (listing.cacheable)
+    {
+        listing.cacheable = listing.body.size() + data.size() <= MAX_CACHED_WEBDAV_LISTING;
+        if (listing.cacheable)
+        {
+            listing.body.append(data);
+        }
+        else
+        {
+            string().swap(listing.body);
+        }
+    }
+
+    std::ostringstream chunk;
+    chunk << std::hex << data.size() << "\r\n" << data << "\r\n";
+    if (listing.done)
+    {
+        chunk << "0\r\n\r\n";
+        if (listing.cacheable)
+        {
+            dynamic_cast<MegaHTTPServer *>(httpctx->server)->cacheWebDavListing(listing);
+        }
+    }
+    listing.chunk = chunk.str();
+    return true;
+}
+
+void MegaHTTPServer::cacheWebDavListing(const MegaWebDavListing &listing)
+{
+    auto it = webDavListings.find(listing.folder);
+    if (it != webDavListings.end())
+    {
+        webDavListingsSize -= it->second.body.size();
+        webDavListings.erase(it);
+    }
+
+    // least recently used first
+    while (!webDavListings.empty() && webDavListingsSize + listing.body.size() > MAX_CACHED_WEBDAV_LISTINGS)
+    {
+        auto victim = webDavListings.begin();
+        for (auto i = webDavListings.begin(); i != webDavListings.end(); i++)
+        {
+            if (i->second.lastUse < victim->second.lastUse)
+            {
+                victim = i;
+            }
+        }
+        webDavListingsSize -= victim->second.body.size();
+        webDavListings.erase(victim);
+    }
+
+    webDavListings[listing.folder] = CachedWebDavListing{listing.etag, listing.baseURL, listing.offlineAttribute, listing.body, ++webDavListingsUses};
+    webDavListingsSize += listing.body.size();
+}
+
 string MegaHTTPServer::getResponseForNode(MegaNode *node, MegaHTTPContext* httpctx)
 {
     MegaNode *parent = httpctx->megaApi->getParentNode(node);
@@ -28874,6 +29883,27 @@ int MegaHTTPServer::onMessageComplete(http_parser *parser)
         return 0;
     }
 
+    if (httpctx->path == "/metrics" && httpserver && httpserver->isMetricsEnabled()
+            && (parser->method == HTTP_GET || parser->method == HTTP_HEAD))
+    {
+        LOG_debug << "Metrics requested";
+        string body = g_metrics.snapshot().prometheus();
+        response << "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " << body.size() << "\r\n"
+                    "Connection: close\r\n"
+                    "\r\n";
+        if (parser->method == HTTP_GET)
+        {
+            response << body;
+        }
+
+        httpctx->resultCode = API_OK;
+        string resstr = response.str();
+        sendHeaders(httpctx, &resstr);
+        return 0;
+    }
+
     if (httpctx->path == "/")
     {
         node = httpctx->megaApi->getRootNode();
@@ -29082,7 +30112,16 @@ int MegaHTTPServer::onMessageComplete(http_parser *parser)
     {
         string baseURL = string("http") + (httpctx->server->useTLS ? "s" : "") + "://"
                 + httpctx->host + "/" + httpctx->nodehandle + "/" + httpctx->nodename + "/";
-        string resstr = getWebDavPropFindResponseForNode(baseURL, httpctx->subpathrelative, node, httpctx);
+        string resstr;
+        if (node->isFolder() && httpctx->depth != 0 && parser->http_major == 1 && parser->http_minor >= 1)
+        {
+            // large folders are sent in chunks, without the whole response in memory
+            resstr = startWebDavListing(baseURL, httpctx->subpathrelative, node, httpctx);
+        }
+        else
+        {
+            resstr = getWebDavPropFindResponseForNode(baseURL, httpctx->subpathrelative, node, httpctx);
+        }
         sendHeaders(httpctx, &resstr);
         delete node;
         delete baseNode;
@@ -29697,7 +30736,6 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
         << "\r\n";
 
     delete [] mimeType;
-    httpctx->pause = false;
     httpctx->lastBuffer = NULL;
     httpctx->lastBufferLen = 0;
     if (httpctx->transfer)
@@ -29709,7 +30747,8 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     string resstr = response.str();
     if (httpctx->parser.method != HTTP_HEAD)
     {
-        httpctx->streamingBuffer.init(len + resstr.size());
+        // only the headers, the data comes from the streaming cache
+        httpctx->streamingBuffer.init(resstr.size());
         httpctx->size = len;
     }
 
@@ -29723,7 +30762,22 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     httpctx->rangeWritten = 0;
     if (start || len)
     {
-        httpctx->megaApi->startStreaming(node, start, len, httpctx);
+        // connections reading the same node share the downloaded data
+        MegaHTTPServer *httpserver = ((MegaHTTPServer *)httpctx->server);
+        httpctx->streamingCache = httpserver->getStreamingCache(node);
+        httpctx->outputSize = httpctx->server->getMaxOutputSize();
+        httpctx->drainRate = 0;
+        httpctx->streamingCache->addReader(httpctx, start, [httpctx]()
+        {
+            uv_async_send(&httpctx->asynchandle);
+        },
+        [httpctx](int tag)
+        {
+            if (httpctx->transfer)
+            {
+                httpctx->transfer->setTag(tag);
+            }
+        });
     }
     else
     {
@@ -29843,13 +30897,24 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
     }
 
     uv_mutex_lock(&httpctx->mutex);
-    if (httpctx->lastBufferLen)
+    if (!httpctx->streamingChunks.empty())
+    {
+        httpctx->streamingChunks.clear();
+        httpctx->lastBufferLen = 0;
+    }
+    else if (httpctx->webDavListing && !httpctx->webDavListing->chunk.empty())
+    {
+        httpctx->webDavListing->chunk.clear();
+        httpctx->lastBufferLen = 0;
+    }
+    else if (httpctx->lastBufferLen)
     {
         httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
         httpctx->lastBufferLen = 0;
     }
 
-    if (httpctx->tcphandle.write_queue_size > httpctx->streamingBuffer.availableCapacity() / 8)
+    size_t maxQueued = httpctx->streamingCache ? size_t(httpctx->server->getMaxBufferSize()) : httpctx->streamingBuffer.availableCapacity();
+    if (httpctx->tcphandle.write_queue_size > maxQueued / 8)
     {
         LOG_warn << "Skipping write. Too much queued data";
         uv_mutex_unlock(&httpctx->mutex);
@@ -29859,22 +30924,74 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
     uv_buf_t resbuf = httpctx->streamingBuffer.nextBuffer();
     uv_mutex_unlock(&httpctx->mutex);
 
-    if (!resbuf.len)
+    std::vector<uv_buf_t> bufs;
+    if (resbuf.len)
+    {
+        bufs.push_back(resbuf);
+    }
+    else if (httpctx->streamingCache)
+    {
+        // written straight from the segments, that stay alive until the write finishes.
+        // TLS encrypts one buffer per write, so the segments are only gathered without it.
+        size_t maxBuffers = MAX_WRITE_BUFFERS;
+        if (httpctx->server->useTLS)
+        {
+            maxBuffers = 1;
+        }
+
+        m_off_t pos = httpctx->rangeStart + httpctx->rangeWritten;
+        m_off_t end = std::min(httpctx->rangeEnd, pos + httpctx->outputSize);
+        while (pos < end && bufs.size() < maxBuffers)
+        {
+            StreamingCache::Chunk chunk;
+            if (!httpctx->streamingCache->read(httpctx, pos, size_t(end - pos), chunk))
+            {
+                LOG_warn << "Streaming transfer failed. Closing connection.";
+                httpctx->streamingChunks.clear();
+                closeConnection(httpctx);
+                return;
+            }
+
+            if (!chunk.len)
+            {
+                break;
+            }
+
+            bufs.push_back(uv_buf_init(const_cast<char *>(chunk.data.get()), unsigned(chunk.len)));
+            pos += chunk.len;
+            httpctx->streamingChunks.push_back(std::move(chunk));
+        }
+    }
+    else if (httpctx->webDavListing && nextWebDavListingChunk(httpctx))
+    {
+        string& chunk = httpctx->webDavListing->chunk;
+        httpctx->size += chunk.size();
+        bufs.push_back(uv_buf_init(&chunk[0], unsigned(chunk.size())));
+    }
+
+    if (bufs.empty())
     {
         LOG_verbose << "Skipping write. No data available";
         return;
     }
 
-    LOG_verbose << "Writing " << resbuf.len << " bytes";
-    httpctx->rangeWritten += resbuf.len;
-    httpctx->lastBuffer = resbuf.base;
-    httpctx->lastBufferLen = resbuf.len;
+    size_t len = 0;
+    for (const uv_buf_t& b : bufs)
+    {
+        len += b.len;
+    }
+
+    LOG_verbose << "Writing " << len << " bytes in " << bufs.size() << " buffers";
+    httpctx->rangeWritten += len;
+    httpctx->lastBuffer = bufs[0].base;
+    httpctx->lastBufferLen = int(len);
+    httpctx->writeStartTime = uv_hrtime();
 
 #ifdef ENABLE_EVT_TLS
     if (httpctx->server->useTLS)
     {
         //notice this, contrary to !useTLS is synchronous
-        int err = evt_tls_write(httpctx->evt_tls, resbuf.base, resbuf.len, onWriteFinished_tls);
+        int err = evt_tls_write(httpctx->evt_tls, bufs[0].base, bufs[0].len, onWriteFinished_tls);
         if (err <= 0)
         {
             LOG_warn << "Finishing due to an error sending the response: " << err;
@@ -29887,7 +31004,8 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
         uv_write_t *req = new uv_write_t();
         req->data = httpctx;
 
-        if (int err = uv_write(req, (uv_stream_t*)&httpctx->tcphandle, &resbuf, 1, onWriteFinished))
+        // libuv keeps its own copy of the buffer descriptors
+        if (int err = uv_write(req, (uv_stream_t*)&httpctx->tcphandle, bufs.data(), unsigned(bufs.size()), onWriteFinished))
         {
             delete req;
             LOG_warn << "Finishing due to an error in uv_write: " << err;
@@ -29902,6 +31020,53 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
 #endif
 }
 
+void MegaHTTPServer::adaptOutputSize(MegaHTTPContext *httpctx)
+{
+    // writes done right away can be larger, writes waiting for the socket to drain smaller
+    uint64_t elapsed = std::max<uint64_t>((uv_hrtime() - httpctx->writeStartTime) / 1000, 1);
+    if (elapsed < FAST_WRITE_US && httpctx->lastBufferLen >= httpctx->outputSize)
+    {
+        httpctx->outputSize = std::min(2 * httpctx->outputSize, m_off_t(httpctx->server->getMaxBufferSize()));
+    }
+    else if (elapsed > SLOW_WRITE_US)
+    {
+        httpctx->outputSize = std::max(httpctx->outputSize / 2, m_off_t(httpctx->server->getMaxOutputSize()));
+    }
+
+    // faster clients get more data downloaded ahead of them
+    m_off_t rate = m_off_t(httpctx->lastBufferLen) * 1000000 / m_off_t(elapsed);
+    httpctx->drainRate = httpctx->drainRate ? (3 * httpctx->drainRate + rate) / 4 : rate;
+    httpctx->streamingCache->setReadAhead(httpctx, httpctx->drainRate * READ_AHEAD_SECONDS);
+}
+
+MegaStreamingCacheFetch::MegaStreamingCacheFetch(std::shared_ptr<StreamingCache> cache, int id)
+    : cache(std::move(cache))
+    , id(id)
+{
+}
+
+void MegaStreamingCacheFetch::onTransferStart(MegaApi *, MegaTransfer *transfer)
+{
+    // the connection that needed the data reports the tag of its transfer
+    cache->started(id, transfer->getTag());
+}
+
+bool MegaStreamingCacheFetch::onTransferData(MegaApi *, MegaTransfer *, char *buffer, size_t size)
+{
+    return cache->write(id, buffer, size);
+}
+
+void MegaStreamingCacheFetch::onTransferFinish(MegaApi *, MegaTransfer *, MegaError *e)
+{
+    int ecode = e->getErrorCode();
+    if (ecode != API_OK && ecode != API_EINCOMPLETE)
+    {
+        LOG_warn << "Streaming transfer failed with error code: " << ecode;
+    }
+    cache->finish(id, ecode != API_OK && ecode != API_EINCOMPLETE);
+    delete this;
+}
+
 MegaHTTPContext::MegaHTTPContext()
 {
     rangeStart = -1;
@@ -29909,7 +31074,6 @@ MegaHTTPContext::MegaHTTPContext()
     rangeWritten = -1;
     range = false;
     failed = false;
-    pause = false;
     nodereceived = false;
     resultCode = API_EINTERNAL;
     node = NULL;
@@ -29923,6 +31087,9 @@ MegaHTTPContext::MegaHTTPContext()
     overwrite = true; //GVFS-DAV via command line does not include this header (assumed true)
     lastBuffer = NULL;
     lastBufferLen = 0;
+    outputSize = 0;
+    drainRate = 0;
+    writeStartTime = 0;
 
     // Mutex to protect the data buffer
     uv_mutex_init(&mutex_responses);
@@ -29948,38 +31115,6 @@ void MegaHTTPContext::onTransferStart(MegaApi *, MegaTransfer *transfer)
     }
 }
 
-bool MegaHTTPContext::onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size)
-{
-    LOG_verbose << "Streaming data received: " << transfer->getTransferredBytes()
-                << " Size: " << size
-                << " Queued: " << this->tcphandle.write_queue_size
-                << " Buffered: " << streamingBuffer.availableData()
-                << " Free: " << streamingBuffer.availableSpace();
-
-    if (finished)
-    {
-        LOG_info << "Removing streaming transfer after " << transfer->getTransferredBytes() << " bytes";
-        return false;
-    }
-
-    // append the data to the buffer
-    uv_mutex_lock(&mutex);
-    long long remaining = size + (transfer->getTotalBytes() - transfer->getTransferredBytes());
-    long long availableSpace = streamingBuffer.availableSpace();
-    if (remaining > availableSpace && availableSpace < (2 * m_off_t(size)))
-    {
-        LOG_debug << "Buffer full: " << availableSpace << " of "
-                 << streamingBuffer.availableCapacity() << " bytes available only. Pausing streaming";
-        pause = true;
-    }
-    streamingBuffer.append(buffer, static_cast<unsigned>(size));
-    uv_mutex_unlock(&mutex);
-
-    // notify the HTTP server
-    uv_async_send(&asynchandle);
-    return !pause;
-}
-
 void MegaHTTPContext::onTransferFinish(MegaApi *, MegaTransfer *, MegaError *e)
 {
     if (finished)
@@ -33461,39 +34596,114 @@ long long MegaFolderInfoPrivate::getVersionsSize() const
     return versionsSize;
 }
 
-TreeProcFolderInfo::TreeProcFolderInfo()
+MegaMetricsPrivate::MegaMetricsPrivate(MetricsSnapshot&& snapshot)
+    : snapshot(std::move(snapshot))
+{
+}
+
+MegaMetricsPrivate::MegaMetricsPrivate(const MegaMetricsPrivate *metrics)
+    : snapshot(metrics->snapshot)
 {
-    numFiles = 0;
-    numFolders = 0;
-    numVersions = 0;
-    currentSize = 0;
-    versionsSize = 0;
 }
 
-void TreeProcFolderInfo::proc(MegaClient *, Node *node)
+MegaMetricsPrivate::~MegaMetricsPrivate()
 {
-    if (node->parent && node->parent->type == FILENODE)
+}
+
+MegaMetrics *MegaMetricsPrivate::copy() const
+{
+    return new MegaMetricsPrivate(this);
+}
+
+MegaStringList *MegaMetricsPrivate::getCounterNames() const
+{
+    MegaStringList *names = new MegaStringListPrivate();
+    for (auto& c : snapshot.counters)
     {
-        numVersions++;
-        versionsSize += node->size;
+        names->add(c.first.c_str());
     }
-    else
+    return names;
+}
+
+long long MegaMetricsPrivate::getCounter(const char *name) const
+{
+    auto it = name ? snapshot.counters.find(name) : snapshot.counters.end();
+    return it == snapshot.counters.end() ? 0 : static_cast<long long>(it->second);
+}
+
+MegaStringList *MegaMetricsPrivate::getGaugeNames() const
+{
+    MegaStringList *names = new MegaStringListPrivate();
+    for (auto& g : snapshot.gauges)
     {
-        if (node->type == FILENODE)
-        {
-            numFiles++;
-            currentSize += node->size;
-        }
-        else
+        names->add(g.first.c_str());
+    }
+    return names;
+}
+
+long long MegaMetricsPrivate::getGauge(const char *name) const
+{
+    auto it = name ? snapshot.gauges.find(name) : snapshot.gauges.end();
+    return it == snapshot.gauges.end() ? 0 : it->second;
+}
+
+MegaStringList *MegaMetricsPrivate::getHistogramNames() const
+{
+    MegaStringList *names = new MegaStringListPrivate();
+    for (auto& h : snapshot.histograms)
+    {
+        names->add(h.first.c_str());
+    }
+    return names;
+}
+
+MegaStringList *MegaMetricsPrivate::getHistogramLabels(const char *name) const
+{
+    MegaStringList *labels = new MegaStringListPrivate();
+    auto it = name ? snapshot.histograms.find(name) : snapshot.histograms.end();
+    if (it != snapshot.histograms.end())
+    {
+        for (auto& series : it->second)
         {
-            numFolders++;
+            labels->add(series.first.c_str());
         }
     }
+    return labels;
+}
+
+const MetricsHistogram::Snapshot *MegaMetricsPrivate::findHistogram(const char *name, const char *label) const
+{
+    auto it = name ? snapshot.histograms.find(name) : snapshot.histograms.end();
+    if (it == snapshot.histograms.end())
+    {
+        return nullptr;
+    }
+
+    auto series = it->second.find(label ? label : "");
+    return series == it->second.end() ? nullptr : &series->second;
+}
+
+long long MegaMetricsPrivate::getHistogramCount(const char *name, const char *label) const
+{
+    const MetricsHistogram::Snapshot *h = findHistogram(name, label);
+    return h ? static_cast<long long>(h->count) : 0;
+}
+
+long long MegaMetricsPrivate::getHistogramSum(const char *name, const char *label) const
+{
+    const MetricsHistogram::Snapshot *h = findHistogram(name, label);
+    return h ? static_cast<long long>(h->sumMicroseconds) : 0;
+}
+
+long long MegaMetricsPrivate::getHistogramPercentile(const char *name, const char *label, double percentile) const
+{
+    const MetricsHistogram::Snapshot *h = findHistogram(name, label);
+    return h ? static_cast<long long>(h->percentile(percentile / 100)) : 0;
 }
 
-MegaFolderInfo *TreeProcFolderInfo::getResult()
+char *MegaMetricsPrivate::getPrometheusText() const
 {
-    return new MegaFolderInfoPrivate(numFiles, numFolders - 1, numVersions, currentSize, versionsSize);
+    return MegaApi::strdup(snapshot.prometheus().c_str());
 }
 
 MegaTimeZoneDetailsPrivate::MegaTimeZoneDetailsPrivate(vector<std::string> *timeZones, vector<int> *timeZoneOffsets, int defaultTimeZone)
@@ -59,6 +59,12 @@ const int MegaClient::MAXQUEUEDFA = 30;
 // maximum number of concurrent putfa
 const int MegaClient::MAXPUTFA = 10;
 
+// sc responses are processed while being received once this much has arrived
+const size_t MegaClient::SCSTREAMTHRESHOLD = 1 << 20;
+
+// number of streamed action packets between state cache commits
+const size_t MegaClient::SCSTREAMCHECKPOINT = 5000;
+
 // hearbeat frequency
 static constexpr int FREQUENCY_HEARTBEAT_DS = 300;
 
@@ -88,6 +94,29 @@ dstime MegaClient::USER_DATA_EXPIRATION_BACKOFF_SECS = 86400; // 1 day
 // stats id
 std::string MegaClient::statsid;
 
+// RSA-encrypted keys are longer than any symmetric one
+static bool isrsakey(int sl)
+{
+    return sl > 4 * FILENODEKEYLENGTH / 3 + 1;
+}
+
+// decrypt the base64 RSA-encrypted key sk (sl characters long)
+static bool rsadecryptkey(AsymmCipher& asymkey, const char* sk, int sl, byte* tk, int tl)
+{
+    sl = sl / 4 * 3 + 3;
+
+    if (sl > 4096)
+    {
+        return false;
+    }
+
+    std::unique_ptr<byte[]> buf(new byte[sl]);
+
+    sl = Base64::atob(sk, buf.get(), sl);
+
+    return asymkey.decrypt(buf.get(), sl, tk, tl) != 0;
+}
+
 // decrypt key (symmetric or asymmetric), rewrite asymmetric to symmetric key
 bool MegaClient::decryptkey(const char* sk, byte* tk, int tl, SymmCipher* sc, int type, handle node)
 {
@@ -102,29 +131,25 @@ bool MegaClient::decryptkey(const char* sk, byte* tk, int tl, SymmCipher* sc, in
 
     sl = int(ptr - sk);
 
-    if (sl > 4 * FILENODEKEYLENGTH / 3 + 1)
+    if (isrsakey(sl))
     {
         // RSA-encrypted key - decrypt and update on the server to save space & client CPU time
-        sl = sl / 4 * 3 + 3;
-
-        if (sl > 4096)
+        string ciphertext(sk, sl);
+        auto it = mRsaDecryptedKeys.find(ciphertext);
+        if (it != mRsaDecryptedKeys.end() && it->second.size() == size_t(tl))
         {
-            return false;
+            memcpy(tk, it->second.data(), tl);
         }
-
-        byte* buf = new byte[sl];
-
-        sl = Base64::atob(sk, buf, sl);
-
-        // decrypt and set session ID for subsequent API communication
-        if (!asymkey.decrypt(buf, sl, tk, tl))
+        else
         {
-            delete[] buf;
-            LOG_warn << "Corrupt or invalid RSA node key";
-            return false;
-        }
+            if (!rsadecryptkey(asymkey, sk, sl, tk, tl))
+            {
+                LOG_warn << "Corrupt or invalid RSA node key";
+                return false;
+            }
 
-        delete[] buf;
+            mRsaDecryptedKeys[ciphertext].assign(reinterpret_cast<const char*>(tk), tl);
+        }
 
         if (!ISUNDEF(node))
         {
@@ -157,10 +182,26 @@ void MegaClient::mergenewshares(bool notify)
 {
     newshare_list::iterator it;
 
+    // the RSA-encrypted keys of inbound shares (one per share when fetching the nodes)
+    vector<pair<string, int>> encrypted;
+    for (NewShare* s : newshares)
+    {
+        if (!s->rsakey.empty())
+        {
+            encrypted.emplace_back(s->rsakey, int(sizeof s->key));
+        }
+    }
+    decryptrsakeys(encrypted);
+
     for (it = newshares.begin(); it != newshares.end(); )
     {
         NewShare* s = *it;
 
+        if (!s->rsakey.empty())
+        {
+            s->have_key = decryptkey(s->rsakey.c_str(), s->key, sizeof s->key, &key, 1, s->h);
+        }
+
         mergenewshare(s, notify);
 
         delete s;
@@ -990,6 +1031,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                 t->slot->retrying = true;
                 app->transfer_failed(t, API_EOVERQUOTA, timeleft);
                 ++performanceStats.transferTempErrors;
+                g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
             }
         }
     }
@@ -1010,6 +1052,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                     t->slot->retrying = true;
                     app->transfer_failed(t, isPaywall ? API_EPAYWALL : API_EOVERQUOTA, 0);
                     ++performanceStats.transferTempErrors;
+                    g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
                 }
             }
         }
@@ -1183,6 +1226,10 @@ void MegaClient::init()
     pendingcs_serverBusySent = false;
 
     btcs.reset();
+    for (auto& channel : cssidechannels)
+    {
+        channel->bt.reset();
+    }
     btsc.reset();
     btpfa.reset();
     btbadhost.reset();
@@ -1197,6 +1244,7 @@ void MegaClient::init()
     insca_notlast = false;
     scnotifyurl.clear();
     scsn.clear();
+    scapplied = 0;
 
     notifyStorageChangeOnStateCurrent = false;
     mNotifiedSumSize = 0;
@@ -1210,6 +1258,7 @@ MegaClient::MegaClient(MegaApp* a, Waiter* w, HttpIO* h, FileSystemAccess* f, Db
     ,syncfslockretrybt(rng), syncdownbt(rng), syncnaglebt(rng), syncextrabt(rng), syncscanbt(rng)
 #endif
     , mAsyncQueue(*w, workerThreadCount)
+    , mLocalCopyQueue(*w, workerThreadCount ? 1 : 0)
 {
     sctable = NULL;
     pendingsccommit = false;
@@ -1356,6 +1405,8 @@ MegaClient::MegaClient(MegaApp* a, Waiter* w, HttpIO* h, FileSystemAccess* f, Db
     h->setuseragent(&useragent);
     h->setmaxdownloadspeed(0);
     h->setmaxuploadspeed(0);
+
+    loaddnscache();
 }
 
 MegaClient::~MegaClient()
@@ -1430,6 +1481,22 @@ std::string MegaClient::getWritableLinkAuthKey(handle nodeHandle)
     return {};
 }
 
+// increment a unique request ID
+static void nextreqid(char* id, size_t len)
+{
+    for (size_t i = len; i--; )
+    {
+        if (id[i]++ < 'z')
+        {
+            break;
+        }
+        else
+        {
+            id[i] = 'a';
+        }
+    }
+}
+
 // nonblocking state machine executing all operations currently in progress
 void MegaClient::exec()
 {
@@ -1857,6 +1924,7 @@ void MegaClient::exec()
                     case REQ_SUCCESS:
                         abortlockrequest();
                         app->request_response_progress(pendingcs->bufpos, -1);
+                        reqs.received(*pendingcs);
 
                         if (pendingcs->in != "-3" && pendingcs->in != "-4")
                         {
@@ -1893,17 +1961,7 @@ void MegaClient::exec()
                                 }
 
                                 // increment unique request ID
-                                for (int i = sizeof reqid; i--; )
-                                {
-                                    if (reqid[i]++ < 'z')
-                                    {
-                                        break;
-                                    }
-                                    else
-                                    {
-                                        reqid[i] = 'a';
-                                    }
-                                }
+                                nextreqid(reqid, sizeof reqid);
 
                                 if (loggedout)
                                 {
@@ -2031,6 +2089,9 @@ void MegaClient::exec()
                         pendingcs = NULL;
 
                         btcs.backoff();
+                        ++performanceStats.csChannels[0].backoffs;
+                        g_metrics.add(MetricsRegistry::CS_BACKOFFS);
+                        g_tracer.instant("cs", "backoff", 0, "\"channel\":0,\"retryin_ds\":" + std::to_string(btcs.retryin()));
                         app->notify_retry(btcs.retryin(), reason);
                         csretrying = true;
                         LOG_warn << "Retrying cs request in " << btcs.retryin() << " ds";
@@ -2060,25 +2121,10 @@ void MegaClient::exec()
                     bool suppressSID = true;
                     reqs.serverrequest(pendingcs->out, suppressSID, pendingcs->includesFetchingNodes);
 
-                    pendingcs->posturl = APIURL;
-
-                    pendingcs->posturl.append("cs?id=");
-                    pendingcs->posturl.append(reqid, sizeof reqid);
-                    if (!suppressSID)
-                    {
-                        pendingcs->posturl.append(auth);
-                    }
-                    pendingcs->posturl.append(appkey);
-
-                    string version = "v=2";
-                    pendingcs->posturl.append("&" + version);
-                    if (lang.size())
-                    {
-                        pendingcs->posturl.append("&");
-                        pendingcs->posturl.append(lang);
-                    }
+                    pendingcs->posturl = csurl(reqid, sizeof reqid, suppressSID);
                     pendingcs->type = REQ_JSON;
 
+                    ++performanceStats.csChannels[0].batchesSent;
                     performanceStats.csRequestWaitTime.start();
                     pendingcs->post(this);
                     continue;
@@ -2091,6 +2137,8 @@ void MegaClient::exec()
             break;
         }
 
+        execsidechannels();
+
         // handle the request for the last 50 UserAlerts
         if (pendingscUserAlerts)
         {
@@ -2146,6 +2194,16 @@ void MegaClient::exec()
             {
             case REQ_SUCCESS:
                 pendingscTimedOut = false;
+                if (scstreaming)
+                {
+                    // the rest of the action packets and the closing elements of the response
+                    LOG_debug << "Processing the last " << (scstreamscanner.elements() - scstreamcommitted) << " streamed action packets";
+                    scstreaming = false;
+                    insca = true;
+                    jsonsc.begin(pendingsc->data());
+                    break;
+                }
+
                 if (pendingsc->contentlength == 1
                         && pendingsc->in.size()
                         && pendingsc->in[0] == '0')
@@ -2249,6 +2307,11 @@ void MegaClient::exec()
                 break;
 
             case REQ_INFLIGHT:
+                if (feedscstream())
+                {
+                    break;
+                }
+
                 if (!pendingscTimedOut && Waiter::ds >= (pendingsc->lastdata + HttpIO::SCREQUESTTIMEOUT))
                 {
                     LOG_debug << "sc timeout expired";
@@ -2264,6 +2327,15 @@ void MegaClient::exec()
         }
 
 #ifdef ENABLE_SYNC
+        // continue flushing state caches that didn't fit in a single batch
+        for (Sync* sync : syncs)
+        {
+            if (sync->mCacheFlushPending)
+            {
+                sync->cachenodes();
+            }
+        }
+
         if (syncactivity)
         {
             syncops = true;
@@ -2330,6 +2402,11 @@ void MegaClient::exec()
             {
                 pendingsc.reset(new HttpReq());
                 pendingsc->logname = clientname + "sc ";
+                scstreaming = false;
+                scstreamscanner.reset();
+                scstreambatch.clear();
+                scstreamcommitted = 0;
+                scpacket = 0;
                 if (scnotifyurl.size())
                 {
                     pendingsc->posturl = scnotifyurl;
@@ -3105,7 +3182,7 @@ void MegaClient::exec()
 
         httpio->updatedownloadspeed();
         httpio->updateuploadspeed();
-    } while (httpio->doio() || execdirectreads() || (!pendingcs && reqs.cmdspending() && btcs.armed()) || looprequested);
+    } while (httpio->doio() || execdirectreads() || (!pendingcs && reqs.cmdspending() && btcs.armed()) || cssidechannelready() || looprequested);
 
 
     NodeCounter storagesum;
@@ -3122,6 +3199,11 @@ void MegaClient::exec()
         app->storagesum_changed(mNotifiedSumSize);
     }
 
+    if (g_metrics.enabled())
+    {
+        updatemetricsgauges();
+    }
+
 #ifdef MEGA_MEASURE_CODE
     performanceStats.transfersActiveTime.start(!tslots.empty() && !performanceStats.transfersActiveTime.inprogress());
     performanceStats.transfersActiveTime.stop(tslots.empty() && performanceStats.transfersActiveTime.inprogress());
@@ -3135,6 +3217,26 @@ void MegaClient::exec()
 #endif
 }
 
+void MegaClient::updatemetricsgauges()
+{
+    int64_t bufferBytes = 0;
+    for (TransferSlot* ts : tslots)
+    {
+        for (auto& req : ts->reqs)
+        {
+            if (req)
+            {
+                bufferBytes += (req->buf ? req->buflen : 0) + m_off_t(req->in.size() + req->outbuf.size());
+            }
+        }
+    }
+
+    g_metrics.set(MetricsRegistry::CS_PENDING_COMMANDS, int64_t(reqs.queuedCommands()));
+    g_metrics.set(MetricsRegistry::TRANSFERS_QUEUED, int64_t(transfers[GET].size() + transfers[PUT].size()));
+    g_metrics.set(MetricsRegistry::TRANSFER_SLOTS, int64_t(tslots.size()));
+    g_metrics.set(MetricsRegistry::TRANSFER_BUFFER_BYTES, bufferBytes);
+}
+
 // get next event time from all subsystems, then invoke the waiter if needed
 // returns true if an engine-relevant event has occurred, false otherwise
 int MegaClient::wait()
@@ -3149,6 +3251,178 @@ int MegaClient::wait()
     return r;
 }
 
+string MegaClient::csurl(const char* id, size_t idlen, bool suppressSID) const
+{
+    string url = APIURL;
+
+    url.append("cs?id=");
+    url.append(id, idlen);
+    if (!suppressSID)
+    {
+        url.append(auth);
+    }
+    url.append(appkey);
+
+    string version = "v=2";
+    url.append("&" + version);
+    if (lang.size())
+    {
+        url.append("&");
+        url.append(lang);
+    }
+    return url;
+}
+
+bool MegaClient::setcssidechannels(unsigned n)
+{
+    if (!reqs.setSideChannels(n))
+    {
+        return false;
+    }
+
+    while (cssidechannels.size() > n)
+    {
+        cssidechannels.pop_back();
+    }
+
+    while (cssidechannels.size() < n)
+    {
+        unique_ptr<CsSideChannel> channel(new CsSideChannel(rng));
+
+        // each channel has its own random request ID sequence (server API is idempotent)
+        for (size_t i = sizeof channel->reqid; i--; )
+        {
+            channel->reqid[i] = static_cast<char>('a' + rng.genuint32(26));
+        }
+        cssidechannels.push_back(move(channel));
+    }
+
+    performanceStats.csChannels.resize(n + 1);
+    LOG_debug << "cs side channels: " << n;
+    return true;
+}
+
+bool MegaClient::cssidechannelready() const
+{
+    if (!reqs.cmdspending(1))
+    {
+        return false;
+    }
+
+    for (auto& channel : cssidechannels)
+    {
+        if (!channel->req && channel->bt.armed())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MegaClient::execsidechannels()
+{
+    // Only order-independent commands get here, so the handling is simpler than for the primary
+    // channel: no lock requests, fetchnodes statistics or postponed DB commits.
+    for (size_t i = 0; i < cssidechannels.size(); i++)
+    {
+        CsSideChannel& channel = *cssidechannels[i];
+        size_t channelIndex = i + 1;
+
+        if (channel.req)
+        {
+            switch (static_cast<reqstatus_t>(channel.req->status))
+            {
+                case REQ_SUCCESS:
+                    if (channel.req->in != "-3" && channel.req->in != "-4")
+                    {
+                        reqs.received(*channel.req, channelIndex);
+                        string in = std::move(channel.req->in);
+                        channel.req.reset();
+                        channel.bt.reset();
+                        nextreqid(channel.reqid, sizeof channel.reqid);
+
+                        if (*in.c_str() == '[')
+                        {
+                            reqs.serverresponse(std::move(in), this, channelIndex);
+                        }
+                        else
+                        {
+                            // request failed
+                            JSON json;
+                            json.pos = in.c_str();
+                            std::string requestError;
+                            error e = API_EINTERNAL;
+                            bool valid = json.storeobject(&requestError);
+                            if (valid)
+                            {
+                                if (strncmp(requestError.c_str(), "{\"err\":", 7) == 0)
+                                {
+                                    e = (error)atoi(requestError.c_str() + 7);
+                                }
+                                else
+                                {
+                                    e = (error)atoi(requestError.c_str());
+                                }
+                            }
+
+                            if (!valid || !e)
+                            {
+                                e = API_EINTERNAL;
+                                requestError = std::to_string(e);
+                            }
+
+                            if (e == API_EBLOCKED && sid.size())
+                            {
+                                block();
+                            }
+
+                            app->request_error(e);
+                            reqs.servererror(requestError, this, channelIndex);
+                        }
+                        break;
+                    }
+                    // fall through
+                case REQ_FAILURE:
+                    // repeat with capped exponential backoff
+                    channel.req.reset();
+                    channel.bt.backoff();
+                    ++performanceStats.csChannels[channelIndex].backoffs;
+                    g_metrics.add(MetricsRegistry::CS_BACKOFFS);
+                    g_tracer.instant("cs", "backoff", 0, "\"channel\":" + std::to_string(channelIndex) + ",\"retryin_ds\":" + std::to_string(channel.bt.retryin()));
+                    LOG_warn << "Retrying cs side channel " << channelIndex << " request in " << channel.bt.retryin() << " ds";
+                    reqs.requeuerequest(channelIndex);
+                    break;
+
+                default:
+                    ;
+            }
+        }
+
+        // processing a response may have logged out or changed the channels
+        if (i >= cssidechannels.size() || cssidechannels[i].get() != &channel)
+        {
+            break;
+        }
+
+        if (!channel.req && channel.bt.armed() && reqs.cmdspending(channelIndex))
+        {
+            channel.req.reset(new HttpReq());
+            channel.req->protect = true;
+            channel.req->logname = clientname + "cs" + std::to_string(channelIndex) + " ";
+
+            bool suppressSID = true;
+            bool includesFetchingNodes = false;
+            reqs.serverrequest(channel.req->out, suppressSID, includesFetchingNodes, channelIndex);
+
+            channel.req->posturl = csurl(channel.reqid, sizeof channel.reqid, suppressSID);
+            channel.req->type = REQ_JSON;
+
+            ++performanceStats.csChannels[channelIndex].batchesSent;
+            channel.req->post(this);
+        }
+    }
+}
+
 int MegaClient::preparewait()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.prepareWait);
@@ -3159,9 +3433,16 @@ int MegaClient::preparewait()
     WAIT_CLASS::bumpds();
 
 #ifdef ENABLE_SYNC
+    // a state cache flush larger than one batch is drained over consecutive exec() calls
+    bool syncCacheFlushPending = false;
+    for (Sync* sync : syncs)
+    {
+        syncCacheFlushPending = syncCacheFlushPending || sync->mCacheFlushPending;
+    }
+
     // sync directory scans in progress or still processing sc packet without having
     // encountered a locally locked item? don't wait.
-    if (syncactivity || syncdownrequired || (!scpaused && jsonsc.pos && (syncsup || !statecurrent) && !syncdownretry))
+    if (syncactivity || syncdownrequired || syncCacheFlushPending || (!scpaused && jsonsc.pos && (syncsup || !statecurrent) && !syncdownretry))
     {
         nds = Waiter::ds;
     }
@@ -3202,6 +3483,14 @@ int MegaClient::preparewait()
             btcs.update(&nds);
         }
 
+        for (auto& channel : cssidechannels)
+        {
+            if (!channel->req)
+            {
+                channel->bt.update(&nds);
+            }
+        }
+
         // retry failed server-client requests
         if (!pendingsc && !pendingscUserAlerts && scsn.ready() && !mBlocked)
         {
@@ -3506,6 +3795,14 @@ bool MegaClient::abortbackoff(bool includexfers)
         r = true;
     }
 
+    for (auto& channel : cssidechannels)
+    {
+        if (channel->bt.arm())
+        {
+            r = true;
+        }
+    }
+
     if (btbadhost.arm())
     {
         r = true;
@@ -3724,6 +4021,30 @@ void MegaClient::dispatchTransfers()
 
                 // app-side transfer preparations (populate localname, create thumbnail...)
                 app->transfer_prepare(nexttransfer);
+
+                std::shared_ptr<LocalReplicaCopy> localcopy;
+                if (nexttransfer->type == GET && !nexttransfer->localfilename.empty()
+                        && !nexttransfer->slot && (localcopy = copylocalreplica(nexttransfer)))
+                {
+                    // a slot without a file: TransferSlot::doio() waits for the copy, then
+                    // runs the usual download completion (or requeues the transfer to download it)
+                    TransferSlot* ts = new TransferSlot(nexttransfer);
+                    ts->fa.reset();
+                    ts->localcopy = std::move(localcopy);
+
+                    LOG_debug << "Activating transfer (local copy)";
+                    ts->slots_it = tslots.insert(tslots.begin(), ts);
+
+                    for (file_list::iterator it = nexttransfer->files.begin();
+                        it != nexttransfer->files.end(); it++)
+                    {
+                        (*it)->start();
+                    }
+                    app->transfer_update(nexttransfer);
+
+                    performanceStats.transferStarts += 1;
+                    continue;
+                }
             }
 
             bool openok = false;
@@ -3940,6 +4261,129 @@ void MegaClient::dispatchTransfers()
     }
 }
 
+std::shared_ptr<LocalReplicaCopy> MegaClient::copylocalreplica(Transfer* t)
+{
+    if (!t->isvalid || t->size <= 0 || t->localcopytried)
+    {
+        return nullptr;
+    }
+    t->localcopytried = true;
+
+    vector<LocalPath> candidates;
+    if (const LocalPath* path = recentdownloads.find(*t))
+    {
+        candidates.push_back(*path);
+    }
+
+#ifdef ENABLE_SYNC
+    // synced files whose cloud node has the same content
+    unique_ptr<node_vector> nodes(mFingerprints.nodesbyfingerprint(t));
+    for (Node* n : *nodes)
+    {
+        LocalNode* l = n->localnode;
+        if (l && l != (LocalNode*)~0 && l->type == FILENODE && *(FileFingerprint*)l == *(FileFingerprint*)t)
+        {
+            candidates.push_back(l->getLocalPath());
+        }
+    }
+#endif
+
+    if (candidates.empty())
+    {
+        return nullptr;
+    }
+
+    auto copy = std::make_shared<LocalReplicaCopy>();
+    copy->path = t->localfilename;
+    copy->path.append(LocalPath::fromPath(".copy", *fsaccess));
+
+    if (!mLocalCopyFsAccess)
+    {
+        mLocalCopyFsAccess.reset(new FSACCESS_CLASS());
+    }
+    FSACCESS_CLASS* fsa = static_cast<FSACCESS_CLASS*>(mLocalCopyFsAccess.get());
+
+    // the copies are created as the app configured fsaccess to create files
+    int permissions = -1;
+    if (auto clientfsa = dynamic_cast<FSACCESS_CLASS*>(fsaccess))
+    {
+        permissions = clientfsa->getdefaultfilepermissions();
+    }
+
+    FileFingerprint expected = *t;
+    m_time_t mtime = t->mtime;
+    mLocalCopyQueue.push([copy, fsa, permissions, candidates, expected, mtime](SymmCipher&) mutable
+    {
+        if (permissions >= 0)
+        {
+            fsa->setdefaultfilepermissions(permissions);
+        }
+
+        LocalPath target = copy->path;
+        bool copied = false;
+        for (LocalPath& candidate : candidates)
+        {
+            {
+                // the transfer is gone (or the client is shutting down): nothing to copy for
+                std::lock_guard<std::mutex> g(copy->mutex);
+                if (copy->abandoned)
+                {
+                    break;
+                }
+            }
+
+            // the index is only a hint: check the file still has the expected content
+            FileFingerprint fp;
+            auto fa = fsa->newfileaccess(false);
+            if (!fa->fopen(candidate, true, false))
+            {
+                continue;
+            }
+            fp.genfingerprint(fa.get());
+            if (!(fp == expected))
+            {
+                continue;
+            }
+            fa.reset();
+
+            if (!fsa->copylocal(candidate, target, mtime))
+            {
+                fsa->unlinklocal(target);
+                continue;
+            }
+
+            // and that the copy has it too, otherwise download as usual
+            FileFingerprint copyfp;
+            fa = fsa->newfileaccess(false);
+            if (fa->fopen(target, true, false))
+            {
+                copyfp.genfingerprint(fa.get());
+            }
+            fa.reset();
+
+            if (copyfp == expected)
+            {
+                LOG_debug << "Download satisfied by a local copy of " << candidate.toPath(*fsa);
+                copied = true;
+                break;
+            }
+
+            LOG_warn << "Local copy for download does not match. Source: " << candidate.toPath(*fsa);
+            fsa->unlinklocal(target);
+        }
+
+        std::lock_guard<std::mutex> g(copy->mutex);
+        if (copy->abandoned && copied)
+        {
+            fsa->unlinklocal(target);
+        }
+        copy->done = true;
+        copy->copied = copied;
+    }, false);
+
+    return copy;
+}
+
 // generate upload handle for this upload
 // (after 65536 uploads, a node handle clash is possible, but far too unlikely
 // to be of real-world concern)
@@ -4110,6 +4554,14 @@ void MegaClient::disconnect()
         pendingcs->disconnect();
     }
 
+    for (auto& channel : cssidechannels)
+    {
+        if (channel->req)
+        {
+            channel->req->disconnect();
+        }
+    }
+
     if (pendingsc)
     {
         pendingsc->disconnect();
@@ -4204,6 +4656,8 @@ void MegaClient::locallogout(bool removecaches)
 {
     mAsyncQueue.clearDiscardable();
 
+    savednscache();
+
     if (removecaches)
     {
 #ifdef ENABLE_SYNC
@@ -4233,6 +4687,7 @@ void MegaClient::locallogout(bool removecaches)
     me = UNDEF;
     uid.clear();
     unshareablekey.clear();
+    recentdownloads.clear();
     publichandle = UNDEF;
     cachedscsn = UNDEF;
     achievements_enabled = false;
@@ -4277,6 +4732,12 @@ void MegaClient::locallogout(bool removecaches)
 
     delete pendingcs;
     pendingcs = NULL;
+
+    for (auto& channel : cssidechannels)
+    {
+        channel->req.reset();
+        channel->bt.reset();
+    }
     scsn.clear();
     mBlocked = false;
     mLoggedIntoWritableFolder = false;
@@ -4347,6 +4808,7 @@ void MegaClient::locallogout(bool removecaches)
     key.setkey(SymmCipher::zeroiv);
     tckey.setkey(SymmCipher::zeroiv);
     asymkey.resetkey();
+    mRsaDecryptedKeys.clear();
     mPrivKey.clear();
     pubk.resetkey();
     resetKeyring();
@@ -4554,6 +5016,7 @@ bool MegaClient::procsc()
                 case MAKENAMEID2('s', 'n'):
                     // the sn element is guaranteed to be the last in sequence (except for notification requests (c=50))
                     scsn.setScsn(&jsonsc);
+                    scapplied = 0;
                     notifypurge();
                     if (sctable)
                     {
@@ -4717,6 +5180,17 @@ bool MegaClient::procsc()
         {
             if (jsonsc.enterobject())
             {
+                // the response for a given sn always starts with the same packets: skip
+                // the ones that a streamed response which failed later has applied already
+                if (scpacket++ < scapplied)
+                {
+                    jsonsc.leaveobject();
+                    continue;
+                }
+                scapplied = scpacket;
+
+                g_metrics.add(MetricsRegistry::SC_ACTIONPACKETS);
+
                 // the "a" attribute is guaranteed to be the first in the object
                 if (jsonsc.getnameid() == 'a')
                 {
@@ -4730,8 +5204,8 @@ bool MegaClient::procsc()
                     // only process server-client request if not marked as
                     // self-originating ("i" marker element guaranteed to be following
                     // "a" element if present)
-                    if (fetchingnodes || memcmp(jsonsc.pos, "\"i\":\"", 5)
-                     || memcmp(jsonsc.pos + 5, sessionid, sizeof sessionid)
+                    if (fetchingnodes || strncmp(jsonsc.pos, "\"i\":\"", 5)
+                     || strncmp(jsonsc.pos + 5, sessionid, sizeof sessionid)
                      || jsonsc.pos[5 + sizeof sessionid] != '"')
                     {
 #ifdef ENABLE_CHAT
@@ -4802,10 +5276,11 @@ bool MegaClient::procsc()
                                     break;
                                 }
 
-                                if (dn && !memcmp(jsonsc.pos, test, 16))
+                                // a streamed batch never ends with a deletion, so the next packet is there
+                                if (dn && !strncmp(jsonsc.pos, test, 16))
                                 {
                                     Base64::btoa((byte *)&dn->nodehandle, sizeof(dn->nodehandle), &test2[18]);
-                                    if (!memcmp(&jsonsc.pos[26], test2, 26))
+                                    if (!strncmp(&jsonsc.pos[26], test2, 26))
                                     {
                                         // it's a move operation, stop parsing after completing it
                                         stop = true;
@@ -4936,6 +5411,20 @@ bool MegaClient::procsc()
             else
             {
                 jsonsc.leavearray();
+
+                if (scstreaming)
+                {
+                    // end of a streamed batch, the array goes on in the next one
+                    jsonsc.pos = NULL;
+#ifdef ENABLE_SYNC
+                    if (!fetchingnodes && newnodes)
+                    {
+                        applykeys();
+                    }
+#endif
+                    return false;
+                }
+
                 insca = false;
 
 #ifdef ENABLE_SYNC
@@ -4950,6 +5439,78 @@ bool MegaClient::procsc()
     }
 }
 
+// move the complete action packets received so far to a batch for procsc()
+// returns true if there is a batch to process
+bool MegaClient::feedscstream()
+{
+    if (!scstreaming)
+    {
+        static const char prefix[] = "{\"a\":[";
+
+        if (pendingsc->size() < SCSTREAMTHRESHOLD
+                || memcmp(pendingsc->data(), prefix, sizeof prefix - 1))
+        {
+            return false;
+        }
+
+        LOG_debug << "Processing action packets while the sc response is being received";
+        pendingsc->purge(sizeof prefix - 1);
+        scstreaming = true;
+        insca = true;
+    }
+
+    size_t complete = scstreamscanner.scan(pendingsc->data(), pendingsc->size());
+
+    // a deletion followed by the addition of the same node is a move, which procsc() can
+    // only tell by looking at the next packet: keep a trailing deletion for the next batch
+    static const char deletion[] = "{\"a\":\"d\"";
+    size_t last = scstreamscanner.laststart();
+    if (complete && complete - last >= sizeof deletion - 1
+            && !memcmp(pendingsc->data() + last, deletion, sizeof deletion - 1))
+    {
+        complete = last;
+        while (complete && pendingsc->data()[complete - 1] == ',')
+        {
+            complete--;
+        }
+    }
+
+    if (!complete)
+    {
+        return false;
+    }
+
+    // checkpoint the progress so far (the scsn is only updated at the end of the response)
+    if (scstreamscanner.elements() - scstreamcommitted >= SCSTREAMCHECKPOINT)
+    {
+        scstreamcommitted = scstreamscanner.elements();
+        notifypurge();
+        if (sctable)
+        {
+            if (!pendingcs && !csretrying && !reqs.cmdspending())
+            {
+                sctable->commit();
+                sctable->begin();
+                app->notify_dbcommit();
+                pendingsccommit = false;
+            }
+            else
+            {
+                pendingsccommit = true;
+            }
+        }
+    }
+
+    scstreambatch.assign(pendingsc->data(), complete);
+    scstreambatch.push_back(']');
+
+    pendingsc->purge(complete);
+    scstreamscanner.consume(complete);
+
+    jsonsc.begin(scstreambatch.c_str());
+    return true;
+}
+
 // update the user's local state cache, on completion of the fetchnodes command
 // (note that if immediate-completion commands have been issued in the
 // meantime, the state of the affected nodes
@@ -4985,9 +5546,18 @@ void MegaClient::initsc()
         if (complete)
         {
             // 3. write new or modified nodes, purge deleted nodes
+            // (in handle order, as when the nodes were kept ordered)
+            node_vector sorted;
+            sorted.reserve(nodes.size());
             for (node_map::iterator it = nodes.begin(); it != nodes.end(); it++)
             {
-                if (!(complete = sctable->put(CACHEDNODE, it->second, &key)))
+                sorted.push_back(it->second);
+            }
+            std::sort(sorted.begin(), sorted.end(), [](const Node* a, const Node* b) { return a->nodehandle < b->nodehandle; });
+
+            for (Node* n : sorted)
+            {
+                if (!(complete = sctable->put(CACHEDNODE, n, &key)))
                 {
                     break;
                 }
@@ -8162,6 +8732,7 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, vector<NewNod
             else
             {
                 byte buf[SymmCipher::KEYLENGTH];
+                string rsask;
 
                 if (!ISUNDEF(su))
                 {
@@ -8184,9 +8755,15 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, vector<NewNod
                     {
                         su = UNDEF;
                     }
-                    else
+                    else if (sk)
                     {
-                        if (sk)
+                        // RSA-encrypted ones are decrypted in a batch by mergenewshares()
+                        size_t sl = strcspn(sk, "\"/");
+                        if (isrsakey(int(sl)))
+                        {
+                            rsask.assign(sk, sl);
+                        }
+                        else
                         {
                             decryptkey(sk, buf, sizeof buf, &key, 1, h);
                         }
@@ -8219,7 +8796,9 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, vector<NewNod
 
                 if (!ISUNDEF(su))
                 {
-                    newshares.push_back(new NewShare(h, 0, su, rl, sts, sk ? buf : NULL));
+                    NewShare* s = new NewShare(h, 0, su, rl, sts, (sk && rsask.empty()) ? buf : NULL);
+                    s->rsakey = std::move(rsask);
+                    newshares.push_back(s);
                 }
 
                 if (u != me && !ISUNDEF(u) && !fetchingnodes)
@@ -8746,6 +9325,8 @@ void MegaClient::applykeys()
 
     if (nodes.size() > size_t(mAppliedKeyNodeCount + noKeyExpected))
     {
+        decryptrsakeys();
+
         for (auto& it : nodes)
         {
             it.second->applykey();
@@ -8755,6 +9336,116 @@ void MegaClient::applykeys()
     sendkeyrewrites();
 }
 
+void MegaClient::decryptrsakeys()
+{
+    if (!loggedin() || !asymkey.isvalid(AsymmCipher::PRIVKEY))
+    {
+        return;
+    }
+
+    // our RSA-encrypted keys of the nodes not readable yet (compound keys: "handle:key/handle:key...")
+    vector<pair<string, int>> encrypted;
+    for (auto& it : nodes)
+    {
+        Node* n = it.second;
+        if (n->type > FOLDERNODE || n->keyApplied())
+        {
+            continue;
+        }
+
+        const string& k = n->nodekeyUnchecked();
+        for (size_t start = 0, end; start < k.size(); start = end + 1)
+        {
+            end = std::min(k.find('/', start), k.size());
+            size_t colon = k.find(':', start);
+            handle h = 0;
+            if (colon >= end
+                    || Base64::atob(k.c_str() + start, (byte*)&h, sizeof h) != USERHANDLE
+                    || h != me)
+            {
+                continue;
+            }
+
+            string ciphertext = k.substr(colon + 1, end - colon - 1);
+            if (isrsakey(int(ciphertext.size())))
+            {
+                encrypted.emplace_back(std::move(ciphertext), (n->type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH);
+            }
+        }
+    }
+
+    decryptrsakeys(encrypted);
+}
+
+void MegaClient::decryptrsakeys(vector<pair<string, int>>& encrypted)
+{
+    if (!loggedin() || !asymkey.isvalid(AsymmCipher::PRIVKEY))
+    {
+        return;
+    }
+
+    // skip the ones already decrypted, and the repeated ones
+    std::unordered_set<string> seen;
+    encrypted.erase(std::remove_if(encrypted.begin(), encrypted.end(), [this, &seen](const pair<string, int>& e)
+    {
+        return mRsaDecryptedKeys.count(e.first) || !seen.insert(e.first).second;
+    }), encrypted.end());
+
+    if (encrypted.size() < 2)
+    {
+        return;
+    }
+
+    LOG_debug << "Decrypting " << encrypted.size() << " RSA-encrypted keys";
+
+    vector<string> decrypted(encrypted.size());
+    std::atomic<size_t> next(0);
+    auto work = [this, &encrypted, &decrypted, &next]()
+    {
+        for (size_t i; (i = next++) < encrypted.size(); )
+        {
+            byte tk[FILENODEKEYLENGTH];
+            const string& sk = encrypted[i].first;
+            if (rsadecryptkey(asymkey, sk.c_str(), int(sk.size()), tk, encrypted[i].second))
+            {
+                decrypted[i].assign(reinterpret_cast<const char*>(tk), encrypted[i].second);
+            }
+        }
+    };
+
+    // threads of their own (as many as the workers) share them with this one, which waits
+    // for them: mAsyncQueue runs its jobs in order, and long ones (local copies of downloads,
+    // chunk MACs) would hold this thread. They only read the RSA key, so it's safe
+    vector<std::thread> threads;
+    for (size_t i = std::min<size_t>(mAsyncQueue.threadCount(), encrypted.size() - 1); i--; )
+    {
+        try
+        {
+            threads.emplace_back(work);
+        }
+        catch (std::system_error& e)
+        {
+            LOG_err << "Failed to start RSA decryption thread: " << e.what();
+            break;
+        }
+    }
+
+    work();
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+
+    // the ones that failed are reported by decryptkey()
+    for (size_t i = 0; i < encrypted.size(); i++)
+    {
+        if (!decrypted[i].empty())
+        {
+            mRsaDecryptedKeys[std::move(encrypted[i].first)] = std::move(decrypted[i]);
+        }
+    }
+}
+
 void MegaClient::sendkeyrewrites()
 {
     if (sharekeyrewrite.size())
@@ -9314,6 +10005,41 @@ void MegaClient::openStatusTable()
     }
 }
 
+void MegaClient::loaddnscache()
+{
+    if (dbaccess)
+    {
+        std::unique_ptr<DbTable> table(dbaccess->open(rng, *fsaccess, "dnscache"));
+        string data;
+        if (table && table->get(CACHEDDNS, &data))
+        {
+            httpio->loaddnscache(data);
+        }
+    }
+
+    // resolve the API host, and revalidate the recently used storage hosts, while the app starts
+    httpio->prewarm({ APIURL });
+}
+
+void MegaClient::savednscache()
+{
+    if (dbaccess)
+    {
+        string data = httpio->serializednscache();
+        std::unique_ptr<DbTable> table(dbaccess->open(rng, *fsaccess, "dnscache"));
+        if (table)
+        {
+            table->begin();
+            table->truncate();
+            if (data.size())
+            {
+                table->put(CACHEDDNS, (char*)data.data(), unsigned(data.size()));
+            }
+            table->commit();
+        }
+    }
+}
+
 // verify a static symmetric password challenge
 int MegaClient::checktsid(byte* sidbuf, unsigned len)
 {
@@ -13335,9 +14061,10 @@ bool MegaClient::syncdown(LocalNode* l, LocalPath& localpath, bool rubbish)
     }
 
     // remove remote items that exist locally from hash, recurse into existing folders
-    for (localnode_map::iterator lit = l->children.begin(); lit != l->children.end(); )
+    // index-based: recursing may move other LocalNodes in or out of l->children
+    for (size_t li = 0; li < l->children.size(); )
     {
-        LocalNode* ll = lit->second;
+        LocalNode* ll = (l->children.begin() + static_cast<ptrdiff_t>(li))->second;
 
         rit = nchildren.find(&ll->name);
 
@@ -13429,7 +14156,10 @@ bool MegaClient::syncdown(LocalNode* l, LocalPath& localpath, bool rubbish)
                 nchildren.erase(rit);
             }
 
-            lit++;
+            // continue after ll, wherever it ended up
+            localnode_map::iterator lit = l->children.find(&ll->localname);
+            assert(lit != l->children.end());
+            li = static_cast<size_t>(lit - l->children.begin()) + 1;
         }
         else if (rubbish && ll->deleted)    // no corresponding remote node: delete local item
         {
@@ -13459,20 +14189,20 @@ bool MegaClient::syncdown(LocalNode* l, LocalPath& localpath, bool rubbish)
                 if (l->sync->movetolocaldebris(localpath) || !fsaccess->transient_error)
                 {
                     DBTableTransactionCommitter committer(tctable);
-                    delete lit++->second;
+                    delete ll;
                 }
                 else
                 {
                     blockedfile = localpath;
                     LOG_warn << "Transient error deleting " << blockedfile.toPath(*fsaccess);
                     success = false;
-                    lit++;
+                    li++;
                 }
             }
         }
         else
         {
-            lit++;
+            li++;
         }
     }
 
@@ -14374,11 +15104,11 @@ void MegaClient::movetosyncdebris(Node* dn, bool unlink)
     {
         if (unlink)
         {
-            dn->tounlink_it = tounlink.insert(dn).first;
+            tounlink.insert(dn);
         }
         else
         {
-            dn->todebris_it = todebris.insert(dn).first;
+            todebris.insert(dn);
         }
     }
 }
@@ -14465,7 +15195,6 @@ void MegaClient::execsyncunlink()
             unlink(tn, false, tn->tag);
         }
 
-        tn->tounlink_it = tounlink.end();
         tounlink.erase(tounlink.begin());
     } while (tounlink.size());
 }
@@ -14551,7 +15280,6 @@ void MegaClient::execmovetosyncdebris()
                 {
                     LOG_debug << "SyncDebris daily folder not created. Final target: " << n->syncdeleted;
                     n->syncdeleted = SYNCDEL_NONE;
-                    n->todebris_it = todebris.end();
                     todebris.erase(it++);
                 }
             }
@@ -14565,7 +15293,6 @@ void MegaClient::execmovetosyncdebris()
         {
             LOG_debug << "Move to SyncDebris finished. Final target: " << n->syncdeleted;
             n->syncdeleted = SYNCDEL_NONE;
-            n->todebris_it = todebris.end();
             todebris.erase(it++);
         }
         else
@@ -15647,6 +16374,7 @@ void MegaClient::nodesbyoriginalfingerprint(const char* originalfingerprint, Nod
     }
     else
     {
+        size_t first = nv->size();
         for (node_map::const_iterator i = nodes.begin(); i != nodes.end(); ++i)
         {
             if (i->second->type == FILENODE)
@@ -15658,6 +16386,9 @@ void MegaClient::nodesbyoriginalfingerprint(const char* originalfingerprint, Nod
                 }
             }
         }
+
+        // the results keep the handle order they had when the nodes were kept ordered
+        std::sort(nv->begin() + first, nv->end(), [](const Node* a, const Node* b) { return a->nodehandle < b->nodehandle; });
     }
 }
 
@@ -15971,8 +16702,12 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
         << scProcessingTime.report(reset) << "\n"
         << csResponseProcessingTime.report(reset) << "\n"
         << " cs Request waiting time: " << csRequestWaitTime.report(reset) << "\n"
-        << " cs requests sent/received: " << reqs.csRequestsSent << "/" << reqs.csRequestsCompleted << " batches: " << reqs.csBatchesSent << "/" << reqs.csBatchesReceived << "\n"
-        << " transfers active time: " << transfersActiveTime.report(reset) << "\n"
+        << " cs requests sent/received: " << reqs.csRequestsSent << "/" << reqs.csRequestsCompleted << " batches: " << reqs.csBatchesSent << "/" << reqs.csBatchesReceived << "\n";
+    for (size_t i = 0; i < csChannels.size(); i++)
+    {
+        s << " cs channel " << i << " batches sent: " << csChannels[i].batchesSent << " backoffs: " << csChannels[i].backoffs << "\n";
+    }
+    s << " transfers active time: " << transfersActiveTime.report(reset) << "\n"
         << " transfer starts/finishes: " << transferStarts << " " << transferFinishes << "\n"
         << " transfer temperror/fails: " << transferTempErrors << " " << transferFails << "\n"
         << " nowait reason: immedate: " << prepwaitImmediate << " zero: " << prepwaitZero << " httpio: " << prepwaitHttpio << " fsaccess: " << prepwaitFsaccess << " nonzero waits: " << nonzeroWait << "\n";
@@ -15983,7 +16718,8 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
             << curlhttpio->countAddAresEventsCode.report(reset) << "\n"
             << curlhttpio->countAddCurlEventsCode.report(reset) << "\n"
             << curlhttpio->countProcessAresEventsCode.report(reset) << "\n"
-            << curlhttpio->countProcessCurlEventsCode.report(reset) << "\n";
+            << curlhttpio->countProcessCurlEventsCode.report(reset) << "\n"
+            << curlhttpio->connectionstatsreport(reset);
     }
 #endif
 #ifdef WIN32
@@ -15996,6 +16732,10 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
     {
         transferStarts = transferFinishes = transferTempErrors = transferFails = 0;
         prepwaitImmediate = prepwaitZero = prepwaitHttpio = prepwaitFsaccess = nonzeroWait = 0;
+        for (auto& channel : csChannels)
+        {
+            channel = CsChannelStats();
+        }
     }
     return s.str();
 }
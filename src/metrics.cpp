@@ -0,0 +1,282 @@
+/**
+ * @file metrics.cpp
+ * @brief Runtime counters, gauges and latency histograms
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/metrics.h"
+#include "mega/logging.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace mega {
+
+MetricsRegistry g_metrics;
+
+void MetricsHistogram::record(std::chrono::steady_clock::duration d)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    recordMicroseconds(us > 0 ? uint64_t(us) : 0);
+}
+
+void MetricsHistogram::recordMicroseconds(uint64_t us)
+{
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(us, std::memory_order_relaxed);
+    mBuckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned MetricsHistogram::bucketIndex(uint64_t us)
+{
+    if (us < SUBBUCKETS)
+    {
+        return unsigned(us);
+    }
+
+    // position of the highest bit, then the next two bits pick the linear sub-bucket
+    unsigned e = 2;
+    while (us >> (e + 1))
+    {
+        ++e;
+    }
+    unsigned index = SUBBUCKETS + (e - 2) * SUBBUCKETS + unsigned((us >> (e - 2)) & (SUBBUCKETS - 1));
+    return std::min<unsigned>(index, NUMBUCKETS - 1);
+}
+
+uint64_t MetricsHistogram::bucketUpperBound(unsigned index)
+{
+    if (index < SUBBUCKETS)
+    {
+        return index;
+    }
+
+    unsigned e = (index - SUBBUCKETS) / SUBBUCKETS + 2;
+    unsigned sub = (index - SUBBUCKETS) % SUBBUCKETS;
+    return (uint64_t(SUBBUCKETS + sub + 1) << (e - 2)) - 1;
+}
+
+MetricsHistogram::Snapshot MetricsHistogram::snapshot() const
+{
+    Snapshot s;
+    s.count = mCount.load(std::memory_order_relaxed);
+    s.sumMicroseconds = mSum.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < NUMBUCKETS; ++i)
+    {
+        s.buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+uint64_t MetricsHistogram::Snapshot::percentile(double q) const
+{
+    // buckets are read one by one while other threads record, so use their own total
+    uint64_t total = 0;
+    for (auto b : buckets)
+    {
+        total += b;
+    }
+    if (!total)
+    {
+        return 0;
+    }
+
+    uint64_t target = uint64_t(q * double(total) + 0.5);
+    target = std::max<uint64_t>(1, std::min(target, total));
+
+    uint64_t cumulative = 0;
+    for (unsigned i = 0; i < NUMBUCKETS; ++i)
+    {
+        cumulative += buckets[i];
+        if (cumulative >= target)
+        {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(NUMBUCKETS - 1);
+}
+
+static std::string prometheusSeconds(uint64_t us)
+{
+    std::ostringstream s;
+    s << std::setprecision(9) << double(us) / 1000000;
+    return s.str();
+}
+
+std::string MetricsSnapshot::prometheus() const
+{
+    std::ostringstream s;
+
+    for (auto& c : counters)
+    {
+        s << "# TYPE mega_" << c.first << "_total counter\n"
+          << "mega_" << c.first << "_total " << c.second << "\n";
+    }
+
+    for (auto& g : gauges)
+    {
+        s << "# TYPE mega_" << g.first << " gauge\n"
+          << "mega_" << g.first << " " << g.second << "\n";
+    }
+
+    for (auto& family : histograms)
+    {
+        auto labelIt = histogramLabels.find(family.first);
+        const std::string labelName = labelIt == histogramLabels.end() ? std::string() : labelIt->second;
+
+        s << "# TYPE mega_" << family.first << " histogram\n";
+        for (auto& series : family.second)
+        {
+            std::string label = labelName.empty() ? std::string() : labelName + "=\"" + series.first + "\"";
+            std::string labelPrefix = label.empty() ? std::string() : label + ",";
+            std::string labels = label.empty() ? std::string() : "{" + label + "}";
+
+            // every bucket, empty or not: the series of a histogram must keep the same bounds
+            // across scrapes for rates and quantiles to be computed over them
+            uint64_t cumulative = 0;
+            for (unsigned i = 0; i < MetricsHistogram::NUMBUCKETS; ++i)
+            {
+                cumulative += series.second.buckets[i];
+                s << "mega_" << family.first << "_bucket{" << labelPrefix << "le=\""
+                  << prometheusSeconds(MetricsHistogram::bucketUpperBound(i)) << "\"} " << cumulative << "\n";
+            }
+            s << "mega_" << family.first << "_bucket{" << labelPrefix << "le=\"+Inf\"} " << cumulative << "\n"
+              << "mega_" << family.first << "_sum" << labels << " " << prometheusSeconds(series.second.sumMicroseconds) << "\n"
+              << "mega_" << family.first << "_count" << labels << " " << cumulative << "\n";
+        }
+    }
+
+    return s.str();
+}
+
+void MetricsRegistry::setEnabled(bool enable)
+{
+    if (mEnabled.exchange(enable) != enable)
+    {
+        LOG_info << "Runtime metrics " << (enable ? "enabled" : "disabled");
+    }
+}
+
+unsigned MetricsRegistry::shardIndex()
+{
+    static std::atomic<unsigned> nextShard{0};
+    thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed) % NUMSHARDS;
+    return shard;
+}
+
+MetricsHistogram& MetricsRegistry::histogram(const std::string& family, const std::string& labelName, const std::string& labelValue)
+{
+    std::lock_guard<std::mutex> g(mHistogramsMutex);
+
+    if (!labelName.empty())
+    {
+        mHistogramLabels[family] = labelName;
+    }
+
+    auto& h = mHistograms[family][labelValue];
+    if (!h)
+    {
+        h.reset(new MetricsHistogram);
+    }
+    return *h;
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const
+{
+    MetricsSnapshot s;
+
+    for (int c = 0; c < NUM_COUNTERS; ++c)
+    {
+        uint64_t sum = 0;
+        for (auto& shard : mShards)
+        {
+            sum += shard.counters[c].load(std::memory_order_relaxed);
+        }
+        s.counters[counterName(Counter(c))] = sum;
+    }
+
+    for (int g = 0; g < NUM_GAUGES; ++g)
+    {
+        s.gauges[gaugeName(Gauge(g))] = mGauges[g].load(std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> g(mHistogramsMutex);
+    s.histogramLabels = mHistogramLabels;
+    for (auto& family : mHistograms)
+    {
+        for (auto& series : family.second)
+        {
+            s.histograms[family.first][series.first] = series.second->snapshot();
+        }
+    }
+    return s;
+}
+
+const char* MetricsRegistry::counterName(Counter c)
+{
+    switch (c)
+    {
+        case CS_REQUESTS_SENT: return "cs_requests_sent";
+        case CS_COMMANDS_SENT: return "cs_commands_sent";
+        case CS_BACKOFFS: return "cs_backoffs";
+        case SC_ACTIONPACKETS: return "sc_actionpackets";
+        case TRANSFER_CHUNKS_GET: return "transfer_chunks_get";
+        case TRANSFER_CHUNKS_PUT: return "transfer_chunks_put";
+        case TRANSFER_TEMPERRORS: return "transfer_temperrors";
+        case TRANSFER_FAILS: return "transfer_fails";
+        case DB_COMMITS: return "db_commits";
+        case EVENTS_DROPPED: return "events_dropped";
+        case EVENTS_COALESCED: return "events_coalesced";
+        case NUM_COUNTERS: break;
+    }
+    return "unknown";
+}
+
+const char* MetricsRegistry::gaugeName(Gauge g)
+{
+    switch (g)
+    {
+        case CS_PENDING_COMMANDS: return "cs_pending_commands";
+        case TRANSFERS_QUEUED: return "transfers_queued";
+        case TRANSFER_SLOTS: return "transfer_slots";
+        case TRANSFER_BUFFER_BYTES: return "transfer_buffer_bytes";
+        case EVENTS_PENDING: return "events_pending";
+        case NUM_GAUGES: break;
+    }
+    return "unknown";
+}
+
+namespace CodeCounter
+{
+    MetricsHistogram* scopeHistogram(const std::string& name)
+    {
+        return &g_metrics.histogram("exec_phase_seconds", "phase", name);
+    }
+
+    bool scopeMetricsEnabled()
+    {
+        return g_metrics.enabled();
+    }
+
+    void recordScope(MetricsHistogram* histogram, steady_clock::duration d)
+    {
+        histogram->record(d);
+    }
+}
+
+} // namespace
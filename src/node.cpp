@@ -32,6 +32,42 @@
 
 namespace mega {
 
+void node_list::push_back(Node* n)
+{
+    assert(!n->prevsibling && !n->nextsibling && mFirst != n);
+    n->prevsibling = mLast;
+    if (mLast)
+    {
+        mLast->nextsibling = n;
+    }
+    else
+    {
+        mFirst = n;
+    }
+    mLast = n;
+    mSize++;
+    mFiles += n->type == FILENODE;
+}
+
+void node_list::erase(Node* n)
+{
+    assert(mSize);
+    (n->prevsibling ? n->prevsibling->nextsibling : mFirst) = n->nextsibling;
+    (n->nextsibling ? n->nextsibling->prevsibling : mLast) = n->prevsibling;
+    n->prevsibling = nullptr;
+    n->nextsibling = nullptr;
+    mSize--;
+    mFiles -= n->type == FILENODE;
+}
+
+void node_list::clear()
+{
+    while (mFirst)
+    {
+        erase(mFirst);
+    }
+}
+
 Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
            nodetype_t t, m_off_t s, handle u, const char* fa, m_time_t ts)
 {
@@ -51,8 +87,6 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
     syncget = NULL;
 
     syncdeleted = SYNCDEL_NONE;
-    todebris_it = client->todebris.end();
-    tounlink_it = client->tounlink.end();
 #endif
 
     type = t;
@@ -60,6 +94,12 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
     size = s;
     owner = u;
 
+    if (type != FILENODE)
+    {
+        mCounts.reset(new NodeCounter);
+        mCounts->folders = (type == FOLDERNODE) ? 1 : 0;
+    }
+
     copystring(&fileattrstring, fa);
 
     ctime = ts;
@@ -105,8 +145,6 @@ Node::Node(MegaClient* cclient, node_vector* dp, handle h, handle ph,
     {
         dp->push_back(this);
     }
-
-    client->mFingerprints.newnode(this);
 }
 
 Node::~Node()
@@ -127,17 +165,9 @@ Node::~Node()
     }
 
 #ifdef ENABLE_SYNC
-    // remove from todebris node_set
-    if (todebris_it != client->todebris.end())
-    {
-        client->todebris.erase(todebris_it);
-    }
-
-    // remove from tounlink node_set
-    if (tounlink_it != client->tounlink.end())
-    {
-        client->tounlink.erase(tounlink_it);
-    }
+    // remove from todebris / tounlink node_sets
+    client->todebris.erase(this);
+    client->tounlink.erase(this);
 #endif
 
     if (outshares)
@@ -166,14 +196,17 @@ Node::~Node()
         // remove from parent's children
         if (parent)
         {
-            parent->children.erase(child_it);
+            parent->children.erase(this);
         }
 
+        NodeCounter nc = subnodeCounts();
+        updateancestorcounts(nc, false);
+
         Node* fa = firstancestor();
         handle ancestor = fa->nodehandle;
         if (ancestor == client->rootnodes[0] || ancestor == client->rootnodes[1] || ancestor == client->rootnodes[2] || fa->inshare)
         {
-            client->mNodeCounters[firstancestor()->nodehandle] -= subnodeCounts();
+            client->mNodeCounters[firstancestor()->nodehandle] -= nc;
         }
 
         if (inshare)
@@ -187,6 +220,7 @@ Node::~Node()
         {
             (*it)->parent = NULL;
         }
+        children.clear();
     }
 
     if (plink)
@@ -994,6 +1028,12 @@ bool Node::applykey()
 
 NodeCounter Node::subnodeCounts() const
 {
+    if (mCounts)
+    {
+        return *mCounts;
+    }
+
+    // a file and its versions
     NodeCounter nc;
     for (Node *child : children)
     {
@@ -1009,11 +1049,41 @@ NodeCounter Node::subnodeCounts() const
             nc.versionStorage += size;
         }
     }
-    else if (type == FOLDERNODE)
+    return nc;
+}
+
+void Node::updateancestorcounts(const NodeCounter& nc, bool add)
+{
+    for (Node* p = parent; p; p = p->parent)
+    {
+        if (p->mCounts)
+        {
+            if (add)
+            {
+                *p->mCounts += nc;
+            }
+            else
+            {
+                *p->mCounts -= nc;
+            }
+        }
+    }
+}
+
+void Node::setsize(m_off_t s)
+{
+    assert(type == FILENODE);
+    updateancestorcounts(subnodeCounts(), false);
+
+    // the size is part of the fingerprint, which the index hashes
+    bool indexed = client->mFingerprints.remove(this);
+    size = s;
+    if (indexed)
     {
-        nc.folders += 1;
+        client->mFingerprints.add(this);
     }
-    return nc;
+
+    updateancestorcounts(subnodeCounts(), true);
 }
 
 // returns whether node was moved
@@ -1024,23 +1094,21 @@ bool Node::setparent(Node* p)
         return false;
     }
 
-    NodeCounter nc;
-    bool gotnc = false;
+    // a file's counts depend on whether it's a version, ie. on its parent
+    NodeCounter nc = subnodeCounts();
+    updateancestorcounts(nc, false);
 
     Node *originalancestor = firstancestor();
     handle oah = originalancestor->nodehandle;
     if (oah == client->rootnodes[0] || oah == client->rootnodes[1] || oah == client->rootnodes[2] || originalancestor->inshare)
     {
-        nc = subnodeCounts();
-        gotnc = true;
-
         // nodes moving from cloud drive to rubbish for example, or between inshares from the same user.
         client->mNodeCounters[oah] -= nc;
     }
 
     if (parent)
     {
-        parent->children.erase(child_it);
+        parent->children.erase(this);
     }
 
 #ifdef ENABLE_SYNC
@@ -1051,18 +1119,19 @@ bool Node::setparent(Node* p)
 
     if (parent)
     {
-        child_it = parent->children.insert(parent->children.end(), this);
+        parent->children.push_back(this);
     }
 
+    if (type == FILENODE)
+    {
+        nc = subnodeCounts();
+    }
+    updateancestorcounts(nc, true);
+
     Node* newancestor = firstancestor();
     handle nah = newancestor->nodehandle;
     if (nah == client->rootnodes[0] || nah == client->rootnodes[1] || nah == client->rootnodes[2] || newancestor->inshare)
     {
-        if (!gotnc)
-        {
-            nc = subnodeCounts();
-        }
-
         client->mNodeCounters[nah] += nc;
     }
 
@@ -1620,9 +1689,10 @@ LocalNode::~LocalNode()
         setnameparent(NULL, NULL, NULL);
     }
 
-    for (localnode_map::iterator it = children.begin(); it != children.end(); )
+    // each child removes itself from children; take them from the back so nothing needs shifting
+    while (!children.empty())
     {
-        delete it++->second;
+        delete (children.end() - 1)->second;
     }
 
     if (node)
@@ -1839,11 +1909,78 @@ LocalNode* LocalNode::unserialize(Sync* sync, const string* d)
 
 #endif
 
-void Fingerprints::newnode(Node* n)
+LocalNodeChildMap::iterator LocalNodeChildMap::lowerBound(const LocalPath* name)
 {
-    if (n->type == FILENODE)
+    return std::lower_bound(mEntries.begin(), mEntries.end(), name,
+                            [](const value_type& entry, const LocalPath* key) { return *entry.first < *key; });
+}
+
+LocalNodeChildMap::const_iterator LocalNodeChildMap::lowerBound(const LocalPath* name) const
+{
+    return std::lower_bound(mEntries.begin(), mEntries.end(), name,
+                            [](const value_type& entry, const LocalPath* key) { return *entry.first < *key; });
+}
+
+LocalNodeChildMap::iterator LocalNodeChildMap::find(const LocalPath* name)
+{
+    iterator it = lowerBound(name);
+    return (it != mEntries.end() && !(*name < *it->first)) ? it : mEntries.end();
+}
+
+LocalNodeChildMap::const_iterator LocalNodeChildMap::find(const LocalPath* name) const
+{
+    const_iterator it = lowerBound(name);
+    return (it != mEntries.end() && !(*name < *it->first)) ? it : mEntries.end();
+}
+
+LocalNode*& LocalNodeChildMap::operator[](const LocalPath* name)
+{
+    iterator it = lowerBound(name);
+    if (it == mEntries.end() || *name < *it->first)
+    {
+        it = mEntries.insert(it, value_type(name, nullptr));
+    }
+    else
     {
-        n->fingerprint_it = mFingerprints.end();
+        // the key must point at the localname of the node currently stored
+        it->first = name;
+    }
+    return it->second;
+}
+
+size_t LocalNodeChildMap::erase(const LocalPath* name)
+{
+    iterator it = find(name);
+    if (it == mEntries.end())
+    {
+        return 0;
+    }
+    erase(it);
+    return 1;
+}
+
+LocalNodeChildMap::iterator LocalNodeChildMap::erase(iterator it)
+{
+    size_t index = static_cast<size_t>(it - mEntries.begin());
+    mEntries.erase(it);
+    compact();
+    return mEntries.begin() + static_cast<ptrdiff_t>(index);
+}
+
+void LocalNodeChildMap::clear()
+{
+    container_type().swap(mEntries);
+}
+
+void LocalNodeChildMap::compact()
+{
+    if (mEntries.empty())
+    {
+        container_type().swap(mEntries);
+    }
+    else if (mEntries.capacity() > 64 && mEntries.size() < mEntries.capacity() / 4)
+    {
+        container_type(mEntries.begin(), mEntries.end()).swap(mEntries);
     }
 }
 
@@ -1851,19 +1988,30 @@ void Fingerprints::add(Node* n)
 {
     if (n->type == FILENODE)
     {
-        n->fingerprint_it = mFingerprints.insert(n);
+        mFingerprints.insert(n);
         mSumSizes += n->size;
     }
 }
 
-void Fingerprints::remove(Node* n)
+bool Fingerprints::remove(Node* n)
 {
-    if (n->type == FILENODE && n->fingerprint_it != mFingerprints.end())
+    if (n->type != FILENODE)
+    {
+        return false;
+    }
+
+    // the iterators of the set don't survive rehashing, so n is found among the nodes with its fingerprint
+    auto p = mFingerprints.equal_range(n);
+    for (iterator it = p.first; it != p.second; ++it)
     {
-        mSumSizes -= n->size;
-        mFingerprints.erase(n->fingerprint_it);
-        n->fingerprint_it = mFingerprints.end();
+        if (*it == n)
+        {
+            mSumSizes -= n->size;
+            mFingerprints.erase(it);
+            return true;
+        }
     }
+    return false;
 }
 
 void Fingerprints::clear()
@@ -75,6 +75,13 @@ extern JavaVM *MEGAjvm;
 #define XFS_SUPER_MAGIC 0x58465342
 #endif /* ! XFS_SUPER_MAGIC */
 
+#include <sys/syscall.h>
+
+// from <linux/fs.h>, which clashes with <sys/mount.h> on some systems
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif /* ! FICLONE */
+
 #endif /* __linux__ */
 
 #if defined(__APPLE__) || defined(USE_IOS)
@@ -1114,6 +1121,49 @@ bool PosixFileSystemAccess::renamelocal(LocalPath& oldname, LocalPath& newname,
     return false;
 }
 
+#ifdef __linux__
+// Copies all of sfd into the empty tfd without moving the data through user space:
+// a reflink (shared extents, btrfs/XFS/...) where possible, otherwise copy_file_range().
+// Returns false, leaving tfd empty and both offsets at 0, if the kernel can't do it for these files.
+static bool copyinkernel(int sfd, int tfd)
+{
+    if (!ioctl(tfd, FICLONE, sfd))
+    {
+        LOG_verbose << "Copied via reflink";
+        return true;
+    }
+
+#ifdef __NR_copy_file_range
+    struct stat statbuf;
+    if (!fstat(sfd, &statbuf))
+    {
+        off_t remaining = statbuf.st_size;
+        ssize_t copied = 0;
+
+        while (remaining > 0
+               && (copied = syscall(__NR_copy_file_range, sfd, nullptr, tfd, nullptr, size_t(remaining), 0u)) > 0)
+        {
+            remaining -= copied;
+        }
+
+        if (!remaining)
+        {
+            LOG_verbose << "Copied via copy_file_range";
+            return true;
+        }
+
+        // not supported (old kernel, cross-filesystem...) or failed midway: start over in user space
+        if (ftruncate(tfd, 0) || lseek(sfd, 0, SEEK_SET) || lseek(tfd, 0, SEEK_SET))
+        {
+            LOG_warn << "Unable to reset files after copy_file_range. Error code: " << errno;
+        }
+    }
+#endif
+
+    return false;
+}
+#endif
+
 bool PosixFileSystemAccess::copylocal(LocalPath& oldname, LocalPath& newname, m_time_t mtime)
 {
 #ifdef USE_IOS
@@ -1143,12 +1193,21 @@ bool PosixFileSystemAccess::copylocal(LocalPath& oldname, LocalPath& newname, m_
 
     if ((sfd = open(oldnamestr.c_str(), O_RDONLY)) >= 0)
     {
-        LOG_verbose << "Copying via read/write";
         mode_t mode = umask(0);
         if ((tfd = open(newnamestr.c_str(), O_WRONLY | O_CREAT | O_TRUNC, defaultfilepermissions)) >= 0)
         {
             umask(mode);
-            while (((t = read(sfd, buf, sizeof buf)) > 0) && write(tfd, buf, t) == t);
+#ifdef __linux__
+            if (copyinkernel(sfd, tfd))
+            {
+                t = 0;
+            }
+            else
+#endif
+            {
+                LOG_verbose << "Copying via read/write";
+                while (((t = read(sfd, buf, sizeof buf)) > 0) && write(tfd, buf, t) == t);
+            }
 #endif
             close(tfd);
         }
@@ -31,6 +31,8 @@ extern JavaVM *MEGAjvm;
 #define IPV6_RETRY_INTERVAL_DS 72000
 #define DNS_CACHE_TIMEOUT_DS 18000
 #define DNS_CACHE_EXPIRES 0
+#define DNS_CACHE_PERSISTED_TTL 86400
+#define DNS_CACHE_PREWARM_HOSTS 8
 #define MAX_SPEED_CONTROL_TIMEOUT_MS 500
 
 namespace mega {
@@ -305,6 +307,10 @@ CurlHttpIO::CurlHttpIO()
     numconnections[GET] = 0;
     numconnections[PUT] = 0;
     curlsocketsprocessed = true;
+    http2enabled = false;
+    maxhostconnections[API] = 0;
+    maxhostconnections[GET] = 0;
+    maxhostconnections[PUT] = 0;
 
     struct ares_options options;
     options.tries = 2;
@@ -341,6 +347,10 @@ CurlHttpIO::CurlHttpIO()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
+    configuremulti(API);
+    configuremulti(GET);
+    configuremulti(PUT);
+
     curlsh = curl_share_init();
     curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
     curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
@@ -794,6 +804,248 @@ void CurlHttpIO::setdnsservers(const char* servers)
     }
 }
 
+void CurlHttpIO::configuremulti(direction_t d)
+{
+#if LIBCURL_VERSION_NUM >= 0x072b00 // At least cURL 7.43.0
+    // when disabled, keep (or restore) the default of libcurl, which multiplexes since 7.62.0
+    long pipelining = CURLPIPE_MULTIPLEX;
+    if (!http2enabled && curl_version_info(CURLVERSION_NOW)->version_num < 0x073e00)
+    {
+        pipelining = CURLPIPE_NOTHING;
+    }
+    curl_multi_setopt(curlm[d], CURLMOPT_PIPELINING, pipelining);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x071e00 // At least cURL 7.30.0
+    curl_multi_setopt(curlm[d], CURLMOPT_MAX_HOST_CONNECTIONS, maxhostconnections[d]);
+#endif
+}
+
+bool CurlHttpIO::sethttp2(bool enable)
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00 // At least cURL 7.47.0
+    if (enable && !(curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2))
+    {
+        LOG_warn << "HTTP/2 not supported by this libcurl";
+        return false;
+    }
+
+    LOG_debug << "HTTP/2 " << (enable ? "enabled" : "disabled");
+    http2enabled = enable;
+    configuremulti(API);
+    configuremulti(GET);
+    configuremulti(PUT);
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+bool CurlHttpIO::setmaxhostconnections(direction_t d, long n)
+{
+#if LIBCURL_VERSION_NUM >= 0x071e00 // At least cURL 7.30.0
+    maxhostconnections[d] = n > 0 ? n : 0;
+    configuremulti(d);
+    return true;
+#else
+    return false;
+#endif
+}
+
+string CurlHttpIO::connectionstatsreport(bool reset)
+{
+    static const char* names[] = { "GET", "PUT", "API" };
+
+    std::ostringstream s;
+    for (int d = GET; d <= API; d++)
+    {
+        const ConnectionStats& stats = connectionstats[d];
+        s << " curl " << names[d] << " requests: " << stats.requests
+          << " handshakes: " << stats.handshakes
+          << " reused: " << stats.reused
+          << " (" << (stats.requests ? stats.reused * 100 / stats.requests : 0) << "%)"
+          << " http2: " << stats.http2 << "\n";
+        if (reset)
+        {
+            connectionstats[d] = ConnectionStats();
+        }
+    }
+    return s.str();
+}
+
+string CurlHttpIO::serializednscache()
+{
+    string d;
+    CacheableWriter w(d);
+
+    m_time_t now = m_time();
+    for (auto& dnsPair : dnscache)
+    {
+        const CurlDNSEntry& entry = dnsPair.second;
+        if ((!entry.ipv4.size() && !entry.ipv6.size())
+                || !entry.mResolvedTime || now - entry.mResolvedTime >= DNS_CACHE_PERSISTED_TTL)
+        {
+            continue;
+        }
+
+        // a cleared IPv6 record means that IPv6 failed for this host, so IPv4 will be preferred
+        w.serializestring(dnsPair.first);
+        w.serializestring(entry.ipv4);
+        w.serializestring(entry.ipv6);
+        w.serializei64(entry.mResolvedTime);
+    }
+    return d;
+}
+
+void CurlHttpIO::loaddnscache(const string& d)
+{
+    CacheableReader r(d);
+
+    string hostname, ipv4, ipv6;
+    int64_t resolvedtime;
+    m_time_t now = m_time();
+    unsigned loaded = 0;
+    while (r.hasdataleft())
+    {
+        if (!r.unserializestring(hostname)
+                || !r.unserializestring(ipv4)
+                || !r.unserializestring(ipv6)
+                || !r.unserializei64(resolvedtime))
+        {
+            LOG_warn << "Corrupt persisted DNS cache";
+            return;
+        }
+
+        if (now - resolvedtime >= DNS_CACHE_PERSISTED_TTL || resolvedtime > now
+                || dnscache.find(hostname) != dnscache.end())
+        {
+            continue;
+        }
+
+        CurlDNSEntry& entry = dnscache[hostname];
+        entry.ipv4 = ipv4;
+        entry.ipv4timestamp = ipv4.size() ? Waiter::ds : 0;
+        entry.ipv6 = ipv6;
+        entry.ipv6timestamp = ipv6.size() ? Waiter::ds : 0;
+        entry.mResolvedTime = resolvedtime;
+
+        // use the persisted IPs right away, but confirm them in the background
+        entry.mNeedsResolvingAgain = true;
+        loaded++;
+    }
+
+    LOG_debug << "Loaded " << loaded << " persisted DNS cache records";
+}
+
+namespace {
+struct DNSPrewarmContext
+{
+    CurlHttpIO* httpio;
+    string hostname;
+};
+}
+
+void CurlHttpIO::prewarm(const vector<string>& urls)
+{
+    if (proxyurl.size())
+    {
+        // names are resolved by the proxy
+        return;
+    }
+
+    std::set<string> hostnames;
+    for (string url : urls)
+    {
+        string scheme, hostname;
+        int port;
+        if (crackurl(&url, &scheme, &hostname, &port) && hostname.size() && hostname[0] != '[')
+        {
+            hostnames.insert(hostname);
+        }
+    }
+
+    // and the most recently resolved hosts from the persisted cache
+    vector<pair<m_time_t, string>> recent;
+    for (auto& dnsPair : dnscache)
+    {
+        if (dnsPair.second.mNeedsResolvingAgain)
+        {
+            recent.emplace_back(dnsPair.second.mResolvedTime, dnsPair.first);
+        }
+    }
+    std::sort(recent.begin(), recent.end(), std::greater<pair<m_time_t, string>>());
+    for (size_t i = 0; i < recent.size() && i < DNS_CACHE_PREWARM_HOSTS; i++)
+    {
+        hostnames.insert(recent[i].second);
+    }
+
+    // both address families are queried in parallel
+    for (const string& hostname : hostnames)
+    {
+        LOG_debug << "Prewarming DNS for " << hostname;
+#if !TARGET_OS_IPHONE
+        CurlDNSEntry& entry = dnscache[hostname];
+        entry.mPrewarmFailed = false;
+
+        // a persisted entry without IPv6 address means that IPv6 failed for the host: keep preferring IPv4
+        if ((entry.ipv6.size() || entry.ipv4.empty()) && ipv6available())
+        {
+            entry.mPrewarmsPending++;
+            if (ipv6requestsenabled)
+            {
+                ares_gethostbyname(ares, hostname.c_str(), PF_INET6, ares_prewarm_callback, new DNSPrewarmContext{ this, hostname });
+            }
+            else
+            {
+                // still disabled (it's decided when the first request is posted)
+                mPrewarmIPv6.insert(hostname);
+            }
+        }
+
+        entry.mPrewarmsPending++;
+        ares_gethostbyname(ares, hostname.c_str(), PF_INET, ares_prewarm_callback, new DNSPrewarmContext{ this, hostname });
+#endif
+    }
+}
+
+void CurlHttpIO::ares_prewarm_callback(void* arg, int status, int, struct hostent* host)
+{
+    std::unique_ptr<DNSPrewarmContext> ctx(static_cast<DNSPrewarmContext*>(arg));
+    CurlDNSEntry& entry = ctx->httpio->dnscache[ctx->hostname];
+    if (entry.mPrewarmsPending)
+    {
+        entry.mPrewarmsPending--;
+    }
+
+    if (status != ARES_SUCCESS || !host || !host->h_addr_list[0])
+    {
+        LOG_debug << "Unable to prewarm DNS for " << ctx->hostname << ": " << status;
+        entry.mPrewarmFailed = true;
+        return;
+    }
+
+    char ip[INET6_ADDRSTRLEN];
+    mega_inet_ntop(host->h_addrtype, host->h_addr_list[0], ip, sizeof(ip));
+
+    if (host->h_addrtype == PF_INET6)
+    {
+        entry.ipv6 = ip;
+        entry.ipv6timestamp = Waiter::ds;
+    }
+    else
+    {
+        entry.ipv4 = ip;
+        entry.ipv4timestamp = Waiter::ds;
+    }
+    entry.mResolvedTime = m_time();
+
+    // the addresses of the other family are confirmed by their own answer,
+    // otherwise they are resolved again when connecting
+    if (!entry.mPrewarmsPending && !entry.mPrewarmFailed)
+    {
+        entry.mNeedsResolvingAgain = false;
+    }
+}
+
 void CurlHttpIO::disconnect()
 {
     LOG_debug << "Reinitializing the network layer";
@@ -867,6 +1119,10 @@ void CurlHttpIO::disconnect()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
+    configuremulti(API);
+    configuremulti(GET);
+    configuremulti(PUT);
+
     disconnecting = false;
     if (dnsservers.size())
     {
@@ -1202,6 +1458,7 @@ void CurlHttpIO::ares_completed_callback(void* arg, int status, int, struct host
             }
             dnsEntry.ipv4timestamp = Waiter::ds;
         }
+        dnsEntry.mResolvedTime = m_time();
 
         // IPv6 takes precedence over IPv4
         if (!httpctx->hostip.size() || (host->h_addrtype == PF_INET6 && !httpctx->curl))
@@ -1474,6 +1731,14 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         curl_easy_setopt(curl, CURLOPT_SOCKOPTDATA, (void*)req);
         curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
 
+#if LIBCURL_VERSION_NUM >= 0x072f00 // At least cURL 7.47.0
+        if (httpio->http2enabled)
+        {
+            // wait for a connection that can be multiplexed rather than opening a new one
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        }
+#endif
 
         if (httpio->maxspeed[GET] && httpio->maxspeed[GET] <= 102400)
         {
@@ -1835,6 +2100,17 @@ void CurlHttpIO::post(HttpReq* req, const char* data, unsigned len)
         }
     }
 
+    if (ipv6requestsenabled && mPrewarmIPv6.size())
+    {
+        // the IPv6 part of the prewarm, which waited for IPv6 requests to be enabled
+        for (const string& hostname : mPrewarmIPv6)
+        {
+            LOG_debug << "Prewarming DNS for " << hostname << " (IPv6)";
+            ares_gethostbyname(ares, hostname.c_str(), PF_INET6, ares_prewarm_callback, new DNSPrewarmContext{ this, hostname });
+        }
+        mPrewarmIPv6.clear();
+    }
+
     // purge DNS cache if needed
     if (DNS_CACHE_EXPIRES && (Waiter::ds - lastdnspurge) > DNS_CACHE_TIMEOUT_DS)
     {
@@ -2102,6 +2378,34 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
 
             if (msg->msg == CURLMSG_DONE)
             {
+                if (CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle)
+                {
+                    ConnectionStats& stats = connectionstats[httpctx->d];
+                    stats.requests++;
+
+                    long newconnections = 0;
+                    if (curl_easy_getinfo(msg->easy_handle, CURLINFO_NUM_CONNECTS, &newconnections) == CURLE_OK)
+                    {
+                        if (newconnections)
+                        {
+                            stats.handshakes += uint64_t(newconnections);
+                        }
+                        else
+                        {
+                            stats.reused++;
+                        }
+                    }
+
+#if LIBCURL_VERSION_NUM >= 0x073200 // At least cURL 7.50.0
+                    long httpversion = 0;
+                    if (curl_easy_getinfo(msg->easy_handle, CURLINFO_HTTP_VERSION, &httpversion) == CURLE_OK
+                            && httpversion == CURL_HTTP_VERSION_2_0)
+                    {
+                        stats.http2++;
+                    }
+#endif
+                }
+
                 CURLcode errorCode = msg->data.result;
                 if (errorCode != CURLE_OK)
                 {
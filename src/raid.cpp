@@ -901,11 +901,7 @@ std::pair<m_off_t, m_off_t> TransferBufferManager::nextNPosForConnection(unsigne
 
 void TransferBufferManager::bufferWriteCompletedAction(FilePiece& r)
 {
-    for (chunkmac_map::iterator it = r.chunkmacs.begin(); it != r.chunkmacs.end(); it++)
-    {
-        transfer->chunkmacs[it->first] = it->second;
-    }
-
+    r.chunkmacs.copyEntriesTo(transfer->chunkmacs);
     r.chunkmacs.clear();
     transfer->progresscompleted += r.buf.datalen();
     LOG_debug << "Cached data at: " << r.pos << "   Size: " << r.buf.datalen();
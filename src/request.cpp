@@ -23,6 +23,9 @@
 #include "mega/command.h"
 #include "mega/logging.h"
 #include "mega/megaclient.h"
+#include "mega/metrics.h"
+#include "mega/tracing.h"
+#include "mega/http.h"
 
 namespace mega {
 
@@ -89,6 +92,9 @@ void Request::process(MegaClient* client)
     DBTableTransactionCommitter committer(client->tctable);
     client->mTctableRequestCommitter = &committer;
 
+    bool measure = g_metrics.enabled() && sentTime != std::chrono::steady_clock::time_point();
+    bool trace = g_tracer.enabled();
+
     client->json = json;
     for (; processindex < cmds.size() && !stopProcessing; processindex++)
     {
@@ -101,6 +107,12 @@ void Request::process(MegaClient* client)
         auto cmdJSON = client->json;
         bool parsedOk = true;
 
+        std::chrono::steady_clock::time_point procresultStart;
+        if (trace && cmd->traceId)
+        {
+            procresultStart = std::chrono::steady_clock::now();
+        }
+
         Error e;
         if (cmd->checkError(e, client->json))
         {
@@ -115,6 +127,17 @@ void Request::process(MegaClient* client)
             parsedOk = processCmdJSON(cmd);
         }
 
+        if (measure)
+        {
+            // from sending the batch until this command's result has been processed
+            client->reqs.commandHistogram(cmd->commandName).record(std::chrono::steady_clock::now() - sentTime);
+        }
+
+        if (trace && cmd->traceId)
+        {
+            tracecommand(cmd, procresultStart, std::chrono::steady_clock::now());
+        }
+
         if (!parsedOk)
         {
             LOG_err << "JSON for that command was not recognised/consumed properly, adjusting";
@@ -143,6 +166,25 @@ void Request::process(MegaClient* client)
     client->mTctableRequestCommitter = nullptr;
 }
 
+void Request::tracecommand(Command* cmd, std::chrono::steady_clock::time_point procresultStart, std::chrono::steady_clock::time_point procresultEnd) const
+{
+    static const std::chrono::steady_clock::time_point none;
+
+    // the whole lifetime of the command, then one span per stage that has both ends recorded
+    g_tracer.span("cs", cmd->commandName, cmd->traceId, cmd->traceQueued, procresultEnd,
+                  "\"batch\":" + std::to_string(cmds.size()));
+
+    std::chrono::steady_clock::time_point stages[] = { cmd->traceQueued, sentTime, postTime, firstByteTime, lastByteTime, procresultStart, procresultEnd };
+    static const char* names[] = { "queued", "sending", "server", "receiving", "waiting", "procresult" };
+    for (size_t i = 0; i + 1 < sizeof stages / sizeof *stages; i++)
+    {
+        if (stages[i] != none && stages[i + 1] != none)
+        {
+            g_tracer.span("cs", names[i], cmd->traceId, stages[i], stages[i + 1]);
+        }
+    }
+}
+
 void Request::serverresponse(std::string&& movestring, MegaClient* client)
 {
     assert(processindex == 0);
@@ -182,6 +224,18 @@ void Request::clear()
     json.pos = NULL;
     processindex = 0;
     stopProcessing = false;
+    sentTime = postTime = firstByteTime = lastByteTime = std::chrono::steady_clock::time_point();
+}
+
+void Request::traceretry(size_t channel) const
+{
+    for (const Command* cmd : cmds)
+    {
+        if (cmd->traceId)
+        {
+            g_tracer.instant("cs", "retry", cmd->traceId, "\"channel\":" + std::to_string(channel));
+        }
+    }
 }
 
 bool Request::empty() const
@@ -201,6 +255,18 @@ void Request::swap(Request& r)
 RequestDispatcher::RequestDispatcher()
 {
     nextreqs.push_back(Request());
+    sidenextreqs.push_back(Request());
+}
+
+Request& RequestDispatcher::inflight(size_t channel)
+{
+    assert(channel <= sideinflightreqs.size());
+    return channel ? sideinflightreqs[channel - 1] : inflightreq;
+}
+
+deque<Request>& RequestDispatcher::queued(size_t channel)
+{
+    return channel ? sidenextreqs : nextreqs;
 }
 
 #ifdef MEGA_MEASURE_CODE
@@ -224,71 +290,184 @@ void RequestDispatcher::add(Command *c)
     }
 #endif
 
-    if (nextreqs.back().size() >= MAX_COMMANDS)
+    if (g_tracer.enabled())
+    {
+        c->traceId = g_tracer.newId();
+        c->traceQueued = std::chrono::steady_clock::now();
+    }
+
+    addTo(c->orderIndependent && !sideinflightreqs.empty() ? sidenextreqs : nextreqs, c);
+}
+
+void RequestDispatcher::addTo(deque<Request>& reqs, Command *c)
+{
+    if (reqs.back().size() >= MAX_COMMANDS)
     {
         LOG_debug << "Starting an additional Request due to MAX_COMMANDS";
-        nextreqs.push_back(Request());
+        reqs.push_back(Request());
     }
-    if (c->batchSeparately && !nextreqs.back().empty())
+    if (c->batchSeparately && !reqs.back().empty())
     {
         LOG_debug << "Starting an additional Request for a batch-separately command";
-        nextreqs.push_back(Request());
+        reqs.push_back(Request());
     }
 
-    nextreqs.back().add(c);
+    reqs.back().add(c);
     if (c->batchSeparately)
     {
-        nextreqs.push_back(Request());
+        reqs.push_back(Request());
     }
 }
 
-bool RequestDispatcher::cmdspending() const
+bool RequestDispatcher::setSideChannels(size_t n)
 {
-    return !nextreqs.front().empty();
+    for (const Request& r : sideinflightreqs)
+    {
+        if (!r.empty())
+        {
+            LOG_warn << "Unable to change the number of cs side channels while they are in use";
+            return false;
+        }
+    }
+
+    sideinflightreqs.resize(n);
+
+    if (!n)
+    {
+        // whatever was waiting for a side channel goes through the primary one
+        for (Request& r : sidenextreqs)
+        {
+            if (!r.empty())
+            {
+                if (!nextreqs.back().empty())
+                {
+                    nextreqs.push_back(Request());
+                }
+                nextreqs.back().swap(r);
+            }
+        }
+        sidenextreqs.clear();
+        sidenextreqs.push_back(Request());
+    }
+    return true;
+}
+
+size_t RequestDispatcher::sideChannels() const
+{
+    return sideinflightreqs.size();
 }
 
-void RequestDispatcher::serverrequest(string *out, bool& suppressSID, bool &includesFetchingNodes)
+bool RequestDispatcher::cmdspending(size_t channel) const
 {
-    assert(inflightreq.empty());
-    inflightreq.swap(nextreqs.front());
-    nextreqs.pop_front();
-    if (nextreqs.empty())
+    return channel ? !sidenextreqs.front().empty() : !nextreqs.front().empty();
+}
+
+size_t RequestDispatcher::queuedCommands() const
+{
+    size_t n = 0;
+    for (const Request& r : nextreqs)
     {
-        nextreqs.push_back(Request());
+        n += r.size();
+    }
+    for (const Request& r : sidenextreqs)
+    {
+        n += r.size();
+    }
+    return n;
+}
+
+MetricsHistogram& RequestDispatcher::commandHistogram(const char* commandName)
+{
+    MetricsHistogram*& h = commandHistograms[commandName];
+    if (!h)
+    {
+        h = &g_metrics.histogram("cs_command_seconds", "command", commandName);
+    }
+    return *h;
+}
+
+void RequestDispatcher::serverrequest(string *out, bool& suppressSID, bool &includesFetchingNodes, size_t channel)
+{
+    Request& req = inflight(channel);
+    deque<Request>& reqs = queued(channel);
+
+    assert(req.empty());
+    req.swap(reqs.front());
+    reqs.pop_front();
+    if (reqs.empty())
+    {
+        reqs.push_back(Request());
+    }
+    req.get(out, suppressSID);
+    includesFetchingNodes = req.isFetchNodes();
+
+    if (g_metrics.enabled() || g_tracer.enabled())
+    {
+        req.sentTime = std::chrono::steady_clock::now();
+        req.postTime = req.firstByteTime = req.lastByteTime = std::chrono::steady_clock::time_point();
+    }
+    if (g_metrics.enabled())
+    {
+        g_metrics.add(MetricsRegistry::CS_REQUESTS_SENT);
+        g_metrics.add(MetricsRegistry::CS_COMMANDS_SENT, req.size());
     }
-    inflightreq.get(out, suppressSID);
-    includesFetchingNodes = inflightreq.isFetchNodes();
 #ifdef MEGA_MEASURE_CODE
-    csRequestsSent += inflightreq.size();
+    csRequestsSent += req.size();
     csBatchesSent += 1;
 #endif
 }
 
-void RequestDispatcher::requeuerequest()
+void RequestDispatcher::requeuerequest(size_t channel)
 {
 #ifdef MEGA_MEASURE_CODE
     csBatchesReceived += 1;
 #endif
-    assert(!inflightreq.empty());
-    if (!nextreqs.front().empty())
+    Request& req = inflight(channel);
+    deque<Request>& reqs = queued(channel);
+
+    assert(!req.empty());
+    if (g_tracer.enabled())
+    {
+        req.traceretry(channel);
+    }
+    if (!reqs.front().empty())
     {
-        nextreqs.push_front(Request());
+        reqs.push_front(Request());
     }
-    nextreqs.front().swap(inflightreq);
+    reqs.front().swap(req);
 }
 
-void RequestDispatcher::serverresponse(std::string&& movestring, MegaClient *client)
+void RequestDispatcher::received(const HttpReq& httpreq, size_t channel)
+{
+    if (g_tracer.enabled())
+    {
+        Request& req = inflight(channel);
+        req.postTime = httpreq.posttime;
+        req.firstByteTime = httpreq.firstdatatime;
+        req.lastByteTime = std::chrono::steady_clock::now();
+    }
+}
+
+void RequestDispatcher::serverresponse(std::string&& movestring, MegaClient *client, size_t channel)
 {
     CodeCounter::ScopeTimer ccst(client->performanceStats.csResponseProcessingTime);
 
+    Request& req = inflight(channel);
+
+    if (g_metrics.enabled() && req.sentTime != std::chrono::steady_clock::time_point())
+    {
+        static MetricsHistogram& requestTime = g_metrics.histogram("cs_request_seconds");
+        requestTime.record(std::chrono::steady_clock::now() - req.sentTime);
+    }
+
 #ifdef MEGA_MEASURE_CODE
     csBatchesReceived += 1;
-    csRequestsCompleted += inflightreq.size();
+    csRequestsCompleted += req.size();
 #endif
     processing = true;
-    inflightreq.serverresponse(std::move(movestring), client);
-    inflightreq.process(client);
-    assert(inflightreq.empty());
+    req.serverresponse(std::move(movestring), client);
+    req.process(client);
+    assert(req.empty());
     processing = false;
     if (clearWhenSafe)
     {
@@ -296,14 +475,16 @@ void RequestDispatcher::serverresponse(std::string&& movestring, MegaClient *cli
     }
 }
 
-void RequestDispatcher::servererror(const std::string& e, MegaClient *client)
+void RequestDispatcher::servererror(const std::string& e, MegaClient *client, size_t channel)
 {
+    Request& req = inflight(channel);
+
     // notify all the commands in the batch of the failure
     // so that they can deallocate memory, take corrective action etc.
     processing = true;
-    inflightreq.servererror(e, client);
-    inflightreq.process(client);
-    assert(inflightreq.empty());
+    req.servererror(e, client);
+    req.process(client);
+    assert(req.empty());
     processing = false;
     if (clearWhenSafe)
     {
@@ -318,6 +499,10 @@ void RequestDispatcher::clear()
         // we are being called from a command that is in progress (eg. logout) - delay wiping the data structure until that call ends.
         clearWhenSafe = true;
         inflightreq.stopProcessing = true;
+        for (Request& r : sideinflightreqs)
+        {
+            r.stopProcessing = true;
+        }
     }
     else
     {
@@ -328,6 +513,16 @@ void RequestDispatcher::clear()
         }
         nextreqs.clear();
         nextreqs.push_back(Request());
+        for (auto& r : sideinflightreqs)
+        {
+            r.clear();
+        }
+        for (auto& r : sidenextreqs)
+        {
+            r.clear();
+        }
+        sidenextreqs.clear();
+        sidenextreqs.push_back(Request());
         processing = false;
         clearWhenSafe = false;
     }
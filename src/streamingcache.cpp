@@ -0,0 +1,345 @@
+/**
+ * @file streamingcache.cpp
+ * @brief Data of a file streamed to several readers at once
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/streamingcache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mega {
+
+const m_off_t StreamingCache::SEGMENT_SIZE;
+const int StreamingCache::MAX_FETCH_ATTEMPTS;
+
+StreamingCache::Segment::Segment(m_off_t size)
+    : data(new char[static_cast<size_t>(size)])
+    , size(size)
+{
+}
+
+StreamingCache::StreamingCache(m_off_t fileSize, m_off_t readAhead, StartFetch startFetch)
+    : mFileSize(fileSize)
+    , mReadAhead(std::max(readAhead, SEGMENT_SIZE))
+    , mMaxCached(std::max(8 * mReadAhead, 8 * SEGMENT_SIZE))
+    , mStartFetch(std::move(startFetch))
+{
+}
+
+void StreamingCache::addReader(const void* reader, m_off_t pos, std::function<void()> notify,
+                               std::function<void(int tag)> fetchStarted)
+{
+    std::vector<FetchStart> starts;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mReaders[reader] = Reader{pos, mReadAhead, std::move(notify), std::move(fetchStarted)};
+        prefetch(reader, pos, mReadAhead, starts);
+    }
+    startFetches(starts);
+}
+
+void StreamingCache::removeReader(const void* reader)
+{
+    // the fetches without readers stop with their next write
+    std::lock_guard<std::mutex> g(mMutex);
+    mReaders.erase(reader);
+}
+
+void StreamingCache::setReadAhead(const void* reader, m_off_t readAhead)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto r = mReaders.find(reader);
+    if (r != mReaders.end())
+    {
+        r->second.readAhead = std::min(std::max(readAhead, mReadAhead), mMaxCached / 2);
+    }
+}
+
+bool StreamingCache::read(const void* reader, m_off_t pos, size_t maxLen, Chunk& chunk)
+{
+    std::vector<FetchStart> starts;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        chunk = Chunk();
+
+        m_off_t readAhead = mReadAhead;
+        auto r = mReaders.find(reader);
+        if (r != mReaders.end())
+        {
+            r->second.pos = pos;
+            readAhead = r->second.readAhead;
+        }
+
+        auto it = mSegments.find(pos / SEGMENT_SIZE);
+        if (it != mSegments.end())
+        {
+            m_off_t offset = pos % SEGMENT_SIZE;
+            if (it->second->filled > offset)
+            {
+                chunk.len = static_cast<size_t>(std::min(m_off_t(maxLen), it->second->filled - offset));
+
+                // shares the ownership of the segment
+                chunk.data = std::shared_ptr<const char>(it->second, it->second->data.get() + offset);
+            }
+        }
+
+        if (!chunk.len && gaveUp(firstMissing(pos)))
+        {
+            return false;
+        }
+
+        prefetch(reader, pos, readAhead, starts);
+    }
+    startFetches(starts);
+    return true;
+}
+
+m_off_t StreamingCache::firstMissing(m_off_t pos) const
+{
+    for (m_off_t index = pos / SEGMENT_SIZE; ; index++)
+    {
+        auto it = mSegments.find(index);
+        if (it == mSegments.end() || it->second->filled < it->second->size)
+        {
+            return index * SEGMENT_SIZE + (it == mSegments.end() ? 0 : it->second->filled);
+        }
+    }
+}
+
+bool StreamingCache::gaveUp(m_off_t missing) const
+{
+    auto f = mFailures.find(missing);
+    return f != mFailures.end() && f->second >= MAX_FETCH_ATTEMPTS;
+}
+
+void StreamingCache::prefetch(const void* reader, m_off_t pos, m_off_t readAhead, std::vector<FetchStart>& starts)
+{
+    m_off_t missing = firstMissing(pos);
+
+    // half the read-ahead is left before fetching more, so that fetches aren't restarted constantly
+    if (missing >= mFileSize || missing - pos >= readAhead / 2 || gaveUp(missing))
+    {
+        return;
+    }
+
+    for (auto& f : mFetches)
+    {
+        if (f.second.pos == missing && !f.second.stopping)
+        {
+            return;
+        }
+    }
+
+    int id = ++mLastFetchId;
+    mFetches[id] = Fetch{missing, false, reader};
+    starts.push_back(FetchStart{id, missing});
+}
+
+void StreamingCache::startFetches(const std::vector<FetchStart>& starts)
+{
+    for (const FetchStart& s : starts)
+    {
+        mStartFetch(shared_from_this(), s.id, s.pos, mFileSize - s.pos);
+    }
+}
+
+void StreamingCache::started(int id, int tag)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto f = mFetches.find(id);
+    if (f == mFetches.end())
+    {
+        return;
+    }
+
+    auto r = mReaders.find(f->second.reader);
+    if (r != mReaders.end() && r->second.fetchStarted)
+    {
+        r->second.fetchStarted(tag);
+    }
+}
+
+bool StreamingCache::write(int id, const char* data, size_t len)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    auto f = mFetches.find(id);
+    if (f == mFetches.end() || f->second.stopping)
+    {
+        return false;
+    }
+    Fetch& fetch = f->second;
+    m_off_t start = fetch.pos;
+
+    while (len && fetch.pos < mFileSize)
+    {
+        m_off_t index = fetch.pos / SEGMENT_SIZE;
+        std::shared_ptr<Segment>& segment = mSegments[index];
+        if (!segment)
+        {
+            segment = std::make_shared<Segment>(std::min(SEGMENT_SIZE, mFileSize - index * SEGMENT_SIZE));
+            mCachedSize += segment->size;
+        }
+
+        m_off_t offset = fetch.pos - index * SEGMENT_SIZE;
+        if (segment->filled != offset)
+        {
+            // another fetch got here first
+            fetch.stopping = true;
+            break;
+        }
+
+        size_t n = static_cast<size_t>(std::min(m_off_t(len), segment->size - offset));
+        memcpy(segment->data.get() + offset, data, n);
+        segment->filled += n;
+        fetch.pos += n;
+        data += n;
+        len -= n;
+    }
+
+    // the data where earlier fetches failed has arrived after all
+    mFailures.erase(mFailures.lower_bound(start), mFailures.lower_bound(fetch.pos));
+
+    notifyReaders();
+    trim();
+
+    if (!fetch.stopping && fetchIsDone(fetch))
+    {
+        fetch.stopping = true;
+    }
+    return !fetch.stopping;
+}
+
+bool StreamingCache::fetchIsDone(const Fetch& fetch) const
+{
+    if (fetch.pos >= mFileSize)
+    {
+        // the download ends by itself
+        return false;
+    }
+
+    auto next = mSegments.find(fetch.pos / SEGMENT_SIZE);
+    if (next != mSegments.end() && next->second->filled != fetch.pos % SEGMENT_SIZE)
+    {
+        return true;
+    }
+
+    const Reader* furthest = nullptr;
+    for (auto& r : mReaders)
+    {
+        if (r.second.pos <= fetch.pos && (!furthest || r.second.pos > furthest->pos))
+        {
+            furthest = &r.second;
+        }
+    }
+    return !furthest || fetch.pos - furthest->pos >= furthest->readAhead;
+}
+
+void StreamingCache::finish(int id, bool failed)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto f = mFetches.find(id);
+    if (f == mFetches.end())
+    {
+        return;
+    }
+
+    if (failed)
+    {
+        mFailures[f->second.pos]++;
+    }
+    mFetches.erase(f);
+
+    // the readers waiting for it ask again, starting another fetch if needed
+    // (the readers of the data it didn't get fail once it's been tried enough)
+    notifyReaders();
+}
+
+void StreamingCache::trim()
+{
+    while (mCachedSize > mMaxCached)
+    {
+        auto victim = mSegments.end();
+        for (auto it = mSegments.begin(); it != mSegments.end() && victim == mSegments.end(); it++)
+        {
+            const Segment& segment = *it->second;
+            if (segment.filled < segment.size)
+            {
+                continue;
+            }
+
+            m_off_t start = it->first * SEGMENT_SIZE;
+            bool needed = false;
+            for (auto& r : mReaders)
+            {
+                needed |= start + segment.size > r.second.pos && start < r.second.pos + r.second.readAhead;
+            }
+
+            if (!needed)
+            {
+                victim = it;
+            }
+        }
+
+        if (victim == mSegments.end())
+        {
+            return;
+        }
+
+        // readers still writing it out keep their reference
+        mCachedSize -= victim->second->size;
+        mSegments.erase(victim);
+    }
+}
+
+void StreamingCache::notifyReaders()
+{
+    for (auto& r : mReaders)
+    {
+        r.second.notify();
+    }
+}
+
+bool StreamingCache::failed() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    for (auto& f : mFailures)
+    {
+        if (f.second >= MAX_FETCH_ATTEMPTS)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+m_off_t StreamingCache::cachedSize() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mCachedSize;
+}
+
+int StreamingCache::fetchesStarted() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mLastFetchId;
+}
+
+} // namespace
@@ -38,6 +38,7 @@ const int Sync::EXTRA_SCANNING_DELAY_DS = 150;
 const int Sync::FILE_UPDATE_DELAY_DS = 30;
 const int Sync::FILE_UPDATE_MAX_DELAY_SECS = 60;
 const dstime Sync::RECENT_VERSION_INTERVAL_SECS = 10800;
+const size_t Sync::CACHENODES_BATCH_SIZE = 10000;
 
 namespace {
 
@@ -779,6 +780,13 @@ Sync::~Sync()
         client->proctree(localroot->node, &tdsg);
     }
 
+    // the state cache outlives us unless the sync was removed (eg. disabled syncs and
+    // logouts that keep the caches): write out what didn't fit in the last batches, all of it
+    if (statecachetable && (insertq.size() || deleteq.size()))
+    {
+        writestatecache(insertq.size() + deleteq.size());
+    }
+
     delete statecachetable;
 
     client->syncs.erase(sync_it);
@@ -935,42 +943,76 @@ void Sync::cachenodes()
 {
     if (statecachetable && (state == SYNC_ACTIVE || (state == SYNC_INITIALSCAN && insertq.size() > 100)) && (deleteq.size() || insertq.size()))
     {
-        LOG_debug << "Saving LocalNode database with " << insertq.size() << " additions and " << deleteq.size() << " deletions";
-        statecachetable->begin();
+        // each call writes at most CACHENODES_BATCH_SIZE records, so a huge initial scan
+        // is flushed over several exec() iterations instead of blocking the SDK thread
+        writestatecache(CACHENODES_BATCH_SIZE);
+    }
+    else
+    {
+        mCacheFlushPending = false;
+    }
+}
 
-        // deletions
-        for (set<uint32_t>::iterator it = deleteq.begin(); it != deleteq.end(); it++)
-        {
-            statecachetable->del(*it);
-        }
+void Sync::writestatecache(size_t limit)
+{
+    LOG_debug << "Saving LocalNode database with " << insertq.size() << " additions and " << deleteq.size() << " deletions";
+    statecachetable->begin();
 
-        deleteq.clear();
+    size_t written = 0;
 
-        // additions - we iterate until completion or until we get stuck
-        bool added;
+    // deletions
+    while (!deleteq.empty() && written < limit)
+    {
+        statecachetable->del(*deleteq.begin());
+        deleteq.erase(deleteq.begin());
+        written++;
+    }
 
-        do {
-            added = false;
+    // additions - parents are written ahead of their children (in the same transaction),
+    // so a single pass is enough. Nodes whose parent can't get a dbid are set aside.
+    vector<LocalNode*> stuck;
+    while (!insertq.empty() && written < limit)
+    {
+        LocalNode* l = *insertq.begin();
+        if (!cachenode(l, written))
+        {
+            insertq.erase(insertq.begin());
+            stuck.push_back(l);
+        }
+    }
 
-            for (set<LocalNode*>::iterator it = insertq.begin(); it != insertq.end(); )
-            {
-                if ((*it)->parent->dbid || (*it)->parent == localroot.get())
-                {
-                    statecachetable->put(MegaClient::CACHEDLOCALNODE, *it, &client->key);
-                    insertq.erase(it++);
-                    added = true;
-                }
-                else it++;
-            }
-        } while (added);
+    statecachetable->commit();
 
-        statecachetable->commit();
+    if (stuck.size())
+    {
+        LOG_err << "LocalNode caching did not complete";
+        insertq.insert(stuck.begin(), stuck.end());
+    }
+
+    // MegaClient::exec() keeps calling us without waiting until the queues are drained
+    mCacheFlushPending = insertq.size() > stuck.size() || deleteq.size();
+    if (mCacheFlushPending)
+    {
+        LOG_debug << "LocalNode database flush continues with " << insertq.size() - stuck.size() << " additions and " << deleteq.size() << " deletions pending";
+    }
+}
 
-        if (insertq.size())
+bool Sync::cachenode(LocalNode* l, size_t& written)
+{
+    LocalNode* parent = l->parent;
+    if (parent != localroot.get() && !parent->dbid)
+    {
+        // the parent's dbid is serialized with the child
+        if (!insertq.count(parent) || !cachenode(parent, written))
         {
-            LOG_err << "LocalNode caching did not complete";
+            return false;
         }
     }
+
+    statecachetable->put(MegaClient::CACHEDLOCALNODE, l, &client->key);
+    insertq.erase(l);
+    written++;
+    return true;
 }
 
 void Sync::changestate(syncstate_t newstate, SyncError newSyncError)
@@ -1874,21 +1916,23 @@ void Sync::deletemissing(LocalNode* l)
 {
     LocalPath path;
     std::unique_ptr<FileAccess> fa;
-    for (localnode_map::iterator it = l->children.begin(); it != l->children.end(); )
+    // index-based: deleting a child removes its entry from l->children
+    for (size_t i = 0; i < l->children.size(); )
     {
-        if (scanseqno-it->second->scanseqno > 1)
+        LocalNode* child = (l->children.begin() + static_cast<ptrdiff_t>(i))->second;
+        if (scanseqno-child->scanseqno > 1)
         {
             if (!fa)
             {
                 fa = client->fsaccess->newfileaccess();
             }
-            client->unlinkifexists(it->second, fa.get(), path);
-            delete it++->second;
+            client->unlinkifexists(child, fa.get(), path);
+            delete child;
         }
         else
         {
-            deletemissing(it->second);
-            it++;
+            deletemissing(child);
+            i++;
         }
     }
 }
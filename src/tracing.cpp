@@ -0,0 +1,188 @@
+/**
+ * @file tracing.cpp
+ * @brief Timelines of API commands and transfer chunks
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/tracing.h"
+#include "mega/logging.h"
+
+#include <sstream>
+
+namespace mega {
+
+RequestTracer g_tracer;
+
+RequestTracer::RequestTracer()
+    : mEpoch(std::chrono::steady_clock::now())
+{
+}
+
+void RequestTracer::setEnabled(bool enable)
+{
+    if (mEnabled.exchange(enable) != enable)
+    {
+        LOG_info << "Request tracing " << (enable ? "enabled" : "disabled");
+    }
+}
+
+void RequestTracer::setCallback(Callback callback)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mCallback = std::move(callback);
+}
+
+void RequestTracer::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mCapacity = capacity;
+    while (mEvents.size() > mCapacity)
+    {
+        mEvents.pop_front();
+    }
+}
+
+uint64_t RequestTracer::newId()
+{
+    return enabled() ? mNextId.fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+}
+
+void RequestTracer::span(const char* category, std::string name, uint64_t id,
+                         std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+                         std::string args)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    TraceEvent e;
+    e.category = category;
+    e.name = std::move(name);
+    e.id = id;
+    e.start = std::chrono::duration_cast<std::chrono::microseconds>(start - mEpoch).count();
+    e.duration = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    e.args = std::move(args);
+    record(std::move(e));
+}
+
+void RequestTracer::instant(const char* category, std::string name, uint64_t id, std::string args)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    TraceEvent e;
+    e.category = category;
+    e.name = std::move(name);
+    e.id = id;
+    e.start = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - mEpoch).count();
+    e.instant = true;
+    e.args = std::move(args);
+    record(std::move(e));
+}
+
+void RequestTracer::record(TraceEvent&& event)
+{
+    Callback callback;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        callback = mCallback;
+        if (mCapacity)
+        {
+            if (mEvents.size() >= mCapacity)
+            {
+                mEvents.pop_front();
+            }
+            mEvents.push_back(event);
+        }
+    }
+
+    // outside the lock, so that the callback may use the tracer
+    if (callback)
+    {
+        callback(event);
+    }
+}
+
+void RequestTracer::clear()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mEvents.clear();
+}
+
+static void appendJsonString(std::ostringstream& s, const std::string& value)
+{
+    s << '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            s << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            s << c;
+        }
+    }
+    s << '"';
+}
+
+static void appendChromeEvent(std::ostringstream& s, const TraceEvent& e, const char* phase, int64_t ts, bool withArgs)
+{
+    s << "{\"name\":";
+    appendJsonString(s, e.name);
+    s << ",\"cat\":\"" << e.category << "\",\"ph\":\"" << phase << "\",\"id\":\"0x" << std::hex << e.id << std::dec
+      << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":1";
+    if (withArgs && !e.args.empty())
+    {
+        s << ",\"args\":{" << e.args << "}";
+    }
+    s << "}";
+}
+
+std::string RequestTracer::chromeTraceJson() const
+{
+    std::ostringstream s;
+    s << "{\"traceEvents\":[";
+
+    std::lock_guard<std::mutex> g(mMutex);
+    bool first = true;
+    for (const TraceEvent& e : mEvents)
+    {
+        s << (first ? "\n" : ",\n");
+        first = false;
+
+        if (e.instant)
+        {
+            appendChromeEvent(s, e, "n", e.start, true);
+        }
+        else
+        {
+            appendChromeEvent(s, e, "b", e.start, true);
+            s << ",\n";
+            appendChromeEvent(s, e, "e", e.start + e.duration, false);
+        }
+    }
+
+    s << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return s.str();
+}
+
+} // namespace
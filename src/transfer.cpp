@@ -29,6 +29,7 @@
 #include "mega/mediafileattribute.h"
 #include "megawaiter.h"
 #include "mega/utils.h"
+#include "mega/metrics.h"
 
 namespace mega {
 
@@ -397,6 +398,7 @@ void Transfer::failed(const Error& e, DBTableTransactionCommitter& committer, ds
             client->activateoverquota(timeleft, (e == API_EPAYWALL));
             client->app->transfer_failed(this, e, timeleft);
             ++client->performanceStats.transferTempErrors;
+            g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
         }
         else
         {
@@ -435,6 +437,7 @@ void Transfer::failed(const Error& e, DBTableTransactionCommitter& committer, ds
         client->app->transfer_failed(this, e, timeleft);
         client->looprequested = true;
         ++client->performanceStats.transferTempErrors;
+        g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
     }
 
 #ifdef ENABLE_SYNC
@@ -544,6 +547,7 @@ void Transfer::failed(const Error& e, DBTableTransactionCommitter& committer, ds
         }
         client->app->transfer_removed(this);
         ++client->performanceStats.transferFails;
+        g_metrics.add(MetricsRegistry::TRANSFER_FAILS);
         delete this;
     }
 }
@@ -944,6 +948,11 @@ void Transfer::complete(DBTableTransactionCommitter& committer)
 
         if (!files.size())
         {
+            if (!localname.empty())
+            {
+                client->recentdownloads.add(*this, localname);
+            }
+
             state = TRANSFERSTATE_COMPLETED;
             localfilename = localname;
             finished = true;
@@ -2057,4 +2066,39 @@ bool TransferList::isReady(Transfer *transfer)
             && transfer->bt.armed());
 }
 
+void RecentDownloads::add(const FileFingerprint& fingerprint, const LocalPath& path)
+{
+    if (!fingerprint.isvalid)
+    {
+        return;
+    }
+
+    auto result = mPaths.insert(std::make_pair(fingerprint, path));
+    if (!result.second)
+    {
+        // newest download of that content wins
+        result.first->second = path;
+        return;
+    }
+
+    mOrder.push_back(fingerprint);
+    if (mOrder.size() > MAX_ENTRIES)
+    {
+        mPaths.erase(mOrder.front());
+        mOrder.pop_front();
+    }
+}
+
+const LocalPath* RecentDownloads::find(const FileFingerprint& fingerprint) const
+{
+    auto it = mPaths.find(fingerprint);
+    return it == mPaths.end() ? nullptr : &it->second;
+}
+
+void RecentDownloads::clear()
+{
+    mPaths.clear();
+    mOrder.clear();
+}
+
 } // namespace
@@ -29,6 +29,8 @@
 #include "mega/utils.h"
 #include "mega/logging.h"
 #include "mega/raid.h"
+#include "mega/metrics.h"
+#include "mega/tracing.h"
 
 namespace mega {
 
@@ -97,6 +99,12 @@ TransferSlot::TransferSlot(Transfer* ctransfer)
 
     slots_it = transfer->client->tslots.end();
 
+    traceId = g_tracer.newId();
+    if (traceId)
+    {
+        traceStart = std::chrono::steady_clock::now();
+    }
+
     maxRequestSize = MAX_REQ_SIZE;
 #if defined(_WIN32) && !defined(WINDOWS_PHONE)
     MEMORYSTATUSEX statex;
@@ -161,6 +169,12 @@ bool TransferSlot::createconnectionsonce()
 // reused on a new slot)
 TransferSlot::~TransferSlot()
 {
+    if (traceId && g_tracer.enabled())
+    {
+        g_tracer.span("transfer", transfer->type == GET ? "download slot" : "upload slot", traceId, traceStart, std::chrono::steady_clock::now(),
+                      "\"size\":" + std::to_string(transfer->size) + ",\"completed\":" + std::to_string(transfer->progresscompleted));
+    }
+
     if (transfer->type == GET && !transfer->finished
             && transfer->progresscompleted != transfer->size
             && !transfer->asyncopencontext)
@@ -273,6 +287,16 @@ TransferSlot::~TransferSlot()
         }
     }
 
+    if (localcopy)
+    {
+        std::lock_guard<std::mutex> g(localcopy->mutex);
+        localcopy->abandoned = true;
+        if (localcopy->copied)
+        {
+            transfer->client->fsaccess->unlinklocal(localcopy->path);
+        }
+    }
+
     transfer->slot = NULL;
 
     if (slots_it != transfer->client->tslots.end())
@@ -508,6 +532,37 @@ void TransferSlot::doio(MegaClient* client, DBTableTransactionCommitter& committ
 {
     CodeCounter::ScopeTimer pbt(client->performanceStats.transferslotDoio);
 
+    if (localcopy)
+    {
+        std::unique_lock<std::mutex> g(localcopy->mutex);
+        if (!localcopy->done)
+        {
+            // the worker wakes us up when it's finished
+            return;
+        }
+
+        bool copied = localcopy->copied;
+        if (copied && !client->fsaccess->renamelocal(localcopy->path, transfer->localfilename, true))
+        {
+            client->fsaccess->unlinklocal(localcopy->path);
+            copied = false;
+        }
+        g.unlock();
+        localcopy.reset();
+
+        if (!copied)
+        {
+            LOG_debug << "No local copy for the download, downloading it";
+            transfer->state = TRANSFERSTATE_QUEUED;
+            delete this;
+            return;
+        }
+
+        transfer->pos = transfer->size;
+        transfer->progresscompleted = transfer->size;
+        progressreported = transfer->size;
+    }
+
     if (!fa || (transfer->size && transfer->progresscompleted == transfer->size)
             || (transfer->type == PUT && transfer->ultoken))
     {
@@ -640,6 +695,19 @@ void TransferSlot::doio(MegaClient* client, DBTableTransactionCommitter& committ
                     lastdata = Waiter::ds;
                     transfer->lastaccesstime = m_time();
 
+                    if (g_metrics.enabled())
+                    {
+                        static MetricsHistogram& getTime = g_metrics.histogram("transfer_chunk_seconds", "direction", "get");
+                        static MetricsHistogram& putTime = g_metrics.histogram("transfer_chunk_seconds", "direction", "put");
+                        g_metrics.add(transfer->type == GET ? MetricsRegistry::TRANSFER_CHUNKS_GET : MetricsRegistry::TRANSFER_CHUNKS_PUT);
+                        (transfer->type == GET ? getTime : putTime).record(std::chrono::steady_clock::now() - reqs[i]->posttime);
+                    }
+
+                    if (traceId && g_tracer.enabled())
+                    {
+                        tracechunk(i);
+                    }
+
                     if (!transferbuf.isRaid())
                     {
                         LOG_debug << "Transfer request finished (" << transfer->type << ") Position: " << transferbuf.transferPos(i) << " (" << transfer->pos << ") Size: " << reqs[i]->size
@@ -1005,6 +1073,10 @@ void TransferSlot::doio(MegaClient* client, DBTableTransactionCommitter& committ
 
                 case REQ_FAILURE:
                     LOG_warn << "Failed chunk. HTTP status: " << reqs[i]->httpstatus << " on channel " << i;
+                    if (traceId)
+                    {
+                        g_tracer.instant("transfer", "chunk failed", traceId, "\"connection\":" + std::to_string(i) + ",\"httpstatus\":" + std::to_string(reqs[i]->httpstatus));
+                    }
                     if (reqs[i]->httpstatus && reqs[i]->contenttype.find("text/html") != string::npos
                             && !memcmp(reqs[i]->posturl.c_str(), "http:", 5))
                     {
@@ -1087,6 +1159,7 @@ void TransferSlot::doio(MegaClient* client, DBTableTransactionCommitter& committ
                             client->app->transfer_failed(transfer, API_EFAILED);
                             client->setchunkfailed(&reqs[i]->posturl);
                             ++client->performanceStats.transferTempErrors;
+                            g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
 
                             if (changeport)
                             {
@@ -1316,17 +1389,37 @@ void TransferSlot::doio(MegaClient* client, DBTableTransactionCommitter& committ
             LOG_warn << "Chunk failed due to a timeout";
             client->app->transfer_failed(transfer, API_EFAILED);
             ++client->performanceStats.transferTempErrors;
+            g_metrics.add(MetricsRegistry::TRANSFER_TEMPERRORS);
         }
     }
 
     if (!failure && backoff > 0)
     {
+        if (traceId)
+        {
+            g_tracer.instant("transfer", "backoff", traceId, "\"retryin_ds\":" + std::to_string(backoff));
+        }
         retrybt.backoff(backoff);
         retrying = true;  // we don't bother checking the `retrybt` before calling `doio` unless `retrying` is set.
     }
 }
 
 
+void TransferSlot::tracechunk(int i)
+{
+    // posted -> first byte of the response -> complete, on connection i
+    auto now = std::chrono::steady_clock::now();
+    const HttpReqXfer& req = *reqs[i];
+    string args = "\"connection\":" + std::to_string(i) + ",\"pos\":" + std::to_string(transferbuf.transferPos(unsigned(i))) + ",\"size\":" + std::to_string(req.size);
+
+    g_tracer.span("transfer", "chunk", traceId, req.posttime, now, std::move(args));
+    if (req.firstdatatime != std::chrono::steady_clock::time_point())
+    {
+        g_tracer.span("transfer", "server", traceId, req.posttime, req.firstdatatime);
+        g_tracer.span("transfer", "receiving", traceId, req.firstdatatime, now);
+    }
+}
+
 bool TransferSlot::tryRaidRecoveryFromHttpGetError(unsigned connectionNum, bool incrementErrors)
 {
     // If we are downloding a cloudraid file then we may be able to ignore one connection and download from the other 5.
@@ -1366,10 +1459,10 @@ void TransferSlot::progress()
 
 void TransferSlot::updatecontiguousprogress()
 {
-    chunkmac_map::iterator pcit;
+    const ChunkMAC* pcmac;
     chunkmac_map &pcchunkmacs = transfer->chunkmacs;
-    while ((pcit = pcchunkmacs.find(progresscontiguous)) != pcchunkmacs.end()
-           && pcit->second.finished)
+    while ((pcmac = pcchunkmacs.find(progresscontiguous))
+           && pcmac->finished)
     {
         progresscontiguous = ChunkedHash::chunkceil(progresscontiguous, transfer->size);
     }
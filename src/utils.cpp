@@ -244,14 +244,143 @@ bool CacheableReader::unserializebinary(byte* data, size_t len)
 }
 
 
+size_t chunkmac_map::chunkIndex(m_off_t pos)
+{
+    // the first 8 chunks grow by SEGSIZE, the rest are 8 * SEGSIZE
+    const m_off_t segsize = ChunkedHash::SEGSIZE;
+    if (pos >= 36 * segsize)
+    {
+        return size_t(8 + (pos - 36 * segsize) / (8 * segsize));
+    }
+
+    size_t index = 0;
+    while (chunkStart(index + 1) <= pos)
+    {
+        index++;
+    }
+    return index;
+}
+
+m_off_t chunkmac_map::chunkStart(size_t index)
+{
+    const m_off_t segsize = ChunkedHash::SEGSIZE;
+    if (index <= 8)
+    {
+        return segsize * m_off_t(index * (index + 1) / 2);
+    }
+    return 36 * segsize + m_off_t(index - 8) * 8 * segsize;
+}
+
+ChunkMAC& chunkmac_map::operator[](m_off_t pos)
+{
+    size_t index = chunkIndex(pos);
+    if (mMacs.empty())
+    {
+        mFirst = index;
+    }
+    else if (index < mFirst)
+    {
+        // rare: uploads and downloads mostly proceed forwards
+        size_t n = mFirst - index;
+        mMacs.insert(mMacs.begin(), n, ChunkMAC());
+        mPresent.insert(mPresent.begin(), n, false);
+        mFirst = index;
+    }
+
+    size_t i = index - mFirst;
+    if (i >= mMacs.size())
+    {
+        mMacs.resize(i + 1);
+        mPresent.resize(i + 1, false);
+    }
+
+    if (!mPresent[i])
+    {
+        mPresent[i] = true;
+        mCount++;
+    }
+    return mMacs[i];
+}
+
+const ChunkMAC* chunkmac_map::at(size_t index) const
+{
+    if (index < mFirst || index - mFirst >= mMacs.size() || !mPresent[index - mFirst])
+    {
+        return nullptr;
+    }
+    return &mMacs[index - mFirst];
+}
+
+ChunkMAC* chunkmac_map::find(m_off_t pos)
+{
+    return const_cast<ChunkMAC*>(at(chunkIndex(pos)));
+}
+
+void chunkmac_map::clear()
+{
+    mFirst = 0;
+    mMacs.clear();
+    mPresent.clear();
+    mCount = 0;
+}
+
+void chunkmac_map::swap(chunkmac_map& other)
+{
+    std::swap(mFirst, other.mFirst);
+    mMacs.swap(other.mMacs);
+    mPresent.swap(other.mPresent);
+    std::swap(mCount, other.mCount);
+}
+
+bool chunkmac_map::operator==(const chunkmac_map& other) const
+{
+    if (mCount != other.mCount)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < mMacs.size(); i++)
+    {
+        if (!mPresent[i])
+        {
+            continue;
+        }
+
+        const ChunkMAC* m = other.at(mFirst + i);
+        if (!m || memcmp(m->mac, mMacs[i].mac, sizeof m->mac)
+                || m->offset != mMacs[i].offset || m->finished != mMacs[i].finished)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void chunkmac_map::copyEntriesTo(chunkmac_map& other) const
+{
+    for (size_t i = 0; i < mMacs.size(); i++)
+    {
+        if (mPresent[i])
+        {
+            other[chunkStart(mFirst + i)] = mMacs[i];
+        }
+    }
+}
+
 void chunkmac_map::serialize(string& d) const
 {
+    // same layout as when this was a map from chunk start to MAC
     unsigned short ll = (unsigned short)size();
+    d.reserve(d.size() + sizeof(ll) + mCount * (sizeof(m_off_t) + sizeof(ChunkMAC)));
     d.append((char*)&ll, sizeof(ll));
-    for (const_iterator it = begin(); it != end(); it++)
+    for (size_t i = 0; i < mMacs.size(); i++)
     {
-        d.append((char*)&it->first, sizeof(it->first));
-        d.append((char*)&it->second, sizeof(it->second));
+        if (mPresent[i])
+        {
+            m_off_t pos = chunkStart(mFirst + i);
+            d.append((char*)&pos, sizeof(pos));
+            d.append((char*)&mMacs[i], sizeof(mMacs[i]));
+        }
     }
 }
 
@@ -265,6 +394,29 @@ bool chunkmac_map::unserialize(const char*& ptr, const char* end)
 
     ptr += sizeof(ll);
 
+    // the MACs are stored densely from the first chunk to the last one, so reject
+    // positions that would make a corrupt cache allocate far more than ll entries.
+    // Gaps are legitimate (chunks in flight when the transfer was cached), but small
+    const size_t maxgap = 1024;
+    const size_t recordsize = sizeof(m_off_t) + sizeof(ChunkMAC);
+    size_t firstindex = 0, lastindex = 0;
+    for (int i = 0; i < ll; i++)
+    {
+        m_off_t pos = MemAccess::get<m_off_t>(ptr + i * recordsize);
+        if (pos < 0)
+        {
+            return false;
+        }
+
+        size_t index = chunkIndex(pos);
+        firstindex = i ? std::min(firstindex, index) : index;
+        lastindex = i ? std::max(lastindex, index) : index;
+        if (lastindex - firstindex >= ll + maxgap)
+        {
+            return false;
+        }
+    }
+
     for (int i = 0; i < ll; i++)
     {
         m_off_t pos = MemAccess::get<m_off_t>(ptr);
@@ -281,26 +433,33 @@ void chunkmac_map::calcprogress(m_off_t size, m_off_t& chunkpos, m_off_t& progre
     chunkpos = 0;
     progresscompleted = 0;
 
-    for (chunkmac_map::iterator it = begin(); it != end(); ++it)
+    for (size_t i = 0; i < mMacs.size(); i++)
     {
-        m_off_t chunkceil = ChunkedHash::chunkceil(it->first, size);
+        if (!mPresent[i])
+        {
+            continue;
+        }
+
+        const ChunkMAC& chunkmac = mMacs[i];
+        m_off_t chunkstart = chunkStart(mFirst + i);
+        m_off_t chunkceil = ChunkedHash::chunkceil(chunkstart, size);
 
-        if (chunkpos == it->first && it->second.finished)
+        if (chunkpos == chunkstart && chunkmac.finished)
         {
             chunkpos = chunkceil;
             progresscompleted = chunkceil;
         }
-        else if (it->second.finished)
+        else if (chunkmac.finished)
         {
-            m_off_t chunksize = chunkceil - ChunkedHash::chunkfloor(it->first);
+            m_off_t chunksize = chunkceil - chunkstart;
             progresscompleted += chunksize;
         }
         else
         {
-            progresscompleted += it->second.offset;
+            progresscompleted += chunkmac.offset;
             if (lastblockprogress)
             {
-                *lastblockprogress += it->second.offset;
+                *lastblockprogress += chunkmac.offset;
             }
         }
     }
@@ -308,17 +467,17 @@ void chunkmac_map::calcprogress(m_off_t size, m_off_t& chunkpos, m_off_t& progre
 
 m_off_t chunkmac_map::nextUnprocessedPosFrom(m_off_t pos)
 {
-    for (const_iterator it = find(ChunkedHash::chunkfloor(pos));
-        it != end();
-        it = find(ChunkedHash::chunkfloor(pos)))
+    for (const ChunkMAC* chunkmac = find(ChunkedHash::chunkfloor(pos));
+        chunkmac;
+        chunkmac = find(ChunkedHash::chunkfloor(pos)))
     {
-        if (it->second.finished)
+        if (chunkmac->finished)
         {
             pos = ChunkedHash::chunkceil(pos);
         }
         else
         {
-            pos += it->second.offset;
+            pos += chunkmac->offset;
             break;
         }
     }
@@ -327,9 +486,9 @@ m_off_t chunkmac_map::nextUnprocessedPosFrom(m_off_t pos)
 
 m_off_t chunkmac_map::expandUnprocessedPiece(m_off_t pos, m_off_t npos, m_off_t fileSize, m_off_t maxReqSize)
 {
-    for (iterator it = find(npos);
-        npos < fileSize && (npos - pos) <= maxReqSize && (it == end() || (!it->second.finished && !it->second.offset));
-        it = find(npos))
+    for (const ChunkMAC* chunkmac = find(npos);
+        npos < fileSize && (npos - pos) <= maxReqSize && (!chunkmac || (!chunkmac->finished && !chunkmac->offset));
+        chunkmac = find(npos))
     {
         npos = ChunkedHash::chunkceil(npos, fileSize);
     }
@@ -338,48 +497,43 @@ m_off_t chunkmac_map::expandUnprocessedPiece(m_off_t pos, m_off_t npos, m_off_t
 
 void chunkmac_map::finishedUploadChunks(chunkmac_map& macs)
 {
-    for (auto& m : macs)
+    for (size_t i = 0; i < macs.mMacs.size(); i++)
     {
-        m.second.finished = true;
-        (*this)[m.first] = m.second;
-        LOG_verbose << "Upload chunk completed: " << m.first;
+        if (macs.mPresent[i])
+        {
+            m_off_t pos = chunkStart(macs.mFirst + i);
+            macs.mMacs[i].finished = true;
+            (*this)[pos] = macs.mMacs[i];
+            LOG_verbose << "Upload chunk completed: " << pos;
+        }
     }
 }
 
 // coalesce block macs into file mac
 int64_t chunkmac_map::macsmac(SymmCipher *cipher)
 {
-    byte mac[SymmCipher::BLOCKSIZE] = { 0 };
-
-    for (chunkmac_map::iterator it = begin(); it != end(); it++)
-    {
-        assert(it->first == ChunkedHash::chunkfloor(it->first));
-        // LOG_debug << "macsmac input: " << it->first << ": " << Base64Str<sizeof it->second.mac>(it->second.mac);
-        SymmCipher::xorblock(it->second.mac, mac);
-        cipher->ecb_encrypt(mac);
-    }
-
-    uint32_t* m = (uint32_t*)mac;
-
-    m[0] ^= m[1];
-    m[1] = m[2] ^ m[3];
-
-    // LOG_debug << "macsmac final: " << Base64Str<sizeof int64_t>(mac);
-    return MemAccess::get<int64_t>((const char*)mac);
+    return macsmac_gaps(cipher, 0, 0, 0, 0);
 }
 
 int64_t chunkmac_map::macsmac_gaps(SymmCipher *cipher, size_t g1, size_t g2, size_t g3, size_t g4)
 {
     byte mac[SymmCipher::BLOCKSIZE] = { 0 };
 
-    int n = 0;
-    for (chunkmac_map::iterator it = begin(); it != end(); it++, n++)
+    // n counts the MACs present, in chunk order
+    size_t n = 0;
+    for (size_t i = 0; i < mMacs.size(); i++)
     {
-        if ((n >= g1 && n < g2) || (n >= g3 && n < g4)) continue;
-        
-        assert(it->first == ChunkedHash::chunkfloor(it->first));
-        SymmCipher::xorblock(it->second.mac, mac);
-        cipher->ecb_encrypt(mac);
+        if (!mPresent[i])
+        {
+            continue;
+        }
+
+        if (!(n >= g1 && n < g2) && !(n >= g3 && n < g4))
+        {
+            SymmCipher::xorblock(mMacs[i].mac, mac);
+            cipher->ecb_encrypt(mac);
+        }
+        n++;
     }
 
     uint32_t* m = (uint32_t*)mac;
@@ -0,0 +1,69 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega/attrmap.h>
+#include <mega/base64.h>
+
+#include "utils.h"
+
+namespace {
+
+// typical decrypted node attributes: name, fingerprint, modification time, labels
+mega::AttrMap makeAttrMap()
+{
+    mega::AttrMap map;
+    map.map = {
+        {'n', "IMG_20200101_123456.jpg"},
+        {'c', mega::Base64::btoa(mt::randomData(24))},
+        {mega::AttrMap::string2nameid("lbl"), "3"},
+        {mega::AttrMap::string2nameid("fav"), "1"},
+        {mega::AttrMap::string2nameid("mtime"), "1600000000"},
+    };
+    return map;
+}
+
+} // anonymous
+
+static void AttrMap_serialize(benchmark::State& state)
+{
+    const mega::AttrMap map = makeAttrMap();
+    std::string d;
+
+    for (auto _ : state)
+    {
+        d.clear();
+        map.serialize(&d);
+        benchmark::DoNotOptimize(d);
+    }
+}
+BENCHMARK(AttrMap_serialize);
+
+static void AttrMap_unserialize(benchmark::State& state)
+{
+    std::string d;
+    makeAttrMap().serialize(&d);
+
+    for (auto _ : state)
+    {
+        mega::AttrMap map;
+        benchmark::DoNotOptimize(map.unserialize(d.c_str(), d.c_str() + d.size()));
+    }
+}
+BENCHMARK(AttrMap_unserialize);
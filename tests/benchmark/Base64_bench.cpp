@@ -0,0 +1,51 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+static void Base64_btoa(benchmark::State& state)
+{
+    const std::string data = mt::randomData(static_cast<size_t>(state.range(0)));
+    std::string encoded;
+
+    for (auto _ : state)
+    {
+        mega::Base64::btoa(data, encoded);
+        benchmark::DoNotOptimize(encoded);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(Base64_btoa)->Arg(8)->Arg(64)->Arg(64 << 10);
+
+static void Base64_atob(benchmark::State& state)
+{
+    const std::string encoded = mega::Base64::btoa(mt::randomData(static_cast<size_t>(state.range(0))));
+    std::string data;
+
+    for (auto _ : state)
+    {
+        mega::Base64::atob(encoded, data);
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+BENCHMARK(Base64_atob)->Arg(8)->Arg(64)->Arg(64 << 10);
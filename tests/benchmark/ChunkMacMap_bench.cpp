@@ -0,0 +1,46 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+// final MAC of a file of the given size, from its chunk MACs
+static void ChunkMacMap_macsmac(benchmark::State& state)
+{
+    const auto size = static_cast<m_off_t>(state.range(0));
+    const std::string key = mt::randomData(mega::SymmCipher::KEYLENGTH);
+    std::string data = mt::randomData(static_cast<size_t>(size));
+
+    mega::SymmCipher cipher;
+    cipher.setkey(reinterpret_cast<const mega::byte*>(key.data()));
+
+    mega::chunkmac_map macs;
+    mega::EncryptBufferByChunks encrypter(reinterpret_cast<mega::byte*>(&data[0]), &cipher, &macs, 0x1234567890abcdef);
+    std::string urlSuffix;
+    encrypter.encrypt(0, size, urlSuffix);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(macs.macsmac(&cipher));
+    }
+    state.counters["chunks"] = static_cast<double>(macs.size());
+}
+BENCHMARK(ChunkMacMap_macsmac)->Arg(1 << 20)->Arg(32 << 20)->Arg(256 << 20);
@@ -0,0 +1,59 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+// transfer chunk encryption with MAC computation, as done for every upload and download
+static void SymmCipher_ctr_crypt(benchmark::State& state)
+{
+    const auto size = static_cast<size_t>(state.range(0));
+    const std::string key = mt::randomData(mega::SymmCipher::KEYLENGTH);
+    std::string data = mt::randomData(size);
+
+    mega::SymmCipher cipher;
+    cipher.setkey(reinterpret_cast<const mega::byte*>(key.data()));
+    mega::byte mac[mega::SymmCipher::BLOCKSIZE];
+
+    for (auto _ : state)
+    {
+        cipher.ctr_crypt(reinterpret_cast<mega::byte*>(&data[0]), static_cast<unsigned>(size), 0, 0x1234567890abcdef, mac, true);
+        benchmark::DoNotOptimize(mac);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+}
+BENCHMARK(SymmCipher_ctr_crypt)->Arg(128 << 10)->Arg(1 << 20)->Arg(8 << 20);
+
+static void SymmCipher_ecb_encrypt(benchmark::State& state)
+{
+    const std::string key = mt::randomData(mega::SymmCipher::KEYLENGTH);
+    std::string data = mt::randomData(mega::SymmCipher::BLOCKSIZE);
+
+    mega::SymmCipher cipher;
+    cipher.setkey(reinterpret_cast<const mega::byte*>(key.data()));
+
+    for (auto _ : state)
+    {
+        cipher.ecb_encrypt(reinterpret_cast<mega::byte*>(&data[0]));
+        benchmark::DoNotOptimize(data);
+    }
+}
+BENCHMARK(SymmCipher_ecb_encrypt);
@@ -0,0 +1,73 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+namespace {
+
+class MemoryInputStream : public mega::InputStreamAccess
+{
+public:
+    explicit MemoryInputStream(const std::string& data)
+        : mData(data)
+    {
+    }
+
+    m_off_t size() override
+    {
+        return static_cast<m_off_t>(mData.size());
+    }
+
+    bool read(mega::byte* buffer, unsigned size) override
+    {
+        if (mOffset + size > mData.size())
+        {
+            return false;
+        }
+        if (buffer)
+        {
+            memcpy(buffer, mData.data() + mOffset, size);
+        }
+        mOffset += size;
+        return true;
+    }
+
+private:
+    const std::string& mData;
+    size_t mOffset = 0;
+};
+
+} // anonymous
+
+// fingerprint of files below and above the size where it switches to sampling
+static void FileFingerprint_genfingerprint(benchmark::State& state)
+{
+    const std::string data = mt::randomData(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        MemoryInputStream is{data};
+        mega::FileFingerprint ffp;
+        benchmark::DoNotOptimize(ffp.genfingerprint(&is, 1600000000));
+    }
+}
+BENCHMARK(FileFingerprint_genfingerprint)->Arg(8 << 10)->Arg(1 << 20)->Arg(64 << 20);
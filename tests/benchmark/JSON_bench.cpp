@@ -0,0 +1,66 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+// walking a fetchnodes response the way MegaClient::readnodes does
+static void JSON_getnameid_storeobject(benchmark::State& state)
+{
+    const std::string json = mt::fetchnodesJson(static_cast<size_t>(state.range(0)));
+    std::string value;
+
+    for (auto _ : state)
+    {
+        mega::JSON j;
+        j.begin(json.c_str());
+        j.enterarray();
+        while (j.enterobject())
+        {
+            while (j.getnameid() != EOO)
+            {
+                j.storeobject(&value);
+            }
+            j.leaveobject();
+        }
+        j.leavearray();
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(JSON_getnameid_storeobject)->Arg(1000)->Arg(100000);
+
+// skipping over the nodes without copying their values
+static void JSON_storeobject_skip(benchmark::State& state)
+{
+    const std::string json = mt::fetchnodesJson(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state)
+    {
+        mega::JSON j;
+        j.begin(json.c_str());
+        j.storeobject();
+        benchmark::DoNotOptimize(j.pos);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(JSON_storeobject_skip)->Arg(100000);
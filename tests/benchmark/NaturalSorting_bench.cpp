@@ -0,0 +1,64 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "utils.h"
+
+namespace mega {
+
+// defined in megaapi_impl.cpp: +1 if i goes first, -1 if j goes first
+int naturalsorting_compare(const char* i, const char* j);
+
+}
+
+// sorting a folder listing of names mixing text and numbers
+static void NaturalSorting_compare(benchmark::State& state)
+{
+    const auto count = static_cast<size_t>(state.range(0));
+    std::vector<std::string> names;
+    const std::string random = mt::randomData(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        names.push_back("IMG_" + std::to_string(static_cast<unsigned char>(random[i]) * 131 + i) + (i % 3 ? ".jpg" : " (copy 2).JPG"));
+    }
+
+    std::vector<const char*> sorted;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        sorted.clear();
+        for (const auto& name : names)
+        {
+            sorted.push_back(name.c_str());
+        }
+        state.ResumeTiming();
+
+        std::sort(sorted.begin(), sorted.end(), [](const char* i, const char* j)
+        {
+            return mega::naturalsorting_compare(i, j) > 0;
+        });
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(NaturalSorting_compare)->Arg(10000);
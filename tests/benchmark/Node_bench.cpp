@@ -0,0 +1,145 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+#include <mega/megaapp.h>
+
+#include "utils.h"
+
+namespace {
+
+// a root with folders of 20 files each, as serialized into the state cache
+std::vector<mega::Node*> makeNodes(mega::MegaClient& client, size_t count)
+{
+    mega::node_vector dp;
+    std::vector<mega::Node*> nodes;
+    nodes.push_back(new mega::Node{&client, &dp, 1, mega::UNDEF, mega::ROOTNODE, -1, 2, nullptr, 1600000000});
+
+    mega::Node* folder = nodes[0];
+    for (mega::handle h = 2; nodes.size() < count; ++h)
+    {
+        const bool isFolder = h % 20 == 0;
+        const auto type = isFolder ? mega::FOLDERNODE : mega::FILENODE;
+        auto n = new mega::Node{&client, &dp, h, folder->nodehandle, type, isFolder ? -1 : static_cast<m_off_t>(h * 1000), 2,
+                                isFolder ? nullptr : "924:1*AAAAAAAAAAA/924:0*AAAAAAAAAAA", 1600000000};
+        n->setkey(reinterpret_cast<const mega::byte*>(mt::randomData(isFolder ? mega::FOLDERNODEKEYLENGTH : mega::FILENODEKEYLENGTH).data()));
+        n->attrs.map['n'] = (isFolder ? "folder " : "file ") + std::to_string(h);
+        n->setparent(folder);
+        nodes.push_back(n);
+
+        if (isFolder)
+        {
+            folder = n;
+        }
+    }
+    return nodes;
+}
+
+void deleteNodes(mega::MegaClient& client, std::vector<mega::Node*>& nodes)
+{
+    // children first
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+    {
+        client.nodes.erase((*it)->nodehandle);
+        delete *it;
+    }
+    nodes.clear();
+}
+
+} // anonymous
+
+static void Node_serialize(benchmark::State& state)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto nodes = makeNodes(*client, static_cast<size_t>(state.range(0)));
+    std::string d;
+
+    for (auto _ : state)
+    {
+        for (auto n : nodes)
+        {
+            d.clear();
+            n->serialize(&d);
+        }
+        benchmark::DoNotOptimize(d);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    deleteNodes(*client, nodes);
+}
+BENCHMARK(Node_serialize)->Arg(10000);
+
+static void Node_unserialize(benchmark::State& state)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto nodes = makeNodes(*client, static_cast<size_t>(state.range(0)));
+
+    std::vector<std::string> serialized(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->serialize(&serialized[i]);
+    }
+    deleteNodes(*client, nodes);
+
+    for (auto _ : state)
+    {
+        mega::node_vector dp;
+        for (const auto& d : serialized)
+        {
+            nodes.push_back(mega::Node::unserialize(client.get(), &d, &dp));
+        }
+
+        state.PauseTiming();
+        deleteNodes(*client, nodes);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(Node_unserialize)->Arg(10000);
+
+static void Node_nodebyhandle(benchmark::State& state)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto nodes = makeNodes(*client, static_cast<size_t>(state.range(0)));
+
+    // looked up in a different order than they were added
+    std::vector<mega::handle> handles;
+    for (auto n : nodes)
+    {
+        handles.push_back(n->nodehandle);
+    }
+    std::reverse(handles.begin(), handles.end());
+
+    for (auto _ : state)
+    {
+        for (auto h : handles)
+        {
+            benchmark::DoNotOptimize(client->nodebyhandle(h));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    deleteNodes(*client, nodes);
+}
+BENCHMARK(Node_nodebyhandle)->Arg(10000)->Arg(500000);
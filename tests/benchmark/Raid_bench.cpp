@@ -0,0 +1,79 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+namespace {
+
+// combines the parts only: the output is neither decrypted nor MACed
+class CombineOnlyBufferManager : public mega::RaidBufferManager
+{
+    void finalize(FilePiece&) override {}
+    m_off_t calcOutputChunkPos(m_off_t acquiredpos) override { return acquiredpos; }
+};
+
+} // anonymous
+
+// reassembling a CloudRAID download from its parts, one of them recovered from parity
+static void RaidBufferManager_combine(benchmark::State& state)
+{
+    const auto filesize = static_cast<m_off_t>(state.range(0));
+    const std::vector<std::string> urls(mega::RAIDPARTS, "http://127.0.0.1/");
+
+    std::vector<std::string> parts;
+    for (unsigned i = 0; i < mega::RAIDPARTS; ++i)
+    {
+        parts.push_back(mt::randomData(static_cast<size_t>(mega::RaidBufferManager::raidPartSize(i, filesize))));
+    }
+
+    for (auto _ : state)
+    {
+        CombineOnlyBufferManager manager;
+        manager.setIsRaid(urls, 0, filesize, filesize, 16 << 20);
+
+        m_off_t output = 0;
+        while (output < filesize)
+        {
+            for (unsigned i = 0; i < mega::RAIDPARTS; ++i)
+            {
+                bool newBufferSupplied = false;
+                bool pause = false;
+                auto range = manager.nextNPosForConnection(i, newBufferSupplied, pause);
+                if (!newBufferSupplied && !pause && range.second > range.first)
+                {
+                    const auto len = static_cast<size_t>(range.second - range.first);
+                    auto piece = new mega::RaidBufferManager::FilePiece(range.first, len);
+                    memcpy(piece->buf.datastart(), parts[i].data() + range.first, len);
+                    manager.submitBuffer(i, piece);
+                }
+
+                if (auto outputPiece = manager.getAsyncOutputBufferPointer(i))
+                {
+                    output += static_cast<m_off_t>(outputPiece->buf.datalen());
+                    manager.bufferWriteCompleted(i, true);
+                }
+            }
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * filesize));
+}
+BENCHMARK(RaidBufferManager_combine)->Arg(1 << 20)->Arg(32 << 20);
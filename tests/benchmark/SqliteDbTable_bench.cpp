@@ -0,0 +1,94 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <mega.h>
+
+#include "utils.h"
+
+#ifdef USE_SQLITE
+
+namespace {
+
+// a state cache table in the working directory, removed afterwards
+struct BenchTable
+{
+    mega::FSACCESS_CLASS fsaccess;
+    mega::PrnGen rng;
+    mega::SqliteDbAccess dbaccess{mega::LocalPath::fromPath(".", fsaccess)};
+    std::unique_ptr<mega::DbTable> table{dbaccess.open(rng, fsaccess, "megasdk_bench", 0)};
+
+    ~BenchTable()
+    {
+        table->remove();
+    }
+};
+
+} // anonymous
+
+// writing node-sized records in one transaction, like a state cache update after fetchnodes
+static void SqliteDbTable_put(benchmark::State& state)
+{
+    BenchTable t;
+    std::string record = mt::randomData(200);
+
+    for (auto _ : state)
+    {
+        t.table->begin();
+        for (uint32_t i = 1; i <= static_cast<uint32_t>(state.range(0)); ++i)
+        {
+            t.table->put(i, &record[0], static_cast<unsigned>(record.size()));
+        }
+        t.table->commit();
+
+        state.PauseTiming();
+        t.table->truncate();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SqliteDbTable_put)->Arg(10000);
+
+// reading all records back, like a state cache load
+static void SqliteDbTable_next(benchmark::State& state)
+{
+    BenchTable t;
+    std::string record = mt::randomData(200);
+
+    t.table->begin();
+    for (uint32_t i = 1; i <= static_cast<uint32_t>(state.range(0)); ++i)
+    {
+        t.table->put(i, &record[0], static_cast<unsigned>(record.size()));
+    }
+    t.table->commit();
+
+    uint32_t id;
+    for (auto _ : state)
+    {
+        t.table->rewind();
+        while (t.table->next(&id, &record))
+        {
+        }
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SqliteDbTable_next)->Arg(10000);
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "utils.h"
+
+#include <random>
+#include <sstream>
+
+#include <mega.h>
+
+namespace mt {
+
+namespace {
+
+std::mt19937 gRandomGenerator{1};
+
+std::string randomBase64(size_t binarySize)
+{
+    return mega::Base64::btoa(randomData(binarySize));
+}
+
+} // anonymous
+
+std::string randomData(size_t size)
+{
+    std::string data(size, '\0');
+    for (auto& c : data)
+    {
+        c = static_cast<char>(gRandomGenerator());
+    }
+    return data;
+}
+
+std::shared_ptr<mega::MegaClient> makeClient(mega::MegaApp& app, mega::FileSystemAccess& fsaccess)
+{
+    struct HttpIo : mega::HttpIO
+    {
+        void addevents(mega::Waiter*, int) override {}
+        void post(struct mega::HttpReq*, const char* = NULL, unsigned = 0) override {}
+        void cancel(mega::HttpReq*) override {}
+        m_off_t postpos(void*) override { return {}; }
+        bool doio(void) override { return {}; }
+        void setuseragent(std::string*) override {}
+    };
+
+    auto httpio = new HttpIo;
+
+    auto deleter = [httpio](mega::MegaClient* client)
+    {
+        delete client;
+        delete httpio;
+    };
+
+    return std::shared_ptr<mega::MegaClient>{new mega::MegaClient{
+            &app, nullptr, httpio, &fsaccess, nullptr, nullptr, "XXX", "benchmark", 0
+        }, deleter};
+}
+
+std::string fetchnodesJson(size_t count)
+{
+    // same shape as the API's: a few folders with many files each
+    const std::string user = randomBase64(mega::MegaClient::USERHANDLE);
+    std::vector<std::string> folders{randomBase64(mega::MegaClient::NODEHANDLE)};
+
+    std::ostringstream json;
+    json << "[{\"h\":\"" << folders[0] << "\",\"t\":2,\"a\":\"\",\"k\":\"\",\"u\":\"" << user << "\",\"ts\":1600000000}";
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        const bool folder = i % 20 == 0;
+        const std::string h = randomBase64(mega::MegaClient::NODEHANDLE);
+        const std::string& p = folders[gRandomGenerator() % folders.size()];
+
+        json << ",{\"h\":\"" << h << "\",\"p\":\"" << p << "\",\"u\":\"" << user
+             << "\",\"t\":" << (folder ? mega::FOLDERNODE : mega::FILENODE)
+             << ",\"a\":\"" << randomBase64(64)
+             << "\",\"k\":\"" << user << ":" << randomBase64(folder ? mega::FOLDERNODEKEYLENGTH : mega::FILENODEKEYLENGTH) << "\"";
+        if (!folder)
+        {
+            json << ",\"s\":" << gRandomGenerator() % 100000000
+                 << ",\"fa\":\"" << "924:1*" << randomBase64(8) << "/924:0*" << randomBase64(8) << "\"";
+        }
+        json << ",\"ts\":" << 1600000000 + i << "}";
+
+        if (folder)
+        {
+            folders.push_back(h);
+        }
+    }
+    json << "]";
+    return json.str();
+}
+
+} // mt
@@ -0,0 +1,37 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <mega/megaclient.h>
+
+namespace mt {
+
+// repeatable pseudo random bytes
+std::string randomData(size_t size);
+
+// a client without network access, for the code that needs one (eg. Node)
+std::shared_ptr<mega::MegaClient> makeClient(mega::MegaApp& app, mega::FileSystemAccess& fsaccess);
+
+// the "f" array of a fetchnodes response, with `count` folders and files
+std::string fetchnodesJson(size_t count);
+
+} // mt
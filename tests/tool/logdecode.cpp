@@ -0,0 +1,46 @@
+/**
+ * @file tests/tool/logdecode.cpp
+ * @brief Converts binary logs written by the asynchronous logger to text
+ *
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+#include "mega/asynclogging.h"
+
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log file>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in)
+    {
+        std::cerr << "Unable to open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    if (!mega::AsyncLogger::decode(in, std::cout))
+    {
+        std::cerr << argv[1] << " is not a valid binary log" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file main.cpp
+ * @brief command line front end of the mock API and storage server
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mockserver.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+static void usage(const char* program)
+{
+    cout << "Usage: " << program << " [--port N] [--email E] [--password P] [--nodes N] [--fanout N] [--filesize BYTES]\n"
+            "       [--raid] [--latency MS] [--bandwidth BYTES_PER_SEC] [--cserrors RATE] [--storageerrors RATE]\n"
+            "       [--scwait MS] [--verbose]\n"
+            "Point a client at it with MegaClient::APIURL = \"http://127.0.0.1:<port>/\"" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    MockConfig config;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (arg == "--raid")
+        {
+            config.raid = true;
+            continue;
+        }
+        else if (arg == "--verbose")
+        {
+            config.verbose = true;
+            continue;
+        }
+        else if (!value)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        if (arg == "--port") config.port = (unsigned short)atoi(value);
+        else if (arg == "--email") config.email = value;
+        else if (arg == "--password") config.password = value;
+        else if (arg == "--nodes") config.nodes = size_t(atoll(value));
+        else if (arg == "--fanout") config.fanout = unsigned(atoi(value));
+        else if (arg == "--filesize") config.filesize = size_t(atoll(value));
+        else if (arg == "--latency") config.latencyms = unsigned(atoi(value));
+        else if (arg == "--bandwidth") config.bandwidth = uint64_t(atoll(value));
+        else if (arg == "--cserrors") config.cserrorrate = atof(value);
+        else if (arg == "--storageerrors") config.storageerrorrate = atof(value);
+        else if (arg == "--scwait") config.scwaitms = unsigned(atoi(value));
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    try
+    {
+        asio::io_service io;
+        MockServer server(io, config);
+        server.start();
+        io.run();
+    }
+    catch (std::exception& e)
+    {
+        cout << "Mock server exception: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1291 @@
+/**
+ * @file mockserver.cpp
+ * @brief local stand-in for the MEGA API and storage servers
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mockserver.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace ::mega;
+
+// number of distinct synthetic file contents (and keys)
+static const size_t CONTENTPOOLSIZE = 8;
+
+// action packets kept for catching up; older sn values get ETOOMANY
+static const size_t MAXACTIONPACKETS = 100000;
+
+typedef map<string, string> MockCommand;
+
+static string quoted(const string& s)
+{
+    return "\"" + s + "\"";
+}
+
+static string get(const MockCommand& cmd, const char* name)
+{
+    auto it = cmd.find(name);
+    return it == cmd.end() ? string() : it->second;
+}
+
+static string lowercase(string s)
+{
+    transform(s.begin(), s.end(), s.begin(), [](char c) { return char(tolower(c)); });
+    return s;
+}
+
+// split a JSON array of objects into name/value maps (values of strings unquoted, others raw)
+static bool parseobjects(const string& json, vector<MockCommand>& objects)
+{
+    JSON j;
+    j.begin(json.c_str());
+
+    if (!j.enterarray())
+    {
+        return false;
+    }
+
+    while (j.enterobject())
+    {
+        MockCommand object;
+        for (;;)
+        {
+            string name = j.getname();
+            if (name.empty())
+            {
+                break;
+            }
+
+            if (!j.storeobject(&object[name]))
+            {
+                return false;
+            }
+        }
+
+        if (!j.leaveobject())
+        {
+            return false;
+        }
+        objects.push_back(move(object));
+    }
+
+    return true;
+}
+
+string HttpRequest::param(const string& name) const
+{
+    string key = name + "=";
+    size_t pos = 0;
+    while (pos < query.size())
+    {
+        size_t end = query.find('&', pos);
+        if (end == string::npos)
+        {
+            end = query.size();
+        }
+
+        if (!query.compare(pos, key.size(), key))
+        {
+            return query.substr(pos + key.size(), end - pos - key.size());
+        }
+        pos = end + 1;
+    }
+    return string();
+}
+
+MockAccount::MockAccount(const MockConfig& config)
+    : mConfig(config)
+    , mFastRng(random_device()())
+{
+    mRng.genblock((byte*)&mMe, sizeof mMe);
+    mMe64 = encodehandle(mMe, MegaClient::USERHANDLE);
+
+    mRng.genblock(mMasterKey, sizeof mMasterKey);
+    mMasterCipher.setkey(mMasterKey);
+
+    byte seed[SymmCipher::KEYLENGTH];
+    mRng.genblock(seed, sizeof seed);
+    mSeedCipher.setkey(seed);
+
+    // version 2 account: the password is stretched with the salt
+    string salt(32, '\0');
+    mRng.genblock((byte*)salt.data(), salt.size());
+    mSalt = Base64::btoa(salt);
+
+    byte derivedKey[2 * SymmCipher::KEYLENGTH];
+    CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA512> pbkdf2;
+    pbkdf2.DeriveKey(derivedKey, sizeof(derivedKey), 0, (const byte*)mConfig.password.data(), mConfig.password.size(),
+                     (const byte*)salt.data(), salt.size(), 100000);
+
+    SymmCipher pwcipher;
+    pwcipher.setkey(derivedKey);
+    byte k[SymmCipher::KEYLENGTH];
+    memcpy(k, mMasterKey, sizeof k);
+    pwcipher.ecb_encrypt(k);
+    mEncryptedMasterKey = Base64::btoa(string((const char*)k, sizeof k));
+    mAuthKey = Base64::btoa(string((const char*)derivedKey + SymmCipher::KEYLENGTH, SymmCipher::KEYLENGTH));
+
+    mSince = m_time();
+    mRng.genblock((byte*)&mNextHandle, sizeof mNextHandle);
+    mSequence = (mFastRng() & 0xFFFFFFFF) + 1;
+
+    generate();
+}
+
+void MockAccount::generate()
+{
+    // a few distinct encrypted contents shared by all synthetic files, so their
+    // MACs only have to be computed once
+    mContentPool.resize(CONTENTPOOLSIZE);
+    for (MockContent& content : mContentPool)
+    {
+        byte key[SymmCipher::KEYLENGTH];
+        uint64_t ctriv;
+        mRng.genblock(key, sizeof key);
+        mRng.genblock((byte*)&ctriv, sizeof ctriv);
+
+        content.data.resize(mConfig.filesize);
+        for (char& c : content.data)
+        {
+            c = char(mFastRng());
+        }
+
+        SymmCipher cipher;
+        cipher.setkey(key);
+        chunkmac_map macs;
+        EncryptBufferByChunks eb((byte*)&content.data[0], &cipher, &macs, ctriv);
+        string urlSuffix;
+        eb.encrypt(0, m_off_t(content.data.size()), urlSuffix);
+
+        memcpy(content.filekey, key, sizeof key);
+        ((int64_t*)content.filekey)[2] = int64_t(ctriv);
+        ((int64_t*)content.filekey)[3] = macs.macsmac(&cipher);
+        SymmCipher::xorblock(content.filekey + SymmCipher::KEYLENGTH, content.filekey);
+    }
+
+    mRoot = addnode(UNDEF, ROOTNODE);
+    mInbox = addnode(UNDEF, INCOMINGNODE);
+    mRubbish = addnode(UNDEF, RUBBISHNODE);
+
+    // breadth first: synthetic node i (the root being 0) is a child of (i - 1) / fanout,
+    // and a folder if it has children itself
+    size_t fanout = max<size_t>(1, mConfig.fanout);
+    vector<handle> synthetic(mConfig.nodes + 1);
+    synthetic[0] = mRoot;
+    mNodes.reserve(mConfig.nodes + 3);
+
+    for (size_t i = 1; i <= mConfig.nodes; i++)
+    {
+        bool folder = i * fanout + 1 <= mConfig.nodes;
+        synthetic[i] = addnode(synthetic[(i - 1) / fanout], folder ? FOLDERNODE : FILENODE);
+
+        if (!folder)
+        {
+            MockNode& n = mNodes.back();
+            n.size = m_off_t(mConfig.filesize);
+            n.blob = -1 - int(i % mContentPool.size());
+        }
+    }
+}
+
+handle MockAccount::addnode(handle parent, int type)
+{
+    MockNode n;
+    n.h = mNextHandle++ & 0xFFFFFFFFFFFF;
+    n.parent = parent;
+    n.type = type;
+    n.ts = mSince;
+
+    mNodeIndex[n.h] = mNodes.size();
+    mNodes.push_back(move(n));
+    return mNodes.back().h;
+}
+
+MockAccount::MockNode* MockAccount::findnode(handle h)
+{
+    auto it = mNodeIndex.find(h);
+    if (it == mNodeIndex.end() || mNodes[it->second].deleted)
+    {
+        return nullptr;
+    }
+    return &mNodes[it->second];
+}
+
+void MockAccount::nodekey(const MockNode& n, byte* key, int& keylen)
+{
+    if (n.type == FILENODE && n.blob < 0)
+    {
+        keylen = FILENODEKEYLENGTH;
+        memcpy(key, mContentPool[size_t(-1 - n.blob)].filekey, FILENODEKEYLENGTH);
+    }
+    else
+    {
+        // derived from the handle, so it doesn't need to be stored
+        keylen = FOLDERNODEKEYLENGTH;
+        memset(key, 0, FOLDERNODEKEYLENGTH);
+        memcpy(key, &n.h, sizeof n.h);
+        mSeedCipher.ecb_encrypt(key);
+    }
+}
+
+string MockAccount::nodeattr(const MockNode& n)
+{
+    if (!n.attr.empty())
+    {
+        return n.attr;
+    }
+
+    byte key[FILENODEKEYLENGTH];
+    int keylen;
+    nodekey(n, key, keylen);
+
+    string attr = "MEGA{\"n\":\"";
+    attr.append(n.type == FILENODE ? "file" : "folder");
+    attr.append(encodehandle(n.h));
+    attr.append(n.type == FILENODE ? ".bin\"}" : "\"}");
+    attr.resize((attr.size() + SymmCipher::BLOCKSIZE - 1) & -SymmCipher::BLOCKSIZE);
+
+    SymmCipher cipher;
+    cipher.setkey(key, n.type);
+    cipher.cbc_encrypt((byte*)&attr[0], attr.size());
+    return Base64::btoa(attr);
+}
+
+void MockAccount::appendnode(string& out, const MockNode& n, int index)
+{
+    out.append("{\"h\":\"");
+    out.append(encodehandle(n.h));
+    if (n.parent != UNDEF)
+    {
+        out.append("\",\"p\":\"");
+        out.append(encodehandle(n.parent));
+    }
+    out.append("\",\"u\":\"");
+    out.append(mMe64);
+    out.append("\",\"t\":");
+    out.append(to_string(n.type));
+
+    if (n.type == FILENODE || n.type == FOLDERNODE)
+    {
+        out.append(",\"a\":\"");
+        out.append(nodeattr(n));
+        out.append("\",\"k\":\"");
+        out.append(mMe64);
+        out.push_back(':');
+        if (!n.key.empty())
+        {
+            out.append(n.key);
+        }
+        else
+        {
+            byte key[FILENODEKEYLENGTH];
+            int keylen;
+            nodekey(n, key, keylen);
+            mMasterCipher.ecb_encrypt(key, key, size_t(keylen));
+            out.append(Base64::btoa(string((const char*)key, size_t(keylen))));
+        }
+        out.push_back('"');
+    }
+
+    if (n.type == FILENODE)
+    {
+        out.append(",\"s\":");
+        out.append(to_string(n.size));
+        if (!n.fa.empty())
+        {
+            out.append(",\"fa\":\"");
+            out.append(n.fa);
+            out.push_back('"');
+        }
+    }
+
+    if (index >= 0)
+    {
+        out.append(",\"i\":");
+        out.append(to_string(index));
+    }
+
+    out.append(",\"ts\":");
+    out.append(to_string(n.ts));
+    out.push_back('}');
+}
+
+void MockAccount::appendsubtree(string& out, const MockNode& n)
+{
+    // parents before children, as the client expects
+    vector<handle> level(1, n.h);
+    set<handle> insubtree(level.begin(), level.end());
+    appendnode(out, n);
+
+    while (!level.empty())
+    {
+        vector<handle> next;
+        for (const MockNode& c : mNodes)
+        {
+            if (!c.deleted && insubtree.count(c.parent) && !insubtree.count(c.h)
+                    && find(level.begin(), level.end(), c.parent) != level.end())
+            {
+                out.push_back(',');
+                appendnode(out, c);
+                next.push_back(c.h);
+            }
+        }
+        insubtree.insert(next.begin(), next.end());
+        level.swap(next);
+    }
+}
+
+bool MockAccount::validsession(const string& sid) const
+{
+    return mSessions.count(sid) > 0;
+}
+
+string MockAccount::cs(const HttpRequest& req, const string& baseurl)
+{
+    string sid = req.param("sid");
+    if (!sid.empty() && !validsession(sid))
+    {
+        return to_string(API_ESID);
+    }
+
+    vector<MockCommand> commands;
+    if (!parseobjects(req.body, commands))
+    {
+        return to_string(API_EARGS);
+    }
+
+    string response = "[";
+    for (const MockCommand& cmd : commands)
+    {
+        if (response.size() > 1)
+        {
+            response.push_back(',');
+        }
+        response.append(command(cmd, sid, baseurl));
+    }
+    response.push_back(']');
+    return response;
+}
+
+string MockAccount::command(const MockCommand& cmd, const string& sid, const string& baseurl)
+{
+    string a = get(cmd, "a");
+
+    if (a == "us0")
+    {
+        return "{\"v\":2,\"s\":" + quoted(mSalt) + "}";
+    }
+
+    if (a == "us")
+    {
+        return login(cmd, sid);
+    }
+
+    if (sid.empty() && a != "g")
+    {
+        return to_string(API_EACCESS);
+    }
+
+    if (a == "up")
+    {
+        mPrivK = get(cmd, "privk");
+        mPubK = get(cmd, "pubk");
+        return quoted(mMe64);
+    }
+
+    if (a == "ug")
+    {
+        string r = "{\"u\":" + quoted(mMe64)
+                + ",\"email\":" + quoted(mConfig.email)
+                + ",\"since\":" + to_string(mSince)
+                + ",\"k\":" + quoted(mEncryptedMasterKey)
+                + ",\"v\":2,\"salt\":" + quoted(mSalt);
+        if (!mPrivK.empty())
+        {
+            r += ",\"privk\":" + quoted(mPrivK) + ",\"pubk\":" + quoted(mPubK);
+        }
+        return r + "}";
+    }
+
+    if (a == "uq")
+    {
+        m_off_t used = 0;
+        for (const MockNode& n : mNodes)
+        {
+            if (!n.deleted && n.type == FILENODE)
+            {
+                used += n.size;
+            }
+        }
+        return "{\"mstrg\":1099511627776,\"cstrg\":" + to_string(used) + ",\"mxfer\":1099511627776,\"caxfer\":0,\"utype\":4}";
+    }
+
+    if (a == "f")
+    {
+        string r;
+        r.reserve(mNodes.size() * 256);
+        r.append("{\"f\":[");
+        bool first = true;
+        for (const MockNode& n : mNodes)
+        {
+            if (!n.deleted)
+            {
+                if (!first)
+                {
+                    r.push_back(',');
+                }
+                first = false;
+                appendnode(r, n);
+            }
+        }
+        r.append("],\"ok\":[],\"s\":[],\"sn\":");
+        r.append(quoted(encodesn(mSequence - 1)));
+        r.push_back('}');
+        return r;
+    }
+
+    if (a == "p")
+    {
+        return putnodes(cmd);
+    }
+
+    if (a == "u")
+    {
+        // upload target
+        uint64_t id;
+        mRng.genblock((byte*)&id, sizeof id);
+        string target = encodehandle(id, sizeof id);
+        mUploads[target].data.resize(size_t(atoll(get(cmd, "s").c_str())));
+        return "{\"p\":" + quoted(baseurl + "ul/" + target) + "}";
+    }
+
+    if (a == "g")
+    {
+        return getfile(cmd, baseurl);
+    }
+
+    if (a == "m")
+    {
+        return movenode(cmd);
+    }
+
+    if (a == "d")
+    {
+        return deletenode(cmd);
+    }
+
+    if (a == "a")
+    {
+        return setattr(cmd);
+    }
+
+    if (a == "ufa")
+    {
+        return "{\"p\":" + quoted(baseurl + (cmd.count("fah") ? "fa/get" : "fa/put")) + "}";
+    }
+
+    if (a == "pfa")
+    {
+        return attachfa(cmd);
+    }
+
+    if (a == "log" || a == "cds" || a == "usma" || a == "wsc")
+    {
+        return "0";
+    }
+
+    // user attributes and everything else this server doesn't know about
+    return to_string(API_ENOENT);
+}
+
+string MockAccount::login(const MockCommand& cmd, const string& sid)
+{
+    if (!cmd.count("user"))
+    {
+        // session resumption
+        if (!validsession(sid))
+        {
+            return to_string(API_ESID);
+        }
+
+        string r = "{\"u\":" + quoted(mMe64) + ",\"k\":" + quoted(mEncryptedMasterKey);
+        if (!mPrivK.empty())
+        {
+            r += ",\"privk\":" + quoted(mPrivK);
+        }
+        return r + "}";
+    }
+
+    if (lowercase(get(cmd, "user")) != lowercase(mConfig.email) || get(cmd, "uh") != mAuthKey)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    byte newsid[MegaClient::SIDLEN];
+    mRng.genblock(newsid, sizeof newsid);
+
+    string r = "{\"u\":" + quoted(mMe64) + ",\"k\":" + quoted(mEncryptedMasterKey);
+    if (mPrivK.empty())
+    {
+        // no RSA keypair yet: symmetric challenge, the client will add a keypair
+        mMasterCipher.ecb_encrypt(newsid, newsid + sizeof newsid - SymmCipher::KEYLENGTH);
+        r += ",\"tsid\":" + quoted(Base64::btoa(string((const char*)newsid, sizeof newsid)));
+    }
+    else
+    {
+        AsymmCipher pubk;
+        string pubkbin = Base64::atob(mPubK);
+        pubk.setkey(AsymmCipher::PUBKEY, (const byte*)pubkbin.data(), int(pubkbin.size()));
+
+        byte csid[AsymmCipher::MAXKEYLENGTH];
+        int len = pubk.encrypt(mRng, newsid, sizeof newsid, csid, sizeof csid);
+        r += ",\"privk\":" + quoted(mPrivK) + ",\"csid\":" + quoted(Base64::btoa(string((const char*)csid, size_t(len))));
+    }
+
+    mSessions.insert(Base64::btoa(string((const char*)newsid, sizeof newsid)));
+    return r + "}";
+}
+
+string MockAccount::putnodes(const MockCommand& cmd)
+{
+    handle target = decodehandle(get(cmd, "t"));
+    if (!findnode(target))
+    {
+        return to_string(API_ENOENT);
+    }
+
+    vector<MockCommand> newnodes;
+    if (!parseobjects(get(cmd, "n"), newnodes) || newnodes.empty())
+    {
+        return to_string(API_EARGS);
+    }
+
+    // validate first, so that a batch is created entirely or not at all
+    for (const MockCommand& nn : newnodes)
+    {
+        if (atoi(get(nn, "t").c_str()) == FILENODE && !mUploadTokens.count(get(nn, "h")))
+        {
+            return to_string(API_ENOENT);
+        }
+    }
+
+    map<string, handle> created;
+    string nodes;
+    for (size_t i = 0; i < newnodes.size(); i++)
+    {
+        const MockCommand& nn = newnodes[i];
+
+        handle parent = target;
+        auto it = created.find(get(nn, "p"));
+        if (it != created.end())
+        {
+            parent = it->second;
+        }
+
+        int type = atoi(get(nn, "t").c_str());
+        handle h = addnode(parent, type);
+        MockNode& n = mNodes.back();
+        n.ts = m_time();
+        n.attr = get(nn, "a");
+        n.key = get(nn, "k");
+
+        if (type == FILENODE)
+        {
+            n.blob = mUploadTokens[get(nn, "h")];
+            n.size = m_off_t(mBlobs[size_t(n.blob)].size());
+
+            // pending file attributes, as "<type>*<handle>/..."
+            string fa = get(nn, "fa");
+            for (size_t pos = 0; pos < fa.size(); )
+            {
+                size_t end = fa.find('/', pos);
+                if (end == string::npos)
+                {
+                    end = fa.size();
+                }
+                n.fa += string(n.fa.empty() ? "" : "/") + "1:" + fa.substr(pos, end - pos);
+                pos = end + 1;
+            }
+        }
+        else
+        {
+            created[get(nn, "h")] = h;
+        }
+
+        if (i)
+        {
+            nodes.push_back(',');
+        }
+        appendnode(nodes, n, int(i));
+    }
+
+    string i = get(cmd, "i");
+    actionpacket("{\"a\":\"t\"" + (i.empty() ? "" : ",\"i\":" + quoted(i)) + ",\"t\":{\"f\":[" + nodes + "]},\"ou\":" + quoted(mMe64) + "}");
+    return "{\"f\":[" + nodes + "]}";
+}
+
+string MockAccount::getfile(const MockCommand& cmd, const string& baseurl)
+{
+    MockNode* n = findnode(decodehandle(get(cmd, "n")));
+    if (!n || n->type != FILENODE)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    string url = baseurl + "dl/" + encodehandle(n->h) + "/";
+    string g;
+    if (mConfig.raid)
+    {
+        g = "[";
+        for (int part = 1; part <= RAIDPARTS; part++)
+        {
+            g += (part > 1 ? "," : "") + quoted(url + to_string(part));
+        }
+        g += "]";
+    }
+    else
+    {
+        g = quoted(url + "0");
+    }
+
+    string r = "{\"s\":" + to_string(n->size) + ",\"at\":" + quoted(nodeattr(*n)) + ",\"g\":" + g;
+    if (!n->fa.empty())
+    {
+        r += ",\"fa\":" + quoted(n->fa);
+    }
+    return r + "}";
+}
+
+string MockAccount::movenode(const MockCommand& cmd)
+{
+    MockNode* n = findnode(decodehandle(get(cmd, "n")));
+    handle target = decodehandle(get(cmd, "t"));
+    if (!n || !findnode(target) || n->type > FOLDERNODE)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    n->parent = target;
+
+    string i = get(cmd, "i");
+    string self = i.empty() ? "" : ",\"i\":" + quoted(i);
+    actionpacket("{\"a\":\"d\"" + self + ",\"n\":" + quoted(encodehandle(n->h)) + "}");
+
+    string nodes;
+    appendsubtree(nodes, *n);
+    actionpacket("{\"a\":\"t\"" + self + ",\"t\":{\"f\":[" + nodes + "]},\"ou\":" + quoted(mMe64) + "}");
+    return "0";
+}
+
+string MockAccount::deletenode(const MockCommand& cmd)
+{
+    MockNode* n = findnode(decodehandle(get(cmd, "n")));
+    if (!n || n->type > FOLDERNODE)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    // mark the whole subtree, parents are always created before their children
+    set<handle> deleted;
+    deleted.insert(n->h);
+    for (MockNode& c : mNodes)
+    {
+        if (!c.deleted && (c.h == n->h || deleted.count(c.parent)))
+        {
+            deleted.insert(c.h);
+            c.deleted = true;
+        }
+    }
+
+    string i = get(cmd, "i");
+    actionpacket("{\"a\":\"d\"" + (i.empty() ? "" : ",\"i\":" + quoted(i)) + ",\"n\":" + quoted(encodehandle(n->h)) + "}");
+    return "0";
+}
+
+string MockAccount::setattr(const MockCommand& cmd)
+{
+    MockNode* n = findnode(decodehandle(get(cmd, "n")));
+    if (!n || n->type > FOLDERNODE)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    if (n->key.empty())
+    {
+        // keep the generated key of a synthetic node next to its new attributes
+        byte key[FILENODEKEYLENGTH];
+        int keylen;
+        nodekey(*n, key, keylen);
+        mMasterCipher.ecb_encrypt(key, key, size_t(keylen));
+        n->key = Base64::btoa(string((const char*)key, size_t(keylen)));
+    }
+    n->attr = get(cmd, "at");
+
+    string i = get(cmd, "i");
+    actionpacket("{\"a\":\"u\"" + (i.empty() ? "" : ",\"i\":" + quoted(i))
+                 + ",\"n\":" + quoted(encodehandle(n->h))
+                 + ",\"u\":" + quoted(mMe64)
+                 + ",\"at\":" + quoted(n->attr)
+                 + ",\"ts\":" + to_string(n->ts) + "}");
+    return "0";
+}
+
+string MockAccount::attachfa(const MockCommand& cmd)
+{
+    MockNode* n = findnode(decodehandle(get(cmd, "n")));
+    string fa = get(cmd, "fa");
+    size_t star = fa.find('*');
+    if (!n || n->type != FILENODE || star == string::npos)
+    {
+        return to_string(API_ENOENT);
+    }
+
+    // replace any attribute of the same type
+    string type = ":" + fa.substr(0, star + 1);
+    string merged;
+    for (size_t pos = 0; pos < n->fa.size(); )
+    {
+        size_t end = n->fa.find('/', pos);
+        if (end == string::npos)
+        {
+            end = n->fa.size();
+        }
+        string item = n->fa.substr(pos, end - pos);
+        if (item.find(type) == string::npos)
+        {
+            merged += (merged.empty() ? "" : "/") + item;
+        }
+        pos = end + 1;
+    }
+    n->fa = merged + (merged.empty() ? "" : "/") + "1:" + fa;
+    return quoted(n->fa);
+}
+
+void MockAccount::actionpacket(string packet)
+{
+    mActionPackets.emplace_back(mSequence++, move(packet));
+    if (mActionPackets.size() > MAXACTIONPACKETS)
+    {
+        mActionPackets.pop_front();
+    }
+}
+
+bool MockAccount::sc(const string& sn, string& response)
+{
+    handle seq = decodehandle(sn, sizeof(handle));
+    if (seq == UNDEF)
+    {
+        response = to_string(API_EARGS);
+        return true;
+    }
+
+    if (!mActionPackets.empty() && seq + 1 < mActionPackets.front().first)
+    {
+        // too far behind: the client has to reload
+        response = to_string(API_ETOOMANY);
+        return true;
+    }
+
+    if (mActionPackets.empty() || mActionPackets.back().first <= seq)
+    {
+        return false;
+    }
+
+    response = "{\"a\":[";
+    bool first = true;
+    for (auto& ap : mActionPackets)
+    {
+        if (ap.first > seq)
+        {
+            if (!first)
+            {
+                response.push_back(',');
+            }
+            first = false;
+            response.append(ap.second);
+        }
+    }
+    response.append("],\"sn\":");
+    response.append(quoted(encodesn(mActionPackets.back().first)));
+    response.push_back('}');
+    return true;
+}
+
+bool MockAccount::upload(const string& target, m_off_t pos, const string& data, string& response)
+{
+    auto it = mUploads.find(target);
+    if (it == mUploads.end() || pos < 0 || size_t(pos) + data.size() > it->second.data.size())
+    {
+        return false;
+    }
+
+    MockUpload& upload = it->second;
+    memcpy(&upload.data[size_t(pos)], data.data(), data.size());
+
+    // chunks may be retried
+    auto chunk = upload.chunks.find(pos);
+    if (chunk != upload.chunks.end())
+    {
+        upload.received -= chunk->second;
+    }
+    upload.chunks[pos] = data.size();
+    upload.received += data.size();
+
+    response.clear();
+    if (upload.received == upload.data.size())
+    {
+        // new style upload token: binary, ending in 1
+        string token(NewNode::UPLOADTOKENLEN, '\0');
+        mRng.genblock((byte*)&token[0], token.size() - 1);
+        token.back() = 1;
+
+        mUploadTokens[Base64::btoa(token)] = int(mBlobs.size());
+        mBlobs.push_back(move(upload.data));
+        mUploads.erase(it);
+        response = token;
+    }
+    return true;
+}
+
+bool MockAccount::download(handle h, int part, m_off_t start, m_off_t end, string& data)
+{
+    MockNode* n = findnode(h);
+    if (!n || n->type != FILENODE)
+    {
+        return false;
+    }
+
+    const string& content = n->blob >= 0 ? mBlobs[size_t(n->blob)] : mContentPool[size_t(-1 - n->blob)].data;
+    m_off_t size = m_off_t(content.size());
+
+    m_off_t available = part ? RaidBufferManager::raidPartSize(unsigned(part - 1), size) : size;
+    if (end >= available)
+    {
+        end = available - 1;
+    }
+    if (start < 0 || start > end + 1)
+    {
+        return false;
+    }
+
+    if (!part)
+    {
+        data = content.substr(size_t(start), size_t(end + 1 - start));
+        return true;
+    }
+
+    // CloudRAID: lines of 5 data sectors, part 1 is the parity (XOR) of a line's sectors
+    // and parts 2-6 are the sectors at that position in each line
+    data.resize(size_t(end + 1 - start));
+    for (m_off_t q = start; q <= end; q++)
+    {
+        m_off_t line = q / RAIDSECTOR;
+        m_off_t offset = line * RAIDLINE + q % RAIDSECTOR;
+        byte b = 0;
+
+        if (part == 1)
+        {
+            for (int s = 0; s < RAIDPARTS - 1; s++)
+            {
+                m_off_t p = offset + s * RAIDSECTOR;
+                b ^= p < size ? byte(content[size_t(p)]) : 0;
+            }
+        }
+        else
+        {
+            m_off_t p = offset + (part - 2) * RAIDSECTOR;
+            b = p < size ? byte(content[size_t(p)]) : 0;
+        }
+        data[size_t(q - start)] = char(b);
+    }
+    return true;
+}
+
+string MockAccount::putfa(const string& data)
+{
+    handle h;
+    mRng.genblock((byte*)&h, sizeof h);
+    mFileAttributes[h] = data;
+    return string((const char*)&h, sizeof h);
+}
+
+string MockAccount::getfa(const string& handles)
+{
+    // (handle.8.le / length.4.le) + attribute data, for each requested handle
+    string response;
+    for (size_t pos = 0; pos + sizeof(handle) <= handles.size(); pos += sizeof(handle))
+    {
+        handle h;
+        memcpy(&h, handles.data() + pos, sizeof h);
+        auto it = mFileAttributes.find(h);
+        if (it != mFileAttributes.end())
+        {
+            uint32_t len = uint32_t(it->second.size());
+            response.append((const char*)&h, sizeof h);
+            response.append((const char*)&len, sizeof len);
+            response.append(it->second);
+        }
+    }
+    return response;
+}
+
+string MockAccount::encodehandle(handle h, int size) const
+{
+    char buf[16];
+    buf[Base64::btoa((const byte*)&h, size, buf)] = 0;
+    return buf;
+}
+
+handle MockAccount::decodehandle(const string& s, int size) const
+{
+    handle h = 0;
+    if (Base64::atob(s.c_str(), (byte*)&h, size) != size)
+    {
+        return UNDEF;
+    }
+    return h;
+}
+
+string MockAccount::encodesn(uint64_t sn) const
+{
+    return encodehandle(sn, sizeof sn);
+}
+
+// one keep-alive HTTP/1.1 connection
+class MockServer::Connection : public enable_shared_from_this<MockServer::Connection>
+{
+public:
+    Connection(MockServer& server, asio::ip::tcp::socket socket)
+        : mServer(server)
+        , mSocket(move(socket))
+        , mTimer(server.mIo)
+    {
+    }
+
+    void start()
+    {
+        readheaders();
+    }
+
+private:
+    MockServer& mServer;
+    asio::ip::tcp::socket mSocket;
+    asio::streambuf mBuffer;
+    asio::steady_timer mTimer;
+    HttpRequest mRequest;
+    string mOut;
+    size_t mOutPos = 0;
+
+    void readheaders()
+    {
+        auto self = shared_from_this();
+        asio::async_read_until(mSocket, mBuffer, "\r\n\r\n", [this, self](const asio::error_code& ec, size_t n)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            string headers(asio::buffers_begin(mBuffer.data()), asio::buffers_begin(mBuffer.data()) + ptrdiff_t(n));
+            mBuffer.consume(n);
+
+            mRequest = HttpRequest();
+            istringstream s(headers);
+            string target, line;
+            s >> mRequest.method >> target;
+            getline(s, line);
+
+            size_t q = target.find('?');
+            mRequest.path = target.substr(0, q);
+            mRequest.query = q == string::npos ? string() : target.substr(q + 1);
+
+            while (getline(s, line) && line.size() > 1)
+            {
+                size_t colon = line.find(':');
+                if (colon != string::npos)
+                {
+                    string value = line.substr(colon + 1);
+                    value.erase(0, value.find_first_not_of(' '));
+                    value.erase(value.find_last_not_of("\r ") + 1);
+                    mRequest.headers[lowercase(line.substr(0, colon))] = value;
+                }
+            }
+
+            size_t length = size_t(atoll(mRequest.headers["content-length"].c_str()));
+            if (mRequest.headers["expect"] == "100-continue")
+            {
+                asio::write(mSocket, asio::buffer(string("HTTP/1.1 100 Continue\r\n\r\n")));
+            }
+            readbody(length);
+        });
+    }
+
+    void readbody(size_t length)
+    {
+        if (mBuffer.size() >= length)
+        {
+            mRequest.body.assign(asio::buffers_begin(mBuffer.data()), asio::buffers_begin(mBuffer.data()) + ptrdiff_t(length));
+            mBuffer.consume(length);
+
+            auto self = shared_from_this();
+            mServer.handle(mRequest, [this, self](const HttpResponse& response) { respond(response); });
+            return;
+        }
+
+        auto self = shared_from_this();
+        asio::async_read(mSocket, mBuffer, asio::transfer_exactly(length - mBuffer.size()), [this, self, length](const asio::error_code& ec, size_t)
+        {
+            if (!ec)
+            {
+                readbody(length);
+            }
+        });
+    }
+
+    void respond(const HttpResponse& response)
+    {
+        ostringstream s;
+        s << "HTTP/1.1 " << response.status << (response.status == 200 ? " OK" : " Error") << "\r\n"
+          << "Content-Type: " << response.contenttype << "\r\n"
+          << "Content-Length: " << response.body.size() << "\r\n"
+          << "Access-Control-Allow-Origin: *\r\n\r\n";
+
+        size_t headerlen = s.str().size();
+        mOut = s.str() + response.body;
+        mOutPos = 0;
+        writenext(response.throttled && mServer.mConfig.bandwidth ? headerlen : mOut.size());
+    }
+
+    void writenext(size_t len)
+    {
+        auto self = shared_from_this();
+        asio::async_write(mSocket, asio::buffer(mOut.data() + mOutPos, len), [this, self](const asio::error_code& ec, size_t n)
+        {
+            if (ec)
+            {
+                return;
+            }
+
+            mOutPos += n;
+            if (mOutPos == mOut.size())
+            {
+                mOut.clear();
+                readheaders();
+                return;
+            }
+
+            // throttled: a tenth of the per second allowance every 100 ms
+            size_t slice = size_t(max<uint64_t>(1, mServer.mConfig.bandwidth / 10));
+            mTimer.expires_from_now(chrono::milliseconds(100));
+            mTimer.async_wait([this, self, slice](const asio::error_code& ec)
+            {
+                if (!ec)
+                {
+                    writenext(min(slice, mOut.size() - mOutPos));
+                }
+            });
+        });
+    }
+};
+
+MockServer::MockServer(asio::io_service& io, const MockConfig& config)
+    : mIo(io)
+    , mAcceptor(io, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), config.port))
+    , mConfig(config)
+    , mAccount(config)
+    , mErrorRng(random_device()())
+{
+}
+
+void MockServer::start()
+{
+    cout << "Serving " << mAccount.nodecount() << " nodes of " << mConfig.email
+         << " at http://127.0.0.1:" << mConfig.port << "/ (use it as MegaClient::APIURL)" << endl;
+    accept();
+}
+
+void MockServer::log(const string& s)
+{
+    if (mConfig.verbose)
+    {
+        cout << s << endl;
+    }
+}
+
+void MockServer::accept()
+{
+    auto socket = make_shared<asio::ip::tcp::socket>(mIo);
+    mAcceptor.async_accept(*socket, [this, socket](const asio::error_code& ec)
+    {
+        if (!ec)
+        {
+            socket->set_option(asio::ip::tcp::no_delay(true));
+            make_shared<Connection>(*this, move(*socket))->start();
+        }
+        accept();
+    });
+}
+
+bool MockServer::injecterror(double rate)
+{
+    return rate > 0 && uniform_real_distribution<double>(0, 1)(mErrorRng) < rate;
+}
+
+void MockServer::handle(const HttpRequest& req, function<void(const HttpResponse&)> respond)
+{
+    if (mConfig.latencyms)
+    {
+        auto direct = respond;
+        respond = [this, direct](const HttpResponse& response)
+        {
+            auto timer = make_shared<asio::steady_timer>(mIo, chrono::milliseconds(mConfig.latencyms));
+            timer->async_wait([timer, direct, response](const asio::error_code&) { direct(response); });
+        };
+    }
+
+    string host = req.headers.count("host") ? req.headers.at("host") : "127.0.0.1:" + to_string(mConfig.port);
+    string baseurl = "http://" + host + "/";
+
+    HttpResponse response;
+    vector<string> path;
+    istringstream s(req.path);
+    for (string item; getline(s, item, '/'); )
+    {
+        if (!item.empty())
+        {
+            path.push_back(item);
+        }
+    }
+
+    if (path.size() == 1 && path[0] == "cs")
+    {
+        response.body = injecterror(mConfig.cserrorrate) ? to_string(API_EAGAIN) : mAccount.cs(req, baseurl);
+        log(req.method + " " + req.path + " " + req.body.substr(0, 200) + " -> " + response.body.substr(0, 200));
+        respond(response);
+
+        // the commands may have generated action packets
+        wakescwaiters();
+        return;
+    }
+
+    if (path.size() == 1 && (path[0] == "wsc" || path[0] == "sc"))
+    {
+        if (!mAccount.validsession(req.param("sid")))
+        {
+            response.body = to_string(API_ESID);
+        }
+        else if (req.param("c") == "50")
+        {
+            // no user alerts
+            response.body = "{\"c\":[],\"u\":[]}";
+        }
+        else if (!mAccount.sc(req.param("sn"), response.body))
+        {
+            auto waiter = make_shared<ScWaiter>();
+            waiter->sn = req.param("sn");
+            waiter->respond = respond;
+            waiter->timer = make_shared<asio::steady_timer>(mIo, chrono::milliseconds(mConfig.scwaitms));
+            waiter->timer->async_wait([this, waiter](const asio::error_code& ec)
+            {
+                auto it = find(mScWaiters.begin(), mScWaiters.end(), waiter);
+                if (!ec && it != mScWaiters.end())
+                {
+                    mScWaiters.erase(it);
+
+                    // keep-alive, the client asks again
+                    HttpResponse keepalive;
+                    keepalive.body = "0";
+                    waiter->respond(keepalive);
+                }
+            });
+            mScWaiters.push_back(waiter);
+            return;
+        }
+
+        log(req.method + " " + req.path + " -> " + response.body.substr(0, 200));
+        respond(response);
+        return;
+    }
+
+    response.contenttype = "application/octet-stream";
+    if (injecterror(mConfig.storageerrorrate))
+    {
+        response.status = 503;
+    }
+    else if (path.size() == 3 && path[0] == "ul")
+    {
+        if (!mAccount.upload(path[1], atoll(path[2].c_str()), req.body, response.body))
+        {
+            response.body = to_string(API_EARGS);
+        }
+    }
+    else if (path.size() == 4 && path[0] == "dl")
+    {
+        ::mega::handle h = 0;
+        Base64::atob(path[1].c_str(), (byte*)&h, MegaClient::NODEHANDLE);
+        m_off_t start = atoll(path[3].c_str());
+        size_t dash = path[3].find('-');
+        m_off_t end = dash == string::npos ? start : atoll(path[3].c_str() + dash + 1);
+
+        if (mAccount.download(h, atoi(path[2].c_str()), start, end, response.body))
+        {
+            response.throttled = true;
+        }
+        else
+        {
+            response.status = 404;
+        }
+    }
+    else if (path.size() == 2 && path[0] == "fa" && path[1] == "put")
+    {
+        response.body = mAccount.putfa(req.body);
+    }
+    else if (path.size() == 2 && path[0] == "fa" && path[1] == "get")
+    {
+        response.body = mAccount.getfa(req.body);
+    }
+    else
+    {
+        response.status = 404;
+    }
+
+    log(req.method + " " + req.path + " " + to_string(req.body.size()) + " bytes -> " + to_string(response.status) + " " + to_string(response.body.size()) + " bytes");
+    respond(response);
+}
+
+void MockServer::wakescwaiters()
+{
+    for (auto it = mScWaiters.begin(); it != mScWaiters.end(); )
+    {
+        HttpResponse response;
+        if (mAccount.sc((*it)->sn, response.body))
+        {
+            auto waiter = *it;
+            it = mScWaiters.erase(it);
+            waiter->timer->cancel();
+            waiter->respond(response);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
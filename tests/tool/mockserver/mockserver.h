@@ -0,0 +1,247 @@
+/**
+ * @file mockserver.h
+ * @brief local stand-in for the MEGA API and storage servers
+ *
+ * (c) 2013-2020 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+#include <asio.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mega.h>
+
+// Speaks enough of the cs/wsc JSON protocol and of the storage protocol for a
+// MegaClient pointed at it (MegaClient::APIURL = "http://127.0.0.1:<port>/")
+// to log in, fetch a synthetic account, create nodes, receive action packets,
+// and upload and download files (optionally as CloudRAID parts).
+// All state lives in memory and is lost when the process exits.
+
+struct MockConfig
+{
+    unsigned short port = 8800;
+
+    // the only account on this server
+    std::string email = "mock@mega.invalid";
+    std::string password = "mockpassword";
+
+    // synthetic cloud drive: `nodes` nodes in a tree where every folder has `fanout` children
+    size_t nodes = 10000;
+    unsigned fanout = 10;
+
+    // size of the synthetic files
+    size_t filesize = 65536;
+
+    // serve downloads as 6 CloudRAID parts rather than a single URL
+    bool raid = false;
+
+    // added to every response
+    unsigned latencyms = 0;
+
+    // storage transfer cap per connection, in bytes per second (0 = no cap)
+    uint64_t bandwidth = 0;
+
+    // fraction of cs requests answered with EAGAIN, and of storage requests with HTTP 503
+    double cserrorrate = 0;
+    double storageerrorrate = 0;
+
+    // how long a wsc request is held when there are no action packets for it
+    unsigned scwaitms = 30000;
+
+    bool verbose = false;
+};
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::string query;
+    std::map<std::string, std::string> headers;
+    std::string body;
+
+    // value of a query string parameter, empty if missing
+    std::string param(const std::string& name) const;
+};
+
+struct HttpResponse
+{
+    int status = 200;
+    std::string contenttype = "application/json";
+    std::string body;
+
+    // throttle the body to the configured bandwidth (storage transfers)
+    bool throttled = false;
+};
+
+// the account, its nodes, sessions, uploads and action packets
+class MockAccount
+{
+public:
+    explicit MockAccount(const MockConfig& config);
+
+    // process a batch of commands; baseurl prefixes the storage URLs handed out
+    std::string cs(const HttpRequest& req, const std::string& baseurl);
+
+    // action packets after sn, false if there are none yet
+    bool sc(const std::string& sn, std::string& response);
+
+    // returns false if the session is unknown
+    bool validsession(const std::string& sid) const;
+
+    // store an uploaded chunk, the response carries the upload token when the file is complete
+    bool upload(const std::string& target, m_off_t pos, const std::string& data, std::string& response);
+
+    // byte range of the encrypted file (part 0: full file, 1-6: CloudRAID part)
+    bool download(mega::handle h, int part, m_off_t start, m_off_t end, std::string& data);
+
+    // file attribute storage
+    std::string putfa(const std::string& data);
+    std::string getfa(const std::string& handles);
+
+    size_t nodecount() const { return mNodes.size(); }
+
+private:
+    struct MockNode
+    {
+        mega::handle h = mega::UNDEF;
+        mega::handle parent = mega::UNDEF;
+        int type = mega::FOLDERNODE;
+        m_off_t size = -1;
+        mega::m_time_t ts = 0;
+
+        // uploaded blob (>= 0) or synthetic content (< 0: -1 - index in the content pool)
+        int blob = -1;
+
+        // created through the API: as received (synthetic nodes are generated on demand)
+        std::string attr;
+        std::string key;
+        std::string fa;
+
+        bool deleted = false;
+    };
+
+    struct MockContent
+    {
+        mega::byte filekey[mega::FILENODEKEYLENGTH];
+        std::string data;
+    };
+
+    struct MockUpload
+    {
+        std::string data;
+        std::map<m_off_t, size_t> chunks;
+        size_t received = 0;
+    };
+
+    const MockConfig& mConfig;
+    mega::PrnGen mRng;
+    std::mt19937_64 mFastRng;
+
+    mega::handle mMe;
+    std::string mMe64;
+    mega::byte mMasterKey[mega::SymmCipher::KEYLENGTH];
+    mega::SymmCipher mMasterCipher;
+    mega::SymmCipher mSeedCipher;
+    std::string mSalt;
+    std::string mAuthKey;
+    std::string mEncryptedMasterKey;
+    std::string mPrivK;
+    std::string mPubK;
+    mega::m_time_t mSince;
+
+    std::vector<MockNode> mNodes;
+    std::unordered_map<mega::handle, size_t> mNodeIndex;
+    mega::handle mNextHandle;
+    mega::handle mRoot, mInbox, mRubbish;
+
+    std::vector<MockContent> mContentPool;
+    std::vector<std::string> mBlobs;
+    std::map<std::string, MockUpload> mUploads;
+    std::map<std::string, int> mUploadTokens;
+    std::map<mega::handle, std::string> mFileAttributes;
+
+    std::set<std::string> mSessions;
+
+    uint64_t mSequence = 1;
+    std::deque<std::pair<uint64_t, std::string>> mActionPackets;
+
+    void generate();
+    mega::handle addnode(mega::handle parent, int type);
+    MockNode* findnode(mega::handle h);
+
+    void nodekey(const MockNode& n, mega::byte* key, int& keylen);
+    std::string nodeattr(const MockNode& n);
+    void appendnode(std::string& out, const MockNode& n, int index = -1);
+    void appendsubtree(std::string& out, const MockNode& n);
+
+    std::string command(const std::map<std::string, std::string>& cmd, const std::string& sid, const std::string& baseurl);
+    std::string login(const std::map<std::string, std::string>& cmd, const std::string& sid);
+    std::string putnodes(const std::map<std::string, std::string>& cmd);
+    std::string getfile(const std::map<std::string, std::string>& cmd, const std::string& baseurl);
+    std::string movenode(const std::map<std::string, std::string>& cmd);
+    std::string deletenode(const std::map<std::string, std::string>& cmd);
+    std::string setattr(const std::map<std::string, std::string>& cmd);
+    std::string attachfa(const std::map<std::string, std::string>& cmd);
+
+    void actionpacket(std::string packet);
+
+    std::string encodehandle(mega::handle h, int size = mega::MegaClient::NODEHANDLE) const;
+    mega::handle decodehandle(const std::string& s, int size = mega::MegaClient::NODEHANDLE) const;
+    std::string encodesn(uint64_t sn) const;
+};
+
+class MockServer
+{
+public:
+    MockServer(asio::io_service& io, const MockConfig& config);
+
+    void start();
+
+    // log one line per request
+    void log(const std::string& s);
+
+private:
+    class Connection;
+
+    asio::io_service& mIo;
+    asio::ip::tcp::acceptor mAcceptor;
+    const MockConfig& mConfig;
+    MockAccount mAccount;
+    std::mt19937 mErrorRng;
+
+    // wsc requests waiting for action packets
+    struct ScWaiter
+    {
+        std::string sn;
+        std::function<void(const HttpResponse&)> respond;
+        std::shared_ptr<asio::steady_timer> timer;
+    };
+    std::vector<std::shared_ptr<ScWaiter>> mScWaiters;
+
+    void accept();
+    void handle(const HttpRequest& req, std::function<void(const HttpResponse&)> respond);
+    void wakescwaiters();
+    bool injecterror(double rate);
+};
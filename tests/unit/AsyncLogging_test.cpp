@@ -0,0 +1,161 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <cstdio>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include <mega/asynclogging.h>
+
+namespace {
+
+class CollectingLogger : public mega::Logger
+{
+public:
+    struct Entry
+    {
+        int level;
+        std::string source;
+        std::string message;
+        std::thread::id thread;
+    };
+    std::vector<Entry> entries;
+
+    void log(const char*, int loglevel, const char* source, const char* message
+#ifdef ENABLE_LOG_PERFORMANCE
+             , const char**, size_t*, unsigned
+#endif
+             ) override
+    {
+        entries.push_back({loglevel, source ? source : "", message, std::this_thread::get_id()});
+    }
+};
+
+void logTo(mega::Logger& logger, int level, const char* source, const char* message)
+{
+    logger.log("12:00:00", level, source, message
+#ifdef ENABLE_LOG_PERFORMANCE
+               , nullptr, nullptr, 0
+#endif
+               );
+}
+
+}
+
+TEST(AsyncLogging, deliversInOrderFromTheFlusherThread)
+{
+    CollectingLogger target;
+    {
+        mega::AsyncLogger logger(&target);
+        for (int i = 0; i < 100; i++)
+        {
+            logTo(logger, mega::logInfo, "file.cpp:1", std::to_string(i).c_str());
+        }
+        logger.flush();
+
+        ASSERT_EQ(100u, target.entries.size());
+        ASSERT_EQ(0u, logger.dropped());
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(std::to_string(i), target.entries[i].message);
+        ASSERT_EQ("file.cpp:1", target.entries[i].source);
+        ASSERT_EQ(mega::logInfo, target.entries[i].level);
+        ASSERT_NE(std::this_thread::get_id(), target.entries[i].thread);
+    }
+}
+
+TEST(AsyncLogging, binaryOutputRoundTrip)
+{
+    const std::string path = "asynclogging_test.bin";
+    CollectingLogger target;
+    {
+        mega::AsyncLogger logger(&target);
+        ASSERT_TRUE(logger.setBinaryOutput(path));
+        logTo(logger, mega::logError, "file.cpp:2", "first message");
+        logTo(logger, mega::logDebug, nullptr, "second message");
+    }
+    ASSERT_TRUE(target.entries.empty());
+
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream out;
+    ASSERT_TRUE(mega::AsyncLogger::decode(in, out));
+    in.close();
+    std::remove(path.c_str());
+
+    std::string text = out.str();
+    ASSERT_NE(std::string::npos, text.find("[err] first message [file.cpp:2]\n"));
+    ASSERT_NE(std::string::npos, text.find("[debug] second message\n"));
+    ASSERT_LT(text.find("first message"), text.find("second message"));
+
+    std::istringstream notALog("plain text");
+    ASSERT_FALSE(mega::AsyncLogger::decode(notALog, out));
+}
+
+TEST(AsyncLogging, countsDroppedMessages)
+{
+    // holds the flusher thread in the first delivery, so nothing is drained meanwhile
+    struct BlockingLogger : public CollectingLogger
+    {
+        std::atomic<bool> entered{false};
+        std::atomic<bool> released{false};
+
+        void log(const char* time, int loglevel, const char* source, const char* message
+#ifdef ENABLE_LOG_PERFORMANCE
+                 , const char** directMessages, size_t* directMessagesSizes, unsigned numberMessages
+#endif
+                 ) override
+        {
+            entered = true;
+            while (!released)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CollectingLogger::log(time, loglevel, source, message
+#ifdef ENABLE_LOG_PERFORMANCE
+                                  , directMessages, directMessagesSizes, numberMessages
+#endif
+                                  );
+        }
+    } target;
+
+    mega::AsyncLogger logger(&target, 4096);
+    logTo(logger, mega::logError, nullptr, "first");
+    while (!target.entered)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // only four of these fit in the ring
+    std::string message(900, 'x');
+    for (int i = 0; i < 10; i++)
+    {
+        logTo(logger, mega::logDebug, nullptr, message.c_str());
+    }
+    EXPECT_EQ(6u, logger.dropped());
+
+    target.released = true;
+    logger.flush();
+
+    ASSERT_EQ(6u, target.entries.size());
+    ASSERT_EQ("first", target.entries.front().message);
+    ASSERT_EQ(mega::logWarning, target.entries.back().level);
+    ASSERT_NE(std::string::npos, target.entries.back().message.find("dropped 6 messages"));
+}
@@ -37,6 +37,33 @@ TEST(AttrMap, serialize_unserialize)
     ASSERT_EQ(map.map, newMap.map);
 }
 
+TEST(AttrMap, keepsTheAttributesSortedByName)
+{
+    mega::attr_map map;
+    map['n'] = "name";
+    map['c'] = "fingerprint";
+    map[mega::AttrMap::string2nameid("rr")] = "restore";
+    ASSERT_TRUE(map.insert({'c', "other"}).second == false);
+    ASSERT_EQ("fingerprint", map['c']);
+
+    std::vector<mega::nameid> names;
+    for (const auto& a : map)
+    {
+        names.push_back(a.first);
+    }
+    ASSERT_EQ((std::vector<mega::nameid>{'c', 'n', mega::AttrMap::string2nameid("rr")}), names);
+
+    ASSERT_EQ(1u, map.erase('n'));
+    ASSERT_EQ(0u, map.erase('n'));
+    ASSERT_EQ(map.end(), map.find('n'));
+    ASSERT_EQ("restore", map.find(mega::AttrMap::string2nameid("rr"))->second);
+    ASSERT_EQ(2u, map.size());
+
+    map.erase(map.find('c'));
+    ASSERT_EQ(1u, map.count(mega::AttrMap::string2nameid("rr")));
+    ASSERT_EQ(0u, map.count('c'));
+}
+
 #ifndef WIN32   // data was recorded with "mock" utf-8 not the actual utf-16
 TEST(AttrMap, unserialize_32bit)
 {
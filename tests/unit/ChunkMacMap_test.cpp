@@ -16,6 +16,8 @@
  * program.
  */
 
+#include <limits>
+
 #include <gtest/gtest.h>
 
 #include <mega/utils.h>
@@ -43,8 +45,9 @@ TEST(ChunkMacMap, serialize_unserialize)
     chunkMac2.finished = false;
 
     mega::chunkmac_map map;
-    map[1] = chunkMac1;
-    map[2] = chunkMac2;
+    map[0] = chunkMac1;
+    map[mega::ChunkedHash::SEGSIZE] = chunkMac2;
+    ASSERT_EQ(2u, map.size());
 
     std::string d;
     map.serialize(d);
@@ -68,16 +71,17 @@ TEST(ChunkMacMap, unserialize_32bit)
     chunkMac2.finished = false;
 
     mega::chunkmac_map map;
-    map[1] = chunkMac1;
-    map[2] = chunkMac2;
+    map[0] = chunkMac1;
+    map[mega::ChunkedHash::SEGSIZE] = chunkMac2;
+    ASSERT_EQ(2u, map.size());
 
     // This is the result of serialization on 32bit Windows
     const std::array<unsigned char, 66> rawData = {
-        0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x58, 0x58,
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x58, 0x58,
         0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58, 0x58,
         0x58, 0x58, 0x0d, 0x00, 0x00, 0x00, 0x01, 0xcc,
-        0xcc, 0xcc, 0x02, 0x00,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59,
+        0xcc, 0xcc, 0x00, 0x00,
+        0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59,
         0x59, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59, 0x59, 0x0e, 0x00,
         0x00, 0x00, 0x00, 0xcc, 0xcc,
         0xcc
@@ -89,3 +93,78 @@ TEST(ChunkMacMap, unserialize_32bit)
     ASSERT_TRUE(newMap.unserialize(data, d.c_str() + d.size()));
     EXPECT_EQ(map, newMap);
 }
+
+TEST(ChunkMacMap, unserialize_rejectsCorruptPositions)
+{
+    mega::ChunkMAC chunkMac;
+    std::fill(chunkMac.mac, chunkMac.mac + mega::SymmCipher::BLOCKSIZE, 'X');
+
+    for (m_off_t pos : { m_off_t(-1), m_off_t(1) << 50, std::numeric_limits<m_off_t>::max() })
+    {
+        std::string d;
+        unsigned short ll = 2;
+        d.append(reinterpret_cast<const char*>(&ll), sizeof(ll));
+        for (m_off_t p : { m_off_t(0), pos })
+        {
+            d.append(reinterpret_cast<const char*>(&p), sizeof(p));
+            d.append(reinterpret_cast<const char*>(&chunkMac), sizeof(chunkMac));
+        }
+
+        mega::chunkmac_map map;
+        auto data = d.c_str();
+        ASSERT_FALSE(map.unserialize(data, d.c_str() + d.size()));
+        ASSERT_TRUE(map.empty());
+    }
+}
+
+TEST(ChunkMacMap, chunkIndexFollowsChunkedHash)
+{
+    for (size_t index = 0; index < 40; index++)
+    {
+        m_off_t start = mega::chunkmac_map::chunkStart(index);
+        ASSERT_EQ(start, mega::ChunkedHash::chunkfloor(start));
+        ASSERT_EQ(mega::chunkmac_map::chunkStart(index + 1), mega::ChunkedHash::chunkceil(start));
+        ASSERT_EQ(index, mega::chunkmac_map::chunkIndex(start));
+        ASSERT_EQ(index, mega::chunkmac_map::chunkIndex(mega::chunkmac_map::chunkStart(index + 1) - 1));
+    }
+}
+
+TEST(ChunkMacMap, macsmac_matchesChunkOrder)
+{
+    std::string key(mega::SymmCipher::KEYLENGTH, 'k');
+    mega::SymmCipher cipher;
+    cipher.setkey(reinterpret_cast<const mega::byte*>(key.data()));
+
+    // added out of order, with gaps
+    std::map<m_off_t, mega::ChunkMAC> reference;
+    mega::chunkmac_map map;
+    for (size_t index : {20, 3, 0, 9, 8, 35, 1})
+    {
+        m_off_t pos = mega::chunkmac_map::chunkStart(index);
+        mega::ChunkMAC& chunkMac = map[pos];
+        std::fill(chunkMac.mac, chunkMac.mac + mega::SymmCipher::BLOCKSIZE, static_cast<char>(index));
+        reference[pos] = chunkMac;
+    }
+    ASSERT_EQ(reference.size(), map.size());
+    ASSERT_EQ(nullptr, map.find(mega::chunkmac_map::chunkStart(2)));
+    ASSERT_NE(nullptr, map.find(mega::chunkmac_map::chunkStart(9) + 5));
+
+    mega::byte mac[mega::SymmCipher::BLOCKSIZE] = { 0 };
+    for (auto& m : reference)
+    {
+        mega::SymmCipher::xorblock(m.second.mac, mac);
+        cipher.ecb_encrypt(mac);
+    }
+    uint32_t* m = reinterpret_cast<uint32_t*>(mac);
+    m[0] ^= m[1];
+    m[1] = m[2] ^ m[3];
+    ASSERT_EQ(mega::MemAccess::get<int64_t>(reinterpret_cast<const char*>(mac)), map.macsmac(&cipher));
+
+    std::string d;
+    map.serialize(d);
+    mega::chunkmac_map newMap;
+    auto data = d.c_str();
+    ASSERT_TRUE(newMap.unserialize(data, d.c_str() + d.size()));
+    EXPECT_EQ(map, newMap);
+    EXPECT_EQ(map.macsmac(&cipher), newMap.macsmac(&cipher));
+}
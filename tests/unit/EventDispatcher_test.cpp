@@ -0,0 +1,179 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include <mega/eventdispatcher.h>
+
+namespace {
+
+// holds the dispatcher thread in a callback until released, so that events pile up
+struct Gate
+{
+    std::atomic<bool> entered{false};
+    std::atomic<bool> released{false};
+
+    void pass()
+    {
+        entered = true;
+        while (!released)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void waitEntered()
+    {
+        while (!entered)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+};
+
+mega::EventDispatcher::Event makeEvent(const void* listener, std::function<void()> call)
+{
+    mega::EventDispatcher::Event e;
+    e.targets.push_back({listener, std::move(call)});
+    return e;
+}
+
+}
+
+TEST(EventDispatcher, deliversInOrderOnItsThread)
+{
+    int listener;
+    std::vector<int> received;
+    std::thread::id thread;
+
+    mega::EventDispatcher dispatcher(100);
+    for (int i = 0; i < 10; i++)
+    {
+        dispatcher.post(makeEvent(&listener, [&received, &thread, i]()
+        {
+            received.push_back(i);
+            thread = std::this_thread::get_id();
+        }));
+    }
+    dispatcher.flush();
+
+    ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), received);
+    ASSERT_NE(std::this_thread::get_id(), thread);
+    ASSERT_EQ(0u, dispatcher.pending());
+}
+
+TEST(EventDispatcher, coalescesAndDropsProgress)
+{
+    int listener;
+    Gate gate;
+    std::vector<std::string> received;
+
+    mega::EventDispatcher dispatcher(3);
+    dispatcher.post(makeEvent(&listener, [&gate]() { gate.pass(); }));
+    gate.waitEntered();
+
+    auto progress = [&](uint64_t subject, const std::string& name)
+    {
+        auto e = makeEvent(&listener, [&received, name]() { received.push_back(name); });
+        e.subject = subject;
+        e.progress = true;
+        dispatcher.post(std::move(e));
+    };
+
+    progress(1, "1: 10%");
+    progress(1, "1: 20%");      // replaces the previous one
+    auto finish = makeEvent(&listener, [&received]() { received.push_back("1: finished"); });
+    finish.subject = 1;
+    dispatcher.post(std::move(finish));
+    progress(1, "1: 30%");      // queued after the finish, not merged with the update before it
+    progress(2, "2: 10%");      // the queue is full
+    dispatcher.post(makeEvent(&listener, [&received]() { received.push_back("other"); }));
+
+    ASSERT_EQ(1u, dispatcher.coalesced());
+    ASSERT_EQ(1u, dispatcher.dropped());
+    ASSERT_EQ(4u, dispatcher.pending());
+
+    gate.released = true;
+    dispatcher.flush();
+    ASSERT_EQ((std::vector<std::string>{"1: 20%", "1: finished", "1: 30%", "other"}), received);
+}
+
+TEST(EventDispatcher, mergesConsecutiveBatches)
+{
+    int listener;
+    Gate gate;
+    std::vector<std::vector<int>> received;
+
+    mega::EventDispatcher dispatcher(100);
+    dispatcher.post(makeEvent(&listener, [&gate]() { gate.pass(); }));
+    gate.waitEntered();
+
+    auto batch = [&](std::vector<int> values)
+    {
+        auto data = std::make_shared<std::vector<int>>(std::move(values));
+        auto e = makeEvent(&listener, [&received, data]() { received.push_back(*data); });
+        e.batchType = 1;
+        e.batch = data;
+        e.mergeBatch = [](void* into, void* from)
+        {
+            auto& a = *static_cast<std::vector<int>*>(into);
+            auto& b = *static_cast<std::vector<int>*>(from);
+            a.insert(a.end(), b.begin(), b.end());
+        };
+        dispatcher.post(std::move(e));
+    };
+
+    batch({1, 2});
+    batch({3});
+    dispatcher.post(makeEvent(&listener, []() {}));
+    batch({4});
+
+    gate.released = true;
+    dispatcher.flush();
+    ASSERT_EQ((std::vector<std::vector<int>>{{1, 2, 3}, {4}}), received);
+}
+
+TEST(EventDispatcher, noCallbacksAfterRemovingTheListener)
+{
+    int slow, other;
+    Gate gate;
+    std::atomic<int> slowCalls{0};
+    std::atomic<int> otherCalls{0};
+
+    mega::EventDispatcher dispatcher(100);
+    dispatcher.post(makeEvent(&slow, [&gate, &slowCalls]() { gate.pass(); slowCalls++; }));
+    gate.waitEntered();
+    dispatcher.post(makeEvent(&slow, [&slowCalls]() { slowCalls++; }));
+    dispatcher.post(makeEvent(&other, [&otherCalls]() { otherCalls++; }));
+
+    // returns only once the running callback of the listener is done
+    std::thread release([&gate]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.released = true;
+    });
+    dispatcher.removeListener(&slow);
+    ASSERT_EQ(1, slowCalls);
+    release.join();
+
+    dispatcher.flush();
+    ASSERT_EQ(1, slowCalls);
+    ASSERT_EQ(1, otherCalls);
+}
@@ -0,0 +1,112 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/json.h>
+
+TEST(JSONArrayScanner, findsCompleteElementsWhileReceiving)
+{
+    const std::string full = "{\"a\":\"u\",\"n\":\"x]}\\\"{\"},{\"a\":\"d\",\"p\":[1,{}]}],\"sn\":\"abc\"}";
+    const size_t firstEnd = full.find("},{") + 1;
+
+    mega::JSONArrayScanner scanner;
+
+    // nothing complete inside the first element, even with brackets in a string
+    ASSERT_EQ(0u, scanner.scan(full.data(), firstEnd - 1));
+    ASSERT_EQ(0u, scanner.elements());
+
+    ASSERT_EQ(firstEnd, scanner.scan(full.data(), firstEnd + 5));
+    ASSERT_EQ(1u, scanner.elements());
+    ASSERT_EQ(0u, scanner.laststart());
+    ASSERT_FALSE(scanner.ended());
+
+    // the caller drops the first element and keeps receiving
+    std::string rest = full.substr(firstEnd);
+    scanner.consume(firstEnd);
+
+    const size_t secondEnd = rest.find("],\"sn\"");
+    ASSERT_EQ(secondEnd, scanner.scan(rest.data(), rest.size()));
+    ASSERT_EQ(2u, scanner.elements());
+    ASSERT_EQ(1u, scanner.laststart());
+    ASSERT_TRUE(scanner.ended());
+
+    scanner.reset();
+    ASSERT_EQ(0u, scanner.elements());
+    ASSERT_FALSE(scanner.ended());
+}
+
+TEST(JSON, storeobjectSkipsStringsAtAnyAlignment)
+{
+    // strings long enough to span several scanning blocks, starting at every offset of a block,
+    // with escapes on both sides of the block boundaries
+    for (size_t shift = 0; shift < 32; shift++)
+    {
+        for (size_t escapeAt = 0; escapeAt < 40; escapeAt += 3)
+        {
+            std::string value(40, 'a');
+            value.insert(escapeAt, "\\\"");
+            value.insert(value.size() - escapeAt / 2, "\\\\");
+
+            std::string buffer(shift, ' ');
+            buffer += "[\"" + value + "\",{\"k\":\"" + value + "\"},12]";
+            buffer += ",\"next\"";
+
+            mega::JSON json;
+            json.begin(buffer.c_str() + shift);
+
+            std::string stored;
+            ASSERT_TRUE(json.storeobject(&stored));
+            ASSERT_EQ("[\"" + value + "\",{\"k\":\"" + value + "\"},12]", stored);
+            ASSERT_TRUE(json.storeobject(&stored));
+            ASSERT_EQ("next", stored);
+        }
+    }
+}
+
+TEST(JSON, storeobjectFailsOnUnterminatedStrings)
+{
+    for (const char* text : { "\"abc", "\"abcdefghijklmnopqrstuvwxyz0123456789", "\"abc\\", "{\"a\":\"b\\\"}" })
+    {
+        mega::JSON json;
+        json.begin(text);
+        ASSERT_FALSE(json.storeobject()) << text;
+        ASSERT_EQ(text, json.pos);
+    }
+}
+
+TEST(JSONArrayScanner, skipsLongStringsWithEscapes)
+{
+    const std::string value = std::string(37, 'x') + "\\\\\\\"]}" + std::string(20, 'y') + "\\\\";
+    const std::string full = "{\"a\":\"" + value + "\"},{\"b\":\"" + value + "\"}]";
+
+    for (size_t chunk = 1; chunk <= full.size(); chunk += 7)
+    {
+        mega::JSONArrayScanner scanner;
+        for (size_t len = chunk; ; len += chunk)
+        {
+            scanner.scan(full.data(), std::min(len, full.size()));
+            if (len >= full.size())
+            {
+                break;
+            }
+        }
+        ASSERT_EQ(2u, scanner.elements());
+        ASSERT_TRUE(scanner.ended());
+    }
+}
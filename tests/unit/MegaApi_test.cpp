@@ -17,6 +17,7 @@
  */
 
 #include <atomic>
+#include <future>
 #include <memory>
 #include <thread>
 
@@ -26,6 +27,8 @@
 #include <megaapi.h>
 #include <megaapi_impl.h>
 
+#include "utils.h"
+
 using namespace std;
 using namespace mega;
 
@@ -217,3 +220,151 @@ TEST(MegaApi, getMimeType)
 
     ASSERT_EQ(600, successCount);
 }
+
+TEST(MegaApi, MegaNodePrivate_decodesAttributesOfTheNodeAsCreated)
+{
+    MegaApp app;
+    FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto& n = mt::makeNode(*client, FILENODE, 42);
+    n.attrs.map[AttrMap::string2nameid("n")] = "file.txt";
+    n.attrs.map[AttrMap::string2nameid("c")] = "fingerprint";
+    n.attrs.map[AttrMap::string2nameid("c0")] = "original";
+    n.attrs.map[AttrMap::string2nameid("_color")] = "blue";
+    n.attrs.map[AttrMap::string2nameid("fav")] = "1";
+    n.attrs.map[AttrMap::string2nameid("lbl")] = "3";
+
+    unique_ptr<MegaNode> node{MegaNodePrivate::fromNode(&n)};
+    unique_ptr<MegaNode> copy{node->copy()};
+
+    // changes after the MegaNode was created don't show
+    n.attrs.map[AttrMap::string2nameid("fav")] = "0";
+    n.attrs.map.erase(AttrMap::string2nameid("_color"));
+
+    for (MegaNode* m : { node.get(), copy.get() })
+    {
+        ASSERT_STREQ("file.txt", m->getName());
+        ASSERT_STREQ("fingerprint", m->getFingerprint());
+        ASSERT_STREQ("original", m->getOriginalFingerprint());
+        ASSERT_TRUE(m->hasCustomAttrs());
+        ASSERT_STREQ("blue", m->getCustomAttr("color"));
+        ASSERT_TRUE(m->isFavourite());
+        ASSERT_EQ(3, m->getLabel());
+    }
+
+    // a copy of a decoded node
+    unique_ptr<MegaNode> copyOfDecoded{node->copy()};
+    ASSERT_STREQ("fingerprint", copyOfDecoded->getFingerprint());
+    ASSERT_STREQ("blue", copyOfDecoded->getCustomAttr("color"));
+    ASSERT_EQ(3, copyOfDecoded->getLabel());
+}
+
+TEST(MegaApi, MegaNodePrivate_fingerprintOfValidNodes)
+{
+    MegaApp app;
+    FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto& n = mt::makeNode(*client, FILENODE, 42);
+    n.attrs.map[AttrMap::string2nameid("n")] = "file.txt";
+    n.attrs.map[AttrMap::string2nameid("c")] = "ignored";
+    n.size = 1024;
+    n.mtime = 1600000000;
+    n.crc = {{1, 2, 3, 4}};
+    n.isvalid = true;
+
+    unique_ptr<MegaNode> node{MegaNodePrivate::fromNode(&n)};
+    unique_ptr<MegaNode> copy{node->copy()};
+    n.isvalid = false;
+
+    ASSERT_NE(nullptr, node->getFingerprint());
+    ASSERT_STRNE("ignored", node->getFingerprint());
+    ASSERT_STREQ(node->getFingerprint(), copy->getFingerprint());
+    ASSERT_FALSE(node->hasCustomAttrs());
+
+    string serialized;
+    ASSERT_TRUE(dynamic_cast<MegaNodePrivate*>(copy.get())->serialize(&serialized));
+    unique_ptr<MegaNode> restored{MegaNodePrivate::unserialize(&serialized)};
+    ASSERT_STREQ(node->getFingerprint(), restored->getFingerprint());
+}
+
+TEST(MegaApi, MegaNodePrivate_publicNodeKeepsTheFingerprints)
+{
+    MegaApp app;
+    FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto& n = mt::makeNode(*client, FILENODE, 42);
+    n.attrs.map[AttrMap::string2nameid("n")] = "file.txt";
+    n.attrs.map[AttrMap::string2nameid("c")] = "fingerprint";
+    n.attrs.map[AttrMap::string2nameid("c0")] = "original";
+    n.setpubliclink(43, 1600000000, 0, false);
+
+    unique_ptr<MegaNode> node{MegaNodePrivate::fromNode(&n)};
+    unique_ptr<MegaNode> publicNode{node->getPublicNode()};
+
+    ASSERT_NE(nullptr, publicNode);
+    ASSERT_EQ(43u, publicNode->getHandle());
+    ASSERT_STREQ("file.txt", publicNode->getName());
+    ASSERT_STREQ("fingerprint", publicNode->getFingerprint());
+    ASSERT_STREQ("original", publicNode->getOriginalFingerprint());
+}
+
+namespace {
+
+class BackupMonitorProbe : public MegaBackupMonitor
+{
+public:
+    BackupMonitorProbe() : MegaBackupMonitor(nullptr) {}
+
+    void onTransferStart(MegaApi* api, MegaTransfer* transfer) override
+    {
+        startThread = std::this_thread::get_id();
+        MegaBackupMonitor::onTransferStart(api, transfer);
+    }
+
+    void onTransferFinish(MegaApi* api, MegaTransfer* transfer, MegaError* error) override
+    {
+        finishThread = std::this_thread::get_id();
+        MegaBackupMonitor::onTransferFinish(api, transfer, error);
+    }
+
+    std::thread::id startThread;
+    std::thread::id finishThread;
+};
+
+class TransferFinishListener : public MegaListener
+{
+public:
+    void onTransferFinish(MegaApi*, MegaTransfer*, MegaError* error) override
+    {
+        finished.set_value({std::this_thread::get_id(), error->getErrorCode()});
+    }
+
+    std::promise<std::pair<std::thread::id, int>> finished;
+};
+
+} // anonymous
+
+TEST(MegaApi, asyncEventDelivery_backupMonitorStaysOnTheSdkThread)
+{
+    MegaApi api("appkey", static_cast<const char*>(nullptr), "unit test");
+    api.setAsyncEventDelivery(true);
+
+    BackupMonitorProbe monitor;
+    TransferFinishListener listener;
+    api.addListener(&monitor);
+    api.addListener(&listener);
+
+    // there is no parent node, so the upload starts and fails right away
+    auto finished = listener.finished.get_future();
+    api.startUpload("file.txt", nullptr);
+    ASSERT_EQ(std::future_status::ready, finished.wait_for(std::chrono::seconds(30)));
+    auto result = finished.get();
+    api.removeListener(&listener);
+    api.removeListener(&monitor);
+
+    ASSERT_EQ(API_EARGS, result.second);
+    ASSERT_NE(std::thread::id(), monitor.startThread);
+    ASSERT_EQ(monitor.startThread, monitor.finishThread);
+    ASSERT_NE(std::this_thread::get_id(), monitor.finishThread);
+    ASSERT_NE(result.first, monitor.finishThread);
+}
@@ -0,0 +1,112 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/metrics.h>
+
+TEST(Metrics, histogramBucketsCoverTheirValues)
+{
+    for (uint64_t us : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 100ull, 1000ull, 123456ull, 1ull << 40})
+    {
+        unsigned index = mega::MetricsHistogram::bucketIndex(us);
+        ASSERT_LT(index, unsigned(mega::MetricsHistogram::NUMBUCKETS));
+        ASSERT_LE(us, mega::MetricsHistogram::bucketUpperBound(index));
+        if (index > 0)
+        {
+            ASSERT_GT(us, mega::MetricsHistogram::bucketUpperBound(index - 1));
+        }
+    }
+
+    // bounds grow monotonically and stay within 25% of each other above the linear range
+    for (unsigned i = mega::MetricsHistogram::SUBBUCKETS; i < mega::MetricsHistogram::NUMBUCKETS; ++i)
+    {
+        uint64_t lower = mega::MetricsHistogram::bucketUpperBound(i - 1);
+        uint64_t upper = mega::MetricsHistogram::bucketUpperBound(i);
+        ASSERT_GT(upper, lower);
+        ASSERT_LE(upper - lower, (lower + 1) / 4 + 1);
+    }
+}
+
+TEST(Metrics, histogramPercentiles)
+{
+    mega::MetricsHistogram h;
+    for (uint64_t us = 1; us <= 1000; ++us)
+    {
+        h.recordMicroseconds(us);
+    }
+
+    auto s = h.snapshot();
+    ASSERT_EQ(1000u, s.count);
+    ASSERT_EQ(500500u, s.sumMicroseconds);
+
+    uint64_t p50 = s.percentile(0.5);
+    ASSERT_GE(p50, 500u);
+    ASSERT_LE(p50, 625u);
+
+    uint64_t p99 = s.percentile(0.99);
+    ASSERT_GE(p99, 990u);
+    ASSERT_LE(p99, 1023u);
+
+    ASSERT_EQ(0u, mega::MetricsHistogram().snapshot().percentile(0.5));
+}
+
+TEST(Metrics, registryRecordsOnlyWhileEnabled)
+{
+    mega::MetricsRegistry registry;
+
+    registry.add(mega::MetricsRegistry::DB_COMMITS);
+    registry.set(mega::MetricsRegistry::TRANSFER_SLOTS, 3);
+    ASSERT_EQ(0u, registry.snapshot().counters["db_commits"]);
+    ASSERT_EQ(0, registry.snapshot().gauges["transfer_slots"]);
+
+    registry.setEnabled(true);
+    registry.add(mega::MetricsRegistry::DB_COMMITS);
+    registry.add(mega::MetricsRegistry::DB_COMMITS, 2);
+    registry.set(mega::MetricsRegistry::TRANSFER_SLOTS, 3);
+    registry.adjust(mega::MetricsRegistry::TRANSFER_SLOTS, -1);
+
+    auto s = registry.snapshot();
+    ASSERT_EQ(3u, s.counters["db_commits"]);
+    ASSERT_EQ(2, s.gauges["transfer_slots"]);
+}
+
+TEST(Metrics, prometheusText)
+{
+    mega::MetricsRegistry registry;
+    registry.setEnabled(true);
+    registry.add(mega::MetricsRegistry::CS_REQUESTS_SENT, 5);
+    registry.histogram("cs_command_seconds", "command", "f").recordMicroseconds(1500000);
+    ASSERT_EQ(&registry.histogram("cs_command_seconds", "command", "f"), &registry.histogram("cs_command_seconds", "command", "f"));
+
+    std::string text = registry.snapshot().prometheus();
+    ASSERT_NE(std::string::npos, text.find("mega_cs_requests_sent_total 5\n"));
+    ASSERT_NE(std::string::npos, text.find("# TYPE mega_cs_command_seconds histogram\n"));
+    ASSERT_NE(std::string::npos, text.find("mega_cs_command_seconds_bucket{command=\"f\",le=\"+Inf\"} 1\n"));
+    ASSERT_NE(std::string::npos, text.find("mega_cs_command_seconds_sum{command=\"f\"} 1.5\n"));
+    ASSERT_NE(std::string::npos, text.find("mega_cs_command_seconds_count{command=\"f\"} 1\n"));
+
+    // the whole ladder, including the empty buckets
+    size_t buckets = 0;
+    for (size_t pos = 0; (pos = text.find("mega_cs_command_seconds_bucket{", pos)) != std::string::npos; pos++)
+    {
+        buckets++;
+    }
+    ASSERT_EQ(size_t(mega::MetricsHistogram::NUMBUCKETS) + 1, buckets);
+    ASSERT_NE(std::string::npos, text.find("mega_cs_command_seconds_bucket{command=\"f\",le=\"1e-06\"} 0\n"));
+}
@@ -0,0 +1,157 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega.h>
+#include <mega/megaapp.h>
+
+#include "utils.h"
+
+namespace {
+
+std::vector<mega::Node*> childrenOf(const mega::Node& n)
+{
+    return std::vector<mega::Node*>(n.children.begin(), n.children.end());
+}
+
+}
+
+TEST(Node, childrenKeepTheirOrderWhenMoved)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+
+    auto& root = mt::makeNode(*client, mega::ROOTNODE, 1);
+    auto& a = mt::makeNode(*client, mega::FOLDERNODE, 2, &root);
+    auto& b = mt::makeNode(*client, mega::FILENODE, 3, &root);
+    auto& c = mt::makeNode(*client, mega::FILENODE, 4, &root);
+    ASSERT_EQ((std::vector<mega::Node*>{&a, &b, &c}), childrenOf(root));
+
+    b.setparent(&a);
+    ASSERT_EQ((std::vector<mega::Node*>{&a, &c}), childrenOf(root));
+    ASSERT_EQ((std::vector<mega::Node*>{&b}), childrenOf(a));
+    ASSERT_EQ(&c, root.children.back());
+
+    b.setparent(&root);
+    c.setparent(&a);
+    ASSERT_EQ((std::vector<mega::Node*>{&a, &b}), childrenOf(root));
+    ASSERT_EQ(2u, root.children.size());
+    ASSERT_EQ((std::vector<mega::Node*>{&c}), childrenOf(a));
+}
+
+TEST(Node, childrenCanBeMovedWhileIterating)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+
+    auto& root = mt::makeNode(*client, mega::ROOTNODE, 1);
+    auto& target = mt::makeNode(*client, mega::FOLDERNODE, 2);
+    for (mega::handle h = 3; h < 10; h++)
+    {
+        mt::makeNode(*client, mega::FILENODE, h, &root);
+    }
+
+    for (mega::node_list::iterator it = root.children.begin(); it != root.children.end(); )
+    {
+        mega::Node* n = *it++;
+        n->setparent(&target);
+    }
+    ASSERT_TRUE(root.children.empty());
+    ASSERT_EQ(root.children.end(), root.children.begin());
+    ASSERT_EQ(7u, target.children.size());
+    ASSERT_EQ(3u, target.children.front()->nodehandle);
+}
+
+TEST(Node, foldersKeepTheCountsOfTheirSubtree)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+
+    auto& root = mt::makeNode(*client, mega::ROOTNODE, 1);
+    auto& a = mt::makeNode(*client, mega::FOLDERNODE, 2, &root);
+    auto& b = mt::makeNode(*client, mega::FOLDERNODE, 3, &a);
+    auto& file = mt::makeNode(*client, mega::FILENODE, 4, &b);
+    auto& version = mt::makeNode(*client, mega::FILENODE, 5, &file);
+    file.setsize(100);
+    version.setsize(40);
+
+    mega::NodeCounter nc = a.subnodeCounts();
+    ASSERT_EQ(2u, nc.folders);
+    ASSERT_EQ(2u, nc.files);
+    ASSERT_EQ(1u, nc.versions);
+    ASSERT_EQ(140, nc.storage);
+    ASSERT_EQ(40, nc.versionStorage);
+    ASSERT_EQ(2u, root.subnodeCounts().folders);
+    ASSERT_EQ(1u, b.children.files());
+    ASSERT_EQ(0u, a.children.files());
+
+    // moving b leaves a empty
+    b.setparent(&root);
+    nc = a.subnodeCounts();
+    ASSERT_EQ(1u, nc.folders);
+    ASSERT_EQ(0u, nc.files);
+    ASSERT_EQ(0, nc.storage);
+    ASSERT_EQ(140, root.subnodeCounts().storage);
+
+    // the version stops being one
+    version.setparent(&b);
+    nc = b.subnodeCounts();
+    ASSERT_EQ(2u, nc.files);
+    ASSERT_EQ(0u, nc.versions);
+    ASSERT_EQ(140, nc.storage);
+    ASSERT_EQ(2u, b.children.files());
+
+    client->nodes.erase(version.nodehandle);
+    delete &version;
+    nc = root.subnodeCounts();
+    ASSERT_EQ(1u, nc.files);
+    ASSERT_EQ(100, nc.storage);
+    ASSERT_EQ(1u, b.children.files());
+}
+
+TEST(Node, fingerprintIndexFollowsSizeChanges)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+
+    auto& root = mt::makeNode(*client, mega::ROOTNODE, 1);
+    auto& file = mt::makeNode(*client, mega::FILENODE, 2, &root);
+    file.setsize(100);
+    file.mtime = 1000;
+    file.isvalid = true;
+    client->mFingerprints.add(&file);
+    ASSERT_EQ(100, client->mFingerprints.getSumSizes());
+
+    file.setsize(250);
+    ASSERT_EQ(250, client->mFingerprints.getSumSizes());
+
+    mega::FileFingerprint fp;
+    fp.size = 250;
+    fp.mtime = 1000;
+    fp.isvalid = true;
+    ASSERT_EQ(&file, client->mFingerprints.nodebyfingerprint(&fp));
+
+    ASSERT_TRUE(client->mFingerprints.remove(&file));
+    ASSERT_FALSE(client->mFingerprints.remove(&file));
+    ASSERT_EQ(0, client->mFingerprints.getSumSizes());
+}
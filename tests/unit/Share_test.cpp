@@ -18,8 +18,12 @@
 
 #include <gtest/gtest.h>
 
+#include <mega.h>
+#include <mega/megaapp.h>
 #include <mega/share.h>
 
+#include "utils.h"
+
 void checkNewShares(const mega::NewShare& exp, const mega::NewShare& act)
 {
     ASSERT_EQ(exp.h, act.h);
@@ -69,3 +73,51 @@ TEST(Share, unserialize_32bit)
     const mega::NewShare expectedNewShare{100, -1, 42, mega::RDONLY, 13, key, NULL, 123};
     checkNewShares(expectedNewShare, *newShare);
 }
+
+TEST(Share, inboundShareKeyIsTakenFromTheDecryptedRsaKeys)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto& folder = mt::makeNode(*client, mega::FOLDERNODE, 42);
+
+    // decrypted earlier (eg. by the batch of a previous fetchnodes)
+    const std::string ciphertext(120, 'A');
+    const std::string key(mega::SymmCipher::KEYLENGTH, 'k');
+    client->mRsaDecryptedKeys[ciphertext] = key;
+
+    auto share = new mega::NewShare(42, 0, mega::UNDEF, mega::RDONLY, 0, nullptr);
+    share->rsakey = ciphertext;
+    client->newshares.push_back(share);
+    client->mergenewshares(false);
+
+    ASSERT_TRUE(client->newshares.empty());
+    ASSERT_NE(nullptr, folder.sharekey);
+    ASSERT_EQ(1u, client->sharekeyrewrite.size());
+    ASSERT_EQ(42, client->sharekeyrewrite[0]);
+
+    mega::byte tk[mega::SymmCipher::KEYLENGTH] = {};
+    ASSERT_TRUE(client->decryptkey(ciphertext.c_str(), tk, sizeof tk, &client->key, 0, mega::UNDEF));
+    ASSERT_EQ(key, std::string(reinterpret_cast<const char*>(tk), sizeof tk));
+}
+
+TEST(Share, inboundShareKeyThatFailsToDecryptIsNotSet)
+{
+    mega::MegaApp app;
+    mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+    auto& folder = mt::makeNode(*client, mega::FOLDERNODE, 42);
+
+    // longer than any RSA-encrypted key can be
+    const std::string ciphertext(6000, 'A');
+
+    auto share = new mega::NewShare(42, 0, mega::UNDEF, mega::RDONLY, 0, nullptr);
+    share->rsakey = ciphertext;
+    client->newshares.push_back(share);
+    client->mergenewshares(false);
+
+    // without have_key the merge leaves the share key alone
+    ASSERT_EQ(nullptr, folder.sharekey);
+    ASSERT_TRUE(client->mRsaDecryptedKeys.empty());
+    ASSERT_TRUE(client->sharekeyrewrite.empty());
+}
@@ -0,0 +1,308 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/streamingcache.h>
+
+namespace {
+
+using mega::StreamingCache;
+
+const m_off_t SEGMENT = StreamingCache::SEGMENT_SIZE;
+
+char byteAt(m_off_t pos)
+{
+    return static_cast<char>(pos * 7 + pos / 251);
+}
+
+// the downloads requested by the cache, fed on demand by the test
+struct Upstream
+{
+    struct Fetch
+    {
+        int id;
+        m_off_t pos;
+        m_off_t end;
+        bool running;
+    };
+    std::vector<Fetch> fetches;
+    std::shared_ptr<StreamingCache> cache;
+    m_off_t delivered = 0;
+
+    StreamingCache::StartFetch starter()
+    {
+        return [this](const std::shared_ptr<StreamingCache>&, int id, m_off_t pos, m_off_t len)
+        {
+            fetches.push_back(Fetch{id, pos, pos + len, true});
+        };
+    }
+
+    // delivers up to len bytes of a fetch, finishing it when the cache doesn't want more
+    void deliver(Fetch& f, m_off_t len)
+    {
+        while (f.running && len > 0 && f.pos < f.end)
+        {
+            std::string data;
+            for (m_off_t i = 0; i < std::min<m_off_t>(65536, len) && f.pos + i < f.end; i++)
+            {
+                data.push_back(byteAt(f.pos + i));
+            }
+            bool more = cache->write(f.id, data.data(), data.size());
+            f.pos += data.size();
+            len -= data.size();
+            delivered += data.size();
+            if (!more || f.pos == f.end)
+            {
+                f.running = false;
+                cache->finish(f.id, false);
+            }
+        }
+    }
+
+    int running() const
+    {
+        int n = 0;
+        for (auto& f : fetches)
+        {
+            n += f.running;
+        }
+        return n;
+    }
+};
+
+// reads [pos, pos + len) through the cache, checking the data
+m_off_t readAll(StreamingCache& cache, const void* reader, m_off_t pos, m_off_t len)
+{
+    m_off_t read = 0;
+    StreamingCache::Chunk chunk;
+    while (read < len && cache.read(reader, pos + read, 100000, chunk) && chunk.len)
+    {
+        for (size_t i = 0; i < chunk.len && read < len; i++, read++)
+        {
+            EXPECT_EQ(byteAt(pos + read), chunk.data.get()[i]);
+        }
+    }
+    return read;
+}
+
+}
+
+TEST(StreamingCache, readersOfTheSameDataShareOneFetch)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(10 * SEGMENT, 4 * SEGMENT, upstream.starter());
+
+    int notified = 0;
+    int a, b;
+    upstream.cache->addReader(&a, 0, [&notified]() { notified++; });
+    upstream.cache->addReader(&b, 0, [&notified]() { notified++; });
+    ASSERT_EQ(1u, upstream.fetches.size());
+    ASSERT_EQ(0, upstream.fetches[0].pos);
+
+    upstream.deliver(upstream.fetches[0], 3 * SEGMENT);
+    ASSERT_GT(notified, 0);
+    ASSERT_EQ(3 * SEGMENT, readAll(*upstream.cache, &a, 0, 3 * SEGMENT));
+    ASSERT_EQ(3 * SEGMENT, readAll(*upstream.cache, &b, 0, 3 * SEGMENT));
+
+    // reading the rest downloads it once more, not twice
+    for (m_off_t pos = 3 * SEGMENT; pos < 10 * SEGMENT; pos += SEGMENT)
+    {
+        for (auto& f : upstream.fetches)
+        {
+            upstream.deliver(f, SEGMENT);
+        }
+        ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &a, pos, SEGMENT));
+        ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &b, pos, SEGMENT));
+    }
+
+    ASSERT_EQ(10 * SEGMENT, upstream.delivered);
+    ASSERT_EQ(0, upstream.running());
+}
+
+TEST(StreamingCache, fetchStopsAheadOfTheFurthestReader)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(100 * SEGMENT, 4 * SEGMENT, upstream.starter());
+
+    int reader;
+    upstream.cache->addReader(&reader, 0, []() {});
+    ASSERT_EQ(1u, upstream.fetches.size());
+
+    // the fetch doesn't go further than the read-ahead
+    upstream.deliver(upstream.fetches[0], 50 * SEGMENT);
+    ASSERT_FALSE(upstream.fetches[0].running);
+    ASSERT_EQ(4 * SEGMENT, upstream.fetches[0].pos);
+
+    // nor is it restarted until the reader gets closer
+    ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &reader, 0, SEGMENT));
+    ASSERT_EQ(1u, upstream.fetches.size());
+    ASSERT_EQ(2 * SEGMENT, readAll(*upstream.cache, &reader, SEGMENT, 2 * SEGMENT));
+    ASSERT_EQ(2u, upstream.fetches.size());
+    ASSERT_EQ(4 * SEGMENT, upstream.fetches[1].pos);
+}
+
+TEST(StreamingCache, distantReadersGetTheirOwnFetch)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(100 * SEGMENT, 4 * SEGMENT, upstream.starter());
+
+    int a, b;
+    upstream.cache->addReader(&a, 0, []() {});
+    upstream.cache->addReader(&b, 50 * SEGMENT + 10, []() {});
+    ASSERT_EQ(2u, upstream.fetches.size());
+    ASSERT_EQ(50 * SEGMENT, upstream.fetches[1].pos);
+
+    upstream.deliver(upstream.fetches[0], SEGMENT);
+    upstream.deliver(upstream.fetches[1], SEGMENT);
+    ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &a, 0, SEGMENT));
+    ASSERT_EQ(SEGMENT - 10, readAll(*upstream.cache, &b, 50 * SEGMENT + 10, SEGMENT - 10));
+}
+
+TEST(StreamingCache, readersGetTheTagsOfTheirFetches)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(100 * SEGMENT, 4 * SEGMENT, upstream.starter());
+
+    int a, b;
+    int tagA = 0, tagB = 0;
+    upstream.cache->addReader(&a, 0, []() {}, [&tagA](int tag) { tagA = tag; });
+    upstream.cache->addReader(&b, 50 * SEGMENT, []() {}, [&tagB](int tag) { tagB = tag; });
+    upstream.cache->started(upstream.fetches[0].id, 7);
+    upstream.cache->started(upstream.fetches[1].id, 8);
+    ASSERT_EQ(7, tagA);
+    ASSERT_EQ(8, tagB);
+
+    upstream.cache->removeReader(&b);
+    upstream.cache->started(upstream.fetches[1].id, 9);
+    ASSERT_EQ(8, tagB);
+}
+
+TEST(StreamingCache, segmentsOutliveEvictionWhileInUse)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(100 * SEGMENT, SEGMENT, upstream.starter());
+
+    int reader;
+    upstream.cache->addReader(&reader, 0, []() {});
+    upstream.deliver(upstream.fetches[0], SEGMENT);
+
+    StreamingCache::Chunk first;
+    ASSERT_TRUE(upstream.cache->read(&reader, 0, 1000, first));
+    ASSERT_EQ(1000u, first.len);
+
+    // the reader moves on, the cache stays within its limit
+    for (m_off_t pos = SEGMENT; pos < 50 * SEGMENT; pos += SEGMENT)
+    {
+        StreamingCache::Chunk chunk;
+        ASSERT_TRUE(upstream.cache->read(&reader, pos, 1, chunk));
+        for (auto& f : upstream.fetches)
+        {
+            upstream.deliver(f, SEGMENT);
+        }
+    }
+    ASSERT_LE(upstream.cache->cachedSize(), 8 * SEGMENT);
+
+    for (size_t i = 0; i < first.len; i++)
+    {
+        ASSERT_EQ(byteAt(i), first.data.get()[i]);
+    }
+}
+
+TEST(StreamingCache, retriesFailedDownloadsBeforeFailingTheirReaders)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(10 * SEGMENT, SEGMENT, upstream.starter());
+
+    int notified = 0;
+    int reader, distantReader;
+    upstream.cache->addReader(&reader, 0, [&notified]() { notified++; });
+    upstream.cache->addReader(&distantReader, 6 * SEGMENT, []() {});
+    ASSERT_EQ(2u, upstream.fetches.size());
+
+    StreamingCache::Chunk chunk;
+    for (int attempt = 1; attempt < StreamingCache::MAX_FETCH_ATTEMPTS; attempt++)
+    {
+        upstream.cache->finish(upstream.fetches[0].id, true);
+        upstream.fetches.erase(upstream.fetches.begin());
+        ASSERT_EQ(attempt, notified);
+
+        // the reader asks again, which downloads the data again
+        ASSERT_TRUE(upstream.cache->read(&reader, 0, 1000, chunk));
+        ASSERT_EQ(0u, chunk.len);
+        ASSERT_FALSE(upstream.cache->failed());
+        ASSERT_EQ(2u, upstream.fetches.size());
+        ASSERT_EQ(0, upstream.fetches.back().pos);
+        std::swap(upstream.fetches.front(), upstream.fetches.back());
+    }
+
+    upstream.cache->finish(upstream.fetches[0].id, true);
+    ASSERT_FALSE(upstream.cache->read(&reader, 0, 1000, chunk));
+    ASSERT_TRUE(upstream.cache->failed());
+
+    // the reader of other data isn't affected
+    upstream.deliver(upstream.fetches[1], SEGMENT);
+    ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &distantReader, 6 * SEGMENT, SEGMENT));
+
+    // no notifications after removing the reader
+    int notifiedBefore = notified;
+    upstream.cache->removeReader(&reader);
+    upstream.cache->finish(upstream.fetches[1].id, true);
+    ASSERT_EQ(notifiedBefore, notified);
+}
+
+TEST(StreamingCache, dataArrivingAfterAFailureClearsIt)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(10 * SEGMENT, SEGMENT, upstream.starter());
+
+    int reader;
+    upstream.cache->addReader(&reader, 0, []() {});
+    upstream.deliver(upstream.fetches[0], SEGMENT / 4);
+    upstream.cache->finish(upstream.fetches[0].id, true);
+    upstream.fetches[0].running = false;
+
+    StreamingCache::Chunk chunk;
+    ASSERT_TRUE(upstream.cache->read(&reader, SEGMENT / 4, 1000, chunk));
+    ASSERT_EQ(2u, upstream.fetches.size());
+    ASSERT_EQ(SEGMENT / 4, upstream.fetches[1].pos);
+    upstream.deliver(upstream.fetches[1], SEGMENT);
+    ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &reader, 0, SEGMENT));
+    ASSERT_FALSE(upstream.cache->failed());
+}
+
+TEST(StreamingCache, fasterReadersGetMoreReadAhead)
+{
+    Upstream upstream;
+    upstream.cache = std::make_shared<StreamingCache>(100 * SEGMENT, 2 * SEGMENT, upstream.starter());
+
+    int reader;
+    upstream.cache->addReader(&reader, 0, []() {});
+    upstream.cache->setReadAhead(&reader, 6 * SEGMENT);
+    upstream.deliver(upstream.fetches[0], 50 * SEGMENT);
+    ASSERT_EQ(6 * SEGMENT, upstream.fetches[0].pos);
+
+    // never more than half the cache
+    upstream.cache->setReadAhead(&reader, 1000 * SEGMENT);
+    ASSERT_EQ(SEGMENT, readAll(*upstream.cache, &reader, 0, SEGMENT));
+    StreamingCache::Chunk chunk;
+    upstream.cache->read(&reader, 6 * SEGMENT, 1, chunk);
+    ASSERT_EQ(2u, upstream.fetches.size());
+    upstream.deliver(upstream.fetches[1], 50 * SEGMENT);
+    ASSERT_EQ(14 * SEGMENT, upstream.fetches[1].pos);
+}
@@ -1085,6 +1085,49 @@ TEST(Sync, assignFilesystemIds_whenFileTypeIsUnexpected_hittingAssert)
 #endif
 */
 
+TEST(Sync, LocalNodeChildMap_keepsChildrenSortedByName)
+{
+    const auto a = LocalPath::fromPlatformEncoded("a");
+    const auto b = LocalPath::fromPlatformEncoded("b");
+    const auto c = LocalPath::fromPlatformEncoded("c");
+
+    // the map never dereferences its values
+    char slots[3];
+    auto node = [&slots](int i) { return reinterpret_cast<mega::LocalNode*>(&slots[i]); };
+
+    mega::localnode_map children;
+    children[&c] = node(2);
+    children[&a] = node(0);
+    children[&b] = node(1);
+
+    ASSERT_EQ(3u, children.size());
+    std::vector<const LocalPath*> keys;
+    for (const auto& child : children)
+    {
+        keys.push_back(child.first);
+    }
+    ASSERT_EQ((std::vector<const LocalPath*>{&a, &b, &c}), keys);
+
+    const auto lookup = LocalPath::fromPlatformEncoded("b");
+    ASSERT_NE(children.end(), children.find(&lookup));
+    ASSERT_EQ(node(1), children.find(&lookup)->second);
+
+    // replacing an entry keeps a single slot and points the key at the new name
+    children[&lookup] = node(1);
+    ASSERT_EQ(3u, children.size());
+    ASSERT_EQ(&lookup, children.find(&b)->first);
+
+    ASSERT_EQ(1u, children.erase(&b));
+    ASSERT_EQ(0u, children.erase(&b));
+    ASSERT_EQ(2u, children.size());
+    ASSERT_EQ(children.end(), children.find(&b));
+    ASSERT_EQ(node(0), children.begin()->second);
+    ASSERT_EQ(node(2), children.find(&c)->second);
+
+    children.clear();
+    ASSERT_TRUE(children.empty());
+}
+
 namespace
 {
 
@@ -1287,6 +1330,12 @@ public:
     {
         mData->clear();
     }
+    void begin() override
+    {
+    }
+    void commit() override
+    {
+    }
 
     std::vector<std::pair<uint32_t, std::string>>* mData = nullptr;
 
@@ -1354,4 +1403,37 @@ TEST(Sync, SyncConfigBag_withPreviousState)
     const std::vector<mega::SyncConfig> expConfigs{config1, config2};
     //ASSERT_EQ(expConfigs, bag2.all());
 }
+
+TEST(Sync, stateCacheRemainderIsWrittenWhenTheSyncIsDestroyed)
+{
+    Fixture fx{"d"};
+    std::vector<std::pair<uint32_t, std::string>> records;
+    const auto count = uint32_t(mega::Sync::CACHENODES_BATCH_SIZE + 5);
+    for (uint32_t id = 1; id <= count; ++id)
+    {
+        fx.mSync->deleteq.insert(id);
+    }
+    for (uint32_t id = count - 4; id <= count; ++id)
+    {
+        records.emplace_back(id, "x"); // the records beyond the first batch
+    }
+    auto table = new MockDbTable{fx.mClient->rng, true};
+    table->mData = &records;
+    fx.mSync->statecachetable = table;
+    fx.mSync->state = mega::SYNC_ACTIVE;
+
+    // one batch per call
+    fx.mSync->cachenodes();
+    ASSERT_TRUE(fx.mSync->mCacheFlushPending);
+    ASSERT_EQ(5u, records.size());
+
+    // a disabled sync isn't flushed anymore...
+    fx.mSync->state = mega::SYNC_DISABLED;
+    fx.mSync->cachenodes();
+    ASSERT_EQ(5u, records.size());
+
+    // ...until it's destroyed, when the rest is written at once
+    fx.mSync.reset();
+    ASSERT_TRUE(records.empty());
+}
 #endif
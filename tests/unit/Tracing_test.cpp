@@ -0,0 +1,81 @@
+/**
+ * (c) 2020 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/tracing.h>
+
+TEST(Tracing, nothingRecordedWhileDisabled)
+{
+    mega::RequestTracer tracer;
+    ASSERT_EQ(0u, tracer.newId());
+
+    auto now = std::chrono::steady_clock::now();
+    tracer.span("cs", "f", 1, now, now);
+    tracer.instant("cs", "retry", 1);
+    ASSERT_EQ(std::string::npos, tracer.chromeTraceJson().find("\"name\""));
+}
+
+TEST(Tracing, callbackAndChromeJson)
+{
+    mega::RequestTracer tracer;
+    tracer.setEnabled(true);
+
+    std::vector<mega::TraceEvent> received;
+    tracer.setCallback([&received](const mega::TraceEvent& e) { received.push_back(e); });
+
+    uint64_t id = tracer.newId();
+    ASSERT_NE(0u, id);
+    ASSERT_NE(id, tracer.newId());
+
+    auto start = std::chrono::steady_clock::now();
+    tracer.span("cs", "putnodes", id, start, start + std::chrono::milliseconds(5), "\"batch\":2");
+    tracer.instant("cs", "retry", id);
+
+    ASSERT_EQ(2u, received.size());
+    ASSERT_EQ("putnodes", received[0].name);
+    ASSERT_EQ(5000, received[0].duration);
+    ASSERT_FALSE(received[0].instant);
+    ASSERT_TRUE(received[1].instant);
+
+    std::string json = tracer.chromeTraceJson();
+    ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"putnodes\",\"cat\":\"cs\",\"ph\":\"b\""));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"putnodes\",\"cat\":\"cs\",\"ph\":\"e\""));
+    ASSERT_NE(std::string::npos, json.find("\"args\":{\"batch\":2}"));
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"retry\",\"cat\":\"cs\",\"ph\":\"n\""));
+
+    tracer.clear();
+    ASSERT_EQ(std::string::npos, tracer.chromeTraceJson().find("\"name\""));
+}
+
+TEST(Tracing, keepsOnlyTheMostRecentEvents)
+{
+    mega::RequestTracer tracer;
+    tracer.setEnabled(true);
+    tracer.setCapacity(2);
+
+    tracer.instant("transfer", "first", 1);
+    tracer.instant("transfer", "second", 1);
+    tracer.instant("transfer", "third", 1);
+
+    std::string json = tracer.chromeTraceJson();
+    ASSERT_EQ(std::string::npos, json.find("\"first\""));
+    ASSERT_NE(std::string::npos, json.find("\"second\""));
+    ASSERT_NE(std::string::npos, json.find("\"third\""));
+}
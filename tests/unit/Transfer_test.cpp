@@ -16,6 +16,8 @@
  * program.
  */
 
+#include <fstream>
+
 #include <gtest/gtest.h>
 
 #include <mega/megaclient.h>
@@ -152,3 +154,88 @@ TEST(Transfer, unserialize_32bit)
     checkTransfers(tf, *newTf);
 }
 #endif
+
+TEST(Transfer, RecentDownloads_findsLatestPathAndEvictsOldest)
+{
+    ::mega::FSACCESS_CLASS fsaccess;
+    mega::RecentDownloads downloads;
+
+    auto fingerprint = [](int i) -> mega::FileFingerprint
+    {
+        mega::FileFingerprint fp;
+        fp.size = 100 + i;
+        fp.mtime = 1000;
+        fp.crc.fill(i);
+        fp.isvalid = true;
+        return fp;
+    };
+
+    const auto foo = ::mega::LocalPath::fromPath("foo", fsaccess);
+    const auto bar = ::mega::LocalPath::fromPath("bar", fsaccess);
+
+    downloads.add(fingerprint(0), foo);
+    ASSERT_NE(nullptr, downloads.find(fingerprint(0)));
+    ASSERT_EQ(foo, *downloads.find(fingerprint(0)));
+    ASSERT_EQ(nullptr, downloads.find(fingerprint(1)));
+
+    downloads.add(fingerprint(0), bar);
+    ASSERT_EQ(bar, *downloads.find(fingerprint(0)));
+
+    mega::FileFingerprint invalid = fingerprint(1);
+    invalid.isvalid = false;
+    downloads.add(invalid, foo);
+    ASSERT_EQ(nullptr, downloads.find(fingerprint(1)));
+
+    for (int i = 1; i <= static_cast<int>(mega::RecentDownloads::MAX_ENTRIES); ++i)
+    {
+        downloads.add(fingerprint(i), foo);
+    }
+    ASSERT_EQ(nullptr, downloads.find(fingerprint(0)));
+    ASSERT_NE(nullptr, downloads.find(fingerprint(1)));
+
+    downloads.clear();
+    ASSERT_EQ(nullptr, downloads.find(fingerprint(1)));
+}
+
+TEST(Transfer, copylocalreplica_copiesAVerifiedIdenticalFileOnce)
+{
+    mega::MegaApp app;
+    ::mega::FSACCESS_CLASS fsaccess;
+    auto client = mt::makeClient(app, fsaccess);
+
+    const std::string content(100000, 'x');
+    {
+        std::ofstream source("replica_source", std::ios::binary);
+        source << content;
+    }
+    auto sourcePath = ::mega::LocalPath::fromPath("replica_source", fsaccess);
+
+    mega::Transfer tf{client.get(), mega::GET};
+    auto fa = fsaccess.newfileaccess(false);
+    ASSERT_TRUE(fa->fopen(sourcePath, true, false));
+    tf.genfingerprint(fa.get());
+    fa.reset();
+    ASSERT_TRUE(tf.isvalid);
+    tf.localfilename = ::mega::LocalPath::fromPath("replica_target", fsaccess);
+    client->recentdownloads.add(tf, sourcePath);
+
+    // the client has no worker threads, so the copy is made right away
+    auto copy = client->copylocalreplica(&tf);
+    ASSERT_NE(nullptr, copy);
+    {
+        std::lock_guard<std::mutex> g(copy->mutex);
+        ASSERT_TRUE(copy->done);
+        ASSERT_TRUE(copy->copied);
+    }
+    ASSERT_FALSE(copy->path == tf.localfilename);
+
+    std::ifstream target(copy->path.toPath(fsaccess), std::ios::binary);
+    ASSERT_EQ(content, std::string(std::istreambuf_iterator<char>(target), {}));
+    target.close();
+
+    // a transfer only looks for a local copy once
+    ASSERT_EQ(nullptr, client->copylocalreplica(&tf));
+
+    fsaccess.unlinklocal(copy->path);
+    fsaccess.unlinklocal(sourcePath);
+}